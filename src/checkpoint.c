@@ -0,0 +1,122 @@
+/*
+ * Machine checkpoint
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <limits.h>
+
+#include "cutils.h"
+#include "checkpoint.h"
+
+#define CHECKPOINT_MAGIC "TEMUCKPT"
+#define CHECKPOINT_VERSION 1
+
+Checkpoint *checkpoint_open(const char *filename, BOOL is_restore)
+{
+    Checkpoint *ck;
+    char magic[8];
+    uint32_t version;
+
+    ck = mallocz(sizeof(*ck));
+    ck->is_restore = is_restore;
+    /* fast compression: the RAM pages make most of the checkpoint */
+    ck->f = gzopen(filename, is_restore ? "rb" : "wb1");
+    if (!ck->f) {
+        perror(filename);
+        free(ck);
+        return NULL;
+    }
+
+    memcpy(magic, CHECKPOINT_MAGIC, sizeof(magic));
+    version = CHECKPOINT_VERSION;
+    checkpoint_data(ck, magic, sizeof(magic));
+    checkpoint_data(ck, &version, sizeof(version));
+    if (memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) ||
+        version != CHECKPOINT_VERSION) {
+        fprintf(stderr, "%s: not a checkpoint of this version\n", filename);
+        gzclose(ck->f);
+        free(ck);
+        return NULL;
+    }
+    return ck;
+}
+
+/* return -1 if an error occurred while saving or restoring */
+int checkpoint_close(Checkpoint *ck)
+{
+    int ret;
+
+    ret = ck->error ? -1 : 0;
+    if (gzclose(ck->f) != Z_OK)
+        ret = -1;
+    free(ck);
+    return ret;
+}
+
+void checkpoint_data(Checkpoint *ck, void *buf, size_t len)
+{
+    unsigned int n;
+    int ret;
+
+    while (len > 0 && !ck->error) {
+        n = len > INT_MAX ? INT_MAX : len;
+        if (ck->is_restore)
+            ret = gzread(ck->f, buf, n);
+        else
+            ret = gzwrite(ck->f, buf, n);
+        if (ret != (int)n) {
+            ck->error = TRUE;
+            break;
+        }
+        buf = (uint8_t *)buf + n;
+        len -= n;
+    }
+}
+
+/* sections are tagged so that a checkpoint restored with another
+   configuration fails early instead of being silently misread */
+void checkpoint_section(Checkpoint *ck, const char *name)
+{
+    char tag[8];
+
+    memset(tag, 0, sizeof(tag));
+    memcpy(tag, name, min_int(strlen(name), sizeof(tag)));
+    checkpoint_data(ck, tag, sizeof(tag));
+    if (strncmp(tag, name, sizeof(tag))) {
+        fprintf(stderr, "checkpoint: expected section '%s'\n", name);
+        ck->error = TRUE;
+    }
+}
+
+/* save a configuration value, or check that it has not changed */
+void checkpoint_check_u64(Checkpoint *ck, uint64_t val)
+{
+    uint64_t val1 = val;
+
+    checkpoint_data(ck, &val1, sizeof(val1));
+    if (val1 != val) {
+        fprintf(stderr, "checkpoint: saved with another configuration "
+                "(0x%" PRIx64 " instead of 0x%" PRIx64 ")\n", val1, val);
+        ck->error = TRUE;
+    }
+}
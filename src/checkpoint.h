@@ -0,0 +1,50 @@
+/*
+ * Machine checkpoint
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <zlib.h>
+
+#include "cutils.h"
+
+/* A checkpoint is a gzip compressed stream of the machine state. Each
+   device has a single function which walks its state in the same order for
+   saving and restoring: checkpoint_data() writes the buffer when saving and
+   fills it when restoring. The checkpoint only holds the state which
+   changes after the machine is initialized, so it must be restored with the
+   same configuration. */
+typedef struct Checkpoint {
+    gzFile f;
+    BOOL is_restore;
+    BOOL error; /* set on I/O error or on a mismatch with the machine */
+} Checkpoint;
+
+Checkpoint *checkpoint_open(const char *filename, BOOL is_restore);
+int checkpoint_close(Checkpoint *ck);
+void checkpoint_data(Checkpoint *ck, void *buf, size_t len);
+void checkpoint_section(Checkpoint *ck, const char *name);
+void checkpoint_check_u64(Checkpoint *ck, uint64_t val);
+
+#define checkpoint_field(ck, s, field) \
+    checkpoint_data(ck, &(s)->field, sizeof((s)->field))
+
+#endif /* CHECKPOINT_H */
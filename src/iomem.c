@@ -27,9 +27,14 @@
 #include <string.h>
 #include <inttypes.h>
 #include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "cutils.h"
 #include "iomem.h"
+#include "pim_datapath.h"
 
 static PhysMemoryRange *default_register_ram(PhysMemoryMap *s, uint64_t addr,
                                              uint64_t size, int devram_flags);
@@ -37,6 +42,7 @@ static void default_free_ram(PhysMemoryMap *s, PhysMemoryRange *pr);
 static const uint32_t *default_get_dirty_bits(PhysMemoryMap *map, PhysMemoryRange *pr);
 static void default_set_addr(PhysMemoryMap *map,
                              PhysMemoryRange *pr, uint64_t addr, BOOL enabled);
+static void pim_free(PhysMemoryRange *pr);
 
 PhysMemoryMap *phys_mem_map_init(void)
 {
@@ -58,23 +64,85 @@ void phys_mem_map_end(PhysMemoryMap *s)
         pr = &s->phys_mem_range[i];
         if (pr->is_ram) {
             s->free_ram(s, pr);
+        } else if (pr->is_pim) {
+            pim_free(pr);
         }
     }
     free(s);
 }
 
-/* return NULL if not found */
-/* XXX: optimize */
-PhysMemoryRange *get_phys_mem_range(PhysMemoryMap *s, uint64_t paddr)
+/* sort the enabled ranges by address. get_phys_mem_range() uses them when
+   the enabled ranges do not overlap, which is the case of the ranges
+   registered by the machine. Otherwise, e.g. if the guest moves a range over
+   another one, it keeps returning the first registered range containing the
+   address. */
+static void phys_mem_map_update(PhysMemoryMap *s)
 {
     PhysMemoryRange *pr;
-    int i;
+    int i, j;
+
+    s->n_sorted_range = 0;
     for(i = 0; i < s->n_phys_mem_range; i++) {
         pr = &s->phys_mem_range[i];
-        if (paddr >= pr->addr && paddr < pr->addr + pr->size)
-            return pr;
+        if (pr->size == 0)
+            continue;
+        for(j = s->n_sorted_range; j > 0 &&
+                s->sorted_range[j - 1]->addr > pr->addr; j--) {
+            s->sorted_range[j] = s->sorted_range[j - 1];
+        }
+        s->sorted_range[j] = pr;
+        s->n_sorted_range++;
+    }
+    s->has_overlap = FALSE;
+    for(i = 1; i < s->n_sorted_range; i++) {
+        if (s->sorted_range[i]->addr - s->sorted_range[i - 1]->addr <
+            s->sorted_range[i - 1]->size)
+            s->has_overlap = TRUE;
+    }
+    __atomic_store_n(&s->last_range, NULL, __ATOMIC_RELAXED);
+}
+
+/* return the first registered range containing paddr, or NULL if not
+   found. The cores running in parallel threads share the last range found,
+   which is only a hint checked before being used. */
+PhysMemoryRange *get_phys_mem_range(PhysMemoryMap *s, uint64_t paddr)
+{
+    PhysMemoryRange *pr;
+    int a, b, m, i;
+
+    if (s->has_overlap) {
+        for(i = 0; i < s->n_phys_mem_range; i++) {
+            pr = &s->phys_mem_range[i];
+            if (paddr >= pr->addr && paddr < pr->addr + pr->size)
+                return pr;
+        }
+        return NULL;
+    }
+
+    pr = __atomic_load_n(&s->last_range, __ATOMIC_RELAXED);
+    if (pr && paddr - pr->addr < pr->size)
+        return pr;
+
+    /* last range starting at or below paddr */
+    a = 0;
+    b = s->n_sorted_range - 1;
+    i = -1;
+    while (a <= b) {
+        m = (a + b) >> 1;
+        if (s->sorted_range[m]->addr <= paddr) {
+            i = m;
+            a = m + 1;
+        } else {
+            b = m - 1;
+        }
     }
-    return NULL;
+    if (i < 0)
+        return NULL;
+    pr = s->sorted_range[i];
+    if (paddr - pr->addr >= pr->size)
+        return NULL;
+    __atomic_store_n(&s->last_range, pr, __ATOMIC_RELAXED);
+    return pr;
 }
 
 PhysMemoryRange *register_ram_entry(PhysMemoryMap *s, uint64_t addr,
@@ -97,6 +165,7 @@ PhysMemoryRange *register_ram_entry(PhysMemoryMap *s, uint64_t addr,
         pr->size = pr->org_size;
     pr->phys_mem = NULL;
     pr->dirty_bits = NULL;
+    phys_mem_map_update(s);
     return pr;
 }
 
@@ -182,9 +251,17 @@ static void default_free_ram(PhysMemoryMap *s, PhysMemoryRange *pr)
     free(pr->phys_mem);
 }
 
-PhysMemoryRange *cpu_register_pim(PhysMemoryMap *s, uint64_t addr, uint64_t size, uint64_t offset)
+/* The PIM area is too large to be allocated up front (up to 64GB), so only
+   the pages which are written are allocated, and the other pages read as
+   zero. If a file is given, it is mapped (copy on write) at the start of the
+   area, e.g. to preload the weights. */
+PhysMemoryRange *cpu_register_pim(PhysMemoryMap *s, uint64_t addr, uint64_t size, uint64_t offset,
+                                  const char *filename)
 {
     PhysMemoryRange *pr;
+    struct stat st;
+    int fd;
+
     assert(s->n_phys_mem_range < PHYS_MEM_RANGE_MAX);
     assert(size <= 0x1000000000);
     pr = &s->phys_mem_range[s->n_phys_mem_range++];
@@ -194,15 +271,132 @@ PhysMemoryRange *cpu_register_pim(PhysMemoryMap *s, uint64_t addr, uint64_t size
     pr->org_size = offset;
     pr->is_ram = FALSE;
     pr->is_pim = TRUE;
+    pr->phys_mem = NULL;
 
-    pr->phys_mem = mallocz(size);
-    if (!pr->phys_mem) {
-        fprintf(stderr, "Could not allocate VM memory\n");
+    pr->pim_nb_chunks = (size + (1 << PIM_CHUNK_SIZE_LOG2) - 1) >> PIM_CHUNK_SIZE_LOG2;
+    pr->pim_chunks = mallocz(pr->pim_nb_chunks * sizeof(PIMChunk *));
+    pr->pim_resident_pages = 0;
+    pr->pim_file_mem = NULL;
+    pr->pim_file_size = 0;
+    pr->pim_file_dirty_bits = NULL;
+    if (!pr->pim_chunks) {
+        fprintf(stderr, "Could not allocate PIM memory\n");
         exit(1);
     }
+
+    if (filename) {
+        fd = open(filename, O_RDONLY);
+        if (fd < 0 || fstat(fd, &st) < 0) {
+            perror(filename);
+            exit(1);
+        }
+        if ((uint64_t)st.st_size > size) {
+            fprintf(stderr, "%s: larger than the PIM area\n", filename);
+            exit(1);
+        }
+        if (st.st_size > 0) {
+            pr->pim_file_mem = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE,
+                                    MAP_PRIVATE, fd, 0);
+            if (pr->pim_file_mem == MAP_FAILED) {
+                perror(filename);
+                exit(1);
+            }
+            /* the page holding the end of file is mapped entirely */
+            pr->pim_file_size = (st.st_size + DEVRAM_PAGE_SIZE - 1) &
+                ~(size_t)(DEVRAM_PAGE_SIZE - 1);
+            pr->pim_file_dirty_bits =
+                mallocz(((pr->pim_file_size >> DEVRAM_PAGE_SIZE_LOG2) + 31) /
+                        32 * sizeof(uint32_t));
+        }
+        close(fd);
+    }
+    pr->pim_dp = pim_datapath_init(pr);
+    phys_mem_map_update(s);
     return pr;
 }
 
+/* return a pointer to the PIM memory at 'offset' inside 'pr'. The access
+   can only be done in the page. If the page was never written, it is
+   allocated if 'is_rw' is set, otherwise NULL is returned and the memory
+   reads as zero. */
+uint8_t *phys_mem_get_pim_ptr(PhysMemoryRange *pr, uint64_t offset, BOOL is_rw)
+{
+    PIMChunk *chunk;
+    uint8_t **page;
+
+    size_t page_index;
+
+    if (offset < pr->pim_file_size) {
+        if (is_rw) {
+            page_index = offset >> DEVRAM_PAGE_SIZE_LOG2;
+            pr->pim_file_dirty_bits[page_index >> 5] |=
+                1 << (page_index & 0x1f);
+        }
+        return pr->pim_file_mem + offset;
+    }
+
+    chunk = pr->pim_chunks[offset >> PIM_CHUNK_SIZE_LOG2];
+    if (!chunk) {
+        if (!is_rw)
+            return NULL;
+        chunk = mallocz(sizeof(PIMChunk));
+        if (!chunk) {
+            fprintf(stderr, "Could not allocate PIM memory\n");
+            exit(1);
+        }
+        pr->pim_chunks[offset >> PIM_CHUNK_SIZE_LOG2] = chunk;
+    }
+
+    page = &chunk->page[(offset >> DEVRAM_PAGE_SIZE_LOG2) & (PIM_PAGES_PER_CHUNK - 1)];
+    if (!*page) {
+        if (!is_rw)
+            return NULL;
+        *page = mallocz(DEVRAM_PAGE_SIZE);
+        if (!*page) {
+            fprintf(stderr, "Could not allocate PIM memory\n");
+            exit(1);
+        }
+        pr->pim_resident_pages++;
+    }
+    return *page + (offset & (DEVRAM_PAGE_SIZE - 1));
+}
+
+static void pim_free(PhysMemoryRange *pr)
+{
+    size_t i, nb_chunks;
+    int j;
+
+    nb_chunks = 0;
+    for(i = 0; i < pr->pim_nb_chunks; i++) {
+        if (!pr->pim_chunks[i])
+            continue;
+        nb_chunks++;
+        for(j = 0; j < PIM_PAGES_PER_CHUNK; j++) {
+            free(pr->pim_chunks[i]->page[j]);
+        }
+        free(pr->pim_chunks[i]);
+    }
+
+    fprintf(stderr, "PIM memory: %zu of %zu pages resident (%zu KB), "
+            "%zu KB page tables, %zu KB file mapped\n",
+            pr->pim_resident_pages, (size_t)(pr->size >> DEVRAM_PAGE_SIZE_LOG2),
+            (pr->pim_resident_pages * DEVRAM_PAGE_SIZE) >> 10,
+            (pr->pim_nb_chunks * sizeof(PIMChunk *)
+             + nb_chunks * sizeof(PIMChunk)) >> 10,
+            pr->pim_file_size >> 10);
+
+    pim_datapath_free(pr->pim_dp);
+    pr->pim_dp = NULL;
+    free(pr->pim_chunks);
+    pr->pim_chunks = NULL;
+    if (pr->pim_file_mem) {
+        munmap(pr->pim_file_mem, pr->pim_file_size);
+        pr->pim_file_mem = NULL;
+        free(pr->pim_file_dirty_bits);
+        pr->pim_file_dirty_bits = NULL;
+    }
+}
+
 PhysMemoryRange *cpu_register_device(PhysMemoryMap *s, uint64_t addr,
                                      uint64_t size, void *opaque,
                                      DeviceReadFunc *read_func, DeviceWriteFunc *write_func,
@@ -225,6 +419,7 @@ PhysMemoryRange *cpu_register_device(PhysMemoryMap *s, uint64_t addr,
     pr->read_func = read_func;
     pr->write_func = write_func;
     pr->devio_flags = devio_flags;
+    phys_mem_map_update(s);
     return pr;
 }
 
@@ -260,8 +455,9 @@ void phys_mem_set_addr(PhysMemoryRange *pr, uint64_t addr, BOOL enabled)
     if (!pr->is_ram) {
         default_set_addr(map, pr, addr, enabled);
     } else {
-        return map->set_ram_addr(map, pr, addr, enabled);
+        map->set_ram_addr(map, pr, addr, enabled);
     }
+    phys_mem_map_update(map);
 }
 
 /* return NULL if no valid RAM page. The access can only be done in the page */
@@ -277,6 +473,117 @@ uint8_t *phys_mem_get_ram_ptr(PhysMemoryMap *map, uint64_t paddr, BOOL is_rw)
     return pr->phys_mem + (uintptr_t)offset;
 }
 
+/* Checkpoint: only the pages which may differ from a freshly initialized
+   machine are saved, i.e. the dirty pages of the RAM ranges which track them,
+   every page of the others and the pages of the PIM area written since
+   boot. Each page is preceded by its offset in the range, and the list ends
+   with PAGE_LIST_END. */
+
+#define PAGE_LIST_END UINT64_MAX
+
+static void checkpoint_page(Checkpoint *ck, uint64_t offset, uint8_t *ptr)
+{
+    checkpoint_data(ck, &offset, sizeof(offset));
+    checkpoint_data(ck, ptr, DEVRAM_PAGE_SIZE);
+}
+
+static void checkpoint_page_list_end(Checkpoint *ck)
+{
+    uint64_t offset = PAGE_LIST_END;
+    checkpoint_data(ck, &offset, sizeof(offset));
+}
+
+/* return the offset of the next page to restore, or PAGE_LIST_END */
+static uint64_t checkpoint_next_page(Checkpoint *ck, uint64_t size)
+{
+    uint64_t offset;
+
+    checkpoint_data(ck, &offset, sizeof(offset));
+    if (ck->error)
+        return PAGE_LIST_END;
+    if (offset != PAGE_LIST_END &&
+        (offset >= size || (offset & (DEVRAM_PAGE_SIZE - 1)) != 0)) {
+        ck->error = TRUE;
+        return PAGE_LIST_END;
+    }
+    return offset;
+}
+
+static void ram_checkpoint(PhysMemoryRange *pr, Checkpoint *ck)
+{
+    uint64_t offset;
+
+    if (ck->is_restore) {
+        while ((offset = checkpoint_next_page(ck, pr->org_size)) !=
+               PAGE_LIST_END) {
+            checkpoint_data(ck, pr->phys_mem + offset, DEVRAM_PAGE_SIZE);
+            phys_mem_set_dirty_bit(pr, offset);
+        }
+    } else {
+        for(offset = 0; offset < pr->org_size; offset += DEVRAM_PAGE_SIZE) {
+            if (phys_mem_is_dirty_bit(pr, offset))
+                checkpoint_page(ck, offset, pr->phys_mem + offset);
+        }
+        checkpoint_page_list_end(ck);
+    }
+}
+
+static void pim_checkpoint(PhysMemoryRange *pr, Checkpoint *ck)
+{
+    uint64_t offset, page_index;
+    size_t i;
+    int j;
+
+    checkpoint_check_u64(ck, pr->pim_file_size);
+    if (ck->is_restore) {
+        while ((offset = checkpoint_next_page(ck, pr->size)) !=
+               PAGE_LIST_END) {
+            checkpoint_data(ck, phys_mem_get_pim_ptr(pr, offset, TRUE),
+                            DEVRAM_PAGE_SIZE);
+        }
+    } else {
+        for(offset = 0; offset < pr->pim_file_size;
+            offset += DEVRAM_PAGE_SIZE) {
+            page_index = offset >> DEVRAM_PAGE_SIZE_LOG2;
+            if ((pr->pim_file_dirty_bits[page_index >> 5] >>
+                 (page_index & 0x1f)) & 1)
+                checkpoint_page(ck, offset, pr->pim_file_mem + offset);
+        }
+        for(i = 0; i < pr->pim_nb_chunks; i++) {
+            if (!pr->pim_chunks[i])
+                continue;
+            for(j = 0; j < PIM_PAGES_PER_CHUNK; j++) {
+                offset = ((uint64_t)i << PIM_CHUNK_SIZE_LOG2) +
+                    ((uint64_t)j << DEVRAM_PAGE_SIZE_LOG2);
+                if (pr->pim_chunks[i]->page[j] && offset >= pr->pim_file_size)
+                    checkpoint_page(ck, offset, pr->pim_chunks[i]->page[j]);
+            }
+        }
+        checkpoint_page_list_end(ck);
+    }
+    pim_datapath_checkpoint(pr->pim_dp, ck);
+}
+
+void phys_mem_checkpoint(PhysMemoryMap *s, Checkpoint *ck)
+{
+    PhysMemoryRange *pr;
+    int i;
+
+    checkpoint_section(ck, "memory");
+    checkpoint_check_u64(ck, s->n_phys_mem_range);
+    for(i = 0; i < s->n_phys_mem_range && !ck->error; i++) {
+        pr = &s->phys_mem_range[i];
+        if (!pr->is_ram && !pr->is_pim)
+            continue;
+        checkpoint_check_u64(ck, pr->addr);
+        checkpoint_check_u64(ck, pr->org_size);
+        if (pr->is_pim)
+            pim_checkpoint(pr, ck);
+        else
+            ram_checkpoint(pr, ck);
+    }
+}
+
 /* IRQ support */
 
 void irq_init(IRQSignal *irq, SetIRQFunc *set_irq, void *opaque, int irq_num)
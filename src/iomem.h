@@ -24,6 +24,8 @@
 #ifndef IOMEM_H
 #define IOMEM_H
 
+#include "checkpoint.h"
+
 typedef void DeviceWriteFunc(void *opaque, uint32_t offset,
                              uint32_t val, int size_log2);
 typedef uint32_t DeviceReadFunc(void *opaque, uint32_t offset, int size_log2);
@@ -41,6 +43,17 @@ typedef uint32_t DeviceReadFunc(void *opaque, uint32_t offset, int size_log2);
 #define DEVRAM_PAGE_SIZE_LOG2 12
 #define DEVRAM_PAGE_SIZE (1 << DEVRAM_PAGE_SIZE_LOG2)
 
+/* PIM memory is allocated in DEVRAM_PAGE_SIZE pages on first write, and
+   the pages are looked up through a table of 2MB chunks */
+#define PIM_CHUNK_SIZE_LOG2 21
+#define PIM_PAGES_PER_CHUNK (1 << (PIM_CHUNK_SIZE_LOG2 - DEVRAM_PAGE_SIZE_LOG2))
+
+typedef struct {
+    uint8_t *page[PIM_PAGES_PER_CHUNK]; /* NULL if not written yet */
+} PIMChunk;
+
+typedef struct PIMDatapath PIMDatapath;
+
 typedef struct PhysMemoryMap PhysMemoryMap;
 
 typedef struct {
@@ -63,6 +76,13 @@ typedef struct {
     int devio_flags;
     /* the following is used for PIM request */
     BOOL is_pim;
+    PIMChunk **pim_chunks;
+    size_t pim_nb_chunks;
+    size_t pim_resident_pages;
+    uint8_t *pim_file_mem; /* file mapped at the start of the area, or NULL */
+    size_t pim_file_size;
+    uint32_t *pim_file_dirty_bits; /* pages of the file written since boot */
+    PIMDatapath *pim_dp; /* functional model of the AiM commands */
 } PhysMemoryRange;
 
 #define PHYS_MEM_RANGE_MAX 32
@@ -70,6 +90,12 @@ typedef struct {
 struct PhysMemoryMap {
     int n_phys_mem_range;
     PhysMemoryRange phys_mem_range[PHYS_MEM_RANGE_MAX];
+    /* enabled ranges sorted by address for get_phys_mem_range(), updated
+       when a range is registered or moved */
+    int n_sorted_range;
+    PhysMemoryRange *sorted_range[PHYS_MEM_RANGE_MAX];
+    BOOL has_overlap; /* some enabled ranges overlap */
+    PhysMemoryRange *last_range; /* last range found, or NULL */
     PhysMemoryRange *(*register_ram)(PhysMemoryMap *s, uint64_t addr,
                                      uint64_t size, int devram_flags);
     void (*free_ram)(PhysMemoryMap *s, PhysMemoryRange *pr);
@@ -91,7 +117,9 @@ static inline PhysMemoryRange *cpu_register_ram(PhysMemoryMap *s, uint64_t addr,
 {
     return s->register_ram(s, addr, size, devram_flags);
 }
-PhysMemoryRange *cpu_register_pim(PhysMemoryMap *s, uint64_t addr, uint64_t size, uint64_t offset);
+PhysMemoryRange *cpu_register_pim(PhysMemoryMap *s, uint64_t addr, uint64_t size, uint64_t offset,
+                                  const char *filename);
+uint8_t *phys_mem_get_pim_ptr(PhysMemoryRange *pr, uint64_t offset, BOOL is_rw);
 PhysMemoryRange *cpu_register_device(PhysMemoryMap *s, uint64_t addr,
                                      uint64_t size, void *opaque,
                                      DeviceReadFunc *read_func, DeviceWriteFunc *write_func,
@@ -130,6 +158,7 @@ static inline BOOL phys_mem_is_dirty_bit(PhysMemoryRange *pr, size_t offset)
 
 void phys_mem_reset_dirty_bit(PhysMemoryRange *pr, size_t offset);
 uint8_t *phys_mem_get_ram_ptr(PhysMemoryMap *map, uint64_t paddr, BOOL is_rw);
+void phys_mem_checkpoint(PhysMemoryMap *s, Checkpoint *ck);
 
 /* IRQ support */
 
@@ -44,6 +44,7 @@
 #include "iomem.h"
 #include "virtio.h"
 #include "machine.h"
+#include "pim_datapath.h"
 #include "fs_utils.h"
 #ifdef CONFIG_FS_NET
 #include "fs_wget.h"
@@ -227,6 +228,29 @@ static int virt_machine_parse_config(VirtMachineParams *p,
     if (str) {
         p->cmdline = cmdline_subst(str);
     }
+
+    tag_name = "pim_file";
+    if (vm_get_str_opt(cfg, tag_name, &str) < 0)
+        goto tag_fail;
+    if (str) {
+        p->pim_file = strdup(str);
+        sim_log_event(sim_log, "%s: %s", "pim_file", p->pim_file);
+    }
+
+    tag_name = "pim_data_type";
+    if (vm_get_str_opt(cfg, tag_name, &str) < 0)
+        goto tag_fail;
+    if (str) {
+        if (!strcmp(str, "fp16")) {
+            p->pim_data_type = PIM_DATA_FP16;
+        } else if (!strcmp(str, "bf16")) {
+            p->pim_data_type = PIM_DATA_BF16;
+        } else {
+            vm_error("Unknown PIM data type: %s\n", str);
+            goto tag_fail;
+        }
+        sim_log_event(sim_log, "%s: %s", "pim_data_type", str);
+    }
     
     for(;;) {
         snprintf(buf1, sizeof(buf1), "drive%d", p->drive_count);
@@ -548,6 +572,7 @@ void virt_machine_free_config(VirtMachineParams *p)
     
     free(p->machine_name);
     free(p->cmdline);
+    free(p->pim_file);
     for(i = 0; i < VM_FILE_COUNT; i++) {
         free(p->files[i].filename);
         free(p->files[i].buf);
@@ -566,6 +591,8 @@ void virt_machine_free_config(VirtMachineParams *p)
     }
     free(p->input_device);
     free(p->display_device);
+    free(p->checkpoint_file);
+    free(p->restore_file);
     free(p->cfg_filename);
 }
 
@@ -102,8 +102,12 @@ typedef struct {
     int eth_count;
 
     char *cmdline; /* bios or kernel command line */
+    char *pim_file; /* mapped at the start of the PIM area, NULL if none */
+    int pim_data_type; /* PIM_DATA_FP16 or PIM_DATA_BF16 */
     BOOL accel_enable; /* enable acceleration (KVM) */
     char *input_device; /* NULL means no input */
+    char *checkpoint_file; /* saved when the simulation first starts */
+    char *restore_file; /* restored before running */
     
     /* kernel, bios and other auxiliary files */
     VMFileEntry files[VM_FILE_COUNT];
@@ -0,0 +1,365 @@
+/*
+ * Functional model of the AiM PIM datapath
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+
+#include "cutils.h"
+#include "iomem.h"
+#include "pim_datapath.h"
+
+typedef union {
+    uint32_t i;
+    float f;
+} PIMFloat32;
+
+static const uint16_t pim_zero_word[PIM_WORD_ELEMS];
+
+static inline float fp16_to_float(uint16_t a)
+{
+    PIMFloat32 u;
+    uint32_t sign, exp, mant;
+
+    sign = (uint32_t)(a & 0x8000) << 16;
+    exp = (a >> 10) & 0x1f;
+    mant = a & 0x3ff;
+    if (exp == 0x1f) {
+        u.i = sign | 0x7f800000 | (mant << 13);
+    } else if (exp == 0) {
+        /* zero or subnormal */
+        u.f = (float)mant * (1.0f / 16777216.0f);
+        u.i |= sign;
+    } else {
+        u.i = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+    }
+    return u.f;
+}
+
+/* round to nearest even */
+static inline uint16_t float_to_fp16(float f)
+{
+    PIMFloat32 u;
+    uint32_t sign, a;
+
+    u.f = f;
+    sign = (u.i >> 16) & 0x8000;
+    a = u.i & 0x7fffffff;
+    if (a >= 0x7f800000)
+        return sign | 0x7c00 | (a > 0x7f800000 ? 0x200 : 0);
+    if (a >= 0x477ff000) /* rounds above 65504 */
+        return sign | 0x7c00;
+    if (a < 0x38800000) {
+        /* subnormal */
+        u.i = a;
+        return sign | (uint16_t)lrintf(u.f * 16777216.0f);
+    }
+    a -= (uint32_t)(127 - 15) << 23;
+    a += 0xfff + ((a >> 13) & 1);
+    return sign | (a >> 13);
+}
+
+static inline float bf16_to_float(uint16_t a)
+{
+    PIMFloat32 u;
+    u.i = (uint32_t)a << 16;
+    return u.f;
+}
+
+/* round to nearest even */
+static inline uint16_t float_to_bf16(float f)
+{
+    PIMFloat32 u;
+    u.f = f;
+    if ((u.i & 0x7fffffff) > 0x7f800000)
+        return (u.i >> 16) | 0x40; /* quiet NaN */
+    u.i += 0x7fff + ((u.i >> 16) & 1);
+    return u.i >> 16;
+}
+
+static inline float pim_to_float(const PIMDatapath *dp, uint16_t a)
+{
+    if (dp->data_type == PIM_DATA_BF16)
+        return bf16_to_float(a);
+    else
+        return fp16_to_float(a);
+}
+
+static inline uint16_t pim_from_float(const PIMDatapath *dp, float f)
+{
+    if (dp->data_type == PIM_DATA_BF16)
+        return float_to_bf16(f);
+    else
+        return float_to_fp16(f);
+}
+
+/* the word kernels are plain loops over the 16 elements so that the
+   compiler can vectorize them */
+static void pim_word_to_float(const PIMDatapath *dp, float *dst,
+                              const uint16_t *src)
+{
+    int i;
+    if (dp->data_type == PIM_DATA_BF16) {
+        for(i = 0; i < PIM_WORD_ELEMS; i++)
+            dst[i] = bf16_to_float(src[i]);
+    } else {
+        for(i = 0; i < PIM_WORD_ELEMS; i++)
+            dst[i] = fp16_to_float(src[i]);
+    }
+}
+
+static void pim_word_from_float(const PIMDatapath *dp, uint16_t *dst,
+                                const float *src)
+{
+    int i;
+    if (dp->data_type == PIM_DATA_BF16) {
+        for(i = 0; i < PIM_WORD_ELEMS; i++)
+            dst[i] = float_to_bf16(src[i]);
+    } else {
+        for(i = 0; i < PIM_WORD_ELEMS; i++)
+            dst[i] = float_to_fp16(src[i]);
+    }
+}
+
+/* the products are reduced with an adder tree as in the bank MAC unit */
+static float pim_word_dot(const float *a, const float *b)
+{
+    float p[PIM_WORD_ELEMS];
+    int i, n;
+
+    for(i = 0; i < PIM_WORD_ELEMS; i++)
+        p[i] = a[i] * b[i];
+    for(n = PIM_WORD_ELEMS / 2; n > 0; n >>= 1) {
+        for(i = 0; i < n; i++)
+            p[i] += p[i + n];
+    }
+    return p[0];
+}
+
+static uint64_t pim_word_offset(int ch, int bank, int row, int col)
+{
+    uint64_t offset;
+    offset = ((uint64_t)ch << PIM_NUM_BANK_BITS) | bank;
+    offset = (offset << PIM_NUM_ROW_BITS) | row;
+    offset = (offset << PIM_NUM_COL_BITS) | col;
+    return offset << PIM_NUM_OFFSET_BITS;
+}
+
+/* words in pages never written read as zero */
+static const uint16_t *pim_read_word(PIMDatapath *dp, int ch, int bank,
+                                     int row, int col)
+{
+    uint64_t offset;
+    uint8_t *ptr;
+
+    offset = pim_word_offset(ch, bank, row, col);
+    if (offset >= dp->pr->size)
+        return pim_zero_word;
+    ptr = phys_mem_get_pim_ptr(dp->pr, offset, FALSE);
+    if (!ptr)
+        return pim_zero_word;
+    return (const uint16_t *)ptr;
+}
+
+static void pim_write_word(PIMDatapath *dp, int ch, int bank, int row,
+                           int col, const uint16_t *src)
+{
+    uint64_t offset;
+    uint8_t *ptr;
+
+    offset = pim_word_offset(ch, bank, row, col);
+    if (offset >= dp->pr->size)
+        return;
+    ptr = phys_mem_get_pim_ptr(dp->pr, offset, TRUE);
+    memcpy(ptr, src, PIM_WORD_ELEMS * sizeof(uint16_t));
+}
+
+static float pim_af(const PIMDatapath *dp, const PIMChannelState *cs, float x)
+{
+    int idx;
+
+    if (!cs->af_lut_valid)
+        return x;
+    if (!(x >= -PIM_AF_RANGE)) {
+        idx = 0; /* also NaN */
+    } else {
+        idx = (int)((x + PIM_AF_RANGE) *
+                    (PIM_AF_LUT_SIZE / (2 * PIM_AF_RANGE)));
+        if (idx >= PIM_AF_LUT_SIZE)
+            idx = PIM_AF_LUT_SIZE - 1;
+    }
+    return pim_to_float(dp, cs->af_lut[idx]);
+}
+
+PIMDatapath *pim_datapath_init(PhysMemoryRange *pr)
+{
+    PIMDatapath *dp;
+
+    dp = mallocz(sizeof(PIMDatapath));
+    if (!dp) {
+        fprintf(stderr, "Could not allocate the PIM datapath\n");
+        exit(1);
+    }
+    dp->pr = pr;
+    dp->data_type = PIM_DATA_FP16;
+    return dp;
+}
+
+void pim_datapath_free(PIMDatapath *dp)
+{
+    uint64_t nb_cmds;
+    int i;
+
+    nb_cmds = 0;
+    for(i = 0; i < PIM_CMD_COUNT; i++)
+        nb_cmds += dp->nb_cmds[i];
+    if (nb_cmds) {
+        fprintf(stderr, "PIM datapath: %" PRIu64 " commands, %" PRIu64
+                " MAC, %" PRIu64 " AF, %" PRIu64 " RD\n", nb_cmds,
+                dp->nb_cmds[PIM_CMD_MAC_SBK] + dp->nb_cmds[PIM_CMD_MAC_4BK] +
+                dp->nb_cmds[PIM_CMD_MAC_ABK],
+                dp->nb_cmds[PIM_CMD_AF_SBK] + dp->nb_cmds[PIM_CMD_AF_4BK] +
+                dp->nb_cmds[PIM_CMD_AF_ABK],
+                dp->nb_cmds[PIM_CMD_RD_MAC] + dp->nb_cmds[PIM_CMD_RD_AF]);
+    }
+    free(dp);
+}
+
+void pim_datapath_set_data_type(PIMDatapath *dp, PIMDataType data_type)
+{
+    dp->data_type = data_type;
+}
+
+void pim_datapath_checkpoint(PIMDatapath *dp, Checkpoint *ck)
+{
+    checkpoint_section(ck, "pim");
+    checkpoint_field(ck, dp, data_type);
+    checkpoint_field(ck, dp, ch);
+    checkpoint_field(ck, dp, nb_cmds);
+}
+
+/* execute 'cmd' at 'offset' in the PIM area. Return the 16 bit result of
+   RD_MAC and RD_AF, 0 for the other commands. */
+uint64_t pim_datapath_exec(PIMDatapath *dp, PIMCommand cmd, uint64_t offset)
+{
+    PIMChannelState *cs;
+    float a[PIM_WORD_ELEMS], b[PIM_WORD_ELEMS];
+    uint16_t *gb;
+    int ch, bank, row, col, first, last, i;
+    uint64_t ret;
+
+    col = (offset >> PIM_NUM_OFFSET_BITS) & (PIM_NUM_COLS - 1);
+    offset >>= PIM_NUM_OFFSET_BITS + PIM_NUM_COL_BITS;
+    row = offset & (PIM_NUM_ROWS - 1);
+    offset >>= PIM_NUM_ROW_BITS;
+    bank = offset & (PIM_BANKS_PER_CH - 1);
+    ch = (offset >> PIM_NUM_BANK_BITS) & (PIM_NUM_CHS - 1);
+
+    cs = &dp->ch[ch];
+    gb = &cs->gb[col * PIM_WORD_ELEMS];
+    dp->nb_cmds[cmd]++;
+
+    /* banks touched by the MAC and AF commands */
+    switch(cmd) {
+    case PIM_CMD_MAC_ABK:
+    case PIM_CMD_AF_ABK:
+        first = 0;
+        last = PIM_BANKS_PER_CH - 1;
+        break;
+    case PIM_CMD_MAC_4BK:
+    case PIM_CMD_AF_4BK:
+        first = bank & ~(PIM_BANKS_PER_BG - 1);
+        last = first + PIM_BANKS_PER_BG - 1;
+        break;
+    default:
+        first = last = bank;
+        break;
+    }
+
+    ret = 0;
+    switch(cmd) {
+    case PIM_CMD_COPY_BKGB:
+    case PIM_CMD_WR_GB:
+        memcpy(gb, pim_read_word(dp, ch, bank, row, col),
+               PIM_WORD_ELEMS * sizeof(uint16_t));
+        break;
+    case PIM_CMD_COPY_GBBK:
+        pim_write_word(dp, ch, bank, row, col, gb);
+        break;
+    case PIM_CMD_WR_BK:
+        for(i = 0; i < PIM_BANKS_PER_CH; i++)
+            pim_write_word(dp, ch, i, row, col, gb);
+        break;
+    case PIM_CMD_MAC_SBK:
+    case PIM_CMD_MAC_4BK:
+    case PIM_CMD_MAC_ABK:
+        pim_word_to_float(dp, a, gb);
+        for(i = first; i <= last; i++) {
+            pim_word_to_float(dp, b, pim_read_word(dp, ch, i, row, col));
+            cs->mac[i] += pim_word_dot(a, b);
+        }
+        break;
+    case PIM_CMD_AF_SBK:
+    case PIM_CMD_AF_4BK:
+    case PIM_CMD_AF_ABK:
+        for(i = first; i <= last; i++)
+            cs->af[i] = pim_af(dp, cs, cs->mac[i] + cs->bias[i]);
+        break;
+    case PIM_CMD_EWMUL:
+    case PIM_CMD_EWADD:
+        pim_word_to_float(dp, a, gb);
+        pim_word_to_float(dp, b, pim_read_word(dp, ch, bank, row, col));
+        if (cmd == PIM_CMD_EWMUL) {
+            for(i = 0; i < PIM_WORD_ELEMS; i++)
+                a[i] *= b[i];
+        } else {
+            for(i = 0; i < PIM_WORD_ELEMS; i++)
+                a[i] += b[i];
+        }
+        pim_word_from_float(dp, gb, a);
+        break;
+    case PIM_CMD_WR_MAC:
+        /* one element per bank */
+        pim_word_to_float(dp, cs->mac, pim_read_word(dp, ch, bank, row, col));
+        break;
+    case PIM_CMD_WR_BIAS:
+        pim_word_to_float(dp, cs->bias, pim_read_word(dp, ch, bank, row, col));
+        break;
+    case PIM_CMD_WR_AFLUT:
+        memcpy(&cs->af_lut[col * PIM_WORD_ELEMS],
+               pim_read_word(dp, ch, bank, row, col),
+               PIM_WORD_ELEMS * sizeof(uint16_t));
+        cs->af_lut_valid = TRUE;
+        break;
+    case PIM_CMD_RD_MAC:
+        ret = pim_from_float(dp, cs->mac[bank]);
+        cs->mac[bank] = 0;
+        break;
+    case PIM_CMD_RD_AF:
+        ret = pim_from_float(dp, cs->af[bank]);
+        break;
+    default:
+        abort();
+    }
+    return ret;
+}
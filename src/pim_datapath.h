@@ -0,0 +1,118 @@
+/*
+ * Functional model of the AiM PIM datapath
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef PIM_DATAPATH_H
+#define PIM_DATAPATH_H
+
+#include "cutils.h"
+#include "iomem.h"
+
+/* PIM address layout from the MSB: channel, bank group, bank, row, column
+   and byte offset in the 32 byte word (must match tools/def.h) */
+#define PIM_NUM_OFFSET_BITS 5
+#define PIM_NUM_COL_BITS    6
+#define PIM_NUM_ROW_BITS    17
+#define PIM_NUM_BANK_BITS   4 /* bank group and bank */
+#define PIM_NUM_CH_BITS     4
+
+#define PIM_WORD_ELEMS    16 /* 16 bit elements in a 32 byte word */
+#define PIM_NUM_COLS      (1 << PIM_NUM_COL_BITS)
+#define PIM_NUM_ROWS      (1 << PIM_NUM_ROW_BITS)
+#define PIM_BANKS_PER_BG  4
+#define PIM_BANKS_PER_CH  (1 << PIM_NUM_BANK_BITS)
+#define PIM_NUM_CHS       (1 << PIM_NUM_CH_BITS)
+#define PIM_GB_ELEMS      (PIM_WORD_ELEMS * PIM_NUM_COLS) /* one row */
+#define PIM_AF_LUT_SIZE   PIM_GB_ELEMS
+#define PIM_AF_RANGE      8.0f /* the AF LUT samples [-range, range) */
+
+typedef enum {
+    PIM_DATA_FP16,
+    PIM_DATA_BF16,
+} PIMDataType;
+
+typedef enum {
+    PIM_CMD_MAC_SBK,
+    PIM_CMD_AF_SBK,
+    PIM_CMD_COPY_BKGB,
+    PIM_CMD_COPY_GBBK,
+    PIM_CMD_MAC_4BK,
+    PIM_CMD_AF_4BK,
+    PIM_CMD_EWMUL,
+    PIM_CMD_EWADD,
+    PIM_CMD_MAC_ABK,
+    PIM_CMD_AF_ABK,
+    PIM_CMD_WR_AFLUT,
+    PIM_CMD_WR_BK,
+    PIM_CMD_WR_GB,
+    PIM_CMD_WR_MAC,
+    PIM_CMD_WR_BIAS,
+    PIM_CMD_RD_MAC,
+    PIM_CMD_RD_AF,
+    PIM_CMD_COUNT,
+} PIMCommand;
+
+/* Per channel state. The global buffer and the AF LUT hold raw 16 bit
+   elements, the MAC accumulators are kept in single precision and are only
+   rounded when read. */
+typedef struct {
+    uint16_t gb[PIM_GB_ELEMS];
+    uint16_t af_lut[PIM_AF_LUT_SIZE];
+    BOOL af_lut_valid; /* AF is the identity until the LUT is written */
+    float mac[PIM_BANKS_PER_CH];
+    float bias[PIM_BANKS_PER_CH];
+    float af[PIM_BANKS_PER_CH];
+} PIMChannelState;
+
+/* The command semantics, with (ch, bank, row, col) decoded from the address:
+   - COPY_BKGB: GB[col] = bank word
+   - COPY_GBBK: bank word = GB[col]
+   - WR_BK: every bank word of the channel at (row, col) = GB[col]
+   - MAC_SBK/4BK/ABK: MAC[b] += dot(bank word, GB[col]) for the addressed
+     bank, the 4 banks of its bank group or all the banks of the channel
+   - AF_SBK/4BK/ABK: AF[b] = LUT(MAC[b] + BIAS[b]) for the same banks
+   - EWMUL/EWADD: GB[col] = GB[col] * or + bank word, element wise
+   - WR_GB: GB[col] = word
+   - WR_MAC/WR_BIAS: MAC[b] or BIAS[b] = word[b], one element per bank
+   - WR_AFLUT: LUT[col * 16 .. col * 16 + 15] = word
+   - RD_MAC: return MAC[bank] and clear it
+   - RD_AF: return AF[bank]
+   The instructions do not carry the host data burst, so the WR_* commands
+   take their operand from the addressed word, which the host writes with
+   regular stores beforehand. */
+struct PIMDatapath {
+    PhysMemoryRange *pr;
+    PIMDataType data_type;
+    PIMChannelState ch[PIM_NUM_CHS];
+    uint64_t nb_cmds[PIM_CMD_COUNT];
+};
+
+PIMDatapath *pim_datapath_init(PhysMemoryRange *pr);
+void pim_datapath_free(PIMDatapath *dp);
+void pim_datapath_set_data_type(PIMDatapath *dp, PIMDataType data_type);
+uint64_t pim_datapath_exec(PIMDatapath *dp, PIMCommand cmd, uint64_t offset);
+void pim_datapath_checkpoint(PIMDatapath *dp, Checkpoint *ck);
+
+static inline BOOL pim_command_is_read(PIMCommand cmd)
+{
+    return cmd == PIM_CMD_RD_MAC || cmd == PIM_CMD_RD_AF;
+}
+
+#endif /* PIM_DATAPATH_H */
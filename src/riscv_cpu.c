@@ -37,6 +37,7 @@
 #include <assert.h>
 #include <time.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #include "cutils.h"
 #include "iomem.h"
@@ -68,6 +69,11 @@
 #ifdef USE_GLOBAL_STATE
 static RISCVCPUState riscv_cpu_global_state;
 #endif
+
+/* with parallel_sim, the harts run on their own host threads: the device
+   accesses and the PIM area, whose pages are allocated on the first write,
+   are serialized */
+static pthread_mutex_t io_lock = PTHREAD_MUTEX_INITIALIZER;
 #ifdef USE_GLOBAL_VARIABLES
 #define code_ptr s->__code_ptr
 #define code_end s->__code_end
@@ -467,13 +473,22 @@ int target_read_slow(RISCVCPUState *s, mem_uint_t *pval,
             }
         } 
         else if (pr->is_pim) {
+            s->data_guest_paddr = paddr;
+            s->is_pim_access = 1;
+
+            /* PIM pages never written read as zero, and are not added to
+               the TLB as they get allocated on the first write */
+            pthread_mutex_lock(&io_lock);
+            ptr = phys_mem_get_pim_ptr(pr, paddr - pr->addr, FALSE);
+            pthread_mutex_unlock(&io_lock);
+            if (!ptr) {
+                *pval = 0;
+                return 0;
+            }
             tlb_idx = (addr >> PG_SHIFT) & (TLB_SIZE - 1);
-            ptr = pr->phys_mem + (uintptr_t)(paddr - pr->addr);
             s->tlb_read[tlb_idx].vaddr = addr & ~PG_MASK;
             s->tlb_read[tlb_idx].mem_addend = (uintptr_t)ptr - addr;
             s->tlb_read[tlb_idx].guest_paddr = paddr & ~PG_MASK;
-            s->data_guest_paddr = (target_ulong)(paddr - pr->addr);
-            s->is_pim_access = 1;
 
             switch(size_log2) { 
             case 0:
@@ -502,6 +517,7 @@ int target_read_slow(RISCVCPUState *s, mem_uint_t *pval,
             s->is_device_io = 1;
             s->data_guest_paddr = paddr;
             offset = paddr - pr->addr;
+            pthread_mutex_lock(&io_lock);
             if (((pr->devio_flags >> size_log2) & 1) != 0) {
                 ret = pr->read_func(pr->opaque, offset, size_log2);
             }
@@ -521,6 +537,7 @@ int target_read_slow(RISCVCPUState *s, mem_uint_t *pval,
 #endif
                 ret = 0;
             }
+            pthread_mutex_unlock(&io_lock);
         }
     }
     *pval = ret;
@@ -590,11 +607,13 @@ int target_write_slow(RISCVCPUState *s, target_ulong addr,
             }
         } else if (pr->is_pim) {
             tlb_idx = (addr >> PG_SHIFT) & (TLB_SIZE - 1);
-            ptr = pr->phys_mem + (uintptr_t)(paddr - pr->addr);
+            pthread_mutex_lock(&io_lock);
+            ptr = phys_mem_get_pim_ptr(pr, paddr - pr->addr, TRUE);
+            pthread_mutex_unlock(&io_lock);
             s->tlb_write[tlb_idx].vaddr = addr & ~PG_MASK;
             s->tlb_write[tlb_idx].mem_addend = (uintptr_t)ptr - addr;
             s->tlb_write[tlb_idx].guest_paddr = paddr & ~PG_MASK;
-            s->data_guest_paddr = (target_ulong)(paddr - pr->addr);
+            s->data_guest_paddr = paddr;
 
             s->is_pim_access = 1;
 
@@ -626,6 +645,7 @@ int target_write_slow(RISCVCPUState *s, target_ulong addr,
             
             s->data_guest_paddr = paddr;
             offset = paddr - pr->addr;
+            pthread_mutex_lock(&io_lock);
             if (((pr->devio_flags >> size_log2) & 1) != 0) {
                 pr->write_func(pr->opaque, offset, val, size_log2);
             }
@@ -645,11 +665,50 @@ int target_write_slow(RISCVCPUState *s, target_ulong addr,
                 printf(" width=%d bits\n", 1 << (3 + size_log2));
 #endif
             }
+            pthread_mutex_unlock(&io_lock);
         }
     }
     return 0;
 }
 
+#if MLEN >= 64
+/* Execute the AiM command 'cmd' at 'addr'. In the PIM area, it is executed
+   by the functional datapath model and RD_MAC/RD_AF return their result in
+   '*pval'. Elsewhere, it is a regular 64 bit load or store of 'val'.
+   return 0 if OK, != 0 if exception */
+int target_aim_command(RISCVCPUState *s, target_ulong addr, PIMCommand cmd,
+                       uint64_t val, uint64_t *pval)
+{
+    target_ulong paddr;
+    PhysMemoryRange *pr;
+    BOOL is_read;
+
+    is_read = pim_command_is_read(cmd);
+    if (get_phys_addr(s, &paddr, addr, is_read ? ACCESS_READ : ACCESS_WRITE)) {
+        s->pending_tval = addr;
+        s->pending_exception = is_read ? CAUSE_LOAD_PAGE_FAULT :
+            CAUSE_STORE_PAGE_FAULT;
+        return -1;
+    }
+    pr = get_phys_mem_range(s->mem_map, paddr);
+    if (!pr || !pr->is_pim) {
+        if (is_read)
+            return target_read_u64(s, pval, addr);
+        else
+            return target_write_u64(s, addr, val);
+    }
+    s->is_device_io = 0;
+    s->is_pim_access = 1;
+    s->data_guest_paddr = (target_ulong)(paddr - pr->addr);
+    pthread_mutex_lock(&io_lock);
+    val = pim_datapath_exec(pr->pim_dp, cmd, paddr - pr->addr);
+    pthread_mutex_unlock(&io_lock);
+    if (pval)
+        *pval = val;
+    return 0;
+}
+#endif
+
 struct __attribute__((packed)) unaligned_u32 {
     uint32_t u32;
 };
@@ -1003,6 +1062,10 @@ static int csr_read(RISCVCPUState *s, target_ulong *pval, uint32_t csr,
         *run_mode = MODE_SIM_STOP;
         val = 0;
         break;
+    case 0x802: /** simulation region begin */
+    case 0x803: /** simulation region end */
+        val = 0;
+        break;
     default:
     invalid_csr:
 #ifdef DUMP_INVALID_CSR
@@ -1175,6 +1238,12 @@ static int csr_write(RISCVCPUState *s, uint32_t csr, target_ulong val)
         mask = MIP_SSIP | MIP_STIP;
         s->mip = (s->mip & ~mask) | (val & mask);
         break;
+    case 0x802: /** simulation region begin, val is the region id */
+        riscv_sim_cpu_region_begin(s->simcpu, val);
+        break;
+    case 0x803: /** simulation region end */
+        riscv_sim_cpu_region_end(s->simcpu, val);
+        break;
     default:
 #ifdef DUMP_INVALID_CSR
         printf("csr_write: invalid CSR=0x%x\n", csr);
@@ -1415,9 +1484,12 @@ static void glue(riscv_cpu_interp, MAX_XLEN)(RISCVCPUState *s, int n_cycles)
     uint64_t timeout;
 
     timeout = s->insn_counter + n_cycles;
-    while (!s->power_down_flag &&
+    while (!s->power_down_flag && !s->sim_start_pending &&
+           !riscv_sim_cpu_slice_done(s->simcpu) &&
            (int)(timeout - s->insn_counter) > 0) {
         n_cycles = timeout - s->insn_counter;
+        /* in sampled simulation, the emulated phases end on time */
+        n_cycles = riscv_sim_cpu_sample_step(s->simcpu, n_cycles);
         switch(s->cur_xlen) {
         case 32:
             riscv_cpu_interp_x32(s, n_cycles);
@@ -1444,9 +1516,10 @@ static uint64_t glue(riscv_cpu_get_cycles, MAX_XLEN)(RISCVCPUState *s)
     return s->insn_counter;
 }
 
+/* the devices may raise an interrupt of a hart running on another thread */
 static void glue(riscv_cpu_set_mip, MAX_XLEN)(RISCVCPUState *s, uint32_t mask)
 {
-    s->mip |= mask;
+    __atomic_fetch_or(&s->mip, mask, __ATOMIC_SEQ_CST);
     /* exit from power down if an interrupt is pending */
     if (s->power_down_flag && (s->mip & s->mie) != 0)
         s->power_down_flag = FALSE;
@@ -1454,7 +1527,7 @@ static void glue(riscv_cpu_set_mip, MAX_XLEN)(RISCVCPUState *s, uint32_t mask)
 
 static void glue(riscv_cpu_reset_mip, MAX_XLEN)(RISCVCPUState *s, uint32_t mask)
 {
-    s->mip &= ~mask;
+    __atomic_fetch_and(&s->mip, ~mask, __ATOMIC_SEQ_CST);
 }
 
 static uint32_t glue(riscv_cpu_get_mip, MAX_XLEN)(RISCVCPUState *s)
@@ -1467,7 +1540,8 @@ static BOOL glue(riscv_cpu_get_power_down, MAX_XLEN)(RISCVCPUState *s)
     return s->power_down_flag;
 }
 
-static RISCVCPUState *glue(riscv_cpu_init, MAX_XLEN)(PhysMemoryMap *mem_map, const SimParams *p)
+static RISCVCPUState *glue(riscv_cpu_init, MAX_XLEN)(PhysMemoryMap *mem_map, const SimParams *p,
+                                                      int hartid, RISCVCPUState *boot_hart)
 {
     RISCVCPUState *s;
     
@@ -1480,6 +1554,7 @@ static RISCVCPUState *glue(riscv_cpu_init, MAX_XLEN)(PhysMemoryMap *mem_map, con
     s->sim_params = (SimParams *)p;
     s->mem_map = mem_map;
     s->pc = 0x1000;
+    s->mhartid = hartid;
     s->priv = PRV_M;
     s->cur_xlen = MAX_XLEN;
     s->mxl = get_base_from_xlen(MAX_XLEN);
@@ -1506,7 +1581,8 @@ static RISCVCPUState *glue(riscv_cpu_init, MAX_XLEN)(PhysMemoryMap *mem_map, con
     assert(s->tlb_read);
     assert(s->tlb_write);
 
-    s->simcpu = riscv_sim_cpu_init(s->sim_params, s);
+    s->simcpu = riscv_sim_cpu_init(s->sim_params, s, hartid,
+                                   boot_hart ? boot_hart->simcpu : NULL);
     tlb_init(s);
 
     return s;
@@ -1539,6 +1615,53 @@ static uint64_t glue(riscv_cpu_in_simulation_get_mtime, MAX_XLEN)(RISCVCPUState
            + (s->simcpu->clock / scale_offset);
 }
 
+/* the simulated core is not saved: a checkpoint is only taken before the
+   simulation starts */
+static void glue(riscv_cpu_checkpoint, MAX_XLEN)(RISCVCPUState *s,
+                                                Checkpoint *ck)
+{
+    checkpoint_section(ck, "cpu");
+    checkpoint_check_u64(ck, s->mhartid);
+    checkpoint_field(ck, s, pc);
+    checkpoint_field(ck, s, reg);
+#if FLEN > 0
+    checkpoint_field(ck, s, fp_reg);
+    checkpoint_field(ck, s, fflags);
+    checkpoint_field(ck, s, frm);
+#endif
+    checkpoint_field(ck, s, cur_xlen);
+    checkpoint_field(ck, s, priv);
+    checkpoint_field(ck, s, fs);
+    checkpoint_field(ck, s, mxl);
+    checkpoint_field(ck, s, insn_counter);
+    checkpoint_field(ck, s, power_down_flag);
+
+    checkpoint_field(ck, s, mstatus);
+    checkpoint_field(ck, s, mtvec);
+    checkpoint_field(ck, s, mscratch);
+    checkpoint_field(ck, s, mepc);
+    checkpoint_field(ck, s, mcause);
+    checkpoint_field(ck, s, mtval);
+    checkpoint_field(ck, s, misa);
+    checkpoint_field(ck, s, mie);
+    checkpoint_field(ck, s, mip);
+    checkpoint_field(ck, s, medeleg);
+    checkpoint_field(ck, s, mideleg);
+    checkpoint_field(ck, s, mcounteren);
+    checkpoint_field(ck, s, stvec);
+    checkpoint_field(ck, s, sscratch);
+    checkpoint_field(ck, s, sepc);
+    checkpoint_field(ck, s, scause);
+    checkpoint_field(ck, s, stval);
+    checkpoint_field(ck, s, satp);
+    checkpoint_field(ck, s, scounteren);
+    checkpoint_field(ck, s, load_res);
+    checkpoint_field(ck, s, load_res_val);
+
+    if (ck->is_restore)
+        tlb_flush_all(s);
+}
+
 const RISCVCPUClass glue(riscv_cpu_class, MAX_XLEN) = {
     glue(riscv_cpu_init, MAX_XLEN),
     glue(riscv_cpu_end, MAX_XLEN),
@@ -1552,10 +1675,12 @@ const RISCVCPUClass glue(riscv_cpu_class, MAX_XLEN) = {
     glue(riscv_cpu_flush_tlb_write_range_ram, MAX_XLEN),
     glue(riscv_cpu_in_simulation, MAX_XLEN),
     glue(riscv_cpu_in_simulation_get_mtime, MAX_XLEN),
+    glue(riscv_cpu_checkpoint, MAX_XLEN),
 };
 
 //#if CONFIG_RISCV_MAX_XLEN == MAX_XLEN
-RISCVCPUState *riscv_cpu_init(PhysMemoryMap *mem_map, int max_xlen, const SimParams *p)
+RISCVCPUState *riscv_cpu_init(PhysMemoryMap *mem_map, int max_xlen, const SimParams *p,
+                              int hartid, RISCVCPUState *boot_hart)
 {
     const RISCVCPUClass *c;
     switch(max_xlen) {
@@ -1584,6 +1709,6 @@ RISCVCPUState *riscv_cpu_init(PhysMemoryMap *mem_map, int max_xlen, const SimPar
     default:
         return NULL;
     }
-    return c->riscv_cpu_init(mem_map, p);
+    return c->riscv_cpu_init(mem_map, p, hartid, boot_hart);
 }
 //#endif /* CONFIG_RISCV_MAX_XLEN == MAX_XLEN */
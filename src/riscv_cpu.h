@@ -53,7 +53,8 @@
 typedef struct RISCVCPUState RISCVCPUState;
 
 typedef struct {
-    RISCVCPUState *(*riscv_cpu_init)(PhysMemoryMap *mem_map, const SimParams *p);
+    RISCVCPUState *(*riscv_cpu_init)(PhysMemoryMap *mem_map, const SimParams *p,
+                                     int hartid, RISCVCPUState *boot_hart);
     void (*riscv_cpu_end)(RISCVCPUState *s);
     void (*riscv_cpu_interp)(RISCVCPUState *s, int n_cycles);
     uint64_t (*riscv_cpu_get_cycles)(RISCVCPUState *s);
@@ -66,6 +67,7 @@ typedef struct {
                                                 uint8_t *ram_ptr, size_t ram_size);
     BOOL (*riscv_cpu_in_simulation)(RISCVCPUState *s);
     uint64_t (*riscv_cpu_in_simulation_get_mtime)(RISCVCPUState *s);
+    void (*riscv_cpu_checkpoint)(RISCVCPUState *s, Checkpoint *ck);
 } RISCVCPUClass;
 
 typedef struct {
@@ -79,7 +81,10 @@ extern const RISCVCPUClass riscv_cpu_class32;
 extern const RISCVCPUClass riscv_cpu_class64;
 extern const RISCVCPUClass riscv_cpu_class128;
 
-RISCVCPUState *riscv_cpu_init(PhysMemoryMap *mem_map, int max_xlen, const SimParams *sim_params);
+/* boot_hart is NULL for hart 0, the other harts share its simulated memory
+   system */
+RISCVCPUState *riscv_cpu_init(PhysMemoryMap *mem_map, int max_xlen, const SimParams *sim_params,
+                              int hartid, RISCVCPUState *boot_hart);
 static inline void riscv_cpu_end(RISCVCPUState *s)
 {
     const RISCVCPUClass *c = ((RISCVCPUCommonState *)s)->class_ptr;
@@ -136,4 +141,9 @@ static inline uint64_t riscv_cpu_in_simulation_get_mtime(RISCVCPUState *s)
     const RISCVCPUClass *c = ((RISCVCPUCommonState *)s)->class_ptr;
     return c->riscv_cpu_in_simulation_get_mtime(s);
 }
+static inline void riscv_cpu_checkpoint(RISCVCPUState *s, Checkpoint *ck)
+{
+    const RISCVCPUClass *c = ((RISCVCPUCommonState *)s)->class_ptr;
+    c->riscv_cpu_checkpoint(s, ck);
+}
 #endif /* RISCV_CPU_H */
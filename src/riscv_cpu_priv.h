@@ -41,6 +41,7 @@
 #include "riscvsim/core/riscv_sim_cpu.h"
 #include "riscvsim/utils/sim_params.h"
 #include "rtc_timer.h"
+#include "pim_datapath.h"
  
 #define __exception __attribute__((warn_unused_result))
  
@@ -168,6 +169,9 @@ typedef struct RISCVCPUState {
     int32_t n_cycles; /* only used inside the CPU loop */
     uint64_t insn_counter;
     BOOL power_down_flag;
+    BOOL stop_at_sim_start; /* leave the CPU loop instead of simulating */
+    BOOL sim_start_pending; /* stopped on the SIM_START CSR access */
+    BOOL sim_warming; /* warmup phase of sampled simulation */
     int pending_exception; /* used during MMU exception handling */
     target_ulong pending_tval;
    
@@ -199,6 +203,7 @@ typedef struct RISCVCPUState {
     uint32_t scounteren;
  
     target_ulong load_res; /* for atomic LR/SC */
+    target_ulong load_res_val; /* value read by LR, for the simulator */
  
     PhysMemoryMap *mem_map;
  
@@ -248,6 +253,12 @@ DLL_PUBLIC int target_read_slow(RISCVCPUState *s, mem_uint_t *pval,
                                 target_ulong addr, int size_log2);
 DLL_PUBLIC int target_write_slow(RISCVCPUState *s, target_ulong addr,
                                  mem_uint_t val, int size_log2);
+#if MLEN >= 64
+#define target_aim_command glue(glue(riscv, MAX_XLEN), _aim_command)
+DLL_PUBLIC int target_aim_command(RISCVCPUState *s, target_ulong addr,
+                                  PIMCommand cmd, uint64_t val,
+                                  uint64_t *pval);
+#endif
  
 /* return 0 if OK, != 0 if exception */
 #define TARGET_READ_WRITE(size, uint_type, size_log2)                          \
@@ -287,6 +298,8 @@ DLL_PUBLIC int target_write_slow(RISCVCPUState *s, target_ulong addr,
         {                                                                      \
             s->data_guest_paddr = s->tlb_read[tlb_idx].guest_paddr             \
                                   + (addr - s->tlb_read[tlb_idx].vaddr);       \
+            if (unlikely(s->sim_warming))                                      \
+                riscv_sim_cpu_warm_data(s, size / 8, FALSE);                   \
         }                                                                      \
         return 0;                                                              \
     }                                                                          \
@@ -325,6 +338,8 @@ DLL_PUBLIC int target_write_slow(RISCVCPUState *s, target_ulong addr,
         {                                                                      \
             s->data_guest_paddr = s->tlb_write[tlb_idx].guest_paddr            \
                                   + (addr - s->tlb_write[tlb_idx].vaddr);      \
+            if (unlikely(s->sim_warming))                                      \
+                riscv_sim_cpu_warm_data(s, size / 8, TRUE);                    \
         }                                                                      \
         return 0;                                                              \
     }
@@ -337,10 +337,13 @@ static void no_inline glue(riscv_cpu_interp_x, XLEN)(RISCVCPUState *s,
 
             case SIM_ICOUNT_COMPLETE_EXCEPTION:
             {
-                /* Simulated user specified sim_emulate_after_icount instructions,
-                 * now switch to emulation mode */
-                riscv_sim_cpu_stop(s->simcpu, s->pc);
-                break;
+                /* Simulated icount_limit instructions, now switch to
+                 * emulation mode. In sampled simulation, return so that the
+                 * next phase starts on time. */
+                s->pc = GET_PC();
+                s->insn_counter = GET_INSN_COUNTER();
+                riscv_sim_cpu_icount_complete(s->simcpu, s->pc);
+                goto the_end;
             }
 
             default:
@@ -404,6 +407,8 @@ static void no_inline glue(riscv_cpu_interp_x, XLEN)(RISCVCPUState *s,
             insn = get_insn32(code_ptr);
         }
         s->n_cycles--;
+        if (unlikely(s->sim_warming))
+            riscv_sim_cpu_warm_insn(s, GET_PC(), insn);
 #if 0
         if (1) {
 #ifdef CONFIG_LOGFILE
@@ -1009,9 +1014,9 @@ static void no_inline glue(riscv_cpu_interp_x, XLEN)(RISCVCPUState *s,
             case 7: /* AIM_RD_AF */
                 {
                     uint64_t rval;
-                    if (target_read_u64(s, &rval, addr))
+                    if (target_aim_command(s, addr, PIM_CMD_RD_AF, 0, &rval))
                         goto mmu_exception;
-                    val = (int64_t)rval;
+                    val = rval;
                 }
                 break;
 #endif
@@ -1057,19 +1062,19 @@ static void no_inline glue(riscv_cpu_interp_x, XLEN)(RISCVCPUState *s,
                 break;
             // AiM
             case 4: /* AIM_MAC_SBK */
-                if (target_write_u64(s, addr, val))
+                if (target_aim_command(s, addr, PIM_CMD_MAC_SBK, val, NULL))
                     goto mmu_exception;
                 break;
             case 5: /* AIM_AF_SBK */
-                if (target_write_u64(s, addr, val))
+                if (target_aim_command(s, addr, PIM_CMD_AF_SBK, val, NULL))
                     goto mmu_exception;
                 break;
             case 6: /* AIM_COPY_BKGB */
-                if (target_write_u64(s, addr, val))
+                if (target_aim_command(s, addr, PIM_CMD_COPY_BKGB, val, NULL))
                     goto mmu_exception;
                 break;
             case 7: /* AIM_COPY_GBBK */
-                if (target_write_u64(s, addr, val))
+                if (target_aim_command(s, addr, PIM_CMD_COPY_GBBK, val, NULL))
                     goto mmu_exception;
                 break;
 #endif
@@ -1400,6 +1405,13 @@ static void no_inline glue(riscv_cpu_interp_x, XLEN)(RISCVCPUState *s,
                 val2 = (intx_t)val2;
                 switch (run_mode) {
                     case MODE_SIM_START: {
+                        if (s->stop_at_sim_start) {
+                            /* the access is executed again once the
+                               checkpoint is restored */
+                            s->sim_start_pending = TRUE;
+                            s->pc = GET_PC();
+                            goto the_end;
+                        }
                         riscv_sim_cpu_start(s->simcpu, GET_PC() + 4);
                         s->pc = GET_PC() + 4;
                         goto the_end;
@@ -1667,11 +1679,12 @@ static void no_inline glue(riscv_cpu_interp_x, XLEN)(RISCVCPUState *s,
             {
                 imm = (int32_t)insn >> 20;
                 addr = s->reg[rs1] + imm;
-                // val = s->reg[rs2];
                 uint64_t rval;
-                if (target_read_u64(s, &rval, addr))
+                if (target_aim_command(s, addr, PIM_CMD_RD_MAC, 0, &rval))
                     goto mmu_exception;
-                // s->fp_reg[rd] = rval | F64_HIGH;
+                /* the result goes to an integer register */
+                if (rd != 0)
+                    s->reg[rd] = rval;
                 break;
             }
             // store-like AiM
@@ -1679,12 +1692,14 @@ static void no_inline glue(riscv_cpu_interp_x, XLEN)(RISCVCPUState *s,
             case 5: /* AIM_WR_MAC */
             case 6: /* AIM_WR_BIAS */
             {
+                static const PIMCommand wr_cmds[3] = {
+                    PIM_CMD_WR_GB, PIM_CMD_WR_MAC, PIM_CMD_WR_BIAS,
+                };
                 imm = rd | ((insn >> (25 - 5)) & 0xfe0);
                 imm = (imm << 20) >> 20;
                 addr = s->reg[rs1] + imm;
                 val = s->reg[rs2];
-                uint64_t rval;
-                if (target_write_u64(s, addr, val))
+                if (target_aim_command(s, addr, wr_cmds[funct3 - 4], val, NULL))
                     goto mmu_exception;
                 break;
             }
@@ -1905,35 +1920,35 @@ static void no_inline glue(riscv_cpu_interp_x, XLEN)(RISCVCPUState *s,
             switch (funct3)
             {
             case 0: /* AIM_MAC_4BK_INTRA_BG */
-                if (target_write_u64(s, addr, val))
+                if (target_aim_command(s, addr, PIM_CMD_MAC_4BK, val, NULL))
                     goto mmu_exception;
                 break;
             case 1: /* AIM_AF_4BK_INTRA_BG */
-                if (target_write_u64(s, addr, val))
+                if (target_aim_command(s, addr, PIM_CMD_AF_4BK, val, NULL))
                     goto mmu_exception;
                 break;
             case 2: /* AIM_EWMUL */
-                if (target_write_u64(s, addr, val))
+                if (target_aim_command(s, addr, PIM_CMD_EWMUL, val, NULL))
                     goto mmu_exception;
                 break;
             case 3: /* AIM_EWADD */
-                if (target_write_u64(s, addr, val))
+                if (target_aim_command(s, addr, PIM_CMD_EWADD, val, NULL))
                     goto mmu_exception;
                 break;
             case 4: /* AIM_MAC_ABK */
-                if (target_write_u64(s, addr, val))
+                if (target_aim_command(s, addr, PIM_CMD_MAC_ABK, val, NULL))
                     goto mmu_exception;
                 break;
             case 5: /* AIM_AF_ABK */
-                if (target_write_u64(s, addr, val))
+                if (target_aim_command(s, addr, PIM_CMD_AF_ABK, val, NULL))
                     goto mmu_exception;
                 break;
             case 6: /* AIM_WR_AFLUT */
-                if (target_write_u64(s, addr, val))
+                if (target_aim_command(s, addr, PIM_CMD_WR_AFLUT, val, NULL))
                     goto mmu_exception;
                 break;
-            case 7: /* AIM_WR_MAC */
-                if (target_write_u64(s, addr, val))
+            case 7: /* AIM_WR_BK */
+                if (target_aim_command(s, addr, PIM_CMD_WR_BK, val, NULL))
                     goto mmu_exception;
                 break;
             default:
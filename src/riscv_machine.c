@@ -31,6 +31,7 @@
 #include <errno.h>
 #include <unistd.h>
 #include <time.h>
+#include <pthread.h>
 
 #include "cutils.h"
 #include "iomem.h"
@@ -40,21 +41,44 @@
 #include "riscvsim/utils/sim_params.h"
 #include "rtc_timer.h"
 #include "riscv_cpu_priv.h"
+#include "checkpoint.h"
+#include "pim_map.h"
 
 #define UART_RX_BUFSIZE 16
+#define MAX_VIRTIO_DEVICE 30 /* each one has its own PLIC interrupt */
 
 /* RISCV machine */
 
+struct RISCVMachine;
+
+typedef struct {
+    struct RISCVMachine *m;
+    int hartid;
+    pthread_t thread;
+} RISCVHartThread;
+
 typedef struct RISCVMachine {
     VirtMachine common;
     PhysMemoryMap *mem_map;
     int max_xlen;
-    RISCVCPUState *cpu_state;
+    RISCVCPUState *cpu_state[MAX_NUM_CORES]; /* hart 0 boots and takes the
+                                                external interrupts */
+    int ncpus;
+    /* parallel simulation: harts 1 to ncpus - 1 run on their own threads,
+       started for each slice by bumping hart_slice */
+    BOOL parallel_sim;
+    RISCVHartThread hart_thread[MAX_NUM_CORES];
+    pthread_mutex_t hart_lock;
+    pthread_cond_t hart_start_cond;
+    pthread_cond_t hart_done_cond;
+    uint64_t hart_slice;
+    int harts_running;
+    BOOL harts_exit;
     uint64_t ram_size;
     /* RTC */
     BOOL rtc_real_time;
     RTC *rtc;
-    uint64_t timecmp;
+    uint64_t timecmp[MAX_NUM_CORES];
     /* PLIC */
     uint32_t plic_pending_irq, plic_served_irq;
     IRQSignal plic_irq[32]; /* IRQ 0 is not used */
@@ -78,7 +102,11 @@ typedef struct RISCVMachine {
     VIRTIODevice *keyboard_dev;
     VIRTIODevice *mouse_dev;
 
+    VIRTIODevice *virtio_dev[MAX_VIRTIO_DEVICE];
     int virtio_count;
+
+    /* saved when a hart first accesses the SIM_START CSR, NULL if none */
+    char *checkpoint_file;
 } RISCVMachine;
 
 #define LOW_RAM_SIZE   0x00010000 /* 64KB */
@@ -96,33 +124,38 @@ typedef struct RISCVMachine {
 #define PLIC_SIZE      0x00400000
 #define FRAMEBUFFER_BASE_ADDR 0x41000000
 
-/***************************   PIM *****************************/
-#define PIM_BASE_ADDR   0x480000000000
-#define PIM_SIZE        0x1000000000 /* 64GB */
-
-
 /***************************   RTC   ***************************/
 
 #define RTC_FREQ 10000000
 #define RTC_FREQ_DIV 16 /* arbitrary, relative to CPU freq to have a
                            10 MHz frequency */
 
-static uint64_t rtc_get_time(RISCVMachine *m)
+/* hart running on the calling thread in parallel simulation: each hart reads
+   mtime from its own clock, as the clocks of the other harts are being
+   advanced by other threads */
+static __thread RISCVCPUState *rtc_hart;
+
+static uint64_t rtc_get_hart_time(RISCVMachine *m, RISCVCPUState *s)
 {
     uint64_t val;
     if (m->rtc_real_time) {
-        if (riscv_cpu_in_simulation(m->cpu_state)) {
-            val = riscv_cpu_in_simulation_get_mtime(m->cpu_state);
+        if (riscv_cpu_in_simulation(s)) {
+            val = riscv_cpu_in_simulation_get_mtime(s);
         } else {
             val = rtc_get_elasped_time(m->rtc);
         }
     } else {
-        val = riscv_cpu_get_cycles(m->cpu_state) / RTC_FREQ_DIV;
+        val = riscv_cpu_get_cycles(s) / RTC_FREQ_DIV;
     }
     //    printf("rtc_time=%" PRId64 "\n", val);
     return val;
 }
 
+static uint64_t rtc_get_time(RISCVMachine *m)
+{
+    return rtc_get_hart_time(m, rtc_hart ? rtc_hart : m->cpu_state[0]);
+}
+
 
 /***************************   UART   ***************************/
 
@@ -400,28 +433,32 @@ static void htif_poll(RISCVMachine *s)
 
 /***************************   CLINT   ***************************/
 
+/* msip at 4 * hart, mtimecmp at 0x4000 + 8 * hart */
+#define CLINT_MSIP       0x0000
+#define CLINT_MTIMECMP   0x4000
+#define CLINT_MTIME      0xbff8
+
 static uint32_t clint_read(void *opaque, uint32_t offset, int size_log2)
 {
     RISCVMachine *m = opaque;
     uint32_t val;
+    int hart;
 
     assert(size_log2 == 2);
-    switch(offset) {
-    case 0xbff8:
+    if (offset == CLINT_MTIME) {
         val = rtc_get_time(m);
-        break;
-    case 0xbffc:
+    } else if (offset == CLINT_MTIME + 4) {
         val = rtc_get_time(m) >> 32;
-        break;
-    case 0x4000:
-        val = m->timecmp;
-        break;
-    case 0x4004:
-        val = m->timecmp >> 32;
-        break;
-    default:
+    } else if (offset >= CLINT_MTIMECMP &&
+               (hart = (offset - CLINT_MTIMECMP) >> 3) < m->ncpus) {
+        if (offset & 4)
+            val = m->timecmp[hart] >> 32;
+        else
+            val = m->timecmp[hart];
+    } else if (offset < CLINT_MTIMECMP && (hart = offset >> 2) < m->ncpus) {
+        val = (riscv_cpu_get_mip(m->cpu_state[hart]) & MIP_MSIP) != 0;
+    } else {
         val = 0;
-        break;
     }
     return val;
 }
@@ -430,19 +467,23 @@ static void clint_write(void *opaque, uint32_t offset, uint32_t val,
                       int size_log2)
 {
     RISCVMachine *m = opaque;
+    int hart;
 
     assert(size_log2 == 2);
-    switch(offset) {
-    case 0x4000:
-        m->timecmp = (m->timecmp & ~0xffffffff) | val;
-        riscv_cpu_reset_mip(m->cpu_state, MIP_MTIP);
-        break;
-    case 0x4004:
-        m->timecmp = (m->timecmp & 0xffffffff) | ((uint64_t)val << 32);
-        riscv_cpu_reset_mip(m->cpu_state, MIP_MTIP);
-        break;
-    default:
-        break;
+    if (offset >= CLINT_MTIMECMP && offset < CLINT_MTIME &&
+        (hart = (offset - CLINT_MTIMECMP) >> 3) < m->ncpus) {
+        if (offset & 4)
+            m->timecmp[hart] = (m->timecmp[hart] & 0xffffffff) |
+                ((uint64_t)val << 32);
+        else
+            m->timecmp[hart] = (m->timecmp[hart] & ~0xffffffff) | val;
+        riscv_cpu_reset_mip(m->cpu_state[hart], MIP_MTIP);
+    } else if (offset < CLINT_MTIMECMP && (hart = offset >> 2) < m->ncpus) {
+        /* inter-processor interrupt */
+        if (val & 1)
+            riscv_cpu_set_mip(m->cpu_state[hart], MIP_MSIP);
+        else
+            riscv_cpu_reset_mip(m->cpu_state[hart], MIP_MSIP);
     }
 }
 
@@ -451,7 +492,7 @@ static void clint_write(void *opaque, uint32_t offset, uint32_t val,
 
 static void plic_update_mip(RISCVMachine *s)
 {
-    RISCVCPUState *cpu = s->cpu_state;
+    RISCVCPUState *cpu = s->cpu_state[0];
     uint32_t mask;
     mask = s->plic_pending_irq & ~s->plic_served_irq;
     if (mask) {
@@ -806,10 +847,11 @@ static int riscv_build_fdt(RISCVMachine *m, uint8_t *dst,
                            const char *cmd_line)
 {
     FDTState *s;
-    int size, max_xlen, i, cur_phandle, intc_phandle, plic_phandle;
+    int size, max_xlen, i, cur_phandle, plic_phandle, hart;
+    int intc_phandle[MAX_NUM_CORES];
     char isa_string[128], *q;
     uint32_t misa;
-    uint32_t tab[4];
+    uint32_t tab[4 * MAX_NUM_CORES];
     FBDevice *fb_dev;
     
     s = fdt_init();
@@ -828,15 +870,8 @@ static int riscv_build_fdt(RISCVMachine *m, uint8_t *dst,
     fdt_prop_u32(s, "#size-cells", 0);
     fdt_prop_u32(s, "timebase-frequency", m->rtc->freq);
 
-    /* cpu */
-    fdt_begin_node_num(s, "cpu", 0);
-    fdt_prop_str(s, "device_type", "cpu");
-    fdt_prop_u32(s, "reg", 0);
-    fdt_prop_str(s, "status", "okay");
-    fdt_prop_str(s, "compatible", "riscv");
-
     max_xlen = m->max_xlen;
-    misa = riscv_cpu_get_misa(m->cpu_state);
+    misa = riscv_cpu_get_misa(m->cpu_state[0]);
     q = isa_string;
     q += snprintf(isa_string, sizeof(isa_string), "rv%d", max_xlen);
     for(i = 0; i < 26; i++) {
@@ -844,20 +879,29 @@ static int riscv_build_fdt(RISCVMachine *m, uint8_t *dst,
             *q++ = 'a' + i;
     }
     *q = '\0';
-    fdt_prop_str(s, "riscv,isa", isa_string);
-    
-    fdt_prop_str(s, "mmu-type", max_xlen <= 32 ? "riscv,sv32" : "riscv,sv48");
-    fdt_prop_u32(s, "clock-frequency", (m->common.virt_machine_params->sim_params->cpu_freq_mhz * 1000000));
 
-    fdt_begin_node(s, "interrupt-controller");
-    fdt_prop_u32(s, "#interrupt-cells", 1);
-    fdt_prop(s, "interrupt-controller", NULL, 0);
-    fdt_prop_str(s, "compatible", "riscv,cpu-intc");
-    intc_phandle = cur_phandle++;
-    fdt_prop_u32(s, "phandle", intc_phandle);
-    fdt_end_node(s); /* interrupt-controller */
-    
-    fdt_end_node(s); /* cpu */
+    for(hart = 0; hart < m->ncpus; hart++) {
+        /* cpu */
+        fdt_begin_node_num(s, "cpu", hart);
+        fdt_prop_str(s, "device_type", "cpu");
+        fdt_prop_u32(s, "reg", hart);
+        fdt_prop_str(s, "status", "okay");
+        fdt_prop_str(s, "compatible", "riscv");
+        fdt_prop_str(s, "riscv,isa", isa_string);
+
+        fdt_prop_str(s, "mmu-type", max_xlen <= 32 ? "riscv,sv32" : "riscv,sv48");
+        fdt_prop_u32(s, "clock-frequency", (m->common.virt_machine_params->sim_params->cpu_freq_mhz * 1000000));
+
+        fdt_begin_node(s, "interrupt-controller");
+        fdt_prop_u32(s, "#interrupt-cells", 1);
+        fdt_prop(s, "interrupt-controller", NULL, 0);
+        fdt_prop_str(s, "compatible", "riscv,cpu-intc");
+        intc_phandle[hart] = cur_phandle++;
+        fdt_prop_u32(s, "phandle", intc_phandle[hart]);
+        fdt_end_node(s); /* interrupt-controller */
+
+        fdt_end_node(s); /* cpu */
+    }
     
     fdt_end_node(s); /* cpus */
 
@@ -881,11 +925,13 @@ static int riscv_build_fdt(RISCVMachine *m, uint8_t *dst,
     fdt_begin_node_num(s, "clint", CLINT_BASE_ADDR);
     fdt_prop_str(s, "compatible", "riscv,clint0");
 
-    tab[0] = intc_phandle;
-    tab[1] = 3; /* M IPI irq */
-    tab[2] = intc_phandle;
-    tab[3] = 7; /* M timer irq */
-    fdt_prop_tab_u32(s, "interrupts-extended", tab, 4);
+    for(hart = 0; hart < m->ncpus; hart++) {
+        tab[4 * hart] = intc_phandle[hart];
+        tab[4 * hart + 1] = 3; /* M IPI irq */
+        tab[4 * hart + 2] = intc_phandle[hart];
+        tab[4 * hart + 3] = 7; /* M timer irq */
+    }
+    fdt_prop_tab_u32(s, "interrupts-extended", tab, 4 * m->ncpus);
 
     fdt_prop_tab_u64_2(s, "reg", CLINT_BASE_ADDR, CLINT_SIZE);
     
@@ -898,9 +944,10 @@ static int riscv_build_fdt(RISCVMachine *m, uint8_t *dst,
     fdt_prop_u32(s, "riscv,ndev", 31);
     fdt_prop_tab_u64_2(s, "reg", PLIC_BASE_ADDR, PLIC_SIZE);
 
-    tab[0] = intc_phandle;
+    /* external interrupts are only routed to hart 0 */
+    tab[0] = intc_phandle[0];
     tab[1] = 9; /* S ext irq */
-    tab[2] = intc_phandle;
+    tab[2] = intc_phandle[0];
     tab[3] = 11; /* M ext irq */
     fdt_prop_tab_u32(s, "interrupts-extended", tab, 4);
 
@@ -1083,19 +1130,161 @@ static void riscv_flush_tlb_write_range(void *opaque, uint8_t *ram_addr,
                                         size_t ram_size)
 {
     RISCVMachine *s = opaque;
-    riscv_cpu_flush_tlb_write_range_ram(s->cpu_state, ram_addr, ram_size);
+    int i;
+    for(i = 0; i < s->ncpus; i++)
+        riscv_cpu_flush_tlb_write_range_ram(s->cpu_state[i], ram_addr, ram_size);
 }
 
 static void riscv_machine_set_defaults(VirtMachineParams *p)
 {
 }
 
+/* run the hart in simulation until the end of its slice */
+static void riscv_machine_run_hart(RISCVMachine *m, int hartid)
+{
+    RISCVCPUState *s = m->cpu_state[hartid];
+    SimParams *p = m->common.virt_machine_params->sim_params;
+
+    rtc_hart = s;
+    while (!riscv_cpu_get_power_down(s) &&
+           !riscv_sim_cpu_slice_done(s->simcpu))
+        riscv_cpu_interp(s, p->sim_quantum_cycles);
+    riscv_sim_cpu_end_slice(s->simcpu);
+    rtc_hart = NULL;
+}
+
+static void *riscv_machine_hart_thread(void *opaque)
+{
+    RISCVHartThread *t = opaque;
+    RISCVMachine *m = t->m;
+    uint64_t slice = 0;
+
+    pthread_mutex_lock(&m->hart_lock);
+    for(;;) {
+        while (m->hart_slice == slice && !m->harts_exit)
+            pthread_cond_wait(&m->hart_start_cond, &m->hart_lock);
+        if (m->harts_exit)
+            break;
+        slice = m->hart_slice;
+        pthread_mutex_unlock(&m->hart_lock);
+
+        riscv_machine_run_hart(m, t->hartid);
+
+        pthread_mutex_lock(&m->hart_lock);
+        if (--m->harts_running == 0)
+            pthread_cond_signal(&m->hart_done_cond);
+    }
+    pthread_mutex_unlock(&m->hart_lock);
+    return NULL;
+}
+
+static void riscv_machine_start_hart_threads(RISCVMachine *m)
+{
+    int i;
+
+    pthread_mutex_init(&m->hart_lock, NULL);
+    pthread_cond_init(&m->hart_start_cond, NULL);
+    pthread_cond_init(&m->hart_done_cond, NULL);
+    for(i = 1; i < m->ncpus; i++) {
+        m->hart_thread[i].m = m;
+        m->hart_thread[i].hartid = i;
+        if (pthread_create(&m->hart_thread[i].thread, NULL,
+                           riscv_machine_hart_thread, &m->hart_thread[i])) {
+            vm_error("could not create the thread of hart %d\n", i);
+            exit(1);
+        }
+    }
+}
+
+static void riscv_machine_stop_hart_threads(RISCVMachine *m)
+{
+    int i;
+
+    pthread_mutex_lock(&m->hart_lock);
+    m->harts_exit = TRUE;
+    pthread_cond_broadcast(&m->hart_start_cond);
+    pthread_mutex_unlock(&m->hart_lock);
+    for(i = 1; i < m->ncpus; i++)
+        pthread_join(m->hart_thread[i].thread, NULL);
+    pthread_cond_destroy(&m->hart_done_cond);
+    pthread_cond_destroy(&m->hart_start_cond);
+    pthread_mutex_destroy(&m->hart_lock);
+}
+
+/* save or restore the state of the harts and of the devices. The machine
+   must have been built with the same configuration. */
+static int riscv_machine_checkpoint(RISCVMachine *s, const char *filename,
+                                    BOOL is_restore)
+{
+    Checkpoint *ck;
+    uint64_t rtc_time;
+    int i;
+
+    ck = checkpoint_open(filename, is_restore);
+    if (!ck)
+        return -1;
+
+    checkpoint_section(ck, "machine");
+    checkpoint_check_u64(ck, s->max_xlen);
+    checkpoint_check_u64(ck, s->ncpus);
+    checkpoint_check_u64(ck, s->ram_size);
+    checkpoint_check_u64(ck, s->virtio_count);
+    checkpoint_check_u64(ck, s->rtc_real_time);
+
+    /* the guest time goes on from the saved value */
+    rtc_time = rtc_get_elasped_time(s->rtc);
+    checkpoint_data(ck, &rtc_time, sizeof(rtc_time));
+    if (is_restore)
+        s->rtc->start_time = rtc_get_host_wall_clock_time(s->rtc) - rtc_time;
+
+    checkpoint_field(ck, s, timecmp);
+    checkpoint_field(ck, s, plic_pending_irq);
+    checkpoint_field(ck, s, plic_served_irq);
+    checkpoint_field(ck, s, htif_tohost);
+    checkpoint_field(ck, s, htif_fromhost);
+    checkpoint_field(ck, s, uart_dll);
+    checkpoint_field(ck, s, uart_dlm);
+    checkpoint_field(ck, s, uart_ier);
+    checkpoint_field(ck, s, uart_fcr);
+    checkpoint_field(ck, s, uart_lcr);
+    checkpoint_field(ck, s, uart_mcr);
+    checkpoint_field(ck, s, uart_scr);
+    checkpoint_field(ck, s, uart_rx_pending);
+    checkpoint_field(ck, s, uart_tx_pending);
+    checkpoint_field(ck, s, uart_rx_head);
+    checkpoint_field(ck, s, uart_rx_tail);
+    checkpoint_field(ck, s, uart_rx_buf);
+
+    for(i = 0; i < s->ncpus; i++)
+        riscv_cpu_checkpoint(s->cpu_state[i], ck);
+    for(i = 0; i < s->virtio_count; i++)
+        virtio_checkpoint(s->virtio_dev[i], ck);
+    phys_mem_checkpoint(s->mem_map, ck);
+
+    if (ck->error)
+        vm_error("%s: checkpoint does not match this machine\n", filename);
+    return checkpoint_close(ck);
+}
+
+/* called when a hart has stopped on the SIM_START CSR access: the
+   emulator exits once the machine is saved */
+static void riscv_machine_save_and_exit(RISCVMachine *s)
+{
+    if (riscv_machine_checkpoint(s, s->checkpoint_file, FALSE) < 0) {
+        vm_error("%s: could not save the checkpoint\n", s->checkpoint_file);
+        exit(1);
+    }
+    fprintf(stderr, "Checkpoint saved in %s\n", s->checkpoint_file);
+    exit(0);
+}
+
 static VirtMachine *riscv_machine_init(const VirtMachineParams *p)
 {
     RISCVMachine *s;
-    VIRTIODevice *blk_dev;
+    VIRTIODevice *blk_dev, *net_dev;
     int irq_num, i, max_xlen, ram_flags;
     VIRTIOBusDef vbus_s, *vbus = &vbus_s;
+    PhysMemoryRange *pr;
 
 
     if (!strcmp(p->machine_name, "riscv32")) {
@@ -1123,21 +1312,28 @@ static VirtMachine *riscv_machine_init(const VirtMachineParams *p)
     /* Validate all the simulation parameters before initializing core */
     sim_params_validate(p->sim_params);
 
-    s->cpu_state = riscv_cpu_init(s->mem_map, max_xlen, p->sim_params);
-    if (!s->cpu_state) {
-        vm_error("unsupported max_xlen=%d\n", max_xlen);
-        /* XXX: should free resources */
-        return NULL;
+    s->ncpus = p->sim_params->num_cores;
+    for(i = 0; i < s->ncpus; i++) {
+        s->cpu_state[i] = riscv_cpu_init(s->mem_map, max_xlen, p->sim_params,
+                                         i, i ? s->cpu_state[0] : NULL);
+        if (!s->cpu_state[i]) {
+            vm_error("unsupported max_xlen=%d\n", max_xlen);
+            /* XXX: should free resources */
+            return NULL;
+        }
     }
-    /* RAM */
-    ram_flags = 0;
+    /* RAM: a checkpoint only saves the pages written since boot */
+    ram_flags = DEVRAM_FLAG_DIRTY_BITS;
     cpu_register_ram(s->mem_map, RAM_BASE_ADDR, p->ram_size, ram_flags);
     cpu_register_ram(s->mem_map, 0x00000000, LOW_RAM_SIZE, 0);
     s->rtc_real_time = p->rtc_real_time;
     s->rtc = rtc_init(p->sim_params->rtc_freq_mhz * 1000000);
-    s->cpu_state->rtc = s->rtc;
+    for(i = 0; i < s->ncpus; i++)
+        s->cpu_state[i]->rtc = s->rtc;
     // PIM area size = PIM device size - RAM size
-    cpu_register_pim(s->mem_map, PIM_BASE_ADDR, PIM_SIZE - p->ram_size, p->ram_size);
+    pr = cpu_register_pim(s->mem_map, PIM_BASE_ADDR, PIM_SIZE - p->ram_size,
+                          p->ram_size, p->pim_file);
+    pim_datapath_set_data_type(pr->pim_dp, p->pim_data_type);
 
     cpu_register_device(s->mem_map, CLINT_BASE_ADDR, CLINT_SIZE, s,
                         clint_read, clint_write, DEVIO_SIZE32);
@@ -1164,27 +1360,26 @@ static VirtMachine *riscv_machine_init(const VirtMachineParams *p)
         s->common.console_dev = virtio_console_init(vbus, p->console);
         vbus->addr += VIRTIO_SIZE;
         irq_num++;
-        s->virtio_count++;
+        s->virtio_dev[s->virtio_count++] = s->common.console_dev;
     }
     
     /* virtio net device */
     for(i = 0; i < p->eth_count; i++) {
         vbus->irq = &s->plic_irq[irq_num];
-        virtio_net_init(vbus, p->tab_eth[i].net);
+        net_dev = virtio_net_init(vbus, p->tab_eth[i].net);
         s->common.net = p->tab_eth[i].net;
         vbus->addr += VIRTIO_SIZE;
         irq_num++;
-        s->virtio_count++;
+        s->virtio_dev[s->virtio_count++] = net_dev;
     }
 
     /* virtio block device */
     for(i = 0; i < p->drive_count; i++) {
         vbus->irq = &s->plic_irq[irq_num];
         blk_dev = virtio_block_init(vbus, p->tab_drive[i].block_dev);
-        (void)blk_dev;
         vbus->addr += VIRTIO_SIZE;
         irq_num++;
-        s->virtio_count++;
+        s->virtio_dev[s->virtio_count++] = blk_dev;
     }
 
     /* virtio filesystem */
@@ -1193,11 +1388,10 @@ static VirtMachine *riscv_machine_init(const VirtMachineParams *p)
         vbus->irq = &s->plic_irq[irq_num];
         fs_dev = virtio_9p_init(vbus, p->tab_fs[i].fs_dev,
                                 p->tab_fs[i].tag);
-        (void)fs_dev;
         //        virtio_set_debug(fs_dev, VIRTIO_DEBUG_9P);
         vbus->addr += VIRTIO_SIZE;
         irq_num++;
-        s->virtio_count++;
+        s->virtio_dev[s->virtio_count++] = fs_dev;
     }
 
     if (p->display_device) {
@@ -1223,14 +1417,14 @@ static VirtMachine *riscv_machine_init(const VirtMachineParams *p)
                                                 VIRTIO_INPUT_TYPE_KEYBOARD);
             vbus->addr += VIRTIO_SIZE;
             irq_num++;
-            s->virtio_count++;
+            s->virtio_dev[s->virtio_count++] = s->keyboard_dev;
 
             vbus->irq = &s->plic_irq[irq_num];
             s->mouse_dev = virtio_input_init(vbus,
                                              VIRTIO_INPUT_TYPE_TABLET);
             vbus->addr += VIRTIO_SIZE;
             irq_num++;
-            s->virtio_count++;
+            s->virtio_dev[s->virtio_count++] = s->mouse_dev;
         } else {
             vm_error("unsupported input device: %s\n", p->input_device);
             exit(1);
@@ -1251,10 +1445,34 @@ static VirtMachine *riscv_machine_init(const VirtMachineParams *p)
                 p->cmdline);
     }
 
+    /* the 9P file systems hold host state (open files, fids) */
+    if ((p->checkpoint_file || p->restore_file) && p->fs_count > 0) {
+        vm_error("checkpoints are not supported with a 9P file system\n");
+        exit(1);
+    }
+    if (p->checkpoint_file) {
+        if (p->sim_params->start_in_sim) {
+            vm_error("-checkpoint cannot be used with -simstart\n");
+            exit(1);
+        }
+        s->checkpoint_file = strdup(p->checkpoint_file);
+        for(i = 0; i < s->ncpus; i++)
+            s->cpu_state[i]->stop_at_sim_start = TRUE;
+    }
+    if (p->restore_file &&
+        riscv_machine_checkpoint(s, p->restore_file, TRUE) < 0) {
+        vm_error("%s: could not restore the checkpoint\n", p->restore_file);
+        exit(1);
+    }
+
+    s->parallel_sim = p->sim_params->parallel_sim && s->ncpus > 1;
+    if (s->parallel_sim)
+        riscv_machine_start_hart_threads(s);
+
     /* We are booting TinyEMU in simulation mode */
     if (p->sim_params->start_in_sim)
     {
-        riscv_sim_cpu_start(s->cpu_state->simcpu, s->cpu_state->simcpu->pc);
+        riscv_sim_cpu_start(s->cpu_state[0]->simcpu, s->cpu_state[0]->simcpu->pc);
     }
 
     return (VirtMachine *)s;
@@ -1263,10 +1481,16 @@ static VirtMachine *riscv_machine_init(const VirtMachineParams *p)
 static void riscv_machine_end(VirtMachine *s1)
 {
     RISCVMachine *s = (RISCVMachine *)s1;
+    int i;
     /* XXX: stop all */
+    if (s->parallel_sim)
+        riscv_machine_stop_hart_threads(s);
 
-    riscv_cpu_end(s->cpu_state);
+    /* hart 0 owns the simulated memory system shared by the other harts */
+    for(i = s->ncpus - 1; i >= 0; i--)
+        riscv_cpu_end(s->cpu_state[i]);
     rtc_free(&s->rtc);
+    free(s->checkpoint_file);
     sim_params_free(s->common.virt_machine_params->sim_params);
     phys_mem_map_end(s->mem_map);
     free(s);
@@ -1276,31 +1500,80 @@ static void riscv_machine_end(VirtMachine *s1)
 static int riscv_machine_get_sleep_duration(VirtMachine *s1, int delay)
 {
     RISCVMachine *m = (RISCVMachine *)s1;
-    RISCVCPUState *s = m->cpu_state;
+    RISCVCPUState *s;
     int64_t delay1;
+    int i;
     
     /* wait for an event: the only asynchronous event is the RTC timer */
-    if (!(riscv_cpu_get_mip(s) & MIP_MTIP)) {
-        delay1 = m->timecmp - rtc_get_time(m);
-        if (delay1 <= 0) {
-            riscv_cpu_set_mip(s, MIP_MTIP);
-            delay = 0;
-        } else {
-            /* convert delay to ms */
-            delay1 = delay1 / (m->rtc->freq / 1000);
-            if (delay1 < delay)
-                delay = delay1;
+    for(i = 0; i < m->ncpus; i++) {
+        s = m->cpu_state[i];
+        if (!(riscv_cpu_get_mip(s) & MIP_MTIP)) {
+            /* the harts are stopped between the slices of a parallel
+               simulation, so their clocks can be read here */
+            if (m->parallel_sim && riscv_cpu_in_simulation(s))
+                delay1 = m->timecmp[i] - rtc_get_hart_time(m, s);
+            else
+                delay1 = m->timecmp[i] - rtc_get_time(m);
+            if (delay1 <= 0) {
+                riscv_cpu_set_mip(s, MIP_MTIP);
+                delay = 0;
+            } else {
+                /* convert delay to ms */
+                delay1 = delay1 / (m->rtc->freq / 1000);
+                if (delay1 < delay)
+                    delay = delay1;
+            }
         }
+        if (!riscv_cpu_get_power_down(s))
+            delay = 0;
     }
-    if (!riscv_cpu_get_power_down(s))
-        delay = 0;
     return delay;
 }
 
 static void riscv_machine_interp(VirtMachine *s1, int max_exec_cycle)
 {
     RISCVMachine *s = (RISCVMachine *)s1;
-    riscv_cpu_interp(s->cpu_state, max_exec_cycle);
+    int i;
+
+    if (s->ncpus == 1) {
+        riscv_cpu_interp(s->cpu_state[0], max_exec_cycle);
+        if (s->cpu_state[0]->sim_start_pending)
+            riscv_machine_save_and_exit(s);
+        return;
+    }
+
+    /* in simulation, each hart runs max_exec_cycle simulated cycles on its
+       own thread, and they synchronize every quantum */
+    if (s->parallel_sim && riscv_cpu_in_simulation(s->cpu_state[0])) {
+        for(i = 0; i < s->ncpus; i++)
+            riscv_sim_cpu_begin_slice(s->cpu_state[i]->simcpu, max_exec_cycle);
+
+        pthread_mutex_lock(&s->hart_lock);
+        s->harts_running = s->ncpus - 1;
+        s->hart_slice++;
+        pthread_cond_broadcast(&s->hart_start_cond);
+        pthread_mutex_unlock(&s->hart_lock);
+
+        riscv_machine_run_hart(s, 0);
+
+        pthread_mutex_lock(&s->hart_lock);
+        while (s->harts_running > 0)
+            pthread_cond_wait(&s->hart_done_cond, &s->hart_lock);
+        pthread_mutex_unlock(&s->hart_lock);
+
+        /* one of the harts may have stopped the simulation */
+        riscv_sim_cpu_sync_stop(s->cpu_state[0]->simcpu);
+        return;
+    }
+
+    /* the harts are time-multiplexed: each one runs a slice in turn, and a
+       pending LR reservation does not survive a switch to another hart */
+    for(i = 0; i < s->ncpus; i++) {
+        riscv_cpu_interp(s->cpu_state[i], max_exec_cycle / s->ncpus);
+        s->cpu_state[i]->load_res = ~0;
+        if (s->cpu_state[i]->sim_start_pending)
+            riscv_machine_save_and_exit(s);
+    }
 }
 
 static void riscv_vm_send_key_event(VirtMachine *s1, BOOL is_down,
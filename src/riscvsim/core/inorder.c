@@ -217,11 +217,19 @@ in_core_run(void *core_type)
 {
     INCore *core = (INCore *)core_type;
     RISCVCPUState *s = core->simcpu->emu_cpu_state;
+    MemoryController *m = s->simcpu->mem_hierarchy->mem_controller;
 
     while (1)
     {
+        /* With parallel_sim, the DRAM models serve the requests of all the
+         * cores at the end of the quantum */
+        if (m->shares_backends && (m->clock >= m->quantum_end))
+        {
+            riscv_sim_cpu_end_quantum(s->simcpu);
+        }
+
         /* Advance DRAM clock */
-        mem_controller_clock(s->simcpu->mem_hierarchy->mem_controller);
+        mem_controller_clock(m);
 
         /* For 5-stage pipeline calls in_core_run_5_stage(), For 6-stage
          * pipeline calls in_core_run_6_stage() */
@@ -283,7 +283,6 @@ flush_fu_stage(INCore *core, CPUStage *fu, int stages)
 static void
 flush_speculated_cpu_state(INCore *core, InstructionLatch *e)
 {
-    int i;
     RISCVCPUState *s = core->simcpu->emu_cpu_state;
 
     /* Send target PC to pcgen */
@@ -327,13 +326,18 @@ flush_speculated_cpu_state(INCore *core, InstructionLatch *e)
     s->simcpu->exception->pending = FALSE;
 
     /* Reset all the insn_latch_pool entries allocated on the speculated path */
-    for (i = 0; i < INSN_LATCH_POOL_SIZE; ++i)
+    reset_insn_latch_pool(s->simcpu->insn_latch_pool);
+    if (core->memory.insn_latch_index != -1)
     {
-        if ((i != core->memory.insn_latch_index)
-            && (i != core->commit.insn_latch_index))
-        {
-            s->simcpu->insn_latch_pool[i].status = INSN_LATCH_FREE;
-        }
+        insn_latch_reserve(s->simcpu->insn_latch_pool,
+                           get_insn_latch(s->simcpu->insn_latch_pool,
+                                          core->memory.insn_latch_index));
+    }
+    if (core->commit.insn_latch_index != -1)
+    {
+        insn_latch_reserve(s->simcpu->insn_latch_pool,
+                           get_insn_latch(s->simcpu->insn_latch_pool,
+                                          core->commit.insn_latch_index));
     }
 }
 
@@ -463,6 +467,64 @@ in_core_memory(INCore *core)
 =            Instruction Commit Stage            =
 ================================================*/
 
+/* Returns the older of oldest and the instruction in stage */
+static InstructionLatch *
+get_older_insn(const INCore *core, const CPUStage *stage,
+               InstructionLatch *oldest)
+{
+    InstructionLatch *e;
+
+    if (!stage->has_data)
+    {
+        return oldest;
+    }
+
+    e = get_insn_latch(core->simcpu->insn_latch_pool, stage->insn_latch_index);
+    if (!oldest || (e->ins_dispatch_id < oldest->ins_dispatch_id))
+    {
+        return e;
+    }
+
+    return oldest;
+}
+
+static InstructionLatch *
+get_older_insn_in_pipe(const INCore *core, const CPUStage *pipe,
+                       int num_stages, InstructionLatch *oldest)
+{
+    int i;
+
+    for (i = 0; i < num_stages; ++i)
+    {
+        oldest = get_older_insn(core, &pipe[i], oldest);
+    }
+
+    return oldest;
+}
+
+/* A cycle in which nothing committed is attributed to the oldest instruction
+ * past decode, or to the front-end if there is none */
+static void
+in_core_profile_stall(INCore *core)
+{
+    const SimParams *p = core->simcpu->params;
+    InstructionLatch *e, *fe;
+
+    e = get_older_insn(core, &core->memory, NULL);
+    e = get_older_insn_in_pipe(core, core->ialu, p->num_alu_stages, e);
+    e = get_older_insn_in_pipe(core, core->imul, p->num_mul_stages, e);
+    e = get_older_insn_in_pipe(core, core->idiv, p->num_div_stages, e);
+    e = get_older_insn_in_pipe(core, core->fpu_fma, p->num_fpu_fma_stages, e);
+    e = get_older_insn(core, &core->fpu_alu, e);
+
+    fe = get_older_insn(core, &core->decode, NULL);
+    fe = get_older_insn(core, &core->fetch, fe);
+    fe = get_older_insn(core, &core->pcgen, fe);
+
+    sim_profile_stall(core->simcpu->profile, e,
+                      fe ? fe->ins.pc : core->simcpu->pc, 1);
+}
+
 int
 in_core_commit(INCore *core)
 {
@@ -513,12 +575,13 @@ in_core_commit(INCore *core)
         }
 
         /* Commit success */
-        e->status = INSN_LATCH_FREE;
+        insn_latch_free(s->simcpu->insn_latch_pool, e);
         cpu_stage_flush(&core->commit);
 
-        /* Check for user specified sim_emulate_after_icount instructions */
-        if (s->sim_params->sim_emulate_after_icount
-            && (s->simcpu->icount >= s->sim_params->sim_emulate_after_icount))
+        /* Check for the end of sim_emulate_after_icount instructions, or of
+         * the detailed window in sampled simulation */
+        if (s->simcpu->icount_limit
+            && (s->simcpu->icount >= s->simcpu->icount_limit))
         {
             e->ins.exception_cause = SIM_ICOUNT_COMPLETE_EXCEPTION;
             sim_exception_set(s->simcpu->exception, e);
@@ -533,6 +596,10 @@ in_core_commit(INCore *core)
             return -1;
         }
     }
+    else if (s->simcpu->profile)
+    {
+        in_core_profile_stall(core);
+    }
     return 0;
 }
 /*=====  End of Instruction Commit Stage  ======*/
\ No newline at end of file
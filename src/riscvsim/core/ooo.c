@@ -25,6 +25,7 @@
  * THE SOFTWARE.
  */
 #include <stdlib.h>
+#include <string.h>
 
 #include "../../cutils.h"
 #include "../../riscv_cpu_priv.h"
@@ -58,6 +59,7 @@ oo_core_log_config(const OOCore *core)
 OOCore *
 oo_core_init(const SimParams *p, struct RISCVSIMCPUState *simcpu)
 {
+    int i;
     OOCore *core;
 
     core = calloc(1, sizeof(OOCore));
@@ -72,6 +74,13 @@ oo_core_init(const SimParams *p, struct RISCVSIMCPUState *simcpu)
     cq_init(&core->lsq.cq, p->lsq_size);
     core->lsq.entries = (LSQEntry *)calloc(p->lsq_size, sizeof(LSQEntry));
     assert(core->lsq.entries);
+    for (i = 0; i < p->lsq_size; ++i)
+    {
+        core->lsq.entries[i].miss_queue.max_size = LSQ_MISS_QUEUE_SIZE;
+        core->lsq.entries[i].miss_queue.entry = (PendingMemAccessEntry *)calloc(
+            LSQ_MISS_QUEUE_SIZE, sizeof(PendingMemAccessEntry));
+        assert(core->lsq.entries[i].miss_queue.entry);
+    }
 
     /* Create Rename tables */
     core->int_rat
@@ -109,6 +118,7 @@ oo_core_reset(void *core_type)
     core = (OOCore *)core_type;
 
     core->ins_dispatch_id = 0;
+    core->stalled = FALSE;
 
     /* Reset front-end stages */
     cpu_stage_flush(&core->fetch);
@@ -135,6 +145,10 @@ oo_core_reset(void *core_type)
     }
 
     cq_reset(&core->rob.cq);
+    for (i = 0; i < core->lsq.cq.max_size; ++i)
+    {
+        oo_core_lsq_flush_entry(core, &core->lsq.entries[i]);
+    }
     cq_reset(&core->lsq.cq);
     iq_reset(core->iq, core->simcpu->params->iq_size);
 
@@ -198,6 +212,7 @@ iq_get_free_entry(const IssueQueueEntry *iq, int size)
 void
 oo_core_free(void *core_type)
 {
+    int i;
     OOCore *core;
 
     core = (OOCore *)(*((OOCore **)core_type));
@@ -207,6 +222,10 @@ oo_core_free(void *core_type)
     core->fp_rat = NULL;
     free(core->rob.entries);
     core->rob.entries = NULL;
+    for (i = 0; i < core->lsq.cq.max_size; ++i)
+    {
+        free(core->lsq.entries[i].miss_queue.entry);
+    }
     free(core->lsq.entries);
     core->lsq.entries = NULL;
     free(core->iq);
@@ -222,16 +241,301 @@ oo_core_free(void *core_type)
     free(core);
 }
 
+/* Pipeline state read by the stages while the core waits on the memory
+ * controller. If a cycle leaves it unchanged, the following cycles leave it
+ * unchanged too, until the memory controller updates one of the stage queues.
+ */
+typedef struct OOCoreStallState
+{
+    uint64_t icount;
+    uint64_t ins_dispatch_id;
+    int priv;
+    int skip_fetch_cycle;
+    int rob_front;
+    int rob_rear;
+    int rob_ready;
+    int lsq_front;
+    int lsq_rear;
+    int lsq_ready;
+    int lsq_mem_request_sent;
+    int lsq_mem_request_complete;
+    int lsq_parked;
+    int lsq_miss_queue_size;
+    int iq_valid;
+    int iq_ready;
+    int iq_read;
+    CPUStage fetch;
+    CPUStage decode;
+    CPUStage dispatch;
+    CPUStage lsu;
+    int fetch_signal_sent;
+    int lsu_signal_sent;
+    int queue_size[3];
+    int queue_idx[3];
+} OOCoreStallState;
+
+static const StageMemAccessQueue *
+get_stage_queue(const MemoryController *m, int i)
+{
+    switch (i)
+    {
+        case 0:
+        {
+            return &m->frontend_mem_access_queue;
+        }
+        case 1:
+        {
+            return &m->backend_mem_access_queue;
+        }
+        default:
+        {
+            return &m->backend_aim_queue;
+        }
+    }
+}
+
+/* The fills of MSHRs drain the miss queues of the parked loads, like the
+ * stage queues */
+static int
+get_lsq_miss_queue_size(const OOCore *core)
+{
+    int i;
+    int size = 0;
+
+    for (i = 0; i < core->lsq.cq.max_size; ++i)
+    {
+        if (core->lsq.entries[i].parked)
+        {
+            size += core->lsq.entries[i].miss_queue.cur_size;
+        }
+    }
+
+    return size;
+}
+
+/* Whether fetch or LSU is empty, or done with the cache lookup and waiting on
+ * the memory controller */
+static int
+stage_waits_on_memory(const OOCore *core, const CPUStage *stage)
+{
+    const InstructionLatch *e;
+
+    if (!stage->has_data)
+    {
+        return TRUE;
+    }
+
+    if (!stage->stage_exec_done)
+    {
+        return FALSE;
+    }
+
+    e = get_insn_latch(core->simcpu->insn_latch_pool, stage->insn_latch_index);
+    return e->elapsed_clock_cycles == e->max_clock_cycles;
+}
+
+static int
+fu_is_idle(const CPUStage *stage, int num_stages)
+{
+    int i;
+
+    for (i = 0; i < num_stages; ++i)
+    {
+        if (stage[i].has_data)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/* Cheap check done before taking the stall state: no stage is counting down a
+ * latency on its own */
+static int
+oo_core_waits_on_memory(const OOCore *core)
+{
+    const SimParams *p = core->simcpu->params;
+
+    return stage_waits_on_memory(core, &core->fetch)
+           && stage_waits_on_memory(core, &core->lsu)
+           && fu_is_idle(core->ialu, p->num_alu_stages)
+           && fu_is_idle(core->imul, p->num_mul_stages)
+           && fu_is_idle(core->idiv, p->num_div_stages)
+           && fu_is_idle(core->fpu_fma, p->num_fpu_fma_stages)
+           && fu_is_idle(&core->fpu_alu, 1);
+}
+
+static void
+oo_core_get_stall_state(const OOCore *core, OOCoreStallState *st)
+{
+    int i;
+    const LSQEntry *lsqe;
+    const InstructionLatch *e;
+    const MemoryController *m = core->simcpu->mem_hierarchy->mem_controller;
+
+    /* Zero the padding too, as the states are compared with memcmp() */
+    memset(st, 0, sizeof(OOCoreStallState));
+
+    st->icount = core->simcpu->icount;
+    st->ins_dispatch_id = core->ins_dispatch_id;
+    st->priv = core->simcpu->emu_cpu_state->priv;
+    st->skip_fetch_cycle = core->simcpu->skip_fetch_cycle;
+
+    st->rob_front = core->rob.cq.front;
+    st->rob_rear = core->rob.cq.rear;
+    for (i = 0; i < core->simcpu->params->rob_size; ++i)
+    {
+        st->rob_ready += core->rob.entries[i].ready;
+    }
+
+    /* oo_core_lsq() goes past the LSQ top when loads are parked */
+    st->lsq_front = core->lsq.cq.front;
+    st->lsq_rear = core->lsq.cq.rear;
+    for (i = 0; i < core->lsq.cq.max_size; ++i)
+    {
+        lsqe = &core->lsq.entries[i];
+        st->lsq_ready += lsqe->ready;
+        st->lsq_mem_request_sent += lsqe->mem_request_sent;
+        st->lsq_mem_request_complete += lsqe->mem_request_complete;
+        st->lsq_parked += lsqe->parked;
+    }
+    st->lsq_miss_queue_size = get_lsq_miss_queue_size(core);
+
+    for (i = 0; i < core->simcpu->params->iq_size; ++i)
+    {
+        if (core->iq[i].valid)
+        {
+            e = core->iq[i].e;
+            ++st->iq_valid;
+            st->iq_ready += core->iq[i].ready;
+            st->iq_read += e->read_rs1 + e->read_rs2 + e->read_rs3;
+        }
+    }
+
+    st->fetch = core->fetch;
+    st->decode = core->decode;
+    st->dispatch = core->dispatch;
+    st->lsu = core->lsu;
+
+    if (core->fetch.has_data && core->fetch.stage_exec_done)
+    {
+        e = get_insn_latch(core->simcpu->insn_latch_pool,
+                           core->fetch.insn_latch_index);
+        st->fetch_signal_sent = e->cache_lookup_complete_signal_sent;
+    }
+
+    if (core->lsu.has_data && core->lsu.stage_exec_done)
+    {
+        e = get_insn_latch(core->simcpu->insn_latch_pool,
+                           core->lsu.insn_latch_index);
+        st->lsu_signal_sent = e->cache_lookup_complete_signal_sent;
+    }
+
+    for (i = 0; i < 3; ++i)
+    {
+        st->queue_size[i] = get_stage_queue(m, i)->cur_size;
+        st->queue_idx[i] = get_stage_queue(m, i)->cur_idx;
+    }
+}
+
+static int
+stage_queues_changed(const OOCore *core, const OOCoreStallState *st)
+{
+    int i;
+    const MemoryController *m = core->simcpu->mem_hierarchy->mem_controller;
+
+    for (i = 0; i < 3; ++i)
+    {
+        if (get_stage_queue(m, i)->cur_size != st->queue_size[i])
+        {
+            return TRUE;
+        }
+    }
+
+    return get_lsq_miss_queue_size(core) != st->lsq_miss_queue_size;
+}
+
+/* Account for cycles in which the stages would only have updated the stall
+ * stats */
+static void
+oo_core_skip_stall_cycles(OOCore *core, int cycles)
+{
+    SimStats *stats;
+
+    stats = &core->simcpu->stats[core->simcpu->emu_cpu_state->priv];
+    core->simcpu->clock += cycles;
+    stats->cycles += cycles;
+    stats->insn_mem_delay += cycles * core->stall_insn_mem_delay;
+    stats->data_mem_delay += cycles * core->stall_data_mem_delay;
+    stats->pim_mem_delay += cycles * core->stall_pim_mem_delay;
+
+    /* A stalled pipeline commits nothing */
+    if (core->simcpu->profile)
+    {
+        oo_core_profile_stall(core, cycles);
+    }
+}
+
 int
 oo_core_run(void *core_type)
 {
     OOCore *core;
+    MemoryController *m;
+    SimStats *stats;
+    OOCoreStallState before, after;
+    uint64_t insn_mem_delay = 0, data_mem_delay = 0, pim_mem_delay = 0;
+    int waits_on_memory, cycles;
 
     core = (OOCore *)core_type;
+    m = core->simcpu->mem_hierarchy->mem_controller;
+    core->stalled = FALSE;
     while (1)
     {
-        /* Advance DRAM clock */
-        mem_controller_clock(core->simcpu->mem_hierarchy->mem_controller);
+        /* With parallel_sim, the DRAM models serve the requests of all the
+         * cores at the end of the quantum, which may unblock the pipeline */
+        if (m->shares_backends && (m->clock >= m->quantum_end))
+        {
+            riscv_sim_cpu_end_quantum(core->simcpu);
+            core->stalled = FALSE;
+        }
+
+        if (core->stalled)
+        {
+            /* The pipeline is stalled until the memory controller updates one
+             * of the stage queues. With the base DRAM model, jump straight to
+             * the next request completion. */
+            cycles = mem_controller_get_idle_cycles(m);
+            if (cycles)
+            {
+                mem_controller_skip_cycles(m, cycles);
+                oo_core_skip_stall_cycles(core, cycles);
+                continue;
+            }
+
+            mem_controller_clock(m);
+            if (!stage_queues_changed(core, &after))
+            {
+                oo_core_skip_stall_cycles(core, 1);
+                continue;
+            }
+            core->stalled = FALSE;
+        }
+        else
+        {
+            /* Advance DRAM clock */
+            mem_controller_clock(m);
+        }
+
+        stats = &core->simcpu->stats[core->simcpu->emu_cpu_state->priv];
+        waits_on_memory = oo_core_waits_on_memory(core);
+        if (waits_on_memory)
+        {
+            oo_core_get_stall_state(core, &before);
+            insn_mem_delay = stats->insn_mem_delay;
+            data_mem_delay = stats->data_mem_delay;
+            pim_mem_delay = stats->pim_mem_delay;
+        }
 
         if (oo_core_rob_commit(core))
         {
@@ -251,6 +555,23 @@ oo_core_run(void *core_type)
         oo_core_decode(core);
         oo_core_fetch(core);
 
+        /* If this cycle changed nothing but the stall stats, the next ones
+         * will do the same until the memory controller makes progress */
+        if (waits_on_memory && oo_core_waits_on_memory(core))
+        {
+            oo_core_get_stall_state(core, &after);
+            if (!memcmp(&before, &after, sizeof(OOCoreStallState)))
+            {
+                core->stalled = TRUE;
+                core->stall_insn_mem_delay
+                    = stats->insn_mem_delay - insn_mem_delay;
+                core->stall_data_mem_delay
+                    = stats->data_mem_delay - data_mem_delay;
+                core->stall_pim_mem_delay
+                    = stats->pim_mem_delay - pim_mem_delay;
+            }
+        }
+
         /* Advance CPU clock */
         ++core->simcpu->clock;
         ++core->simcpu->stats[core->simcpu->emu_cpu_state->priv].cycles;
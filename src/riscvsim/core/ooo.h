@@ -27,10 +27,14 @@
 #ifndef _OOO_H_
 #define _OOO_H_
 
+#include "../memory_hierarchy/memory_controller_utils.h"
 #include "../utils/circular_queue.h"
 #include "../utils/cpu_latches.h"
 #include "../utils/sim_params.h"
 
+/* Stage queue entries of a load parked in the LSQ, see oo_core_lsu() */
+#define LSQ_MISS_QUEUE_SIZE 8
+
 /* Forward declare */
 struct RISCVSIMCPUState;
 
@@ -59,6 +63,12 @@ typedef struct LSQEntry
     int mem_request_sent;
     int mem_request_complete;
     InstructionLatch *e;
+
+    /* Set for a load whose cache misses are all held by MSHRs. It leaves the
+     * LSU to the next loads, which may hit under the misses, and completes
+     * once the fills drain miss_queue. */
+    int parked;
+    StageMemAccessQueue miss_queue;
 } LSQEntry;
 
 typedef struct LSQ
@@ -104,6 +114,14 @@ typedef struct OOCore
     /* Dispatch ID for instruction */
     uint64_t ins_dispatch_id; /* Support for speculative execution */
 
+    /* Set when the pipeline did not change in the last cycle while waiting on
+     * the memory controller, along with the stall stats it updated, so that
+     * the following cycles can be skipped, see oo_core_run() */
+    int stalled;
+    uint64_t stall_insn_mem_delay;
+    uint64_t stall_data_mem_delay;
+    uint64_t stall_pim_mem_delay;
+
     struct RISCVSIMCPUState *simcpu; /* Pointer to parent */
 } OOCore;
 
@@ -117,6 +135,7 @@ int oo_core_run(void *core_type);
 int oo_core_rob_commit(OOCore *core);
 void oo_core_lsq(OOCore *core);
 void oo_core_lsu(OOCore *core);
+void oo_core_lsq_flush_entry(OOCore *core, LSQEntry *lsqe);
 void oo_core_execute_all(OOCore *core);
 void oo_core_issue(OOCore *core);
 void oo_core_dispatch(OOCore *core);
@@ -125,6 +144,7 @@ void oo_core_fetch(OOCore *core);
 
 /*----------  Out of order core utility functions  ----------*/
 void oo_process_branch(OOCore *core, InstructionLatch *e);
+void oo_core_profile_stall(OOCore *core, uint64_t cycles);
 
 void iq_reset(IssueQueueEntry *iq_entry, int size);
 int iq_full(const IssueQueueEntry *iq, int size);
@@ -424,6 +424,42 @@ rob_can_commit(const ROB *rob)
     return FALSE;
 }
 
+/* oo_core_profile_stall()
+ * @details
+ * Attributes cycles in which nothing committed to the head of the ROB. If the
+ * ROB is empty, they are attributed to the oldest instruction in the
+ * front-end, or to the next PC to fetch from.
+ */
+void
+oo_core_profile_stall(OOCore *core, uint64_t cycles)
+{
+    int i;
+    InstructionLatch *e = NULL;
+    target_ulong fetch_pc = core->simcpu->pc;
+    const CPUStage *frontend[3] = { &core->dispatch, &core->decode,
+                                    &core->fetch };
+
+    if (!cq_empty(&core->rob.cq))
+    {
+        e = core->rob.entries[cq_front(&core->rob.cq)].e;
+    }
+    else
+    {
+        for (i = 0; i < 3; ++i)
+        {
+            if (frontend[i]->has_data)
+            {
+                fetch_pc = get_insn_latch(core->simcpu->insn_latch_pool,
+                                          frontend[i]->insn_latch_index)
+                               ->ins.pc;
+                break;
+            }
+        }
+    }
+
+    sim_profile_stall(core->simcpu->profile, e, fetch_pc, cycles);
+}
+
 int
 oo_core_rob_commit(OOCore *core)
 {
@@ -488,7 +524,7 @@ oo_core_rob_commit(OOCore *core)
             }
 
             /* Free up insn_latch_pool entry */
-            e->status = INSN_LATCH_FREE;
+            insn_latch_free(s->simcpu->insn_latch_pool, e);
 
             /* All the dependent instructions will have to lookup ARF for
              * operand value */
@@ -497,9 +533,10 @@ oo_core_rob_commit(OOCore *core)
             /* Deallocate ROB entry */
             cq_dequeue(&core->rob.cq);
 
-            /* Check for user specified sim_emulate_after_icount instructions */
-            if (s->sim_params->sim_emulate_after_icount
-                && (s->simcpu->icount >= s->sim_params->sim_emulate_after_icount))
+            /* Check for the end of sim_emulate_after_icount instructions, or of
+             * the detailed window in sampled simulation */
+            if (s->simcpu->icount_limit
+                && (s->simcpu->icount >= s->simcpu->icount_limit))
             {
                 e->ins.exception_cause = SIM_ICOUNT_COMPLETE_EXCEPTION;
                 sim_exception_set(s->simcpu->exception, e);
@@ -522,6 +559,11 @@ oo_core_rob_commit(OOCore *core)
         }
     }
 
+    if (!commits && s->simcpu->profile)
+    {
+        oo_core_profile_stall(core, 1);
+    }
+
     return 0;
 }
 /*=====  End of ROB Commit Stage  ======*/
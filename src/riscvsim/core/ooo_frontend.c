@@ -218,6 +218,7 @@ lsq_entry_create(LSQ *lsq, InstructionLatch *e)
     lsq->entries[lsq_idx].ready = FALSE;
     lsq->entries[lsq_idx].mem_request_sent = FALSE;
     lsq->entries[lsq_idx].mem_request_complete = FALSE;
+    lsq->entries[lsq_idx].parked = FALSE;
     lsq->entries[lsq_idx].e = e;
 }
 
@@ -29,6 +29,71 @@
 #include "../utils/circular_queue.h"
 #include "riscv_sim_cpu.h"
 
+/* A load can leave the LSU once its cache lookups are done, if it only waits
+ * on the fills of MSHRs, as they complete on their own */
+static int
+can_park_load(const InstructionLatch *e, const StageMemAccessQueue *stage_queue)
+{
+    int j;
+
+    if (e->ins.is_aim || !e->ins.is_load || e->ins.is_atomic
+        || e->ins.exception || (stage_queue->cur_size > LSQ_MISS_QUEUE_SIZE))
+    {
+        return FALSE;
+    }
+
+    for (j = 0; j < stage_queue->cur_idx; ++j)
+    {
+        if (stage_queue->entry[j].valid && !stage_queue->entry[j].fill_queue)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/* Move the entries the load waits on from the stage queue to its LSQ entry,
+ * the MSHR waiters then complete them there */
+static void
+park_load(LSQEntry *lsqe, StageMemAccessQueue *stage_queue)
+{
+    int j;
+    PendingMemAccessEntry *se;
+    StageMemAccessQueue *q = &lsqe->miss_queue;
+
+    mem_controller_reset_cpu_stage_queue(q);
+    for (j = 0; j < stage_queue->cur_idx; ++j)
+    {
+        se = &stage_queue->entry[j];
+        if (se->valid)
+        {
+            q->entry[q->cur_idx] = *se;
+            se->fill_waiter->stage_queue = q;
+            se->fill_waiter->stage_queue_index = q->cur_idx;
+            ++q->cur_idx;
+            ++q->cur_size;
+        }
+    }
+
+    mem_controller_reset_cpu_stage_queue(stage_queue);
+    lsqe->parked = TRUE;
+}
+
+/* Called for the LSQ entries removed on flush, so that the fills no longer
+ * complete the entries of a parked load */
+void
+oo_core_lsq_flush_entry(OOCore *core, LSQEntry *lsqe)
+{
+    if (lsqe->parked)
+    {
+        mem_controller_invalidate_mem_request_queue_entries(
+            core->simcpu->mem_hierarchy->mem_controller, &lsqe->miss_queue);
+        mem_controller_reset_cpu_stage_queue(&lsqe->miss_queue);
+        lsqe->parked = FALSE;
+    }
+}
+
 void
 oo_core_lsu(OOCore *core)
 {
@@ -85,9 +150,18 @@ oo_core_lsu(OOCore *core)
                 core->lsq.entries[e->lsq_idx].mem_request_complete = TRUE;
                 cpu_stage_flush(&core->lsu);
             }
+            else if (can_park_load(e, stage_queue))
+            {
+                park_load(&core->lsq.entries[e->lsq_idx], stage_queue);
+                cpu_stage_flush(&core->lsu);
+            }
             else
             {
                 ++s->simcpu->stats[s->priv].data_mem_delay;
+                if (e->ins.is_aim)
+                {
+                    ++s->simcpu->stats[s->priv].pim_mem_delay;
+                }
             }
         }
         else
@@ -98,11 +172,16 @@ oo_core_lsu(OOCore *core)
 }
 
 static void
-process_lsq_entry_load(OOCore *core, LSQEntry *lsqe)
+process_lsq_entry_load(OOCore *core, LSQEntry *lsqe, int at_front)
 {
     InstructionLatch *e;
 
     e = lsqe->e;
+    if (lsqe->parked && !lsqe->miss_queue.cur_size)
+    {
+        lsqe->mem_request_complete = TRUE;
+    }
+
     if (!lsqe->mem_request_sent)
     {
         if (!core->lsu.has_data)
@@ -136,7 +215,14 @@ process_lsq_entry_load(OOCore *core, LSQEntry *lsqe)
                     core->rob.entries[e->rob_idx].ready = TRUE;
                 }
             }
-            cq_dequeue(&core->lsq.cq);
+
+            /* Parked loads may complete out of order, but leave the LSQ in
+             * order */
+            if (at_front)
+            {
+                lsqe->parked = FALSE;
+                cq_dequeue(&core->lsq.cq);
+            }
         }
     }
 }
@@ -189,42 +275,83 @@ process_lsq_entry_store(OOCore *core, LSQEntry *lsqe)
     }
 }
 
-void
-oo_core_lsq(OOCore *core)
+static void
+process_lsq_entry(OOCore *core, LSQEntry *lsqe, int at_front)
 {
     InstructionLatch *e;
-    LSQEntry *lsqe;
 
-    if (!cq_empty(&core->lsq.cq))
-    {
-        lsqe = &core->lsq.entries[cq_front(&core->lsq.cq)];
-        e = lsqe->e;
+    e = lsqe->e;
 
-        if (lsqe->ready == TRUE)
+    if (lsqe->ready == TRUE)
+    {
+        // AiM
+        if (e->ins.is_aim)
         {
-            // AiM
-            if (e->ins.is_aim)
+            if (e->ins.type == INS_TYPE_AIM_RD_MAC || e->ins.type == INS_TYPE_AIM_RD_AF)
             {
-                if (e->ins.type == INS_TYPE_AIM_RD_MAC || e->ins.type == INS_TYPE_AIM_RD_AF)
-                {
-                    process_lsq_entry_load(core, lsqe);
-                }
-                else
-                {
-                    process_lsq_entry_store(core, lsqe);
-                }
+                process_lsq_entry_load(core, lsqe, at_front);
             }
             else
             {
-                if (e->ins.is_load || e->ins.is_atomic)
-                {
-                    process_lsq_entry_load(core, lsqe);
-                }
-                else if (e->ins.is_store)
-                {
-                    process_lsq_entry_store(core, lsqe);
-                }
+                process_lsq_entry_store(core, lsqe);
+            }
+        }
+        else
+        {
+            if (e->ins.is_load || e->ins.is_atomic)
+            {
+                process_lsq_entry_load(core, lsqe, at_front);
+            }
+            else if (e->ins.is_store)
+            {
+                process_lsq_entry_store(core, lsqe);
             }
         }
     }
 }
+
+/* Only plain loads go past the loads parked on their cache misses */
+static int
+can_go_past_parked_load(const LSQEntry *lsqe)
+{
+    return !lsqe->e->ins.is_aim && lsqe->e->ins.is_load
+           && !lsqe->e->ins.is_atomic;
+}
+
+/* The LSQ top is processed, and with MSHRs, the loads following the ones
+ * parked on their cache misses, which may hit in the cache meanwhile */
+void
+oo_core_lsq(OOCore *core)
+{
+    int i, at_front, at_rear;
+    LSQEntry *lsqe;
+    CQ *cq = &core->lsq.cq;
+
+    if (cq_empty(cq))
+    {
+        return;
+    }
+
+    i = cq_front(cq);
+    while (1)
+    {
+        lsqe = &core->lsq.entries[i];
+        at_front = (i == cq_front(cq));
+        at_rear = (i == cq_rear(cq));
+        process_lsq_entry(core, lsqe, at_front);
+
+        /* Stop once the top left the LSQ, as before, or at the first entry
+         * neither parked nor done with the LSU */
+        if (at_rear || (at_front && (cq_front(cq) != i))
+            || !(lsqe->parked || lsqe->mem_request_complete))
+        {
+            break;
+        }
+
+        i = (i + 1) % cq->max_size;
+        if (!can_go_past_parked_load(&core->lsq.entries[i]))
+        {
+            break;
+        }
+    }
+}
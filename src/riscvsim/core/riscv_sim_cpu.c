@@ -33,6 +33,7 @@
 #include <time.h>
 #include <unistd.h>
 
+#include "../../pim_map.h"
 #include "../../riscv_cpu_priv.h"
 #include "../memory_hierarchy/dramsim_wrapper_c_connector.h"
 #include "../memory_hierarchy/ramulator_wrapper_c_connector.h"
@@ -50,6 +51,24 @@
 #define GET_TIMER_DIFF(start, end)                                             \
     (1000000000L * (end.tv_sec - start.tv_sec) + end.tv_nsec - start.tv_nsec)
 
+#define COPY_MSHR_STATS(stats, cache, cache_stats)                             \
+    do                                                                         \
+    {                                                                          \
+        (stats).cache##_mshr_allocs = (cache_stats).mshr_alloc_cnt;            \
+        (stats).cache##_mshr_merges = (cache_stats).mshr_merge_cnt;            \
+        (stats).cache##_mshr_full = (cache_stats).mshr_full_cnt;               \
+        (stats).cache##_mshr_occupancy = (cache_stats).mshr_occupancy_cnt;     \
+    } while (0)
+
+#define COPY_PREFETCH_STATS(stats, cache, cache_stats)                         \
+    do                                                                         \
+    {                                                                          \
+        (stats).cache##_pf_issued = (cache_stats).pf_issued_cnt;               \
+        (stats).cache##_pf_useful = (cache_stats).pf_useful_cnt;               \
+        (stats).cache##_pf_late = (cache_stats).pf_late_cnt;                   \
+        (stats).cache##_pf_useless = (cache_stats).pf_useless_cnt;             \
+    } while (0)
+
 static void
 bpu_enabled_fetch_stage_handler(struct RISCVCPUState *s, InstructionLatch *e)
 {
@@ -312,12 +331,15 @@ copy_cache_stats_to_global_stats(RISCVSIMCPUState *simcpu)
             cache_stats = cache_get_stats(simcpu->mem_hierarchy->icache);
             simcpu->stats[i].icache_read = cache_stats[i].total_read_cnt;
             simcpu->stats[i].icache_read_miss = cache_stats[i].read_miss_cnt;
+            COPY_MSHR_STATS(simcpu->stats[i], icache, cache_stats[i]);
 
             cache_stats = cache_get_stats(simcpu->mem_hierarchy->dcache);
             simcpu->stats[i].dcache_read = cache_stats[i].total_read_cnt;
             simcpu->stats[i].dcache_read_miss = cache_stats[i].read_miss_cnt;
             simcpu->stats[i].dcache_write = cache_stats[i].total_write_cnt;
             simcpu->stats[i].dcache_write_miss = cache_stats[i].write_miss_cnt;
+            COPY_MSHR_STATS(simcpu->stats[i], dcache, cache_stats[i]);
+            COPY_PREFETCH_STATS(simcpu->stats[i], dcache, cache_stats[i]);
 
             if (simcpu->params->enable_l2_cache)
             {
@@ -329,11 +351,40 @@ copy_cache_stats_to_global_stats(RISCVSIMCPUState *simcpu)
                     = cache_stats[i].total_write_cnt;
                 simcpu->stats[i].l2_cache_write_miss
                     = cache_stats[i].write_miss_cnt;
+                COPY_MSHR_STATS(simcpu->stats[i], l2_cache, cache_stats[i]);
+                COPY_PREFETCH_STATS(simcpu->stats[i], l2_cache,
+                                    cache_stats[i]);
             }
         }
     }
 }
 
+static int
+get_mem_backend_stats(const RISCVSIMCPUState *simcpu, MemBackendStats *mem)
+{
+    int i;
+    const MemoryController *m = simcpu->mem_hierarchy->mem_controller;
+
+    for (i = 0; i < m->num_backends; ++i)
+    {
+        mem[i] = m->backend[i].stats;
+    }
+
+    return m->num_backends;
+}
+
+/* Appends the record of the epoch which just ended to the epoch file */
+static void
+end_epoch(RISCVSIMCPUState *simcpu)
+{
+    MemBackendStats mem[NUM_MAX_MEM_BACKENDS];
+
+    copy_cache_stats_to_global_stats(simcpu);
+    get_mem_backend_stats(simcpu, mem);
+    sim_epoch_end(simcpu->epoch, simcpu->stats, mem, simcpu->clock,
+                  simcpu->icount);
+}
+
 /* Setup shared memory to dump stats, read by sim-stats-display tool */
 static void
 setup_stats_shm(RISCVSIMCPUState *simcpu)
@@ -437,6 +488,18 @@ update_insn_commit_stats(RISCVCPUState *s, InstructionLatch *e)
 {
     ++s->simcpu->icount;
     ++s->simcpu->stats[s->priv].ins_simulated;
+
+    if (s->simcpu->profile)
+    {
+        sim_profile_commit(s->simcpu->profile, e);
+    }
+
+    if (s->simcpu->epoch
+        && sim_epoch_done(s->simcpu->epoch, s->simcpu->clock,
+                          s->simcpu->icount))
+    {
+        end_epoch(s->simcpu);
+    }
     ++s->simcpu->stats[s->priv].ins_type[e->ins.type];
 
     if ((e->ins.type == INS_TYPE_COND_BRANCH) && e->is_branch_taken)
@@ -478,7 +541,8 @@ update_insn_commit_stats(RISCVCPUState *s, InstructionLatch *e)
 void
 write_stats_to_stats_display_shm(RISCVSIMCPUState *simcpu)
 {
-    if ((simcpu->clock % WRITE_STATS_TO_SHM_CLOCK_CYCLES_INTERVAL) == 0)
+    if (simcpu->stats_shm_ptr
+        && (simcpu->clock % WRITE_STATS_TO_SHM_CLOCK_CYCLES_INTERVAL) == 0)
     {
         /* Since cache stats are stored separately inside the Cache structure,
          * they have to be copied to global stats structure before writing stats
@@ -505,6 +569,21 @@ set_max_clock_cycles_for_non_pipe_fu(RISCVCPUState *s, int fu_type,
     return 1;
 }
 
+/* The instruction latches are not cleared on allocation, so the instruction is
+ * cleared before it is decoded, and when fetch raises an exception as the
+ * out-of-order cores do not decode it, except for the fields set by fetch */
+static void
+clear_decoded_insn(RVInstruction *ins)
+{
+    RVInstruction fetched = *ins;
+
+    memset((void *)ins, 0, sizeof(RVInstruction));
+    ins->pc = fetched.pc;
+    ins->binary = fetched.binary;
+    ins->str = fetched.str;
+    ins->create_str = fetched.create_str;
+}
+
 /* Read the instruction from TinyEMU memory map into the instruction latch */
 void
 fetch_cpu_stage_exec(RISCVCPUState *s, InstructionLatch *e)
@@ -530,11 +609,14 @@ fetch_cpu_stage_exec(RISCVCPUState *s, InstructionLatch *e)
     {
         /* This instruction has raised a page fault exception during
          * fetch */
+        clear_decoded_insn(&e->ins);
         e->ins.exception = TRUE;
         e->ins.exception_cause = SIM_MMU_EXCEPTION;
     }
     else
     {
+        e->ins_guest_paddr = s->code_guest_paddr;
+
         /* max_clock_cycles: Number of CPU cycles required for TLB and Cache
          * look-up */
         e->max_clock_cycles
@@ -571,12 +653,46 @@ fetch_cpu_stage_exec(RISCVCPUState *s, InstructionLatch *e)
 void
 decode_cpu_stage_exec(RISCVCPUState *s, InstructionLatch *e)
 {
+    int current_fs;
+    uint32_t rm;
+    DecodeCache *dc = s->simcpu->decode_cache;
+
     /* For decoding floating point instructions */
     e->ins.current_fs = s->fs;
     e->ins.rm = get_insn_rm(s, (e->ins.binary >> 12) & 7);
 
+    /* Instructions which raised an exception during fetch are not cached */
+    if (e->ins.exception)
+    {
+        decode_riscv_binary(&e->ins, e->ins.binary);
+        return;
+    }
+
+    if (decode_cache_lookup(dc, e->ins_guest_paddr, &e->ins))
+    {
+        ++s->simcpu->stats[s->priv].decode_cache_hits;
+        return;
+    }
+
     /* Decode the instruction */
+    current_fs = e->ins.current_fs;
+    rm = e->ins.rm;
+    clear_decoded_insn(&e->ins);
+    e->ins.current_fs = current_fs;
+    e->ins.rm = rm;
     decode_riscv_binary(&e->ins, e->ins.binary);
+    ++s->simcpu->stats[s->priv].decode_cache_misses;
+
+    /* fence.i orders the instruction fetches after the stores before it, so
+     * drop all the decoded instructions. It is executed by TinyEMU, so there
+     * is no need to cache it. */
+    if ((e->ins.major_opcode == FENCE_MASK) && (e->ins.funct3 == 1))
+    {
+        decode_cache_flush(dc);
+        return;
+    }
+
+    decode_cache_insert(dc, e->ins_guest_paddr, current_fs, rm, &e->ins);
 }
 
 /* Read/Write data to/from TinyEMU memory map into the instruction latch and set
@@ -613,6 +729,15 @@ mem_cpu_stage_exec(RISCVCPUState *s, InstructionLatch *e)
     {
         /* Memory access was successful, no page fault, so calculate the memory
          * access latency */
+        e->has_data_guest_paddr
+            = !s->is_device_io && (s->data_guest_paddr || s->is_pim_access);
+        e->data_guest_paddr = s->data_guest_paddr;
+        if (e->ins.is_aim && s->is_pim_access)
+        {
+            /* AiM commands in the PIM area keep the offset in the area in
+             * s->data_guest_paddr, for the memory hierarchy */
+            e->data_guest_paddr += PIM_BASE_ADDR;
+        }
         e->max_clock_cycles
             = s->simcpu->mem_hierarchy->mem_controller->page_walk_delay;
         if (s->is_device_io || (!s->data_guest_paddr && !e->ins.is_aim))
@@ -649,6 +774,7 @@ mem_cpu_stage_exec(RISCVCPUState *s, InstructionLatch *e)
             else
             {
                 /* RAM access */
+                s->simcpu->mem_hierarchy->access_pc = e->ins.pc;
                 if ((e->ins.is_load || e->ins.is_atomic_load))
                 {
                     e->max_clock_cycles
@@ -681,18 +807,263 @@ mem_cpu_stage_exec(RISCVCPUState *s, InstructionLatch *e)
     }
 }
 
-void
-riscv_sim_cpu_start(RISCVSIMCPUState *simcpu, target_ulong pc)
+/* The DRAM models are shared by all the cores, and handled by the first one */
+static void
+reset_dram_backends(RISCVSIMCPUState *simcpu)
+{
+    int i;
+    MemoryController *m;
+
+    m = simcpu->mem_hierarchy->mem_controller;
+    for (i = 0; i < m->num_backends; ++i)
+    {
+        dram_restart_backend(m->backend[i].dram, simcpu->params);
+    }
+}
+
+static void
+print_dram_backend_stats(RISCVSIMCPUState *simcpu, const char *timestamp)
+{
+    int i;
+    MemoryController *m;
+
+    m = simcpu->mem_hierarchy->mem_controller;
+    for (i = 0; i < m->num_backends; ++i)
+    {
+        switch (m->backend[i].dram->dram_model_type)
+        {
+            case MEM_MODEL_BASE:
+            {
+                break;
+            }
+            case MEM_MODEL_DRAMSIM:
+            {
+                printf("[MARSS-RISCV] file path: %s\n", &simcpu->params->sim_file_path);
+                printf("[MARSS-RISCV] time stamp: %s\n", &timestamp);
+                dramsim_wrapper_print_stats(m->backend[i].dram->dramsim,
+                                            timestamp);
+                sim_log_event(
+                    sim_log,
+                    "Saved dramsim3 statistics in %s/dramsim3_%s.json",
+                    simcpu->params->sim_file_path, timestamp);
+                break;
+            }
+            case MEM_MODEL_RAMULATOR:
+            {
+                ramulator_wrapper_finish(m->backend[i].dram->ramulator);
+                ramulator_wrapper_print_stats(m->backend[i].dram->ramulator,
+                                              simcpu->params->sim_file_path,
+                                              timestamp);
+                sim_log_event(
+                    sim_log,
+                    "Saved ramulator statistics in %s/ramulator_%s.stats",
+                    simcpu->params->sim_file_path, timestamp);
+                break;
+            }
+            // AiM
+            case MEM_MODEL_AIMULATOR:
+            {
+                printf("[MARSS-RISCV] file path: %s\n", &simcpu->params->sim_file_path);
+                printf("[MARSS-RISCV] time stamp: %s\n", &timestamp);
+                aimulator_wrapper_finish_and_print_stats(
+                    m->backend[i].dram->aimulator,
+                    simcpu->params->sim_file_path, timestamp);
+                sim_log_event(
+                    sim_log,
+                    "Saved aimulator statistics in %s/aimulator_%s.stats",
+                    simcpu->params->sim_file_path, timestamp);
+                if (m->backend[i].dram->aim_trace)
+                {
+                    sim_log_event(
+                        sim_log,
+                        "Saved %lu aimulator requests in %s/%s.aimtrace",
+                        m->backend[i].dram->aim_trace->num_requests,
+                        simcpu->params->sim_file_path,
+                        simcpu->params->sim_file_prefix);
+                    dram_stop_aim_trace(m->backend[i].dram);
+                }
+                break;
+            }
+        }
+    }
+}
+
+/* With several cores, each one writes its own trace, named by inserting
+ * _core<N> before the extension of the configured trace file */
+static void
+get_core_trace_file(const RISCVSIMCPUState *simcpu, char *buf, size_t size)
+{
+    const char *file = simcpu->params->sim_trace_file;
+    const char *ext = strrchr(file, '.');
+
+    if (simcpu->params->num_cores == 1)
+    {
+        snprintf(buf, size, "%s", file);
+    }
+    else if (ext && !strchr(ext, '/'))
+    {
+        snprintf(buf, size, "%.*s_core%d%s", (int)(ext - file), file,
+                 simcpu->core_id, ext);
+    }
+    else
+    {
+        snprintf(buf, size, "%s_core%d", file, simcpu->core_id);
+    }
+}
+
+/* The epoch file of every core is named <prefix>[_core<N>].epoch.jsonl */
+static void
+get_core_epoch_file(const RISCVSIMCPUState *simcpu, char *buf, size_t size)
+{
+    if (simcpu->params->num_cores == 1)
+    {
+        snprintf(buf, size, "%s/%s.epoch.jsonl", simcpu->params->sim_file_path,
+                 simcpu->params->sim_file_prefix);
+    }
+    else
+    {
+        snprintf(buf, size, "%s/%s_core%d.epoch.jsonl",
+                 simcpu->params->sim_file_path,
+                 simcpu->params->sim_file_prefix, simcpu->core_id);
+    }
+}
+
+/* Cycles and stall cycles measured over the detailed windows of sampled
+ * simulation */
+static void
+get_sample_counters(const RISCVSIMCPUState *simcpu, uint64_t *counters)
+{
+    int i;
+
+    counters[SAMPLE_CYCLES] = simcpu->clock;
+    counters[SAMPLE_MEM_STALL_CYCLES] = 0;
+    counters[SAMPLE_PIM_STALL_CYCLES] = 0;
+    for (i = 0; i < NUM_MAX_PRV_LEVELS; ++i)
+    {
+        counters[SAMPLE_MEM_STALL_CYCLES]
+            += simcpu->stats[i].insn_mem_delay + simcpu->stats[i].data_mem_delay;
+        counters[SAMPLE_PIM_STALL_CYCLES] += simcpu->stats[i].pim_mem_delay;
+    }
+}
+
+static void
+begin_warmup(RISCVSIMCPUState *simcpu)
+{
+    MemoryHierarchy *m = simcpu->mem_hierarchy;
+
+    memcpy(simcpu->warmup_stats, simcpu->stats,
+           NUM_MAX_PRV_LEVELS * sizeof(SimStats));
+    if (simcpu->params->enable_l1_caches)
+    {
+        memcpy(simcpu->warmup_icache_stats, cache_get_stats(m->icache),
+               sizeof(simcpu->warmup_icache_stats));
+        memcpy(simcpu->warmup_dcache_stats, cache_get_stats(m->dcache),
+               sizeof(simcpu->warmup_dcache_stats));
+        if (simcpu->params->enable_l2_cache)
+        {
+            memcpy(simcpu->warmup_l2_cache_stats, cache_get_stats(m->l2_cache),
+                   sizeof(simcpu->warmup_l2_cache_stats));
+        }
+    }
+
+    /* Cache misses and write-backs create no DRAM requests */
+    m->mem_controller->functional_warming = TRUE;
+    simcpu->warm_branch_pending = FALSE;
+    simcpu->emu_cpu_state->sim_warming = TRUE;
+}
+
+static void
+end_warmup(RISCVSIMCPUState *simcpu)
+{
+    MemoryHierarchy *m = simcpu->mem_hierarchy;
+
+    if (!simcpu->emu_cpu_state->sim_warming)
+    {
+        return;
+    }
+
+    memcpy(simcpu->stats, simcpu->warmup_stats,
+           NUM_MAX_PRV_LEVELS * sizeof(SimStats));
+    if (simcpu->params->enable_l1_caches)
+    {
+        cache_set_stats(m->icache, simcpu->warmup_icache_stats);
+        cache_set_stats(m->dcache, simcpu->warmup_dcache_stats);
+        if (simcpu->params->enable_l2_cache)
+        {
+            cache_set_stats(m->l2_cache, simcpu->warmup_l2_cache_stats);
+        }
+    }
+
+    m->mem_controller->functional_warming = FALSE;
+    simcpu->emu_cpu_state->sim_warming = FALSE;
+}
+
+static void
+enter_sample_phase(RISCVSIMCPUState *simcpu, SimSamplePhase phase)
+{
+    uint64_t counters[NUM_SAMPLE_METRICS];
+    uint64_t scale_offset;
+
+    switch (phase)
+    {
+        case SAMPLE_FAST_FORWARD:
+        {
+            break;
+        }
+        case SAMPLE_WARMUP:
+        {
+            begin_warmup(simcpu);
+            break;
+        }
+        case SAMPLE_DETAIL:
+        {
+            end_warmup(simcpu);
+            simcpu->simulation = TRUE;
+            simcpu->icount_limit
+                = simcpu->icount + simcpu->params->sample_detail_icount;
+            get_sample_counters(simcpu, counters);
+            sim_sampler_begin_window(simcpu->sampler, simcpu->icount, counters);
+
+            /* mtime goes on from its emulated value, see
+             * riscv_cpu_in_simulation_get_mtime() */
+            scale_offset
+                = simcpu->params->cpu_freq_mhz / simcpu->params->rtc_freq_mhz;
+            simcpu->temu_rtc_time_at_simstart
+                = rtc_get_elasped_time(simcpu->emu_cpu_state->rtc)
+                  - (simcpu->clock / scale_offset);
+            break;
+        }
+        default:
+        {
+            sim_assert((0), "error: %s at line %d in %s(): %s", __FILE__,
+                       __LINE__, __func__, "invalid sample phase");
+        }
+    }
+}
+
+static void
+start_core(RISCVSIMCPUState *simcpu, target_ulong pc)
 {
-    if (!simcpu->simulation)
+    char trace_file[1024];
+    char epoch_file[1024];
+    MemBackendStats mem[NUM_MAX_MEM_BACKENDS];
+
+    if (!simcpu->simulation && !simcpu->sampling)
     {
         simcpu->simulation = TRUE;
         simcpu->clock = 0;
         simcpu->icount = 0;
+        simcpu->icount_limit = simcpu->params->sim_emulate_after_icount;
 
         sim_stats_reset(simcpu->stats);
         GET_TIME(simcpu->sim_start_time);
 
+        if (simcpu->profile)
+        {
+            sim_profile_reset(simcpu->profile);
+        }
+        sim_regions_reset(simcpu->regions);
+
         simcpu->temu_rtc_time_at_simstart
             = rtc_get_elasped_time(simcpu->emu_cpu_state->rtc);
 
@@ -714,7 +1085,8 @@ riscv_sim_cpu_start(RISCVSIMCPUState *simcpu, target_ulong pc)
                 cache_flush(simcpu->mem_hierarchy->dcache);
             }
 
-            if (simcpu->params->enable_l2_cache)
+            if (simcpu->params->enable_l2_cache
+                && simcpu->mem_hierarchy->owns_l2_cache)
             {
                 cache_reset_stats(simcpu->mem_hierarchy->l2_cache);
 
@@ -726,58 +1098,65 @@ riscv_sim_cpu_start(RISCVSIMCPUState *simcpu, target_ulong pc)
         }
 
         /* Reset DRAMs at every new simulation run */
-        switch (simcpu->mem_hierarchy->mem_controller->dram_model_type)
+        if (simcpu->mem_hierarchy->owns_shared_levels)
         {
-            case MEM_MODEL_BASE:
-            {
-                break;
-            }
-            case MEM_MODEL_DRAMSIM:
-            {
-                dramsim_wrapper_destroy();
-                dramsim_wrapper_init(simcpu->params->dramsim_config_file,
-                                     simcpu->params->sim_file_path);
-                break;
-            }
-            case MEM_MODEL_RAMULATOR:
-            {
-                ramulator_wrapper_destroy();
-                ramulator_wrapper_init(simcpu->params->ramulator_config_file,
-                                       simcpu->params->cache_line_size);
-                break;
-            }
-            // AiM
-            case MEM_MODEL_AIMULATOR:
-            {
-                aimulator_wrapper_destroy();
-                aimulator_wrapper_init(simcpu->params->aimulator_config_file);
-                break;
-            }
+            reset_dram_backends(simcpu);
         }
 
         /* Open trace file if running in trace mode */
         if (simcpu->params->do_sim_trace)
         {
-            simcpu->params->create_ins_str = TRUE;
+            /* The binary trace only stores the instruction word, the
+             * disassembly is generated by sim-trace-dump */
+            if (simcpu->params->sim_trace_format == SIM_TRACE_FORMAT_TEXT)
+            {
+                simcpu->params->create_ins_str = TRUE;
+            }
+            get_core_trace_file(simcpu, trace_file, sizeof(trace_file));
             sim_log_event(sim_log, "Starting simulation trace "
                                    "at pc = 0x%" PR_target_ulong " in file: %s",
-                          pc, simcpu->params->sim_trace_file);
-            sim_trace_start(simcpu->trace, simcpu->params->sim_trace_file);
+                          pc, trace_file);
+            sim_trace_start(simcpu->trace, trace_file,
+                            simcpu->params->sim_trace_format);
+        }
+
+        if (simcpu->epoch)
+        {
+            copy_cache_stats_to_global_stats(simcpu);
+            get_core_epoch_file(simcpu, epoch_file, sizeof(epoch_file));
+            sim_epoch_start(simcpu->epoch, epoch_file, simcpu->stats, mem,
+                            get_mem_backend_stats(simcpu, mem), simcpu->clock,
+                            simcpu->icount);
+            sim_log_event(sim_log, "Writing epoch stats in %s", epoch_file);
         }
 
         sim_log_event(sim_log, "Switching to full-system simulation "
                                "mode at pc = 0x%" PR_target_ulong,
                       pc);
+
+        /* The sampled region starts with the first non-empty phase, see
+         * riscv_sim_cpu_sample_step() */
+        if (simcpu->sampler)
+        {
+            simcpu->simulation = FALSE;
+            simcpu->sampling = TRUE;
+            sim_sampler_start(simcpu->sampler,
+                              simcpu->emu_cpu_state->insn_counter);
+            enter_sample_phase(simcpu, simcpu->sampler->phase);
+        }
     }
 }
 
-void
-riscv_sim_cpu_stop(RISCVSIMCPUState *simcpu, target_ulong pc)
+static void
+stop_core(RISCVSIMCPUState *simcpu, target_ulong pc)
 {
+    MemBackendStats mem[NUM_MAX_MEM_BACKENDS];
     char *timestamp;
+    char stats_file[1024];
+    char trace_file[1024];
     uint64_t sim_time;
 
-    if (simcpu->simulation)
+    if (simcpu->simulation || simcpu->sampling)
     {
         simcpu->simulation = FALSE;
         GET_TIME(simcpu->sim_end_time);
@@ -786,70 +1165,502 @@ riscv_sim_cpu_stop(RISCVSIMCPUState *simcpu, target_ulong pc)
 
         print_performance_summary(simcpu, sim_time);
 
+        /* A detailed window cut short by the stop is not sampled, the
+         * instructions at its end would be missing from its mean */
+        if (simcpu->sampling)
+        {
+            simcpu->sampling = FALSE;
+            end_warmup(simcpu);
+            sim_sampler_print(simcpu->sampler,
+                              simcpu->emu_cpu_state->insn_counter);
+        }
+
         timestamp
             = sim_log_get_current_timestamp(simcpu->params->sim_file_prefix);
 
-        switch (simcpu->mem_hierarchy->mem_controller->dram_model_type)
+
+        if (simcpu->params->do_sim_trace)
         {
-            case MEM_MODEL_BASE:
-            {
-                break;
-            }
-            case MEM_MODEL_DRAMSIM:
+            get_core_trace_file(simcpu, trace_file, sizeof(trace_file));
+            sim_trace_stop(simcpu->trace);
+            sim_log_event(sim_log, "Saved simulation trace in %s", trace_file);
+        }
+
+        /* One stats file per core: prefix_timestamp_core<N>.csv */
+        if (simcpu->params->num_cores > 1)
+        {
+            snprintf(stats_file, sizeof(stats_file), "%s_core%d", timestamp,
+                     simcpu->core_id);
+        }
+        else
+        {
+            snprintf(stats_file, sizeof(stats_file), "%s", timestamp);
+        }
+
+        copy_cache_stats_to_global_stats(simcpu);
+        sim_stats_print_to_file(simcpu->stats, simcpu->params->sim_file_path,
+                                sim_time, stats_file);
+
+        sim_regions_print_to_file(simcpu->regions,
+                                  simcpu->params->sim_file_path, stats_file);
+
+        if (simcpu->epoch)
+        {
+            get_mem_backend_stats(simcpu, mem);
+            sim_epoch_stop(simcpu->epoch, simcpu->stats, mem, simcpu->clock,
+                           simcpu->icount);
+        }
+
+        if (simcpu->profile)
+        {
+            sim_profile_print_to_file(simcpu->profile,
+                                      simcpu->params->sim_file_path,
+                                      stats_file);
+            sim_log_event(sim_log,
+                          "Saved commit stall profile in %s/%s_profile.txt",
+                          simcpu->params->sim_file_path, stats_file);
+        }
+
+        sim_log_event(sim_log, "Switching to emulation mode "
+                               "mode at pc = 0x%" PR_target_ulong,
+                      pc);
+
+        /* The DRAM models may still be serving the other cores */
+        if (simcpu->mem_hierarchy->owns_shared_levels)
+        {
+            simcpu->dram_stats_timestamp = timestamp;
+        }
+        else
+        {
+            free(timestamp);
+        }
+    }
+}
+
+static void
+leave_quantum(RISCVSIMCPUState *simcpu)
+{
+    if (simcpu->in_quantum)
+    {
+        simcpu->in_quantum = FALSE;
+        sim_quantum_leave(simcpu->quantum);
+    }
+}
+
+/* Simulation is switched on and off for all the cores together, the other cores
+ * start and stop at their current PC */
+void
+riscv_sim_cpu_start(RISCVSIMCPUState *simcpu, target_ulong pc)
+{
+    RISCVSIMCPUState *c;
+    int was_simulating = simcpu->simulation;
+
+    start_core(simcpu, pc);
+    for (c = simcpu->next_core; c != simcpu; c = c->next_core)
+    {
+        start_core(c, c->emu_cpu_state->pc);
+    }
+
+    /* Every core clock starts from 0, and the requests left in the shared
+     * DRAM models by the previous run are dropped. Each hart reads mtime from
+     * its own clock, so all the cores share the mtime base of the first one. */
+    if (simcpu->quantum && !was_simulating)
+    {
+        sim_quantum_reset(simcpu->quantum);
+        c = simcpu;
+        do
+        {
+            if (!simcpu->sampling)
             {
-                printf("[MARSS-RISCV] file path: %s\n", &simcpu->params->sim_file_path);
-                printf("[MARSS-RISCV] time stamp: %s\n", &timestamp);
-                dramsim_wrapper_print_stats(timestamp);
-                sim_log_event(
-                    sim_log,
-                    "Saved dramsim3 statistics in %s/dramsim3_%s.json",
-                    simcpu->params->sim_file_path, timestamp);
-                break;
+                c->temu_rtc_time_at_simstart
+                    = simcpu->temu_rtc_time_at_simstart;
             }
-            case MEM_MODEL_RAMULATOR:
+            mem_controller_reset_backends(c->mem_hierarchy->mem_controller);
+            c = c->next_core;
+        } while (c != simcpu);
+    }
+}
+
+void
+riscv_sim_cpu_stop(RISCVSIMCPUState *simcpu, target_ulong pc)
+{
+    RISCVSIMCPUState *c;
+
+    /* The other cores are running on their own threads */
+    if (simcpu->in_quantum)
+    {
+        stop_core(simcpu, pc);
+        simcpu->stop_pending = TRUE;
+        leave_quantum(simcpu);
+        return;
+    }
+
+    stop_core(simcpu, pc);
+    for (c = simcpu->next_core; c != simcpu; c = c->next_core)
+    {
+        stop_core(c, c->emu_cpu_state->pc);
+    }
+
+    c = simcpu;
+    do
+    {
+        if (c->dram_stats_timestamp)
+        {
+            print_dram_backend_stats(c, c->dram_stats_timestamp);
+            free(c->dram_stats_timestamp);
+            c->dram_stats_timestamp = NULL;
+        }
+        c = c->next_core;
+    } while (c != simcpu);
+}
+
+/* riscv_sim_cpu_icount_complete()
+ * @details
+ * Called by TinyEMU once the core committed icount_limit instructions. This
+ * stops the simulation, or in sampled simulation, ends the detailed window
+ * and moves on to the next phase.
+ */
+void
+riscv_sim_cpu_icount_complete(RISCVSIMCPUState *simcpu, target_ulong pc)
+{
+    uint64_t counters[NUM_SAMPLE_METRICS];
+
+    if (!simcpu->sampling)
+    {
+        riscv_sim_cpu_stop(simcpu, pc);
+        return;
+    }
+
+    get_sample_counters(simcpu, counters);
+    sim_sampler_end_window(simcpu->sampler, simcpu->icount, counters);
+    simcpu->simulation = FALSE;
+    simcpu->icount_limit = 0;
+    enter_sample_phase(
+        simcpu, sim_sampler_next_phase(simcpu->sampler,
+                                       simcpu->emu_cpu_state->insn_counter));
+}
+
+/* riscv_sim_cpu_region_begin()
+ * @details
+ * Called by TinyEMU when the guest writes the id of a region to CSR 0x802, the
+ * pipeline being drained. The markers are ignored in emulation mode, including
+ * outside the detailed windows of sampled simulation.
+ */
+void
+riscv_sim_cpu_region_begin(RISCVSIMCPUState *simcpu, uint64_t id)
+{
+    MemBackendStats mem[NUM_MAX_MEM_BACKENDS];
+    int num_backends;
+
+    if (simcpu->simulation)
+    {
+        copy_cache_stats_to_global_stats(simcpu);
+        num_backends = get_mem_backend_stats(simcpu, mem);
+        sim_region_begin(simcpu->regions, id, simcpu->stats, mem,
+                         num_backends);
+    }
+}
+
+/* Called by TinyEMU when the guest writes the id of a region to CSR 0x803 */
+void
+riscv_sim_cpu_region_end(RISCVSIMCPUState *simcpu, uint64_t id)
+{
+    MemBackendStats mem[NUM_MAX_MEM_BACKENDS];
+
+    if (simcpu->simulation)
+    {
+        copy_cache_stats_to_global_stats(simcpu);
+        get_mem_backend_stats(simcpu, mem);
+        sim_region_end(simcpu->regions, id, simcpu->stats, mem);
+    }
+}
+
+/* riscv_sim_cpu_sample_step()
+ * @details
+ * Called by TinyEMU before emulating up to n_cycles instructions. In sampled
+ * simulation, moves on to the next phase once the emulated instruction counter
+ * reaches the end of the current one, and returns the number of instructions
+ * left to emulate in it.
+ */
+int
+riscv_sim_cpu_sample_step(RISCVSIMCPUState *simcpu, int n_cycles)
+{
+    SimSampler *sampler = simcpu->sampler;
+    uint64_t insn_counter;
+
+    if (!simcpu->sampling || simcpu->simulation)
+    {
+        return n_cycles;
+    }
+
+    insn_counter = simcpu->emu_cpu_state->insn_counter;
+    if (insn_counter >= sampler->phase_end)
+    {
+        enter_sample_phase(simcpu,
+                           sim_sampler_next_phase(sampler, insn_counter));
+        if (simcpu->simulation)
+        {
+            return n_cycles;
+        }
+    }
+
+    if (sampler->phase_end - insn_counter < (uint64_t)n_cycles)
+    {
+        n_cycles = sampler->phase_end - insn_counter;
+    }
+    return n_cycles;
+}
+
+/* Quick filter on the instructions which may be jumps or branches, before
+ * decoding them */
+static int
+may_be_control_flow_insn(uint32_t insn)
+{
+    switch (insn & 3)
+    {
+        case 1:
+        {
+            /* c.jal, c.j, c.beqz, c.bnez */
+            switch ((insn >> 13) & 7)
             {
-                ramulator_wrapper_finish();
-                ramulator_wrapper_print_stats(simcpu->params->sim_file_path,
-                                              timestamp);
-                sim_log_event(
-                    sim_log,
-                    "Saved ramulator statistics in %s/ramulator_%s.stats",
-                    simcpu->params->sim_file_path, timestamp);
-                break;
+                case 1:
+                case 5:
+                case 6:
+                case 7:
+                    return TRUE;
             }
-            // AiM
-            case MEM_MODEL_AIMULATOR:
+            return FALSE;
+        }
+        case 2:
+        {
+            /* c.jr, c.jalr */
+            return ((insn >> 13) & 7) == 4;
+        }
+        case 3:
+        {
+            /* jal, jalr, branches */
+            switch (insn & 0x7f)
             {
-                printf("[MARSS-RISCV] file path: %s\n", &simcpu->params->sim_file_path);
-                printf("[MARSS-RISCV] time stamp: %s\n", &timestamp);
-                aimulator_wrapper_finish_and_print_stats(simcpu->params->sim_file_path, timestamp);
-                sim_log_event(
-                    sim_log,
-                    "Saved aimulator statistics in %s/aimulator_%s.stats",
-                    simcpu->params->sim_file_path, timestamp);
-                break;
+                case 0x6f:
+                case 0x67:
+                case 0x63:
+                    return TRUE;
             }
+            return FALSE;
         }
+    }
 
-        if (simcpu->params->do_sim_trace)
+    return FALSE;
+}
+
+/* Trains the BPU with the control-flow instruction emulated last, the same way
+ * as the execute stage, now that next_pc is known */
+static void
+warm_branch(RISCVSIMCPUState *simcpu, target_ulong next_pc)
+{
+    RVInstruction ins;
+    BPUResponsePkt pkt;
+    target_ulong pc = simcpu->warm_branch_pc;
+    target_ulong target;
+    int priv = simcpu->warm_branch_priv;
+    int insn_len, taken;
+
+    memset(&ins, 0, sizeof(ins));
+    decode_riscv_binary(&ins, simcpu->warm_branch_insn);
+    if (!ins.is_branch)
+    {
+        return;
+    }
+
+    insn_len = ((ins.binary & 3) == 3) ? 4 : 2;
+    taken = (next_pc != pc + insn_len);
+    target = (ins.branch_type == BRANCH_COND) ? pc + ins.imm : next_pc;
+
+    if (simcpu->params->ras_size)
+    {
+        if (ins.is_func_call)
         {
-            sim_trace_stop(simcpu->trace);
-            sim_log_event(sim_log, "Saved simulation trace in %s",
-                          simcpu->params->sim_trace_file);
+            ras_push(simcpu->bpu->ras, pc + insn_len);
+        }
+        if (ins.is_func_ret)
+        {
+            ras_pop(simcpu->bpu->ras);
         }
+    }
 
-        copy_cache_stats_to_global_stats(simcpu);
-        sim_stats_print_to_file(simcpu->stats, simcpu->params->sim_file_path,
-                                sim_time, timestamp);
+    bpu_probe(simcpu->bpu, pc, &pkt, priv);
+    if (!pkt.bpu_probe_status)
+    {
+        bpu_add(simcpu->bpu, pc, ins.branch_type, &pkt, priv,
+                ins.is_func_ret);
+        bpu_probe(simcpu->bpu, pc, &pkt, priv);
+    }
+    bpu_update(simcpu->bpu, pc, target, taken, ins.branch_type, &pkt, priv);
+}
 
-        sim_log_event(sim_log, "Switching to emulation mode "
-                               "mode at pc = 0x%" PR_target_ulong,
-                      pc);
+/* riscv_sim_cpu_warm_insn()
+ * @details
+ * Called by TinyEMU for every instruction emulated in the warmup phase of
+ * sampled simulation. The instruction cache is looked up without timing, and
+ * the BPU is trained with the jumps and branches.
+ */
+void
+riscv_sim_cpu_warm_insn(RISCVCPUState *s, target_ulong pc, uint32_t insn)
+{
+    RISCVSIMCPUState *simcpu = s->simcpu;
+    MemoryHierarchy *m = simcpu->mem_hierarchy;
+    uint32_t tlb_idx;
+
+    /* For the data accesses of this instruction */
+    m->access_pc = pc;
+
+    tlb_idx = (pc >> PG_SHIFT) & (TLB_SIZE - 1);
+    if (s->tlb_code[tlb_idx].vaddr == (pc & ~PG_MASK))
+    {
+        m->insn_read_delay(m,
+                           s->tlb_code[tlb_idx].guest_paddr
+                               + (pc - s->tlb_code[tlb_idx].vaddr),
+                           4, FETCH, s->priv);
+    }
+
+    if (!simcpu->params->enable_bpu)
+    {
+        return;
+    }
+
+    if (simcpu->warm_branch_pending)
+    {
+        warm_branch(simcpu, pc);
+        simcpu->warm_branch_pending = FALSE;
+    }
+
+    if (may_be_control_flow_insn(insn))
+    {
+        simcpu->warm_branch_pending = TRUE;
+        simcpu->warm_branch_priv = s->priv;
+        simcpu->warm_branch_pc = pc;
+        simcpu->warm_branch_insn = ((insn & 3) == 3) ? insn : (insn & 0xffff);
+    }
+}
+
+/* Called by TinyEMU for every load and store to RAM emulated in the warmup
+ * phase, at s->data_guest_paddr */
+void
+riscv_sim_cpu_warm_data(RISCVCPUState *s, int bytes, int is_write)
+{
+    MemoryHierarchy *m = s->simcpu->mem_hierarchy;
+
+    if (is_write)
+    {
+        m->data_write_delay(m, s->data_guest_paddr, bytes, MEMORY, s->priv);
+    }
+    else
+    {
+        m->data_read_delay(m, s->data_guest_paddr, bytes, MEMORY, s->priv);
+    }
+}
+
+/* riscv_sim_cpu_begin_slice()
+ * @details
+ * With parallel_sim, called for every core before they run on their own
+ * threads. The slice is over once the core simulated slice_cycles past the
+ * current quantum, see riscv_sim_cpu_slice_done().
+ */
+void
+riscv_sim_cpu_begin_slice(RISCVSIMCPUState *simcpu, uint64_t slice_cycles)
+{
+    if (simcpu->quantum && simcpu->simulation)
+    {
+        simcpu->in_slice = TRUE;
+        simcpu->in_quantum = TRUE;
+        simcpu->slice_end = simcpu->quantum->end + slice_cycles;
+        sim_quantum_enter(simcpu->quantum);
+    }
+}
+
+/* Checked by TinyEMU every time it gets control back from the simulator. With
+ * parallel_sim, a core only simulates inside its slice. */
+int
+riscv_sim_cpu_slice_done(const RISCVSIMCPUState *simcpu)
+{
+    if (!simcpu->quantum)
+    {
+        return FALSE;
+    }
+
+    if (!simcpu->in_slice)
+    {
+        return simcpu->simulation;
+    }
+
+    return !simcpu->in_quantum || (simcpu->clock >= simcpu->slice_end);
+}
+
+void
+riscv_sim_cpu_end_slice(RISCVSIMCPUState *simcpu)
+{
+    leave_quantum(simcpu);
+    simcpu->in_slice = FALSE;
+}
+
+/* Called by the core when its clock reaches the end of the quantum. Once all
+ * the cores are there, the shared DRAM models serve the requests they made
+ * during the quantum, see quantum_complete(). */
+void
+riscv_sim_cpu_end_quantum(RISCVSIMCPUState *simcpu)
+{
+    MemoryController *m = simcpu->mem_hierarchy->mem_controller;
+
+    sim_assert((simcpu->in_quantum), "error: %s at line %d in %s(): %s",
+               __FILE__, __LINE__, __func__,
+               "core simulated outside of its slice");
+    m->quantum_end = sim_quantum_wait(simcpu->quantum, m->clock);
+}
+
+/* riscv_sim_cpu_sync_stop()
+ * @details
+ * Called once the slices of all the cores are over. If one of them stopped
+ * the simulation during its slice, the other ones are stopped now.
+ */
+void
+riscv_sim_cpu_sync_stop(RISCVSIMCPUState *simcpu)
+{
+    RISCVSIMCPUState *c;
+    int stop = FALSE;
 
-        free(timestamp);
+    c = simcpu;
+    do
+    {
+        stop |= c->stop_pending;
+        c->stop_pending = FALSE;
+        c = c->next_core;
+    } while (c != simcpu);
+
+    if (stop)
+    {
+        riscv_sim_cpu_stop(simcpu, simcpu->emu_cpu_state->pc);
     }
 }
 
+/* Called by the last core to reach the end of the quantum, opaque being the
+ * first core */
+static void
+quantum_complete(void *opaque, uint64_t start, uint64_t end)
+{
+    RISCVSIMCPUState *c, *boot_core = (RISCVSIMCPUState *)opaque;
+    MemoryController *m[MAX_NUM_CORES];
+    int num_cores = 0;
+
+    c = boot_core;
+    do
+    {
+        m[num_cores++] = c->mem_hierarchy->mem_controller;
+        c = c->next_core;
+    } while (c != boot_core);
+
+    mem_controller_run_quantum(m, num_cores, start, end);
+}
+
 void
 riscv_sim_cpu_reset(RISCVSIMCPUState *simcpu)
 {
@@ -858,6 +1669,14 @@ riscv_sim_cpu_reset(RISCVSIMCPUState *simcpu)
     reset_insn_latch_pool(simcpu->insn_latch_pool);
     mem_controller_reset(simcpu->mem_hierarchy->mem_controller);
     simcpu->core_reset(simcpu->core);
+
+    /* The clock is also advanced by the instructions emulated in between */
+    if (simcpu->quantum)
+    {
+        simcpu->mem_hierarchy->mem_controller->clock = simcpu->clock;
+        simcpu->mem_hierarchy->mem_controller->quantum_end
+            = simcpu->quantum->end;
+    }
 }
 
 int
@@ -875,14 +1694,18 @@ riscv_sim_cpu_switch_to_cpu_simulation(RISCVSIMCPUState *simcpu)
     return sim_exit_status;
 }
 
+/* The first core is created with boot_core set to NULL. The other cores join
+ * its ring and share its L2 cache and memory controller. */
 RISCVSIMCPUState *
-riscv_sim_cpu_init(const SimParams *p, struct RISCVCPUState *s)
+riscv_sim_cpu_init(const SimParams *p, struct RISCVCPUState *s, int core_id,
+                   RISCVSIMCPUState *boot_core)
 {
-    RISCVSIMCPUState *simcpu;
+    RISCVSIMCPUState *simcpu, *c;
 
     simcpu = calloc(1, sizeof(RISCVSIMCPUState));
     assert(simcpu);
 
+    simcpu->core_id = core_id;
     simcpu->emu_cpu_state = s;
     simcpu->pc = 0x1000;
     simcpu->clock = 0;
@@ -892,11 +1715,14 @@ riscv_sim_cpu_init(const SimParams *p, struct RISCVCPUState *s)
     simcpu->stats = (SimStats *)calloc(NUM_MAX_PRV_LEVELS, sizeof(SimStats));
     assert(simcpu->stats != NULL);
 
-    simcpu->insn_latch_pool = (InstructionLatch *)calloc(
-        INSN_LATCH_POOL_SIZE, sizeof(InstructionLatch));
-    assert(simcpu->insn_latch_pool);
+    simcpu->insn_latch_pool = insn_latch_pool_init(p->insn_latch_pool_size);
+
+    if (!boot_core)
+    {
+        sim_params_log_options(p);
+    }
 
-    sim_params_log_options(p);
+    simcpu->decode_cache = decode_cache_init();
 
     switch (p->core_type)
     {
@@ -918,9 +1744,13 @@ riscv_sim_cpu_init(const SimParams *p, struct RISCVCPUState *s)
         }
     }
 
-    sim_params_log_exec_unit_config(p);
+    if (!boot_core)
+    {
+        sim_params_log_exec_unit_config(p);
+    }
 
-    simcpu->mem_hierarchy = memory_hierarchy_init(simcpu->params, sim_log);
+    simcpu->mem_hierarchy = memory_hierarchy_init(
+        simcpu->params, sim_log, boot_core ? boot_core->mem_hierarchy : NULL);
 
     /* Seed for random eviction, if used in BPU and caches */
     srand(time(NULL));
@@ -939,29 +1769,96 @@ riscv_sim_cpu_init(const SimParams *p, struct RISCVCPUState *s)
         simcpu->bpu_execute_stage_handler = &bpu_disabled_execute_stage_handler;
     }
 
+    if (p->sample_detail_icount)
+    {
+        simcpu->sampler = sim_sampler_init(p);
+        simcpu->warmup_stats
+            = (SimStats *)calloc(NUM_MAX_PRV_LEVELS, sizeof(SimStats));
+        assert(simcpu->warmup_stats);
+    }
+
     simcpu->temu_mem_map_wrapper = temu_mem_map_wrapper_init();
     simcpu->exception = sim_exception_init();
     simcpu->trace = sim_trace_init();
 
-    if (p->enable_stats_display)
+    if (p->do_sim_profile)
+    {
+        simcpu->profile = sim_profile_init();
+    }
+
+    if (p->sim_epoch_length)
+    {
+        simcpu->epoch = sim_epoch_init(p);
+    }
+
+    simcpu->regions = sim_regions_init();
+
+    /* sim-stats-display shows the stats of the first core */
+    if (p->enable_stats_display && !boot_core)
     {
         setup_stats_shm(simcpu);
     }
 
+    if (p->parallel_sim && (p->num_cores > 1))
+    {
+        simcpu->quantum
+            = boot_core ? boot_core->quantum
+                        : sim_quantum_init(p->sim_quantum_cycles,
+                                           &quantum_complete, simcpu);
+    }
+
+    simcpu->next_core = simcpu;
+    if (boot_core)
+    {
+        for (c = boot_core; c->next_core != boot_core; c = c->next_core)
+        {
+        }
+        c->next_core = simcpu;
+        simcpu->next_core = boot_core;
+    }
+
     sim_assert((sim_file_path_valid(p->sim_file_path)),
                "error: %s at line %d in %s(): %s", __FILE__, __LINE__, __func__,
                "top-level stats directory not found");
     return simcpu;
 }
 
+/* The cores sharing the memory hierarchy of the first one must be freed before
+ * it */
 void
 riscv_sim_cpu_free(RISCVSIMCPUState **simcpu)
 {
+    RISCVSIMCPUState *c;
+
+    for (c = (*simcpu)->next_core; c->next_core != *simcpu; c = c->next_core)
+    {
+    }
+    c->next_core = (*simcpu)->next_core;
+
     free((*simcpu)->stats);
     (*simcpu)->stats = NULL;
 
-    free((*simcpu)->insn_latch_pool);
-    (*simcpu)->insn_latch_pool = NULL;
+    if ((*simcpu)->sampler)
+    {
+        sim_sampler_free(&(*simcpu)->sampler);
+        free((*simcpu)->warmup_stats);
+    }
+
+    if ((*simcpu)->profile)
+    {
+        sim_profile_free(&(*simcpu)->profile);
+    }
+
+    if ((*simcpu)->epoch)
+    {
+        sim_epoch_free(&(*simcpu)->epoch);
+    }
+
+    sim_regions_free(&(*simcpu)->regions);
+
+    insn_latch_pool_free(&(*simcpu)->insn_latch_pool);
+
+    decode_cache_free(&(*simcpu)->decode_cache);
 
     memory_hierarchy_free(&((*simcpu)->mem_hierarchy));
 
@@ -974,5 +1871,11 @@ riscv_sim_cpu_free(RISCVSIMCPUState **simcpu)
     temu_mem_map_wrapper_free(&(*simcpu)->temu_mem_map_wrapper);
     sim_exception_free(&(*simcpu)->exception);
     sim_trace_free(&(*simcpu)->trace);
+
+    if ((*simcpu)->quantum && ((*simcpu)->next_core == *simcpu))
+    {
+        sim_quantum_free(&(*simcpu)->quantum);
+    }
+    free((*simcpu)->dram_stats_timestamp);
     free(*simcpu);
 }
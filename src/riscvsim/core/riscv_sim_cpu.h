@@ -33,12 +33,18 @@
 #include <time.h>
 
 #include "../bpu/bpu.h"
+#include "../decoder/riscv_decode_cache.h"
 #include "../memory_hierarchy/memory_hierarchy.h"
 #include "../memory_hierarchy/temu_mem_map_wrapper.h"
 #include "../riscv_sim_typedefs.h"
 #include "../utils/cpu_latches.h"
+#include "../utils/sim_epoch.h"
 #include "../utils/sim_exception.h"
 #include "../utils/sim_params.h"
+#include "../utils/sim_profile.h"
+#include "../utils/sim_quantum.h"
+#include "../utils/sim_region.h"
+#include "../utils/sim_sample.h"
 #include "../utils/sim_stats.h"
 #include "../utils/sim_trace.h"
 
@@ -64,12 +70,16 @@ typedef struct RISCVSIMCPUState
      * across the pipeline stages when the instruction advances through the
      * pipeline. When the instruction commits, the latch is added back to the
      * pool for reuse by following instructions. */
-    InstructionLatch *insn_latch_pool;
+    InsnLatchPool *insn_latch_pool;
 
     SimStats *stats;
     SimParams *params;
     BranchPredUnit *bpu;
 
+    /* Decoded instructions, reused by the decode stage for the instructions
+     * fetched again from the same physical address */
+    DecodeCache *decode_cache;
+
     /* Memory hierarchy to simulate the delays We do not model the actual data
      * in the hierarchy for simplicity, but just the addresses for simulating
      * the delays.*/
@@ -87,6 +97,15 @@ typedef struct RISCVSIMCPUState
     /* For generating simulation trace */
     SimTrace *trace;
 
+    /* Commit stall profile, NULL if disabled */
+    SimProfile *profile;
+
+    /* Epoch stats, NULL if disabled */
+    SimEpoch *epoch;
+
+    /* Regions tagged by the guest, see riscv_sim_cpu_region_begin() */
+    SimRegions *regions;
+
     /* Pointer to shared memory area to write stats, which is read by
      * sim-stats-display tool */
     SimStats *stats_shm_ptr;
@@ -97,6 +116,28 @@ typedef struct RISCVSIMCPUState
     struct timespec sim_start_time;
     struct timespec sim_end_time;
 
+    /* Committed instructions after which the core switches to emulation, 0
+     * if unlimited, see riscv_sim_cpu_icount_complete() */
+    uint64_t icount_limit;
+
+    /* Sampled simulation, NULL if disabled. sampling is set from simulation
+     * start to stop, simulation then only being set in the detailed windows.
+     * The stats updated while warming the caches and the BPU are saved when
+     * the warmup starts, and restored when it is over. */
+    SimSampler *sampler;
+    int sampling;
+    SimStats *warmup_stats;
+    CacheStats warmup_icache_stats[NUM_MAX_PRV_LEVELS];
+    CacheStats warmup_dcache_stats[NUM_MAX_PRV_LEVELS];
+    CacheStats warmup_l2_cache_stats[NUM_MAX_PRV_LEVELS];
+
+    /* Control-flow instruction emulated last during the warmup, resolved in
+     * the BPU once the PC of the next instruction is known */
+    int warm_branch_pending;
+    int warm_branch_priv;
+    target_ulong warm_branch_pc;
+    uint32_t warm_branch_insn;
+
     /* BPU handler routines when BPU is enabled or disabled */
     void (*bpu_fetch_stage_handler)(struct RISCVCPUState *, InstructionLatch *);
     int (*bpu_decode_stage_handler)(struct RISCVCPUState *, InstructionLatch *);
@@ -105,6 +146,24 @@ typedef struct RISCVSIMCPUState
 
     struct RISCVCPUState *emu_cpu_state; /* Pointer to emulated CPU state */
 
+    /* Ring of the simulated cores, one per guest hart */
+    struct RISCVSIMCPUState *next_core;
+
+    /* With parallel_sim, the cores run on their own host threads, each one
+     * for a slice of slice_end cycles, and synchronize at the end of every
+     * quantum. A core leaves the quantum when its slice is over, or when it
+     * stops the simulation, in which case the other cores are stopped after
+     * their slice, see riscv_sim_cpu_sync_stop(). */
+    SimQuantum *quantum;
+    int in_slice;
+    int in_quantum;
+    uint64_t slice_end;
+    int stop_pending;
+
+    /* Set on the core owning the DRAM models, until their stats are printed
+     * once all the cores stopped */
+    char *dram_stats_timestamp;
+
     /*----------  Set based on core type: in-order or out-of-order  ----------*/
     void *core;
     void (*core_reset)(void *core);
@@ -113,12 +172,27 @@ typedef struct RISCVSIMCPUState
 } RISCVSIMCPUState;
 
 RISCVSIMCPUState *riscv_sim_cpu_init(const SimParams *p,
-                                     struct RISCVCPUState *s);
+                                     struct RISCVCPUState *s, int core_id,
+                                     RISCVSIMCPUState *boot_core);
 int riscv_sim_cpu_switch_to_cpu_simulation(RISCVSIMCPUState *simcpu);
 void riscv_sim_cpu_start(RISCVSIMCPUState *simcpu, target_ulong pc);
 void riscv_sim_cpu_stop(RISCVSIMCPUState *simcpu, target_ulong pc);
+void riscv_sim_cpu_icount_complete(RISCVSIMCPUState *simcpu, target_ulong pc);
+void riscv_sim_cpu_region_begin(RISCVSIMCPUState *simcpu, uint64_t id);
+void riscv_sim_cpu_region_end(RISCVSIMCPUState *simcpu, uint64_t id);
+int riscv_sim_cpu_sample_step(RISCVSIMCPUState *simcpu, int n_cycles);
+void riscv_sim_cpu_warm_insn(struct RISCVCPUState *s, target_ulong pc,
+                             uint32_t insn);
+void riscv_sim_cpu_warm_data(struct RISCVCPUState *s, int bytes,
+                             int is_write);
 void riscv_sim_cpu_reset(RISCVSIMCPUState *simcpu);
 void riscv_sim_cpu_free(RISCVSIMCPUState **simcpu);
+void riscv_sim_cpu_begin_slice(RISCVSIMCPUState *simcpu,
+                               uint64_t slice_cycles);
+int riscv_sim_cpu_slice_done(const RISCVSIMCPUState *simcpu);
+void riscv_sim_cpu_end_slice(RISCVSIMCPUState *simcpu);
+void riscv_sim_cpu_end_quantum(RISCVSIMCPUState *simcpu);
+void riscv_sim_cpu_sync_stop(RISCVSIMCPUState *simcpu);
 
 int get_data_mem_access_latency(struct RISCVCPUState *s, InstructionLatch *e);
 void fetch_cpu_stage_exec(struct RISCVCPUState *s, InstructionLatch *e);
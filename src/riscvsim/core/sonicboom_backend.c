@@ -488,7 +488,7 @@ sonicboom_core_rob_commit(BOOM3Core *core)
             }
 
             /* Free up insn_latch_pool entry */
-            e->status = INSN_LATCH_FREE;
+            insn_latch_free(s->simcpu->insn_latch_pool, e);
 
             /* All the dependent instructions will have to lookup ARF for
              * operand value */
@@ -497,9 +497,10 @@ sonicboom_core_rob_commit(BOOM3Core *core)
             /* Deallocate ROB entry */
             cq_dequeue(&core->rob.cq);
 
-            /* Check for user specified sim_emulate_after_icount instructions */
-            if (s->sim_params->sim_emulate_after_icount
-                && (s->simcpu->icount >= s->sim_params->sim_emulate_after_icount))
+            /* Check for the end of sim_emulate_after_icount instructions, or of
+             * the detailed window in sampled simulation */
+            if (s->simcpu->icount_limit
+                && (s->simcpu->icount >= s->simcpu->icount_limit))
             {
                 e->ins.exception_cause = SIM_ICOUNT_COMPLETE_EXCEPTION;
                 sim_exception_set(s->simcpu->exception, e);
@@ -118,7 +118,7 @@ restore_rob_entry(BOOM3Core *core, ROBEntry *rbe, uint64_t tag)
                        __func__, "rob entry rollback failure");
         }
         /* Free up latch */
-        e->status = INSN_LATCH_FREE;
+        insn_latch_free(core->simcpu->insn_latch_pool, e);
     }
 }
 
@@ -174,7 +174,7 @@ restore_iq(IssueQueueEntry *iq, int size, uint64_t tag)
 
 static void
 restore_fu(CPUStage *fu, int stages, uint64_t tag,
-           InstructionLatch *insn_latch_pool)
+           InsnLatchPool *insn_latch_pool)
 {
     int i;
     InstructionLatch *e;
@@ -183,7 +183,7 @@ restore_fu(CPUStage *fu, int stages, uint64_t tag,
     {
         if (fu[i].has_data)
         {
-            e = &insn_latch_pool[fu[i].insn_latch_index];
+            e = get_insn_latch(insn_latch_pool, fu[i].insn_latch_index);
             if (e->ins_dispatch_id > tag)
             {
                 cpu_stage_flush_free_insn_latch(&fu[i], insn_latch_pool);
@@ -199,7 +199,8 @@ restore_lsu(BOOM3Core *core, uint64_t tag)
 
     if (core->lsu.has_data)
     {
-        e = &core->simcpu->insn_latch_pool[core->lsu.insn_latch_index];
+        e = get_insn_latch(core->simcpu->insn_latch_pool,
+                           core->lsu.insn_latch_index);
         if (e->ins_dispatch_id > tag)
         {
             cpu_stage_flush_free_insn_latch(&core->lsu,
@@ -315,24 +316,26 @@ reallocate_active_insn_latch_pool_entries(BOOM3Core *core)
 {
     int i;
 
-    /* Set the insn_latch_pool entry status for active instructions as allocated
-     */
+    /* Mark the insn_latch_pool entries of active instructions as allocated */
     if (core->rob.cq.rear >= core->rob.cq.front)
     {
         for (i = core->rob.cq.front; i <= core->rob.cq.rear; ++i)
         {
-            core->rob.entries[i].e->status = INSN_LATCH_ALLOCATED;
+            insn_latch_reserve(core->simcpu->insn_latch_pool,
+                               core->rob.entries[i].e);
         }
     }
     else
     {
         for (i = core->rob.cq.front; i < core->rob.cq.max_size; ++i)
         {
-            core->rob.entries[i].e->status = INSN_LATCH_ALLOCATED;
+            insn_latch_reserve(core->simcpu->insn_latch_pool,
+                               core->rob.entries[i].e);
         }
         for (i = 0; i <= core->rob.cq.rear; ++i)
         {
-            core->rob.entries[i].e->status = INSN_LATCH_ALLOCATED;
+            insn_latch_reserve(core->simcpu->insn_latch_pool,
+                               core->rob.entries[i].e);
         }
     }
 }
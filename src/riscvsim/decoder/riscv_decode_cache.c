@@ -0,0 +1,134 @@
+/**
+ * Decoded instruction cache
+ *
+ * MARSS-RISCV : Micro-Architectural System Simulator for RISC-V
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../cutils.h"
+#include "../utils/sim_log.h"
+#include "riscv_decode_cache.h"
+
+static void
+decode_cache_log_config(const DecodeCache *d)
+{
+    sim_log_event_to_file(sim_log, "%s", "Setting up decoded instruction cache");
+    sim_log_param_to_file(sim_log, "%s: %d", "size", d->size);
+}
+
+static DecodeCacheEntry *
+get_decode_cache_entry(DecodeCache *d, target_ulong paddr)
+{
+    /* Instructions are at least 2-byte aligned */
+    return &d->entry[(paddr >> 1) & (d->size - 1)];
+}
+
+DecodeCache *
+decode_cache_init()
+{
+    DecodeCache *d;
+
+    d = (DecodeCache *)calloc(1, sizeof(DecodeCache));
+    assert(d);
+
+    d->size = DECODE_CACHE_SIZE;
+    d->entry = (DecodeCacheEntry *)calloc(d->size, sizeof(DecodeCacheEntry));
+    assert(d->entry);
+
+    decode_cache_log_config(d);
+    return d;
+}
+
+void
+decode_cache_free(DecodeCache **d)
+{
+    free((*d)->entry);
+    (*d)->entry = NULL;
+    free(*d);
+    *d = NULL;
+}
+
+void
+decode_cache_flush(DecodeCache *d)
+{
+    memset((void *)d->entry, 0, d->size * sizeof(DecodeCacheEntry));
+}
+
+/**
+ * Returns TRUE and copies the decoded instruction into ins, if the instruction
+ * at paddr with the same binary and decoding state (set in ins by the fetch and
+ * decode stages) is present in the cache, else returns FALSE. PC and the
+ * string buffer of ins are preserved, the cached string is copied into it if
+ * needed.
+ */
+int
+decode_cache_lookup(DecodeCache *d, target_ulong paddr, RVInstruction *ins)
+{
+    target_ulong pc;
+    char *str;
+    DecodeCacheEntry *e = get_decode_cache_entry(d, paddr);
+
+    if (e->valid && (e->paddr == paddr) && (e->binary == ins->binary)
+        && (e->current_fs == ins->current_fs) && (e->rm == ins->rm)
+        && (e->create_str == ins->create_str))
+    {
+        pc = ins->pc;
+        str = ins->str;
+        *ins = e->ins;
+        ins->pc = pc;
+        ins->str = str;
+        if (ins->create_str)
+        {
+            memcpy(ins->str, e->str, RISCV_INS_STR_MAX_LENGTH);
+        }
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/**
+ * Saves the instruction decoded for paddr, evicting the instruction in its
+ * place. current_fs and rm are the values set in the instruction before
+ * decoding, as the decoder may overwrite rm.
+ */
+void
+decode_cache_insert(DecodeCache *d, target_ulong paddr, int current_fs,
+                    uint32_t rm, const RVInstruction *ins)
+{
+    DecodeCacheEntry *e = get_decode_cache_entry(d, paddr);
+
+    e->valid = TRUE;
+    e->paddr = paddr;
+    e->binary = ins->binary;
+    e->current_fs = current_fs;
+    e->rm = rm;
+    e->create_str = ins->create_str;
+    e->ins = *ins;
+    e->ins.str = NULL;
+    if (ins->create_str)
+    {
+        strncpy(e->str, ins->str, RISCV_INS_STR_MAX_LENGTH);
+        e->str[RISCV_INS_STR_MAX_LENGTH - 1] = '\0';
+    }
+}
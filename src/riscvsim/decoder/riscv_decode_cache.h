@@ -0,0 +1,66 @@
+/**
+ * Decoded instruction cache
+ *
+ * MARSS-RISCV : Micro-Architectural System Simulator for RISC-V
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _RISCV_DECODE_CACHE_H_
+#define _RISCV_DECODE_CACHE_H_
+
+#include "../riscv_sim_macros.h"
+#include "../riscv_sim_typedefs.h"
+#include "riscv_instruction.h"
+
+/* Number of entries in the direct-mapped decoded instruction cache, must be a
+ * power of 2 */
+#define DECODE_CACHE_SIZE 4096
+
+/* Holds a template of the decoded instruction, which is copied into the
+ * instruction latch on a hit. The decoder output only depends on the
+ * instruction binary, FP state (fs), rounding mode and whether the instruction
+ * string is generated, so these are part of the tag along with the physical
+ * address. As the binary is part of the tag, instructions overwritten by
+ * stores miss and get decoded again. */
+typedef struct DecodeCacheEntry
+{
+    int valid;
+    target_ulong paddr;
+    uint32_t binary;
+    int current_fs;
+    uint32_t rm;
+    int create_str;
+    RVInstruction ins;
+    char str[RISCV_INS_STR_MAX_LENGTH]; /* Only written if create_str is set */
+} DecodeCacheEntry;
+
+typedef struct DecodeCache
+{
+    DecodeCacheEntry *entry;
+    int size;
+} DecodeCache;
+
+DecodeCache *decode_cache_init();
+void decode_cache_free(DecodeCache **d);
+void decode_cache_flush(DecodeCache *d);
+int decode_cache_lookup(DecodeCache *d, target_ulong paddr,
+                        RVInstruction *ins);
+void decode_cache_insert(DecodeCache *d, target_ulong paddr, int current_fs,
+                         uint32_t rm, const RVInstruction *ins);
+#endif
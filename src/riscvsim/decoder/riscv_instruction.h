@@ -70,8 +70,9 @@ typedef struct RVInstruction
     /* Rounding Mode, used by floating Point */
     uint32_t rm;
 
-    /* Instruction string */
-    char str[RISCV_INS_STR_MAX_LENGTH];
+    /* Instruction string, points into the side table of the instruction latch
+     * pool and is only written if create_str is set */
+    char *str;
     int create_str;
 
     int has_src1;
@@ -0,0 +1,138 @@
+/**
+ * AiMulator Request Trace
+ *
+ * MARSS-RISCV : Micro-Architectural System Simulator for RISC-V
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../cutils.h"
+#include "../utils/sim_log.h"
+#include "aim_trace.h"
+
+#define AIM_TRACE_BUF_SIZE (1 << 20)
+
+/* Type byte and up to four varints */
+#define AIM_TRACE_MAX_HEADER_SIZE 48
+
+AimTrace *
+aim_trace_open(const char *filename, int max_inflight_requests,
+               int aim_batch_size, uint64_t clock)
+{
+    AimTrace *t;
+    AimTraceFileHeader h;
+
+    t = (AimTrace *)calloc(1, sizeof(AimTrace));
+    assert(t);
+
+    t->fp = fopen(filename, "wb");
+    sim_assert((t->fp), "error: %s at line %d in %s(): %s", __FILE__,
+               __LINE__, __func__, "cannot open the AiM trace file");
+    t->buf = (char *)malloc(AIM_TRACE_BUF_SIZE);
+    assert(t->buf);
+    setvbuf(t->fp, t->buf, _IOFBF, AIM_TRACE_BUF_SIZE);
+
+    memset((void *)&h, 0, sizeof(h));
+    memcpy(h.magic, AIM_TRACE_MAGIC, sizeof(h.magic));
+    h.version = AIM_TRACE_VERSION;
+    h.max_inflight_requests = max_inflight_requests;
+    h.aim_batch_size = aim_batch_size;
+    fwrite(&h, sizeof(h), 1, t->fp);
+
+    t->prev_clock = clock;
+    return t;
+}
+
+void
+aim_trace_close(AimTrace **t)
+{
+    fclose((*t)->fp);
+    free((*t)->buf);
+    free(*t);
+    *t = NULL;
+}
+
+/* Appends the request req_id sent to AiMulator at the given memory clock */
+void
+aim_trace_request(AimTrace *t, uint64_t clock, uint64_t req_id,
+                  PendingMemAccessEntry **e, int num_entries)
+{
+    int i;
+    uint8_t buf[AIM_TRACE_MAX_HEADER_SIZE];
+    uint8_t *p;
+    uint64_t addr;
+
+    /* The clock delta goes right after the type byte */
+    p = sim_trace_put_varint(buf + 1, clock - t->prev_clock);
+    t->prev_clock = clock;
+    buf[0] = (uint8_t)e[0]->type;
+
+    if (t->has_done)
+    {
+        p = sim_trace_put_varint(p, req_id - t->last_done_req_id);
+        p = sim_trace_put_varint(p, clock - t->last_done_clock);
+    }
+    else
+    {
+        p = sim_trace_put_varint(p, 0);
+    }
+
+    p = sim_trace_put_varint(p, num_entries);
+    if (e[0]->type == MEM_ACCESS_READ || e[0]->type == MEM_ACCESS_WRITE)
+    {
+        p = sim_trace_put_varint(p, e[0]->access_size_bytes);
+    }
+    fwrite(buf, 1, p - buf, t->fp);
+
+    for (i = 0; i < num_entries; ++i)
+    {
+        addr = e[i]->addr;
+        p = sim_trace_put_varint(
+            buf, sim_trace_zigzag_encode((int64_t)(addr - t->prev_addr)));
+        t->prev_addr = addr;
+        fwrite(buf, 1, p - buf, t->fp);
+    }
+
+    ++t->num_requests;
+    t->num_entries += num_entries;
+}
+
+/* AiMulator served all the parts of req_id */
+void
+aim_trace_request_done(AimTrace *t, uint64_t clock, uint64_t req_id)
+{
+    t->has_done = TRUE;
+    t->last_done_req_id = req_id;
+    t->last_done_clock = clock;
+}
+
+void
+aim_trace_reset(AimTrace *t, uint64_t clock)
+{
+    uint8_t buf[AIM_TRACE_MAX_HEADER_SIZE];
+    uint8_t *p;
+
+    p = sim_trace_put_varint(buf + 1, clock - t->prev_clock);
+    t->prev_clock = clock;
+    buf[0] = AIM_TRACE_RESET;
+    fwrite(buf, 1, p - buf, t->fp);
+}
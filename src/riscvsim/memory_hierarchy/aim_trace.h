@@ -0,0 +1,62 @@
+/**
+ * AiMulator Request Trace
+ *
+ * Records the requests sent to AiMulator during simulation, with their memory
+ * clock and their dependency on the completion of an earlier request, so that
+ * sim-aim-replay can run them against another AiMulator configuration without
+ * simulating the CPU again. See aim_trace_format.h for the file layout.
+ *
+ * MARSS-RISCV : Micro-Architectural System Simulator for RISC-V
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _AIM_TRACE_H_
+#define _AIM_TRACE_H_
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "aim_trace_format.h"
+#include "memory_controller_utils.h"
+
+typedef struct AimTrace
+{
+    FILE *fp;
+    char *buf;
+    uint64_t prev_clock;
+    uint64_t prev_addr;
+
+    /* Request which completed last, the requests sent afterwards depend on
+     * it */
+    int has_done;
+    uint64_t last_done_req_id;
+    uint64_t last_done_clock;
+
+    uint64_t num_requests;
+    uint64_t num_entries;
+} AimTrace;
+
+AimTrace *aim_trace_open(const char *filename, int max_inflight_requests,
+                         int aim_batch_size, uint64_t clock);
+void aim_trace_close(AimTrace **t);
+void aim_trace_request(AimTrace *t, uint64_t clock, uint64_t req_id,
+                       PendingMemAccessEntry **e, int num_entries);
+void aim_trace_request_done(AimTrace *t, uint64_t clock, uint64_t req_id);
+void aim_trace_reset(AimTrace *t, uint64_t clock);
+#endif
@@ -0,0 +1,72 @@
+/**
+ * AiMulator Request Trace Format
+ *
+ * MARSS-RISCV : Micro-Architectural System Simulator for RISC-V
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _AIM_TRACE_FORMAT_H_
+#define _AIM_TRACE_FORMAT_H_
+
+#include <inttypes.h>
+
+#include "../utils/sim_trace_format.h"
+
+/*
+ * The requests sent to AiMulator by the memory controller, in the order they
+ * were sent. File layout, all fields in host byte order:
+ *
+ *   AimTraceFileHeader
+ *   records                                         (repeated)
+ *
+ * A record is a type byte, either the MemAccessType of a request or
+ * AIM_TRACE_RESET, followed by:
+ * - varint of the memory clock delta from the previous record
+ * For a request only:
+ * - varint of the distance, in requests, to the request it depends on, 0 if
+ *   none. It is the last request which completed before this one was sent.
+ * - varint of the memory clocks from that completion to the send, only if
+ *   there is a dependency
+ * - varint of the number of entries, more than one for a batch of AiM
+ *   commands
+ * - varint of the access size in bytes, only for a read or a write
+ * - zigzag varint of the address delta from the previous address, for each
+ *   entry
+ * AIM_TRACE_RESET records the drop of all the requests in flight on a
+ * pipeline flush. The previous clock and address are 0 at the start of the
+ * trace.
+ */
+
+#define AIM_TRACE_MAGIC "AIMTRACE"
+#define AIM_TRACE_VERSION 1
+
+#define AIM_TRACE_RESET 0xff
+
+typedef struct AimTraceFileHeader
+{
+    char magic[8];
+    uint32_t version;
+
+    /* DRAM settings of the recording, the entries in flight are limited to
+     * max_inflight_requests, and a batch holds up to aim_batch_size entries */
+    uint32_t max_inflight_requests;
+    uint32_t aim_batch_size;
+    uint32_t reserved;
+} AimTraceFileHeader;
+#endif
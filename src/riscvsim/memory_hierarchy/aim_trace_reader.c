@@ -0,0 +1,166 @@
+/**
+ * AiMulator Request Trace Reader
+ *
+ * MARSS-RISCV : Micro-Architectural System Simulator for RISC-V
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "aim_trace_reader.h"
+#include "memory_controller_utils.h"
+
+/* Returns -1 if the varint runs past the end of the file */
+static int
+read_varint(FILE *fp, uint64_t *val)
+{
+    int c;
+    int shift = 0;
+
+    *val = 0;
+    while (shift < 64 && (c = getc(fp)) != EOF)
+    {
+        *val |= (uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80))
+        {
+            return 0;
+        }
+        shift += 7;
+    }
+    return -1;
+}
+
+AimTraceReader *
+aim_trace_reader_open(const char *filename)
+{
+    AimTraceReader *r;
+
+    r = (AimTraceReader *)calloc(1, sizeof(AimTraceReader));
+    if (!r)
+    {
+        return NULL;
+    }
+
+    r->fp = fopen(filename, "rb");
+    if (!r->fp)
+    {
+        fprintf(stderr, "error: cannot open %s\n", filename);
+        goto fail;
+    }
+
+    if (fread(&r->header, sizeof(r->header), 1, r->fp) != 1
+        || memcmp(r->header.magic, AIM_TRACE_MAGIC, sizeof(r->header.magic))
+        || r->header.version != AIM_TRACE_VERSION
+        || !r->header.max_inflight_requests || !r->header.aim_batch_size)
+    {
+        fprintf(stderr, "error: %s is not an AiM request trace\n", filename);
+        goto fail;
+    }
+
+    r->addr = (uint64_t *)malloc(r->header.aim_batch_size * sizeof(uint64_t));
+    if (!r->addr)
+    {
+        goto fail;
+    }
+
+    return r;
+
+fail:
+    aim_trace_reader_close(&r);
+    return NULL;
+}
+
+void
+aim_trace_reader_close(AimTraceReader **r)
+{
+    if ((*r)->fp)
+    {
+        fclose((*r)->fp);
+    }
+    free((*r)->addr);
+    free(*r);
+    *r = NULL;
+}
+
+/* Returns 1 if a record was read, 0 at the end of the trace, -1 on a corrupt
+ * trace. The addresses of the record stay valid until the next call. */
+int
+aim_trace_reader_next(AimTraceReader *r, AimTraceRecord *rec)
+{
+    int i, type;
+    uint64_t val;
+
+    if ((type = getc(r->fp)) == EOF)
+    {
+        return 0;
+    }
+
+    if (read_varint(r->fp, &val))
+    {
+        goto corrupt;
+    }
+    rec->type = type;
+    rec->clock = r->prev_clock + val;
+    r->prev_clock = rec->clock;
+    rec->dep_distance = 0;
+    rec->dep_gap = 0;
+    rec->num_entries = 0;
+    rec->access_size_bytes = 0;
+    rec->addr = r->addr;
+
+    if (type == AIM_TRACE_RESET)
+    {
+        return 1;
+    }
+
+    if (read_varint(r->fp, &rec->dep_distance)
+        || (rec->dep_distance && read_varint(r->fp, &rec->dep_gap))
+        || read_varint(r->fp, &val) || !val
+        || val > r->header.aim_batch_size)
+    {
+        goto corrupt;
+    }
+    rec->num_entries = (int)val;
+
+    if (type == MEM_ACCESS_READ || type == MEM_ACCESS_WRITE)
+    {
+        if (read_varint(r->fp, &val))
+        {
+            goto corrupt;
+        }
+        rec->access_size_bytes = (int)val;
+    }
+
+    for (i = 0; i < rec->num_entries; ++i)
+    {
+        if (read_varint(r->fp, &val))
+        {
+            goto corrupt;
+        }
+        r->addr[i] = r->prev_addr + sim_trace_zigzag_decode(val);
+        r->prev_addr = r->addr[i];
+    }
+
+    return 1;
+
+corrupt:
+    fprintf(stderr, "error: corrupt AiM request trace record\n");
+    return -1;
+}
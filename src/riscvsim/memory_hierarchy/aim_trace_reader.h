@@ -0,0 +1,59 @@
+/**
+ * AiMulator Request Trace Reader
+ *
+ * MARSS-RISCV : Micro-Architectural System Simulator for RISC-V
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _AIM_TRACE_READER_H_
+#define _AIM_TRACE_READER_H_
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "aim_trace_format.h"
+
+typedef struct AimTraceRecord
+{
+    int type;
+    uint64_t clock;
+
+    /* Request only fields, dep_distance is 0 if there is no dependency */
+    uint64_t dep_distance;
+    uint64_t dep_gap;
+    int num_entries;
+    int access_size_bytes;
+    const uint64_t *addr;
+} AimTraceRecord;
+
+typedef struct AimTraceReader
+{
+    FILE *fp;
+    AimTraceFileHeader header;
+    uint64_t prev_clock;
+    uint64_t prev_addr;
+
+    /* Addresses of the current record */
+    uint64_t *addr;
+} AimTraceReader;
+
+AimTraceReader *aim_trace_reader_open(const char *filename);
+void aim_trace_reader_close(AimTraceReader **r);
+int aim_trace_reader_next(AimTraceReader *r, AimTraceRecord *rec);
+#endif
@@ -78,26 +78,32 @@ aimulator_wrapper::finish_and_print_stats(const char* stats_dir, const char* tim
 //     it->second = true;
 // }
 
-bool
-aimulator_wrapper::access_complete()
+void
+aimulator_wrapper::transaction_complete(uint64_t req_id, int entry)
 {
-    auto it = mem_addr_cb_status.begin();
+    auto it = entry_parts_pending.find(req_id);
+    size_t i;
 
-    while (it != mem_addr_cb_status.end())
+    /* Requests dropped by reset() may still be served by the memory system,
+     * their callbacks are ignored */
+    if (it == entry_parts_pending.end())
     {
-        if (it->second == true)
-        {
-            // Erase completed entries
-            it = mem_addr_cb_status.erase(it);
-        }
-        else
+        return;
+    }
+
+    if (--it->second[entry] == 0)
+    {
+        completed_entries.push_back(std::make_pair(req_id, entry));
+
+        for (i = 0; i < it->second.size(); ++i)
         {
-            // Found an incomplete entry
-            return false;
+            if (it->second[i])
+            {
+                return;
+            }
         }
+        entry_parts_pending.erase(it);
     }
-
-    return true;
 }
 
 bool
@@ -111,123 +117,126 @@ aimulator_wrapper::try_send_transaction(const PendingTransaction& trans)
     if (trans.is_aim)
     {
         return ramulator2_frontend->receive_external_aim_requests(trans.type_id, trans.addr,
-            [this, addr=trans.addr](Ramulator::Request& req) {
+            [this, addr=trans.addr, req_id=trans.req_id, entry=trans.entry](Ramulator::Request& req) {
 #ifdef DEBUG_BUILD
                 fprintf(stderr, "(DEBUG) [NDP-Sim: AiM Wrapper] AiM req callback success! addr: 0x%lx, req.addr: 0x%lx\n",
                     addr, req.addr);
 #endif
-                auto it = mem_addr_cb_status.find(req.addr);
-                assert(it != mem_addr_cb_status.end());
-                it->second = true;
+                transaction_complete(req_id, entry);
             });
     }
     else
     {
         return ramulator2_frontend->receive_external_requests(
             trans.type_id, trans.addr, 0,
-            [this, addr=trans.addr](Ramulator::Request& req) {
+            [this, addr=trans.addr, req_id=trans.req_id, entry=trans.entry](Ramulator::Request& req) {
 #ifdef DEBUG_BUILD
                 fprintf(stderr, "(DEBUG) [NDP-Sim: AiM Wrapper] RD/WR req callback success! addr: 0x%lx, req.addr: 0x%lx\n",
                     addr, req.addr);
 #endif
-                auto it = mem_addr_cb_status.find(req.addr);
-                assert(it != mem_addr_cb_status.end());
-                it->second = true;
+                transaction_complete(req_id, entry);
             });
     }
 }
 
-int
-aimulator_wrapper::get_max_clock_cycles(PendingMemAccessEntry *e)
+void
+aimulator_wrapper::enqueue_transaction(const PendingTransaction& trans)
 {
+    // Pending transactions has a higher priority than newly arriving requests.
+    // Until the AiMulator resolves pending requests, it does not issue newly arriving requests.
+    // This behavior stems from the nature of in-order execution of AiM operations.
+    if (!retry_queue.empty() || !try_send_transaction(trans))
+    {
+        retry_queue.push(trans);
+    }
+}
+
+/* send_request()
+ * @details
+ * Hand over a memory controller request to AiMulator without waiting for it
+ * to complete. The request is identified by req_id, and each of its entries
+ * is returned by get_completed_entry() once all of its parts are served.
+ * Requests the frontend cannot accept right now are kept in the retry queue
+ * in order. A request is either a single read or write, or a batch of
+ * num_entries AiM commands of the same type, each of them being an entry.
+ */
+void
+aimulator_wrapper::send_request(uint64_t req_id, PendingMemAccessEntry **e,
+                                int num_entries)
+{
+    int i;
     int bytes_accessed = 0;
-    int clock_cycles_elasped = 0;
-    int cycles_queuing_delay = 0;
     target_ulong addr = 0;
+    std::vector<int> &parts_pending = entry_parts_pending[req_id];
 
-    mem_addr_cb_status.clear();
-
-    /* Split the entire request size into MEM_BUS_WIDTH sized parts, and query
-     * latency for each of the part separately */
-    if (e->type == MEM_ACCESS_READ || e->type == MEM_ACCESS_WRITE)
+    /* Split the entire request size into MEM_BUS_WIDTH sized parts, and send
+     * each of the part separately */
+    if (e[0]->type == MEM_ACCESS_READ || e[0]->type == MEM_ACCESS_WRITE)
     {
-        while (bytes_accessed <= e->access_size_bytes)
+        assert(num_entries == 1);
+        parts_pending.assign(1, 0);
+        while (bytes_accessed <= e[0]->access_size_bytes)
         {
-            addr = e->addr + bytes_accessed;
-            mem_addr_cb_status.insert(std::pair<target_ulong, bool>(addr, false));
-            PendingTransaction trans(addr, e->type, false);
-            if (!try_send_transaction(trans))
-            {
-                mem_addr_cb_status.erase(addr);
-                retry_queue.push(trans);
-            }
+            addr = e[0]->addr + bytes_accessed;
+            ++parts_pending[0];
+            enqueue_transaction(PendingTransaction(req_id, 0, addr, e[0]->type, false));
             bytes_accessed += MEM_BUS_WIDTH;
         }
     }
     else
     {
-        addr = e->addr;
-        mem_addr_cb_status.insert(std::pair<target_ulong, bool>(addr, false));
-        PendingTransaction trans(addr, e->type, true);
-        if (!try_send_transaction(trans))
+        parts_pending.assign(num_entries, 1);
+        for (i = 0; i < num_entries; ++i)
         {
-            mem_addr_cb_status.erase(addr);
-            retry_queue.push(trans);
+            enqueue_transaction(PendingTransaction(req_id, i, e[i]->addr, e[i]->type, true));
         }
-        
     }
+}
 
-    int cnt = 0;
-    while (!access_complete())
+/* tick()
+ * @details
+ * Advance AiMulator by one memory clock. Pending transactions are retried in
+ * order before the memory system is ticked, and the front of the retry queue
+ * blocks the ones behind it.
+ */
+void
+aimulator_wrapper::tick()
+{
+    while (!retry_queue.empty())
     {
-        // Pending transactions has a higher priority than newly arriving requests.
-        // Until the AiMulator resolves pending requests, it does not issue newly arriving requests.
-        // This behavior stems from the nature of in-order execution of AiM operations.
-        if (!retry_queue.empty())
-        {
-            // The order of pending requests should be reserved.
-            // Thus, try only a request at the front of the retry queue.
-            PendingTransaction& retry_trans = retry_queue.front();
 #ifdef DEBUG_BUILD
-            fprintf(stderr, "(DEBUG) [NDP-Sim: AiM Wrapper] Retrying address 0x%lx\n", retry_trans.addr);
+        fprintf(stderr, "(DEBUG) [NDP-Sim: AiM Wrapper] Retrying address 0x%lx\n", retry_queue.front().addr);
 #endif
-            mem_addr_cb_status.insert(std::pair<target_ulong, bool>(retry_trans.addr, false));
-            if (try_send_transaction(retry_trans))
-            {
-                retry_queue.pop();
-            }
-            else
-            {
-                mem_addr_cb_status.erase(retry_trans.addr);
-                ramulator2_memorysystem->tick();
-                cycles_queuing_delay++;
-            }
-        }
-        else
+        if (!try_send_transaction(retry_queue.front()))
         {
-            // if (cnt >= 2000)
-            // {
-            //     printf("Clock exceed\n");
-            //     printf("Not completed request addr: ");
-            //     auto it = mem_addr_cb_status.begin();
-            //     while (it != mem_addr_cb_status.end())
-            //     {
-            //         if (it->second == false)
-            //         {
-            //             printf("%x ", it->first);
-            //         }
-            //         it = mem_addr_cb_status.erase(it);
-            //     }
-
-            //     printf("\n");
-            //     throw std::runtime_error("The first incompleted request was recorded.");
-            // }
-
-            ramulator2_memorysystem->tick();
-            clock_cycles_elasped++;
-            cnt++;
+            break;
         }
+        retry_queue.pop();
     }
-    
-    return clock_cycles_elasped + cycles_queuing_delay;
+
+    ramulator2_memorysystem->tick();
+}
+
+bool
+aimulator_wrapper::get_completed_entry(uint64_t *req_id, int *entry)
+{
+    if (completed_entries.empty())
+    {
+        return false;
+    }
+
+    *req_id = completed_entries.front().first;
+    *entry = completed_entries.front().second;
+    completed_entries.pop_front();
+    return true;
+}
+
+/* Forget about all the requests sent so far, used when the memory controller
+ * drops its in-flight requests on a pipeline flush */
+void
+aimulator_wrapper::reset()
+{
+    entry_parts_pending.clear();
+    completed_entries.clear();
+    std::queue<PendingTransaction>().swap(retry_queue);
 }
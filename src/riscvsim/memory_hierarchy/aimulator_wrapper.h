@@ -24,8 +24,8 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  * THE SOFTWARE.
  */
-#ifndef _RAMULATOR_WRAPPER_H_
-#define _RAMULATOR_WRAPPER_H_
+#ifndef _AIMULATOR_WRAPPER_H_
+#define _AIMULATOR_WRAPPER_H_
 
 #include "../riscv_sim_typedefs.h"
 #include "memory_controller_utils.h"
@@ -36,7 +36,12 @@
 #include "../../AiMulator/src/frontend/frontend.h"
 #include "../../AiMulator/src/memory_system/memory_system.h"
 
+#include <deque>
 #include <fstream>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include "../../AiMulator/src/base/stats.h"
 
 class aimulator_wrapper
@@ -47,8 +52,11 @@ class aimulator_wrapper
 
     // bool add_transaction(target_ulong addr, bool isWrite);
     bool add_aim_transaction(target_ulong addr, int type_id);
-    int get_max_clock_cycles(PendingMemAccessEntry *e);
-    bool access_complete();
+    void send_request(uint64_t req_id, PendingMemAccessEntry **e,
+                      int num_entries);
+    void tick();
+    bool get_completed_entry(uint64_t *req_id, int *entry);
+    void reset();
     // void write_complete(Ramulator::Request &req);
     // void read_complete(Ramulator::Request &req);
     void finish();
@@ -59,9 +67,15 @@ class aimulator_wrapper
     Ramulator::IFrontEnd* ramulator2_frontend;
     Ramulator::IMemorySystem* ramulator2_memorysystem;
 
-    /* We split the cache-line address into MEM_BUS_WIDTH sized parts, so this map
-     * keeps track of callbacks for each of this part */
-    std::multimap<target_ulong, bool> mem_addr_cb_status;
+    /* We split the cache-line address into MEM_BUS_WIDTH sized parts, so this
+     * map keeps track of the number of parts still in flight for each entry
+     * of the requests sent by the memory controller. A request has a single
+     * read or write entry, or one entry per AiM command of a batch. */
+    std::unordered_map<uint64_t, std::vector<int>> entry_parts_pending;
+
+    /* Entries whose parts have all been served, as request id and index of
+     * the entry in the request, in order of completion */
+    std::deque<std::pair<uint64_t, int>> completed_entries;
 
     // Deprecated in Ramulator 2
     // std::function<void(Ramulator::Request&)> read_cb_func;
@@ -69,15 +83,21 @@ class aimulator_wrapper
 
   private:
     struct PendingTransaction {
+      uint64_t req_id;
+      int entry;
       target_ulong addr;
       int type_id;
       bool is_aim;
 
-      PendingTransaction(target_ulong addr, int type_id = -1, bool aim = false)
-        : addr(addr), type_id(type_id), is_aim(aim) {}
+      PendingTransaction(uint64_t req_id, int entry, target_ulong addr,
+                         int type_id = -1, bool aim = false)
+        : req_id(req_id), entry(entry), addr(addr), type_id(type_id),
+          is_aim(aim) {}
     };
 
     std::queue<PendingTransaction> retry_queue;
     bool try_send_transaction(const PendingTransaction& trans);
+    void transaction_complete(uint64_t req_id, int entry);
+    void enqueue_transaction(const PendingTransaction& trans);
 };
-#endif
\ No newline at end of file
+#endif
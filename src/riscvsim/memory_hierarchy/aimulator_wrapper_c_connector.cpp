@@ -31,53 +31,66 @@
 extern "C" {
 #endif
 
-static aimulator_wrapper *aimulator_wrapper_obj = NULL;
+/* Each handle is an aimulator_wrapper, so several AiMulator memory systems can
+ * live in the same process */
+static aimulator_wrapper *
+to_obj(AimulatorWrapper *w)
+{
+    return reinterpret_cast<aimulator_wrapper *>(w);
+}
 
-void
+AimulatorWrapper *
 aimulator_wrapper_init(const char *config_file)
 {
-    if (aimulator_wrapper_obj == NULL)
-    {
-        aimulator_wrapper_obj
-            = new aimulator_wrapper(config_file);
-    }
+    return reinterpret_cast<AimulatorWrapper *>(
+        new aimulator_wrapper(config_file));
 }
 
 void
-aimulator_wrapper_destroy()
+aimulator_wrapper_destroy(AimulatorWrapper **w)
 {
-    delete aimulator_wrapper_obj;
-    aimulator_wrapper_obj = NULL;
+    delete to_obj(*w);
+    *w = NULL;
 }
 
 void
-aimulator_wrapper_finish()
+aimulator_wrapper_finish(AimulatorWrapper *w)
 {
-    aimulator_wrapper_obj->finish();
+    to_obj(w)->finish();
 }
 
 void
-aimulator_wrapper_finish_and_print_stats(const char* stats_dir, const char* timestamp)
+aimulator_wrapper_finish_and_print_stats(AimulatorWrapper *w,
+                                         const char *stats_dir,
+                                         const char *timestamp)
 {
-    aimulator_wrapper_obj->finish_and_print_stats(stats_dir, timestamp);
+    to_obj(w)->finish_and_print_stats(stats_dir, timestamp);
 }
 
-// int
-// aimulator_wrapper_add_transaction(target_ulong addr, int isWrite)
-// {
-//     return (int)aimulator_wrapper_obj->add_transaction(addr, (bool)isWrite);
-// }
+void
+aimulator_wrapper_send_request(AimulatorWrapper *w, uint64_t req_id,
+                               PendingMemAccessEntry **e, int num_entries)
+{
+    to_obj(w)->send_request(req_id, e, num_entries);
+}
 
-// int
-// aimulator_wrapper_add_aim_transaction(target_ulong addr, int req_type)
-// {
-//     return (int)aimulator_wrapper_obj->add_aim_transaction(addr, req_type);
-// }
+void
+aimulator_wrapper_tick(AimulatorWrapper *w)
+{
+    to_obj(w)->tick();
+}
 
 int
-aimulator_wrapper_get_max_clock_cycles(PendingMemAccessEntry *e)
+aimulator_wrapper_get_completed_entry(AimulatorWrapper *w, uint64_t *req_id,
+                                      int *entry)
+{
+    return (int)to_obj(w)->get_completed_entry(req_id, entry);
+}
+
+void
+aimulator_wrapper_reset(AimulatorWrapper *w)
 {
-    return aimulator_wrapper_obj->get_max_clock_cycles(e);
+    to_obj(w)->reset();
 }
 
 #ifdef __cplusplus
@@ -24,26 +24,33 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  * THE SOFTWARE.
  */
-#ifndef _RAMULATOR_WRAPPER_C_CONNECTOR_H_
-#define _RAMULATOR_WRAPPER_C_CONNECTOR_H_
+#ifndef _AIMULATOR_WRAPPER_C_CONNECTOR_H_
+#define _AIMULATOR_WRAPPER_C_CONNECTOR_H_
 
 #include <inttypes.h>
 
 #include "../riscv_sim_typedefs.h"
 #include "memory_controller_utils.h"
 
+/* Opaque handle to one AiMulator instance */
+typedef struct AimulatorWrapper AimulatorWrapper;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
-void aimulator_wrapper_init(const char *config_file);
-void aimulator_wrapper_destroy();
-void aimulator_wrapper_finish();
-void aimulator_wrapper_finish_and_print_stats(const char* stats_dir, const char* timestamp);
-// int aimulator_wrapper_add_transaction(target_ulong addr, int isWrite);
-int aimulator_wrapper_get_max_clock_cycles(PendingMemAccessEntry *e);
-
-// AiM
-// int aimulator_wrapper_add_aim_transaction(target_ulong addr, int req_type);
+AimulatorWrapper *aimulator_wrapper_init(const char *config_file);
+void aimulator_wrapper_destroy(AimulatorWrapper **w);
+void aimulator_wrapper_finish(AimulatorWrapper *w);
+void aimulator_wrapper_finish_and_print_stats(AimulatorWrapper *w,
+                                              const char *stats_dir,
+                                              const char *timestamp);
+void aimulator_wrapper_send_request(AimulatorWrapper *w, uint64_t req_id,
+                                    PendingMemAccessEntry **e,
+                                    int num_entries);
+void aimulator_wrapper_tick(AimulatorWrapper *w);
+int aimulator_wrapper_get_completed_entry(AimulatorWrapper *w,
+                                          uint64_t *req_id, int *entry);
+void aimulator_wrapper_reset(AimulatorWrapper *w);
 
 #ifdef __cplusplus
 }
@@ -32,14 +32,130 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
 
 #include "../utils/sim_log.h"
 #include "cache.h"
 
+/* Bit mask of the ways of a row of the tag store holding tag. The row has
+ * num_ways entries, a multiple of the SIMD vector length. */
+#if defined(__AVX2__)
+static inline uint64_t
+match_tags(const target_ulong *tags, int num_ways, target_ulong tag)
+{
+    int i;
+    uint64_t match = 0;
+
+#if BIT_SIZE == 64
+    const __m256i key = _mm256_set1_epi64x((long long)tag);
+
+    for (i = 0; i < num_ways; i += 4)
+    {
+        __m256i row = _mm256_load_si256((const __m256i *)&tags[i]);
+        match |= (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(
+                     _mm256_cmpeq_epi64(row, key)))
+                 << i;
+    }
+#else
+    const __m256i key = _mm256_set1_epi32((int)tag);
+
+    for (i = 0; i < num_ways; i += 8)
+    {
+        __m256i row = _mm256_load_si256((const __m256i *)&tags[i]);
+        match |= (uint64_t)_mm256_movemask_ps(_mm256_castsi256_ps(
+                     _mm256_cmpeq_epi32(row, key)))
+                 << i;
+    }
+#endif
+
+    return match;
+}
+#elif defined(__SSE4_1__)
+static inline uint64_t
+match_tags(const target_ulong *tags, int num_ways, target_ulong tag)
+{
+    int i;
+    uint64_t match = 0;
+
+#if BIT_SIZE == 64
+    const __m128i key = _mm_set1_epi64x((long long)tag);
+
+    for (i = 0; i < num_ways; i += 2)
+    {
+        __m128i row = _mm_load_si128((const __m128i *)&tags[i]);
+        match |= (uint64_t)_mm_movemask_pd(
+                     _mm_castsi128_pd(_mm_cmpeq_epi64(row, key)))
+                 << i;
+    }
+#else
+    const __m128i key = _mm_set1_epi32((int)tag);
+
+    for (i = 0; i < num_ways; i += 4)
+    {
+        __m128i row = _mm_load_si128((const __m128i *)&tags[i]);
+        match |= (uint64_t)_mm_movemask_ps(
+                     _mm_castsi128_ps(_mm_cmpeq_epi32(row, key)))
+                 << i;
+    }
+#endif
+
+    return match;
+}
+#else
+static inline uint64_t
+match_tags(const target_ulong *tags, int num_ways, target_ulong tag)
+{
+    int i;
+    uint64_t match = 0;
+
+    for (i = 0; i < num_ways; ++i)
+    {
+        match |= (uint64_t)(tags[i] == tag) << i;
+    }
+
+    return match;
+}
+#endif
+
+/* Way of the set holding the valid line with the given tag, -1 if none */
+static inline int
+find_way(const Cache *c, uint32_t set, target_ulong tag)
+{
+    uint64_t match
+        = match_tags(&c->tags[set * c->tag_stride], c->tag_stride, tag)
+          & c->valid[set];
+
+    return match ? __builtin_ctzll(match) : -1;
+}
+
+/* Install the line with the given tag in the way selected as victim */
+static inline void
+set_line(const Cache *c, uint32_t set, int way, target_ulong tag)
+{
+    c->tags[set * c->tag_stride + way] = tag;
+    SET_BIT(c->valid[set], way);
+}
+
+static inline void
+clear_line(const Cache *c, uint32_t set, int way)
+{
+    CLEAR_BIT(c->valid[set], way);
+    CLEAR_BIT(c->dirty[set], way);
+    CLEAR_BIT(c->prefetched[set], way);
+}
+
+static inline target_ulong
+get_tag(const Cache *c, uint32_t set, int way)
+{
+    return c->tags[set * c->tag_stride + way];
+}
+
 static void
-update_tag_address(const Cache *c, uint32_t *pset, CacheBlk **pblk,
-                   target_ulong *ptag, target_ulong *paddr,
-                   int *pbytes_to_access, int available_bytes)
+update_tag_address(const Cache *c, uint32_t *pset, target_ulong *ptag,
+                   target_ulong *paddr, int *pbytes_to_access,
+                   int available_bytes)
 {
     /* Update pbytes_to_access to account for the available_bytes already
      * accessed */
@@ -48,7 +164,6 @@ update_tag_address(const Cache *c, uint32_t *pset, CacheBlk **pblk,
     /* Calculate set, tag and physical address to access remaining bytes not
      * present in the current cache line */
     *pset = (*pset + 1) % c->num_sets;
-    *pblk = c->blk[*pset];
     *ptag = (*ptag + 1) % c->max_tag_val;
     *paddr = *ptag << c->word_bits;
 }
@@ -69,6 +184,198 @@ read_data_internal(const Cache *c, target_ulong paddr, int bytes_to_read,
                                              p_mem_access_info);
 }
 
+/* Busy MSHR filling the line with the given tag, if any */
+static CacheMSHR *
+find_mshr(const Cache *c, target_ulong tag)
+{
+    int i;
+
+    for (i = 0; i < c->num_mshrs; ++i)
+    {
+        if (c->mshr[i].fill_queue.cur_size && (c->mshr[i].tag == tag))
+        {
+            return &c->mshr[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* The line is allocated on a miss, so a later access to it finds the tag even
+ * though the line is still being filled. The access is then merged into the
+ * fill, unless the MSHR cannot track more accesses, in which case it goes on
+ * as a hit. */
+static void
+merge_into_mshr(const Cache *c, target_ulong tag, MemAccessType type,
+                void *p_mem_access_info, int priv)
+{
+    CacheMSHR *mshr = find_mshr(c, tag);
+
+    if (mshr
+        && mem_controller_wait_fill(c->mem_controller, p_mem_access_info, type,
+                                    &mshr->fill_queue))
+    {
+        c->stats[priv].mshr_merge_cnt++;
+    }
+}
+
+/* Demand access to a line found in the cache. The first access to a
+ * prefetched line makes the prefetch useful, and late if the line is still
+ * being filled. Returns TRUE in that case, for the prefetcher to be trained as
+ * on a miss. */
+static int
+demand_hit(const Cache *c, uint32_t set, int way, target_ulong tag,
+           MemAccessType type, void *p_mem_access_info, int priv)
+{
+    int prefetched = GET_BIT(c->prefetched[set], way);
+
+    if (prefetched)
+    {
+        CLEAR_BIT(c->prefetched[set], way);
+        c->stats[priv].pf_useful_cnt++;
+        if (find_mshr(c, tag))
+        {
+            c->stats[priv].pf_late_cnt++;
+        }
+    }
+
+    merge_into_mshr(c, tag, type, p_mem_access_info, priv);
+    return prefetched;
+}
+
+/* Read the line to allocate. With MSHRs, the requests filling the line are
+ * tracked by a free MSHR instead of the access, which waits on the fill along
+ * with the accesses merged into it later. If all the MSHRs are busy, the line
+ * is filled as by a blocking cache. */
+static int
+fill_line(const Cache *c, target_ulong paddr, int bytes_to_read,
+          MemAccessType type, void *p_mem_access_info, int priv)
+{
+    int i, latency;
+    int num_busy = 0;
+    CacheMSHR *mshr = NULL;
+    MemAccessInfo fill_info;
+
+    if (!c->num_mshrs)
+    {
+        return read_data_internal(c, paddr, bytes_to_read, p_mem_access_info,
+                                  priv);
+    }
+
+    for (i = 0; i < c->num_mshrs; ++i)
+    {
+        if (c->mshr[i].fill_queue.cur_size)
+        {
+            ++num_busy;
+        }
+        else if (NULL == mshr)
+        {
+            mshr = &c->mshr[i];
+        }
+    }
+
+    if (NULL == mshr)
+    {
+        c->stats[priv].mshr_full_cnt++;
+        return read_data_internal(c, paddr, bytes_to_read, p_mem_access_info,
+                                  priv);
+    }
+
+    fill_info = *(const MemAccessInfo *)p_mem_access_info;
+    fill_info.fill_queue = &mshr->fill_queue;
+    mem_controller_reset_cpu_stage_queue(&mshr->fill_queue);
+    latency = read_data_internal(c, paddr, bytes_to_read, (void *)&fill_info,
+                                 priv);
+
+    /* Nothing to wait for if the line was found in the next level */
+    if (mshr->fill_queue.cur_size)
+    {
+        mshr->tag = paddr >> c->word_bits;
+        mem_controller_wait_fill(c->mem_controller, p_mem_access_info, type,
+                                 &mshr->fill_queue);
+        c->stats[priv].mshr_alloc_cnt++;
+        c->stats[priv].mshr_occupancy_cnt += num_busy + 1;
+    }
+
+    return latency;
+}
+
+/* Allocate the line at paddr without any access waiting on it: the fill is
+ * tracked by a free MSHR, and started right away. The prefetch is dropped if
+ * the line is present, or if all the MSHRs are busy. */
+static void
+prefetch_line(const Cache *c, target_ulong paddr,
+              const MemAccessInfo *p_mem_access_info, int priv)
+{
+    int i, victim;
+    uint32_t set = (paddr >> c->word_bits) & ((1 << c->set_bits) - 1);
+    target_ulong tag = paddr >> (c->word_bits);
+    CacheMSHR *mshr = NULL;
+    MemAccessInfo fill_info;
+
+    if (find_way(c, set, tag) >= 0)
+    {
+        return;
+    }
+
+    for (i = 0; i < c->num_mshrs; ++i)
+    {
+        if (!c->mshr[i].fill_queue.cur_size)
+        {
+            mshr = &c->mshr[i];
+            break;
+        }
+    }
+
+    if (NULL == mshr)
+    {
+        return;
+    }
+
+    /* The write-back of the victim is part of the fill */
+    fill_info = *p_mem_access_info;
+    fill_info.fill_queue = &mshr->fill_queue;
+    mem_controller_reset_cpu_stage_queue(&mshr->fill_queue);
+
+    victim = c->evict_policy->evict(c->evict_policy, set);
+    (*c->pfn_victim_evict_handler)(c, set, victim, (void *)&fill_info, priv);
+    read_data_internal(c, paddr, (WORD_SIZE * c->max_words_per_blk),
+                       (void *)&fill_info, priv);
+
+    set_line(c, set, victim, tag);
+    SET_BIT(c->prefetched[set], victim);
+    c->evict_policy->use(c->evict_policy, set, victim);
+    c->stats[priv].pf_issued_cnt++;
+
+    if (mshr->fill_queue.cur_size)
+    {
+        mshr->tag = tag;
+        mem_controller_cache_lookup_complete_signal(c->mem_controller,
+                                                    &mshr->fill_queue);
+    }
+}
+
+/* Train the prefetcher with the demand access to paddr, and prefetch the lines
+ * it returns */
+static void
+train_prefetcher(const Cache *c, target_ulong paddr, int miss,
+                 void *p_mem_access_info, int priv)
+{
+    int i, num_lines;
+    const MemAccessInfo *info = (const MemAccessInfo *)p_mem_access_info;
+
+    if (NULL == c->prefetcher)
+    {
+        return;
+    }
+
+    num_lines = c->prefetcher->train(c->prefetcher, paddr, info->pc, miss);
+    for (i = 0; i < num_lines; ++i)
+    {
+        prefetch_line(c, c->prefetcher->candidate[i], info, priv);
+    }
+}
+
 static int
 read_allocate_handler(const Cache *c, target_ulong paddr, int bytes_to_read,
                       int set, void *p_mem_access_info, int priv)
@@ -76,7 +383,6 @@ read_allocate_handler(const Cache *c, target_ulong paddr, int bytes_to_read,
     target_ulong tag;
     int latency = 0;
 
-    CacheBlk *blk = c->blk[set];
     /* Select victim using the set policy */
     int victim = c->evict_policy->evict(c->evict_policy, set);
 
@@ -87,16 +393,15 @@ read_allocate_handler(const Cache *c, target_ulong paddr, int bytes_to_read,
     tag = paddr >> (c->word_bits);
 
     /* Handle victim eviction according to set policy */
-    latency += (*c->pfn_victim_evict_handler)(c, &(blk[victim]), set, victim,
+    latency += (*c->pfn_victim_evict_handler)(c, set, victim,
                                               p_mem_access_info, priv);
 
     /* Read the line contents into the cache line selected as victim and adjust
      * the latency accordingly */
-    latency
-        += read_data_internal(c, paddr, bytes_to_read, p_mem_access_info, priv);
+    latency += fill_line(c, paddr, bytes_to_read, MEM_ACCESS_READ,
+                         p_mem_access_info, priv);
 
-    blk[victim].tag = tag;
-    blk[victim].status = Valid;
+    set_line(c, set, victim, tag);
 
     /* Update the status bits used for victim selection policy */
     c->evict_policy->use(c->evict_policy, set, victim);
@@ -116,52 +421,47 @@ int
 cache_read(const Cache *c, target_ulong paddr, int bytes_to_read,
            void *p_mem_access_info, int priv)
 {
-    int i;
+    int way;
     uint32_t start_byte = (paddr & ((1 << c->word_bits) - 1));
     uint32_t set = (paddr >> c->word_bits) & ((1 << c->set_bits) - 1);
     target_ulong tag = paddr >> (c->word_bits);
+    target_ulong demand_paddr = paddr;
     int latency = c->read_latency;
     int available_bytes = 0;
     int cache_miss_updated = 0;
-    CacheBlk *blk = c->blk[set];
+    int prefetch_hit = 0;
 
     c->stats[priv].total_read_cnt++;
 
     while (bytes_to_read > 0)
     {
-        for (i = 0; i < c->num_ways; ++i)
+        way = find_way(c, set, tag);
+        if (way >= 0)
         {
-            if ((blk[i].tag == tag) && (blk[i].status == Valid))
+            /* Tag-match: Physical address is present in the cache */
+            c->evict_policy->use(c->evict_policy, set, way);
+            prefetch_hit |= demand_hit(c, set, way, tag, MEM_ACCESS_READ,
+                                       p_mem_access_info, priv);
+
+            if ((start_byte + bytes_to_read)
+                <= (c->max_words_per_blk * WORD_SIZE))
             {
-                /* Tag-match: Physical address is present in the cache */
-                c->evict_policy->use(c->evict_policy, set, i);
-
-                if ((start_byte + bytes_to_read)
-                    <= (c->max_words_per_blk * WORD_SIZE))
-                {
-                    /* All required bytes are present in the cache */
-                    return latency;
-                }
-
-                /* Required bytes are possibly split across 2 cache lines */
-                /* Calculate the bytes available to read in the current cache
-                 * line */
-                available_bytes
-                    = ((c->max_words_per_blk * WORD_SIZE) - start_byte);
-
-                /* Adjust the remaining bytes to read, tag, set and physical
-                 * address */
-                update_tag_address(c, &set, &blk, &tag, &paddr, &bytes_to_read,
-                                   available_bytes);
-                break;
+                /* All required bytes are present in the cache */
+                train_prefetcher(c, demand_paddr,
+                                 cache_miss_updated || prefetch_hit,
+                                 p_mem_access_info, priv);
+                return latency;
             }
-        }
 
-        if (i < c->num_ways)
-        {
-            /* It means above loop was broken because required bytes were not
-             * found in the same cache line. So, start looking again for new tag
-             * and address */
+            /* Required bytes are possibly split across 2 cache lines */
+            /* Calculate the bytes available to read in the current cache
+             * line */
+            available_bytes = ((c->max_words_per_blk * WORD_SIZE) - start_byte);
+
+            /* Adjust the remaining bytes to read, tag, set and physical
+             * address, and start looking again for the new tag */
+            update_tag_address(c, &set, &tag, &paddr, &bytes_to_read,
+                               available_bytes);
             continue;
         }
 
@@ -190,12 +490,14 @@ cache_read(const Cache *c, target_ulong paddr, int bytes_to_read,
 
             /* Adjust the remaining bytes to read, tag, set and physical
              * address */
-            update_tag_address(c, &set, &blk, &tag, &paddr, &bytes_to_read,
+            update_tag_address(c, &set, &tag, &paddr, &bytes_to_read,
                                available_bytes);
             continue;
         }
     }
 
+    train_prefetcher(c, demand_paddr, cache_miss_updated || prefetch_hit,
+                     p_mem_access_info, priv);
     return latency;
 }
 
@@ -204,8 +506,7 @@ writeback_handler(const Cache *c, target_ulong paddr, int bytes_to_write,
                   int set, int way, void *p_mem_access_info, int priv)
 {
     /* Just update dirty bit and status bits, no need to write to next cache */
-    CacheBlk *blk = c->blk[set];
-    blk[way].dirty = Dirty;
+    SET_BIT(c->dirty[set], way);
     c->evict_policy->use(c->evict_policy, set, way);
     return 0;
 }
@@ -215,8 +516,7 @@ writethrough_handler(const Cache *c, target_ulong paddr, int bytes_to_write,
                      int set, int way, void *p_mem_access_info, int priv)
 {
     /* Update the dirty bit and status bits */
-    CacheBlk *blk = c->blk[set];
-    blk[way].dirty = Dirty;
+    SET_BIT(c->dirty[set], way);
     c->evict_policy->use(c->evict_policy, set, way);
 
     /* Propagate write to next-level cache if available, memory otherwise */
@@ -236,7 +536,6 @@ write_allocate_handler(const Cache *c, target_ulong paddr, int bytes_to_write,
                        int set, void *p_mem_access_info, int priv)
 {
     int latency = 0;
-    CacheBlk *blk = c->blk[set];
 
     /* As we want to allocate complete line, bytes_to_read = cache line width in
      * bytes and paddr is the address of the zeroth byte in the cache line */
@@ -250,16 +549,15 @@ write_allocate_handler(const Cache *c, target_ulong paddr, int bytes_to_write,
     /* Select victim using the set policy */
     int victim = c->evict_policy->evict(c->evict_policy, set);
     /* Handle victim eviction according to set policy */
-    latency += (*c->pfn_victim_evict_handler)(c, &(blk[victim]), set, victim,
+    latency += (*c->pfn_victim_evict_handler)(c, set, victim,
                                               p_mem_access_info, priv);
 
     /* Read the line contents into the cache line selected as victim and adjust
      * the latency accordingly */
-    latency += read_data_internal(c, new_paddr, bytes_to_read,
-                                  p_mem_access_info, priv);
+    latency += fill_line(c, new_paddr, bytes_to_read, MEM_ACCESS_WRITE,
+                         p_mem_access_info, priv);
 
-    blk[victim].tag = tag;
-    blk[victim].status = Valid;
+    set_line(c, set, victim, tag);
 
     /* Handle the cache write using underlying write policy */
     latency += (*c->pfn_write_handler)(c, paddr, bytes_to_write, set, victim,
@@ -287,45 +585,53 @@ write_no_allocate_handler(const Cache *c, target_ulong paddr,
 }
 
 static int
-writeback_victim_evict_handler(const Cache *c, CacheBlk *pBlk, int set, int way,
+writeback_victim_evict_handler(const Cache *c, int set, int way,
                                void *p_mem_access_info, int priv)
 {
     int latency = 0;
+    int valid = GET_BIT(c->valid[set], way);
+
+    if (valid && GET_BIT(c->prefetched[set], way))
+    {
+        c->stats[priv].pf_useless_cnt++;
+    }
 
-    if (NULL != pBlk)
+    /* If the cache line contents are dirty, write to next level cache if
+     * present, otherwise write to memory */
+    if (valid && GET_BIT(c->dirty[set], way))
     {
-        /* If the cache line contents are dirty, write to next level cache if
-         * present, otherwise write to memory */
-        if (Valid == pBlk->status && Dirty == pBlk->dirty)
+        if (NULL != c->next_level_cache)
         {
-            if (NULL != c->next_level_cache)
-            {
-                latency += cache_write(c->next_level_cache,
-                                       (pBlk->tag << c->word_bits),
-                                       (WORD_SIZE * c->max_words_per_blk),
-                                       p_mem_access_info, priv);
-            }
-            else
-            {
-                latency += mem_controller_create_mem_request(
-                    c->mem_controller, pBlk->tag << c->word_bits,
-                    (WORD_SIZE * c->max_words_per_blk), MEM_ACCESS_WRITE,
-                    p_mem_access_info);
-            }
+            latency += cache_write(c->next_level_cache,
+                                   (get_tag(c, set, way) << c->word_bits),
+                                   (WORD_SIZE * c->max_words_per_blk),
+                                   p_mem_access_info, priv);
+        }
+        else
+        {
+            latency += mem_controller_create_mem_request(
+                c->mem_controller, get_tag(c, set, way) << c->word_bits,
+                (WORD_SIZE * c->max_words_per_blk), MEM_ACCESS_WRITE,
+                p_mem_access_info);
         }
-        memset(pBlk, 0, sizeof(CacheBlk));
     }
+    clear_line(c, set, way);
 
     return latency;
 }
 
 static int
-writethrough_victim_evict_handler(const Cache *c, CacheBlk *pBlk, int set,
-                                  int way, void *p_mem_access_info, int priv)
+writethrough_victim_evict_handler(const Cache *c, int set, int way,
+                                  void *p_mem_access_info, int priv)
 {
+    if (GET_BIT(c->valid[set], way) && GET_BIT(c->prefetched[set], way))
+    {
+        c->stats[priv].pf_useless_cnt++;
+    }
+
     /* No need to write to next level cache or memory as we have already written
      * it */
-    memset(pBlk, 0, sizeof(CacheBlk));
+    clear_line(c, set, way);
     return 0;
 }
 
@@ -333,55 +639,51 @@ int
 cache_write(const Cache *c, target_ulong paddr, int bytes_to_write,
             void *p_mem_access_info, int priv)
 {
-    int i;
+    int way;
     uint32_t start_byte = (paddr & ((1 << c->word_bits) - 1));
     uint32_t set = (paddr >> c->word_bits) & ((1 << c->set_bits) - 1);
     target_ulong tag = paddr >> (c->word_bits);
+    target_ulong demand_paddr = paddr;
     int latency = c->write_latency;
     int available_bytes = 0;
     int cache_miss_updated = 0;
-    CacheBlk *blk = c->blk[set];
+    int prefetch_hit = 0;
 
     c->stats[priv].total_write_cnt++;
 
     while (bytes_to_write > 0)
     {
-        for (i = 0; i < c->num_ways; ++i)
+        way = find_way(c, set, tag);
+        if (way >= 0)
         {
-            if ((blk[i].tag == tag) && (blk[i].status == Valid))
+            /* Tag-match: Physical address is present in the cache */
+            prefetch_hit |= demand_hit(c, set, way, tag, MEM_ACCESS_WRITE,
+                                       p_mem_access_info, priv);
+            if ((start_byte + bytes_to_write)
+                <= (c->max_words_per_blk * WORD_SIZE))
             {
-                /* Tag-match: Physical address is present in the cache */
-                if ((start_byte + bytes_to_write)
-                    <= (c->max_words_per_blk * WORD_SIZE))
-                {
-                    /* All required bytes are present in the cache */
-                    latency += (*c->pfn_write_handler)(c, paddr, bytes_to_write,
-                                                       set, i,
-                                                       p_mem_access_info, priv);
-                    return latency;
-                }
-
-                /* Required bytes are possibly split across 2 cache lines */
-                available_bytes
-                    = ((c->max_words_per_blk * WORD_SIZE) - start_byte);
-
-                /* Write the cache line with the bytes_to_write set to actual
-                 * bytes found in this cache line */
-                latency += (*c->pfn_write_handler)(
-                    c, paddr, available_bytes, set, i, p_mem_access_info, priv);
-
-                /* Adjust the remaining bytes to write */
-                update_tag_address(c, &set, &blk, &tag, &paddr, &bytes_to_write,
-                                   available_bytes);
-                break;
+                /* All required bytes are present in the cache */
+                latency += (*c->pfn_write_handler)(c, paddr, bytes_to_write,
+                                                   set, way, p_mem_access_info,
+                                                   priv);
+                train_prefetcher(c, demand_paddr,
+                                 cache_miss_updated || prefetch_hit,
+                                 p_mem_access_info, priv);
+                return latency;
             }
-        }
 
-        if (i < c->num_ways)
-        {
-            /* It means above loop was broken because required bytes were not
-             * found in the same cache line. So, start looking again for new tag
-             * and address */
+            /* Required bytes are possibly split across 2 cache lines */
+            available_bytes = ((c->max_words_per_blk * WORD_SIZE) - start_byte);
+
+            /* Write the cache line with the bytes_to_write set to actual
+             * bytes found in this cache line */
+            latency += (*c->pfn_write_handler)(c, paddr, available_bytes, set,
+                                               way, p_mem_access_info, priv);
+
+            /* Adjust the remaining bytes to write, and start looking again for
+             * the new tag */
+            update_tag_address(c, &set, &tag, &paddr, &bytes_to_write,
+                               available_bytes);
             continue;
         }
 
@@ -410,26 +712,47 @@ cache_write(const Cache *c, target_ulong paddr, int bytes_to_write,
                 set, p_mem_access_info, priv);
 
             /* Adjust the remaining bytes to write */
-            update_tag_address(c, &set, &blk, &tag, &paddr, &bytes_to_write,
+            update_tag_address(c, &set, &tag, &paddr, &bytes_to_write,
                                available_bytes);
             continue;
         }
     }
 
+    train_prefetcher(c, demand_paddr, cache_miss_updated || prefetch_hit,
+                     p_mem_access_info, priv);
     return latency;
 }
 
 void
 cache_flush(Cache *c)
 {
-    int i;
-
     c->evict_policy->reset(c->evict_policy);
-
-    for (i = 0; i < c->num_sets; ++i)
+    if (c->prefetcher)
     {
-        memset((void *)c->blk[i], 0, sizeof(CacheBlk) * c->num_ways);
+        c->prefetcher->reset(c->prefetcher);
     }
+
+    memset((void *)c->tags, 0,
+           c->num_sets * c->tag_stride * sizeof(target_ulong));
+    memset((void *)c->valid, 0, c->num_sets * sizeof(uint64_t));
+    memset((void *)c->dirty, 0, c->num_sets * sizeof(uint64_t));
+    memset((void *)c->prefetched, 0, c->num_sets * sizeof(uint64_t));
+}
+
+/* The cache takes ownership of the prefetcher, which requires MSHRs to track
+ * its fills */
+void
+cache_set_prefetcher(Cache *c, Prefetcher *prefetcher)
+{
+    sim_assert((c->num_mshrs), "error: %s at line %d in %s(): %s", __FILE__,
+               __LINE__, __func__, "a cache prefetcher requires MSHRs");
+    c->prefetcher = prefetcher;
+    sim_log_param_to_file(sim_log, "%s: %s", "prefetcher",
+                          prefetcher_str[prefetcher->type]);
+    sim_log_param_to_file(sim_log, "%s: %d", "prefetch_degree",
+                          prefetcher->degree);
+    sim_log_param_to_file(sim_log, "%s: %d", "prefetch_distance",
+                          prefetcher->distance);
 }
 
 const CacheStats *
@@ -444,6 +767,15 @@ cache_reset_stats(Cache *c)
     memset((void *)c->stats, 0, NUM_MAX_PRV_LEVELS * sizeof(CacheStats));
 }
 
+/* Restores the stats returned by cache_get_stats(), for the accesses made
+ * while warming the cache not to be counted */
+void
+cache_set_stats(Cache *c, const CacheStats *stats)
+{
+    memcpy((void *)c->stats, (const void *)stats,
+           NUM_MAX_PRV_LEVELS * sizeof(CacheStats));
+}
+
 static void
 cache_log_config(const Cache *c)
 {
@@ -463,6 +795,7 @@ cache_log_config(const Cache *c)
     sim_log_param_to_file(sim_log, "%s: %s", "write_policy", cache_wp_str[c->cache_write_policy]);
     sim_log_param_to_file(sim_log, "%s: %d cycle(s)", "read_latency", c->read_latency);
     sim_log_param_to_file(sim_log, "%s: %d cycle(s)", "write_latency", c->write_latency);
+    sim_log_param_to_file(sim_log, "%s: %d", "num_mshrs", c->num_mshrs);
 }
 
 static int
@@ -478,7 +811,7 @@ cache_init(CacheTypes type, CacheLevels level, int size_kb, int cache_line_size,
            CacheWritePolicy write_policy,
            CacheReadAllocPolicy read_alloc_policy,
            CacheWriteAllocPolicy write_alloc_policy,
-           MemoryController *mem_controller)
+           MemoryController *mem_controller, int num_mshrs)
 {
     int i;
     uint32_t blks = get_num_cache_blks(size_kb, cache_line_size);
@@ -490,16 +823,28 @@ cache_init(CacheTypes type, CacheLevels level, int size_kb, int cache_line_size,
     c->num_ways = ways;
     c->num_sets = (blks / ways);
 
-    /* Allocate memory for all cache line pointers */
-    c->blk = (CacheBlk **)calloc(c->num_sets, sizeof(CacheBlk *));
-    assert(c->blk);
+    /* The status bits of a set are kept in 64-bit masks */
+    sim_assert((c->num_ways <= 64), "error: %s at line %d in %s(): %s",
+               __FILE__, __LINE__, __func__,
+               "caches support at most 64 ways");
 
-    /* Allocate memory for cache blocks */
-    for (i = 0; i < c->num_sets; ++i)
+    /* Allocate the tag store, with every row a multiple of CACHE_TAG_ALIGN */
+    c->tag_stride = c->num_ways;
+    while ((c->tag_stride * sizeof(target_ulong)) % CACHE_TAG_ALIGN)
     {
-        c->blk[i] = (CacheBlk *)calloc(c->num_ways, sizeof(CacheBlk));
-        assert(c->blk[i]);
+        ++c->tag_stride;
     }
+    c->tags = (target_ulong *)aligned_alloc(
+        CACHE_TAG_ALIGN, c->num_sets * c->tag_stride * sizeof(target_ulong));
+    assert(c->tags);
+    c->valid = (uint64_t *)calloc(c->num_sets, sizeof(uint64_t));
+    assert(c->valid);
+    c->dirty = (uint64_t *)calloc(c->num_sets, sizeof(uint64_t));
+    assert(c->dirty);
+    c->prefetched = (uint64_t *)calloc(c->num_sets, sizeof(uint64_t));
+    assert(c->prefetched);
+    memset((void *)c->tags, 0,
+           c->num_sets * c->tag_stride * sizeof(target_ulong));
 
     c->max_words_per_blk = words_per_blk;
 
@@ -535,6 +880,26 @@ cache_init(CacheTypes type, CacheLevels level, int size_kb, int cache_line_size,
     c->cache_write_policy = write_policy;
     c->cache_read_alloc_policy = read_alloc_policy;
     c->cache_write_alloc_policy = write_alloc_policy;
+    c->prefetcher = NULL;
+
+    /* The fills of the MSHRs are dropped with the CPU stage queues when the
+     * memory controller is reset */
+    c->num_mshrs = num_mshrs;
+    c->mshr = (CacheMSHR *)calloc(num_mshrs, sizeof(CacheMSHR));
+    assert(c->mshr || !num_mshrs);
+    for (i = 0; i < num_mshrs; ++i)
+    {
+        c->mshr[i].fill_queue.max_size = MSHR_FILL_QUEUE_SIZE;
+        c->mshr[i].fill_queue.entry = (PendingMemAccessEntry *)calloc(
+            MSHR_FILL_QUEUE_SIZE, sizeof(PendingMemAccessEntry));
+        assert(c->mshr[i].fill_queue.entry);
+        c->mshr[i].fill_queue.max_waiters = MSHR_MAX_WAITERS;
+        c->mshr[i].fill_queue.waiter = (PendingMemAccessEntry *)calloc(
+            MSHR_MAX_WAITERS, sizeof(PendingMemAccessEntry));
+        assert(c->mshr[i].fill_queue.waiter);
+        mem_controller_add_fill_queue(mem_controller,
+                                      &c->mshr[i].fill_queue);
+    }
 
     /* Set write policy handler function pointer */
     switch (write_policy)
@@ -595,16 +960,28 @@ cache_free(Cache **c)
 {
     int i;
 
-    for (i = 0; i < (*c)->num_sets; ++i)
-    {
-        free((*c)->blk[i]);
-        (*c)->blk[i] = NULL;
-    }
-    free((*c)->blk);
-    (*c)->blk = NULL;
+    free((*c)->tags);
+    (*c)->tags = NULL;
+    free((*c)->valid);
+    (*c)->valid = NULL;
+    free((*c)->dirty);
+    (*c)->dirty = NULL;
+    free((*c)->prefetched);
+    (*c)->prefetched = NULL;
     free((*c)->stats);
     (*c)->stats = NULL;
+    for (i = 0; i < (*c)->num_mshrs; ++i)
+    {
+        free((*c)->mshr[i].fill_queue.entry);
+        free((*c)->mshr[i].fill_queue.waiter);
+    }
+    free((*c)->mshr);
+    (*c)->mshr = NULL;
     evict_policy_free(&(*c)->evict_policy);
+    if ((*c)->prefetcher)
+    {
+        prefetcher_free(&(*c)->prefetcher);
+    }
     free(*c);
     *c = NULL;
 }
\ No newline at end of file
@@ -34,11 +34,15 @@
 #include "../utils/evict_policy.h"
 #include "../utils/sim_params.h"
 #include "memory_controller.h"
+#include "prefetcher.h"
 
 /* Word size in the target architecture */
 #define WORD_SIZE (sizeof(target_ulong))
 
-struct CacheBlk;
+/* Requests of a line fill, and accesses merged into it, an MSHR can track */
+#define MSHR_FILL_QUEUE_SIZE 8
+#define MSHR_MAX_WAITERS 16
+
 struct Cache;
 
 typedef int (*PFN_GET_VICTIM_INDEX)(const struct Cache *c, int set);
@@ -52,8 +56,7 @@ typedef int (*PFN_WRITE_ALLOC_HANDLER)(const struct Cache *c,
                                        target_ulong paddr, int bytes_to_write,
                                        int set, void *p_mem_access_info,
                                        int priv);
-typedef int (*PFN_VICTIM_EVICTION_HANDLER)(const struct Cache *c,
-                                           struct CacheBlk *pBlk, int set,
+typedef int (*PFN_VICTIM_EVICTION_HANDLER)(const struct Cache *c, int set,
                                            int way, void *p_mem_access_info,
                                            int priv);
 
@@ -72,15 +75,6 @@ typedef enum CacheLevels {
     L3 = 0x3,
 } CacheLevels;
 
-/* Status of the cache block */
-typedef enum BlockStatus {
-    Unused = 0x0,
-    Valid = 0x1,
-} BlockStatus;
-
-/* Block status, used if WriteBack policy is set */
-typedef enum BlockDirtyStatus { NonDirty = 0x0, Dirty = 0x1 } BlockDirtyStatus;
-
 /* Cache line allocate policy on write-miss */
 typedef enum CacheWriteAllocPolicy {
     WriteAllocate = 0x0,
@@ -109,15 +103,35 @@ typedef struct CacheStats
     uint64_t total_write_cnt;
     uint64_t read_miss_cnt;
     uint64_t write_miss_cnt;
+
+    /* Line fills tracked by an MSHR, accesses merged into one of them instead
+     * of counting as misses, misses served blocking as all the MSHRs were
+     * busy, and the busy MSHRs summed over the allocations, which gives the
+     * average occupancy seen by a miss */
+    uint64_t mshr_alloc_cnt;
+    uint64_t mshr_merge_cnt;
+    uint64_t mshr_full_cnt;
+    uint64_t mshr_occupancy_cnt;
+
+    /* Lines prefetched, prefetched lines accessed before being evicted,
+     * those of them still being filled when accessed, and prefetched lines
+     * evicted without being accessed */
+    uint64_t pf_issued_cnt;
+    uint64_t pf_useful_cnt;
+    uint64_t pf_late_cnt;
+    uint64_t pf_useless_cnt;
 } CacheStats;
 
-/* Single cache line */
-typedef struct CacheBlk
+/* Rows of the tag store are aligned for the SIMD tag match */
+#define CACHE_TAG_ALIGN 32
+
+/* Miss status holding register, busy while the fill of the line with the
+ * given tag has requests left in fill_queue */
+typedef struct CacheMSHR
 {
-    uint8_t status;
-    uint8_t dirty;
     target_ulong tag;
-} CacheBlk;
+    StageMemAccessQueue fill_queue;
+} CacheMSHR;
 
 /* Cache object storing cache blocks, status bits and policies to be used */
 
@@ -127,7 +141,15 @@ typedef struct CacheBlk
  * cache. The cache accesses are non-pipelined and follow a non-inclusive
  * non-exclusive design, meaning the contents of the lower level cache are
  * neither strictly inclusive nor exclusive of the higher-level cache. L2 cache
- * can be accessed in parallel by split L1 caches.*/
+ * can be accessed in parallel by split L1 caches.
+ *
+ * With MSHRs, a cache becomes non-blocking: the line is allocated on a miss as
+ * before, but its fill completes asynchronously through the memory controller,
+ * and the later accesses to the line wait on the same fill.
+ *
+ * A prefetcher can be attached to a cache with MSHRs. The lines it finds are
+ * allocated like on a miss, but their fills are only tracked by the MSHRs, and
+ * no access waits on them until the line is accessed. */
 typedef struct Cache
 {
     int level;
@@ -170,13 +192,28 @@ typedef struct Cache
        used(Write-Allocate/Write-No-Allocate) */
     PFN_VICTIM_EVICTION_HANDLER pfn_victim_evict_handler;
 
-    CacheBlk **blk;
+    /* Tag store as a structure of arrays: the tags of a set are contiguous,
+     * starting at tags[set * tag_stride], and the valid, dirty and prefetched
+     * (not accessed since prefetched) bits of its ways are kept in one mask
+     * per set. tag_stride pads num_ways to a full row of SIMD vectors, the
+     * padding ways are never valid. */
+    int tag_stride;
+    target_ulong *tags;
+    uint64_t *valid;
+    uint64_t *dirty;
+    uint64_t *prefetched;
 
     /* Pointer to the next level cache, if NULL it means it is the last level
      * cache (LLC) */
     struct Cache *next_level_cache;
     CacheStats *stats;
     EvictPolicy *evict_policy;
+
+    int num_mshrs;
+    CacheMSHR *mshr;
+
+    /* NULL if the cache has no prefetcher */
+    Prefetcher *prefetcher;
 } Cache;
 
 Cache *cache_init(CacheTypes type, CacheLevels level, int size_kb,
@@ -185,10 +222,12 @@ Cache *cache_init(CacheTypes type, CacheLevels level, int size_kb,
                   int evict_policy, CacheWritePolicy write_policy,
                   CacheReadAllocPolicy read_alloc_policy,
                   CacheWriteAllocPolicy write_alloc_policy,
-                  MemoryController *mem_controller);
+                  MemoryController *mem_controller, int num_mshrs);
+void cache_set_prefetcher(struct Cache *c, Prefetcher *prefetcher);
 void cache_flush(struct Cache *c);
 void cache_reset_stats(struct Cache *c);
 const CacheStats *cache_get_stats(const struct Cache *c);
+void cache_set_stats(struct Cache *c, const CacheStats *stats);
 int cache_read(const struct Cache *c, target_ulong paddr, int bytes_to_read,
                void *p_mem_access_info, int priv);
 int cache_write(const struct Cache *c, target_ulong paddr, int bytes_to_read,
@@ -25,24 +25,30 @@
  * THE SOFTWARE.
  */
 #include <assert.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "../utils/sim_log.h"
 #include "dram.h"
-#include "dramsim_wrapper_c_connector.h"
-#include "ramulator_wrapper_c_connector.h"
-// AiM
-#include "aimulator_wrapper_c_connector.h"
 
 static void
 dram_log_config(const Dram *d, const SimParams *p)
 {
     sim_log_event_to_file(sim_log, "%s", "Setting up base dram");
     sim_log_param_to_file(sim_log, "%s: %s", "dram_model_type",
-                          dram_model_type_str[p->dram_model_type]);
-    switch (p->dram_model_type)
+                          dram_model_type_str[d->dram_model_type]);
+    sim_log_param_to_file(sim_log, "%s: %d", "max_inflight_requests",
+                          d->max_inflight_requests);
+    sim_log_param_to_file(sim_log, "%s: %d", "aim_batch_size",
+                          d->aim_batch_size);
+    if (d->clock_backend)
+    {
+        sim_log_param_to_file(sim_log, "%s: %d MHz", "clock_freq",
+                              d->backend_clock_freq_mhz);
+    }
+    switch (d->dram_model_type)
     {
         case MEM_MODEL_BASE:
         {
@@ -70,7 +76,7 @@ dram_log_config(const Dram *d, const SimParams *p)
         case MEM_MODEL_AIMULATOR:
         {
             sim_log_param_to_file(sim_log, "%s: %s)", "config_file",
-                                  p->ramulator_config_file);
+                                  p->aimulator_config_file);
             sim_log_param_to_file(sim_log, "%s: %s", "output-directory",
                                   p->sim_file_path);
             break;
@@ -127,342 +133,625 @@ get_tinyemu_ram_addr_from_zero(target_ulong tinyemu_ram_addr)
     return tinyemu_ram_addr;
 }
 
-static int
-dramsim_get_max_clock_cycles(Dram *d, PendingMemAccessEntry *e)
+static DramInflightRequest *
+dram_find_inflight_request(Dram *d, uint64_t req_id)
 {
-    int max_clock_cycles;
-    target_ulong ram_addr = get_tinyemu_ram_addr_from_zero(e->addr);
-    max_clock_cycles = dramsim_wrapper_get_max_clock_cycles(e);
+    int i;
 
-    if (max_clock_cycles >= 1000)
+    for (i = 0; i < d->max_inflight_requests; ++i)
     {
-        sim_log_event(sim_log,
-                      "possible dramsim3 block detected, callback for physical "
-                      "addr 0x% " TARGET_ULONG_HEX " received after %d cycle(s)",
-                      ram_addr, max_clock_cycles);
+        if (d->inflight[i].valid && (d->inflight[i].req_id == req_id))
+        {
+            return &d->inflight[i];
+        }
     }
 
-    return max_clock_cycles;
+    return NULL;
 }
 
+/* Latency between LLC and memory controller: reads (including AiM reads) wait
+ * for the data to come back, while writes and AiM commands only pay the one way
+ * delay */
 static int
-ramulator_get_max_clock_cycles(Dram *d, PendingMemAccessEntry *e)
+get_llc_to_mem_controller_delay(const PendingMemAccessEntry *e)
 {
-    int max_clock_cycles = 0;
-    target_ulong ram_addr = get_tinyemu_ram_addr_from_zero(e->addr);
-
-    max_clock_cycles = ramulator_wrapper_get_max_clock_cycles(e);
-
-    if (max_clock_cycles >= 1000)
+    if (e->type == MEM_ACCESS_READ || e->type == AIM_RD_MAC
+        || e->type == AIM_RD_AF)
     {
-        sim_log_event(
-            sim_log, "possible ramulator block detected, callback for physical "
-                     "addr 0x% " TARGET_ULONG_HEX " received after %d cycle(s)",
-            ram_addr, max_clock_cycles);
+        return 2 * LLC_TO_MEM_CONTROLLER_DELAY;
     }
 
-    return max_clock_cycles;
+    return LLC_TO_MEM_CONTROLLER_DELAY;
 }
 
+/* Mark the entry of the in-flight request req_id as served by the back end.
+ * Now it only has to pay for the trip back to the LLC. Returns TRUE if all the
+ * entries of the request were served. */
 static int
-aimulator_get_max_clock_cycles(Dram *d, PendingMemAccessEntry *e)
+dram_backend_request_done(Dram *d, uint64_t req_id, int entry,
+                          const char *backend_name)
 {
-    int max_clock_cycles = 0;
-    // target_ulong ram_addr = get_tinyemu_ram_addr_from_zero(e->addr); // No need to convert to access pim memory
-    target_ulong ram_addr = e->addr;
-    
-    max_clock_cycles = aimulator_wrapper_get_max_clock_cycles(e);
+    int i;
+    DramInflightRequest *r = dram_find_inflight_request(d, req_id);
 
-    if (max_clock_cycles >= 1000)
+    if (r == NULL || r->e[entry] == NULL)
     {
-        sim_log_event(
-            sim_log, "possible ramulator block detected, callback for physical "
-                     "addr 0x% " TARGET_ULONG_HEX " received after %d cycles(s)",
-            ram_addr, max_clock_cycles);
+        return FALSE;
     }
-    return max_clock_cycles;
-}
 
-static void
-read_complete_callback(target_ulong addr, StageMemAccessQueue *f,
-                       StageMemAccessQueue *b)
-{
-    int i;
+    if (r->elapsed_clock_cycles >= 1000)
+    {
+        sim_log_event(sim_log,
+                      "possible %s block detected, callback for physical "
+                      "addr 0x% " TARGET_ULONG_HEX " received after %d cycle(s)",
+                      backend_name,
+                      get_tinyemu_ram_addr_from_zero(r->e[entry]->addr),
+                      r->elapsed_clock_cycles);
+    }
+
+    r->max_clock_cycles[entry] = r->elapsed_clock_cycles
+                                 + get_llc_to_mem_controller_delay(r->e[entry]);
 
-    for (i = 0; i < f->cur_idx; ++i)
+    for (i = 0; i < r->num_entries; ++i)
     {
-        if ((f->entry[i].valid) && (f->entry[i].addr == addr)
-            && (f->entry[i].type == MEM_ACCESS_READ))
+        if (r->e[i] && !r->max_clock_cycles[i])
         {
-            f->entry[i].valid = FALSE;
-            --f->cur_size;
-            return;
+            return FALSE;
         }
     }
 
-    for (i = 0; i < b->cur_idx; ++i)
+    return TRUE;
+}
+
+static void
+dramsim_send_request(Dram *d, DramInflightRequest *r)
+{
+    dramsim_wrapper_send_request(d->dramsim, r->req_id, r->e[0]);
+}
+
+/* DRAMsim3, Ramulator and AiMulator are ticked from dram_clock(), at the ratio
+ * of their clock frequency to the CPU one */
+static void
+dramsim_clock(Dram *d)
+{
+    uint64_t req_id;
+
+    dramsim_wrapper_tick(d->dramsim);
+
+    while (dramsim_wrapper_get_completed_request(d->dramsim, &req_id))
     {
-        if ((b->entry[i].valid) && (b->entry[i].addr == addr)
-            && (b->entry[i].type == MEM_ACCESS_READ))
-        {
-            b->entry[i].valid = FALSE;
-            --b->cur_size;
-            return;
-        }
+        dram_backend_request_done(d, req_id, 0, "dramsim3");
     }
 }
 
 static void
-write_complete_callback(target_ulong addr, StageMemAccessQueue *f,
-                        StageMemAccessQueue *b)
+ramulator_send_request(Dram *d, DramInflightRequest *r)
 {
-    int i;
+    ramulator_wrapper_send_request(d->ramulator, r->req_id, r->e[0]);
+}
+
+static void
+ramulator_clock(Dram *d)
+{
+    uint64_t req_id;
 
-    for (i = 0; i < f->cur_idx; ++i)
+    ramulator_wrapper_tick(d->ramulator);
+
+    while (ramulator_wrapper_get_completed_request(d->ramulator, &req_id))
     {
-        if ((f->entry[i].valid) && (f->entry[i].addr == addr)
-            && (f->entry[i].type == MEM_ACCESS_WRITE))
-        {
-            f->entry[i].valid = FALSE;
-            --f->cur_size;
-            return;
-        }
+        dram_backend_request_done(d, req_id, 0, "ramulator");
     }
+}
 
-    for (i = 0; i < b->cur_idx; ++i)
+static void
+aimulator_send_request(Dram *d, DramInflightRequest *r)
+{
+    // target_ulong ram_addr = get_tinyemu_ram_addr_from_zero(e->addr); // No need to convert to access pim memory
+    aimulator_wrapper_send_request(d->aimulator, r->req_id, r->e,
+                                   r->num_entries);
+    if (d->aim_trace)
     {
-        if ((b->entry[i].valid) && (b->entry[i].addr == addr)
-            && (b->entry[i].type == MEM_ACCESS_WRITE))
-        {
-            b->entry[i].valid = FALSE;
-            --b->cur_size;
-            return;
-        }
+        aim_trace_request(d->aim_trace, d->backend_clock, r->req_id, r->e,
+                          r->num_entries);
     }
 }
 
-// AiM
 static void
-aim_read_complete_callback(target_ulong addr, StageMemAccessQueue *ba)
+aimulator_clock(Dram *d)
 {
-    int i;
+    uint64_t req_id;
+    int entry;
+
+    aimulator_wrapper_tick(d->aimulator);
 
-    for (i = 0; i < ba->cur_idx; ++i)
+    /* The AiM commands of a batch complete one by one, so a read is not held
+     * back by slower commands of its batch */
+    while (aimulator_wrapper_get_completed_entry(d->aimulator, &req_id, &entry))
     {
-        if ((ba->entry[i].valid) && (ba->entry[i].addr == addr)
-            && (ba->entry[i].type == AIM_RD_MAC || ba->entry[i].type == AIM_RD_AF))
+        if (dram_backend_request_done(d, req_id, entry, "aimulator")
+            && d->aim_trace)
         {
-            ba->entry[i].valid = FALSE;
-            --ba->cur_size;
-            return;
+            aim_trace_request_done(d->aim_trace, d->backend_clock, req_id);
         }
     }
 }
 
+/* Drain the entry paired with the memory request from its CPU stage queue.
+ * Requests flushed by the CPU pipeline (invalidated while in flight) have
+ * their stage queue already reset, so they are skipped. */
 static void
-aim_write_complete_callback(target_ulong addr, StageMemAccessQueue *ba)
+stage_queue_complete_callback(const PendingMemAccessEntry *e)
 {
-    int i;
-    for (i = 0; i < ba->cur_idx; ++i)
+    if (!e->valid)
     {
-        if ((ba->entry[i].valid) && (ba->entry[i].addr == addr))
-        {
-            ba->entry[i].valid = FALSE;
-            --ba->cur_size;
-            return;
-        }
+        return;
     }
+
+    mem_controller_complete_stage_queue_entry(e->stage_queue,
+                                              e->stage_queue_index);
 }
 
 int
 dram_can_accept_request(const Dram *d)
 {
-    return !d->mem_access_active;
+    return d->num_inflight_entries < d->max_inflight_requests;
+}
+
+/* Number of AiM commands which can be sent as one request right now, as each
+ * of them takes one of the max_inflight_requests */
+int
+dram_get_max_batch_size(const Dram *d)
+{
+    int n = d->max_inflight_requests - d->num_inflight_entries;
+
+    return (n < d->aim_batch_size) ? n : d->aim_batch_size;
 }
 
 /* dram_send_request()
  * @details
  * Get the max_clock_cycles of the DRAM from one of the wrappers, or base model.
+ * Event-driven models get the request instead, and set max_clock_cycles later
+ * from dram_clock() when the request completes.
  * Drain the pending memory request from the stage queue to memory request queue by
  * - decreasing cur_size of the stage queue, which can set mem_request_complete
  *   to TRUE in oo_core_lsu().
  * - invalidating the pending memory write request by invoking callback functions.
- * Set DRAM states: active_mem_request, mem_access_active, elapsed_clock_cycles
+ * Set DRAM states: an in-flight request slot tracking elapsed_clock_cycles
+ * A batch of num_entries AiM commands of the same type takes a single slot,
+ * but counts as num_entries requests in flight.
  */
 void
-dram_send_request(Dram *d, PendingMemAccessEntry *e)
+dram_send_request(Dram *d, PendingMemAccessEntry **e, int num_entries)
 {
+    int i;
+    DramInflightRequest *r = NULL;
+
 #ifdef DEBUG_BUILD
-    fprintf(stderr, "(DEBUG) [NDP-Sim: DRAM] Mem req type: %d\n", e->type);
+    fprintf(stderr, "(DEBUG) [NDP-Sim: DRAM] Mem req type: %d, entries: %d\n",
+            e[0]->type, num_entries);
 #endif
-    d->max_clock_cycles = d->get_max_clock_cycles_for_request(d, e);
-    assert(d->max_clock_cycles);
+    assert(num_entries >= 1 && num_entries <= dram_get_max_batch_size(d));
+    for (i = 0; i < d->max_inflight_requests; ++i)
+    {
+        if (!d->inflight[i].valid)
+        {
+            r = &d->inflight[i];
+            break;
+        }
+    }
+    assert(r);
+
+    r->valid = TRUE;
+    r->req_id = d->next_req_id++;
+    r->num_entries = num_entries;
+    r->num_entries_pending = num_entries;
+    for (i = 0; i < num_entries; ++i)
+    {
+        r->e[i] = e[i];
+        r->max_clock_cycles[i] = 0;
+        e[i]->in_flight = TRUE;
+    }
+    r->elapsed_clock_cycles = 1;
+    d->num_inflight_entries += num_entries;
 
-    /* To model latency between LLC and Memory controller */
-    if (e->type == MEM_ACCESS_READ)
+    if (d->send_request_to_backend)
     {
-        d->max_clock_cycles += (2 * LLC_TO_MEM_CONTROLLER_DELAY);
+        d->send_request_to_backend(d, r);
     }
-    else {
-        // AiM, MEM_ACCESS_WRITE
-        /* One way delay LLC - Memory Controller */
-        d->max_clock_cycles += LLC_TO_MEM_CONTROLLER_DELAY;
+    else
+    {
+        r->max_clock_cycles[0] = d->get_max_clock_cycles_for_request(d, e[0]);
+        assert(r->max_clock_cycles[0]);
+
+        /* To model latency between LLC and Memory controller */
+        r->max_clock_cycles[0] += get_llc_to_mem_controller_delay(e[0]);
     }
 
     /* Send a write complete callback to the calling pipeline stage as
      * we don't want the pipeline stage to wait for write to complete.
      * But, simulate this write delay asynchronously via the memory
      * controller */
-    if (e->type == MEM_ACCESS_WRITE)
+    if (e[0]->type != MEM_ACCESS_READ && e[0]->type != AIM_RD_MAC
+        && e[0]->type != AIM_RD_AF)
     {
-        write_complete_callback(e->addr, d->frontend_mem_access_queue,
-                                d->backend_mem_access_queue);
+        for (i = 0; i < num_entries; ++i)
+        {
+            stage_queue_complete_callback(e[i]);
+        }
     }
-    else if (e->type != MEM_ACCESS_READ)
-    {// AiM
-        aim_write_complete_callback(e->addr, d->backend_aim_queue);
+}
+
+/* Complete the entry i of the in-flight request r, and the request itself
+ * once all of its entries are completed */
+static void
+dram_complete_entry(Dram *d, DramInflightRequest *r, int i)
+{
+    PendingMemAccessEntry *e = r->e[i];
+
+    if (e->type == MEM_ACCESS_READ || e->type == AIM_RD_MAC
+        || e->type == AIM_RD_AF)
+    {
+        stage_queue_complete_callback(e);
     }
 
-    d->active_mem_request = e;
-    d->mem_access_active = TRUE;
-    d->elapsed_clock_cycles = 1;
+    e->valid = FALSE;
+    e->in_flight = FALSE;
+    r->e[i] = NULL;
+    --d->num_inflight_entries;
+
+    if (--r->num_entries_pending == 0)
+    {
+        r->valid = FALSE;
+        r->num_entries = 0;
+    }
 }
 
 /* dram_clock()
  * @details
- * Increment elapsed_clock_cycles until reaching to the max_clock_cycles.
- * If reaches, drain the memory request from the DRAM. At the same time,
- * drain the memory request from the stage queue by invoking the callback
- * function for the load instructions, which can set mem_request_complete
- * to TRUE in oo_core_lsu().
+ * Advance the event-driven back end, if any, by the number of its own cycles
+ * which fit in one CPU cycle. Then increment
+ * elapsed_clock_cycles of every in-flight request until reaching the
+ * max_clock_cycles of its entries. If reaches, drain the memory request of the
+ * entry from the DRAM. At the same time, drain the memory request from the
+ * stage queue by invoking the callback function for the load instructions,
+ * which can set mem_request_complete to TRUE in oo_core_lsu().
+ * Returns the number of entries completed in this cycle.
  */
 int
 dram_clock(Dram *d)
 {
-    if (d->mem_access_active)
+    int i, k;
+    int completed = 0;
+    DramInflightRequest *r;
+
+    if (d->clock_backend)
     {
-        if (d->elapsed_clock_cycles == d->max_clock_cycles)
+        /* Catch up with the CPU clock */
+        d->backend_clock_credit += d->backend_clock_freq_mhz;
+        while (d->backend_clock_credit >= d->cpu_freq_mhz)
         {
-            d->mem_access_active = FALSE;
-            d->max_clock_cycles = 0;
-            d->elapsed_clock_cycles = 0;
+            ++d->backend_clock;
+            d->clock_backend(d);
+            d->backend_clock_credit -= d->cpu_freq_mhz;
+        }
+    }
 
-            if (d->active_mem_request->type == MEM_ACCESS_READ)
-            {
-                read_complete_callback(d->active_mem_request->addr,
-                                       d->frontend_mem_access_queue,
-                                       d->backend_mem_access_queue);
-            }
-            else if (d->active_mem_request->type == AIM_RD_MAC
-                     || d->active_mem_request->type == AIM_RD_AF)
+    for (i = 0; i < d->max_inflight_requests; ++i)
+    {
+        r = &d->inflight[i];
+
+        if (!r->valid)
+        {
+            continue;
+        }
+
+        for (k = 0; k < r->num_entries; ++k)
+        {
+            if (r->e[k] && r->max_clock_cycles[k]
+                && (r->elapsed_clock_cycles == r->max_clock_cycles[k]))
             {
-                aim_read_complete_callback(d->active_mem_request->addr,
-                                           d->backend_aim_queue);
+                dram_complete_entry(d, r, k);
+                ++completed;
+                if (!r->valid)
+                {
+                    break;
+                }
             }
+        }
+
+        if (r->valid)
+        {
+            r->elapsed_clock_cycles++;
+        }
+    }
+
+    return completed;
+}
+
+/* dram_get_idle_cycles()
+ * @details
+ * Number of dram_clock() calls before any in-flight request completes, during
+ * which dram_clock() only increments elapsed_clock_cycles. Returns 0 if a
+ * request completes on the next call, if nothing is in flight, or if an
+ * event-driven back end has to be clocked every cycle.
+ */
+int
+dram_get_idle_cycles(const Dram *d)
+{
+    int i, k;
+    int cycles = INT_MAX;
+    const DramInflightRequest *r;
+
+    if (d->clock_backend || !d->num_inflight_entries)
+    {
+        return 0;
+    }
 
-            d->active_mem_request->valid = FALSE;
-            return TRUE;
+    for (i = 0; i < d->max_inflight_requests; ++i)
+    {
+        r = &d->inflight[i];
+        if (!r->valid)
+        {
+            continue;
         }
-        else
+
+        for (k = 0; k < r->num_entries; ++k)
         {
-            d->elapsed_clock_cycles++;
+            if (r->e[k]
+                && (r->max_clock_cycles[k] - r->elapsed_clock_cycles < cycles))
+            {
+                cycles = r->max_clock_cycles[k] - r->elapsed_clock_cycles;
+            }
         }
     }
 
-    return FALSE;
+    return cycles;
 }
 
+/* dram_skip_cycles()
+ * @details
+ * Same as calling dram_clock() cycles times, where cycles is at most
+ * dram_get_idle_cycles() if a request is in flight.
+ */
 void
-dram_reset(Dram *d)
+dram_skip_cycles(Dram *d, int cycles)
 {
-    d->elapsed_clock_cycles = 0;
-    d->max_clock_cycles = 0;
-    d->mem_access_active = FALSE;
-    d->active_mem_request = NULL;
+    int i;
 
-    /* For base DRAM model */
-    d->last_accessed_page_num = 0;
+    assert(!d->num_inflight_entries || (cycles <= dram_get_idle_cycles(d)));
+    for (i = 0; i < d->max_inflight_requests; ++i)
+    {
+        if (d->inflight[i].valid)
+        {
+            d->inflight[i].elapsed_clock_cycles += cycles;
+        }
+    }
 }
 
-Dram *
-dram_create(const SimParams *p, StageMemAccessQueue *f,
-            StageMemAccessQueue *b, StageMemAccessQueue *ba)
+void
+dram_reset(Dram *d)
 {
-    Dram *d;
+    int i;
 
-    d = calloc(1, sizeof(Dram));
-    assert(d);
+    for (i = 0; i < d->max_inflight_requests; ++i)
+    {
+        d->inflight[i].valid = FALSE;
+        d->inflight[i].num_entries = 0;
+        d->inflight[i].num_entries_pending = 0;
+    }
+    d->num_inflight_entries = 0;
+    d->backend_clock_credit = 0;
 
-    d->mem_access_latency = p->mem_access_latency;
-    d->frontend_mem_access_queue = f;
-    d->backend_mem_access_queue = b;
-    // AiM
-    d->backend_aim_queue = ba;
+    /* Requests still in flight in the back end are dropped */
+    switch (d->dram_model_type)
+    {
+        case MEM_MODEL_BASE:
+        {
+            break;
+        }
+        case MEM_MODEL_DRAMSIM:
+        {
+            dramsim_wrapper_reset(d->dramsim);
+            break;
+        }
+        case MEM_MODEL_RAMULATOR:
+        {
+            ramulator_wrapper_reset(d->ramulator);
+            break;
+        }
+        // AiM
+        case MEM_MODEL_AIMULATOR:
+        {
+            aimulator_wrapper_reset(d->aimulator);
+            if (d->aim_trace)
+            {
+                aim_trace_reset(d->aim_trace, d->backend_clock);
+            }
+            break;
+        }
+    }
 
-    d->dram_model_type = p->dram_model_type;
+    /* For base DRAM model */
+    d->last_accessed_page_num = 0;
+}
 
+static void
+dram_backend_init(Dram *d, const SimParams *p)
+{
     switch (d->dram_model_type)
     {
         case MEM_MODEL_BASE:
         {
-            d->get_max_clock_cycles_for_request
-                = &base_dram_model_get_max_clock_cycles;
             break;
         }
         case MEM_MODEL_DRAMSIM:
         {
-            dramsim_wrapper_init(p->dramsim_config_file, p->sim_file_path);
-            d->get_max_clock_cycles_for_request = &dramsim_get_max_clock_cycles;
+            d->dramsim
+                = dramsim_wrapper_init(p->dramsim_config_file, p->sim_file_path);
             break;
         }
         case MEM_MODEL_RAMULATOR:
         {
-            ramulator_wrapper_init(p->ramulator_config_file,
-                                   p->cache_line_size);
-            d->get_max_clock_cycles_for_request
-                = &ramulator_get_max_clock_cycles;
+            d->ramulator = ramulator_wrapper_init(p->ramulator_config_file,
+                                                  p->cache_line_size);
             break;
         }
         // AiM
         case MEM_MODEL_AIMULATOR:
         {
-            aimulator_wrapper_init(p->aimulator_config_file);
-            d->get_max_clock_cycles_for_request
-                = &aimulator_get_max_clock_cycles;
+            d->aimulator = aimulator_wrapper_init(p->aimulator_config_file);
             break;
         }
     }
+}
 
-    dram_reset(d);
-    dram_log_config(d, p);
-    return d;
+static void
+dram_backend_destroy(Dram *d)
+{
+    switch (d->dram_model_type)
+    {
+        case MEM_MODEL_BASE:
+        {
+            break;
+        }
+        case MEM_MODEL_DRAMSIM:
+        {
+            dramsim_wrapper_destroy(&d->dramsim);
+            break;
+        }
+        case MEM_MODEL_RAMULATOR:
+        {
+            ramulator_wrapper_destroy(&d->ramulator);
+            break;
+        }
+        // AiM
+        case MEM_MODEL_AIMULATOR:
+        {
+            aimulator_wrapper_destroy(&d->aimulator);
+            if (d->aim_trace)
+            {
+                aim_trace_close(&d->aim_trace);
+            }
+            break;
+        }
+    }
 }
 
+/* Replace the back-end instance by a new one, which starts with fresh
+ * statistics */
 void
-dram_free(Dram **d)
+dram_restart_backend(Dram *d, const SimParams *p)
 {
-    switch ((*d)->dram_model_type)
+    char filename[1024];
+
+    dram_backend_destroy(d);
+    dram_backend_init(d, p);
+
+    /* Each simulation run gets a new trace, like it gets new statistics */
+    if (p->do_aim_trace && (d->dram_model_type == MEM_MODEL_AIMULATOR))
+    {
+        snprintf(filename, sizeof(filename), "%s/%s.aimtrace",
+                 p->sim_file_path, p->sim_file_prefix);
+        d->aim_trace = aim_trace_open(filename, d->max_inflight_requests,
+                                      d->aim_batch_size, d->backend_clock);
+    }
+}
+
+/* Close the trace of the simulation run which just ended */
+void
+dram_stop_aim_trace(Dram *d)
+{
+    if (d->aim_trace)
+    {
+        aim_trace_close(&d->aim_trace);
+    }
+}
+
+Dram *
+dram_create(const SimParams *p, int dram_model_type)
+{
+    int i;
+    Dram *d;
+
+    d = calloc(1, sizeof(Dram));
+    assert(d);
+
+    d->mem_access_latency = p->mem_access_latency;
+
+    d->dram_model_type = dram_model_type;
+    d->max_inflight_requests = p->max_inflight_requests;
+    d->aim_batch_size = 1;
+    d->cpu_freq_mhz = p->cpu_freq_mhz;
+
+    switch (d->dram_model_type)
     {
         case MEM_MODEL_BASE:
         {
+            d->get_max_clock_cycles_for_request
+                = &base_dram_model_get_max_clock_cycles;
             break;
         }
         case MEM_MODEL_DRAMSIM:
         {
-            dramsim_wrapper_destroy();
+            d->send_request_to_backend = &dramsim_send_request;
+            d->clock_backend = &dramsim_clock;
+            d->backend_clock_freq_mhz = p->dramsim_clock_freq_mhz;
             break;
         }
         case MEM_MODEL_RAMULATOR:
         {
-            ramulator_wrapper_destroy();
+            d->send_request_to_backend = &ramulator_send_request;
+            d->clock_backend = &ramulator_clock;
+            d->backend_clock_freq_mhz = p->ramulator_clock_freq_mhz;
             break;
         }
         // AiM
         case MEM_MODEL_AIMULATOR:
         {
-            aimulator_wrapper_destroy();
+            d->send_request_to_backend = &aimulator_send_request;
+            d->clock_backend = &aimulator_clock;
+            d->backend_clock_freq_mhz = p->aimulator_clock_freq_mhz;
+            d->aim_batch_size = p->aim_batch_size;
             break;
         }
     }
+
+    dram_backend_init(d, p);
+    if (!d->backend_clock_freq_mhz)
+    {
+        d->backend_clock_freq_mhz = d->cpu_freq_mhz;
+    }
+
+    d->inflight = (DramInflightRequest *)calloc(d->max_inflight_requests,
+                                                sizeof(DramInflightRequest));
+    assert(d->inflight);
+    for (i = 0; i < d->max_inflight_requests; ++i)
+    {
+        d->inflight[i].e = (PendingMemAccessEntry **)calloc(
+            d->aim_batch_size, sizeof(PendingMemAccessEntry *));
+        assert(d->inflight[i].e);
+        d->inflight[i].max_clock_cycles
+            = (int *)calloc(d->aim_batch_size, sizeof(int));
+        assert(d->inflight[i].max_clock_cycles);
+    }
+
+    dram_reset(d);
+    dram_log_config(d, p);
+    return d;
+}
+
+void
+dram_free(Dram **d)
+{
+    int i;
+
+    dram_backend_destroy(*d);
+    for (i = 0; i < (*d)->max_inflight_requests; ++i)
+    {
+        free((*d)->inflight[i].e);
+        free((*d)->inflight[i].max_clock_cycles);
+    }
+    free((*d)->inflight);
+    (*d)->inflight = NULL;
     free(*d);
 }
@@ -31,33 +31,81 @@
 #include "../riscv_sim_typedefs.h"
 #include "../utils/sim_params.h"
 #include "memory_controller_utils.h"
+#include "dramsim_wrapper_c_connector.h"
+#include "ramulator_wrapper_c_connector.h"
+#include "aimulator_wrapper_c_connector.h"
+#include "aim_trace.h"
+
+/* A request handed over to the DRAM model by the memory controller */
+typedef struct DramInflightRequest
+{
+    int valid;
+    uint64_t req_id;
+    int elapsed_clock_cycles;
+
+    /* Memory controller requests served together. There is more than one
+     * only for a batch of AiM commands, which all have the same type. Each
+     * entry completes on its own, and is set to NULL once completed. */
+    PendingMemAccessEntry **e;
+    int num_entries;
+    int num_entries_pending;
+
+    /* Latency of each entry, zero until it is known. Synchronous models set
+     * it when the request is sent, event-driven models when the back end
+     * reports that the entry was served. */
+    int *max_clock_cycles;
+} DramInflightRequest;
 
 typedef struct Dram
 {
-    /* Type of DRAM model: base or dramsim3 */
+    /* Type of DRAM model: base, dramsim3, ramulator or aimulator */
     int dram_model_type;
 
-    /* Requests are processed sequentially, one at a time, from the head of
-     * mem_req_queue. Processing solely involves simulating a latency in CPU
-     * cycles (known as max_clock_cycles). After simulating the latency, the
-     * stall on the waiting CPU pipeline stage is removed, and the current entry
-     * is dequeued from mem_req_queue. Below parameters keep track of the
-     * current request in progress. */
-    int mem_access_active;
-    int elapsed_clock_cycles;
-    int max_clock_cycles;
-    PendingMemAccessEntry *active_mem_request;
+    /* Requests are processed in order from the head of mem_req_queue.
+     * Processing involves simulating a latency in CPU cycles (known as
+     * max_clock_cycles). After simulating the latency, the stall on the waiting
+     * CPU pipeline stage is removed, and the entry is dequeued from
+     * mem_req_queue. Up to max_inflight_requests memory controller requests
+     * are kept in flight, each AiM command of a batch counting as one, and
+     * they may complete out of order. The base model knows max_clock_cycles
+     * when the request is sent, while DRAMsim3, Ramulator and AiMulator are
+     * ticked every CPU cycle until they call back. */
+    int max_inflight_requests;
+    int num_inflight_entries;
+    uint64_t next_req_id;
+    DramInflightRequest *inflight;
 
-    /* These queues are used to control the stall on fetch and memory CPU
-     * pipeline stages */
-    StageMemAccessQueue *frontend_mem_access_queue;
-    StageMemAccessQueue *backend_mem_access_queue;
-    StageMemAccessQueue *backend_aim_queue;
+    /* Up to aim_batch_size consecutive AiM commands of the same type are
+     * sent to AiMulator as a single request, each of them completing when it
+     * is served. It is 1 for the other models. */
+    int aim_batch_size;
 
     /* Set based on type of DRAM model used: base or dramsim */
     int (*get_max_clock_cycles_for_request)(struct Dram *d,
                                             PendingMemAccessEntry *e);
 
+    /* Set for event-driven models only */
+    void (*send_request_to_backend)(struct Dram *d, DramInflightRequest *r);
+    void (*clock_backend)(struct Dram *d);
+
+    /* Back-end instance owned by this DRAM, only the one matching
+     * dram_model_type is set */
+    DramsimWrapper *dramsim;
+    RamulatorWrapper *ramulator;
+    AimulatorWrapper *aimulator;
+
+    /* Event-driven models run in their own clock domain: clock_backend() is
+     * called backend_clock_freq_mhz times every cpu_freq_mhz CPU cycles */
+    int backend_clock_freq_mhz;
+    int cpu_freq_mhz;
+    int backend_clock_credit;
+
+    /* Number of clock_backend() calls, the time base of aim_trace */
+    uint64_t backend_clock;
+
+    /* Set when the requests sent to AiMulator are recorded */
+    AimTrace *aim_trace;
+
     /* Following parameters are used by base DRAM model */
     uint64_t last_accessed_page_num;
 
@@ -65,11 +113,15 @@ typedef struct Dram
     int mem_access_latency;
 } Dram;
 
-Dram *dram_create(const SimParams *p, StageMemAccessQueue *f,
-                  StageMemAccessQueue *b, StageMemAccessQueue *ba);
+Dram *dram_create(const SimParams *p, int dram_model_type);
 int dram_can_accept_request(const Dram *d);
+int dram_get_max_batch_size(const Dram *d);
 int dram_clock(Dram *d);
+int dram_get_idle_cycles(const Dram *d);
+void dram_skip_cycles(Dram *d, int cycles);
 void dram_reset(Dram *d);
-void dram_send_request(Dram *d, PendingMemAccessEntry *e);
+void dram_send_request(Dram *d, PendingMemAccessEntry **e, int num_entries);
+void dram_restart_backend(Dram *d, const SimParams *p);
+void dram_stop_aim_trace(Dram *d);
 void dram_free(Dram **d);
 #endif /* _BASE_DRAM_H_ */
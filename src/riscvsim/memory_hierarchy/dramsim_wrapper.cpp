@@ -47,36 +47,44 @@ dramsim_wrapper::~dramsim_wrapper()
 }
 
 void
-dramsim_wrapper::read_complete(uint64_t addr)
+dramsim_wrapper::transaction_complete(uint64_t addr, bool is_write)
 {
-    auto it = mem_addr_cb_status.find(addr);
-    assert(it != mem_addr_cb_status.end());
-    it->second = true;
+    uint64_t req_id;
+    auto it = addr_req_ids[is_write].find(addr);
+    assert(it != addr_req_ids[is_write].end());
+
+    req_id = it->second.front();
+    it->second.pop_front();
+    if (it->second.empty())
+    {
+        addr_req_ids[is_write].erase(it);
+    }
+
+    /* Requests dropped by reset() are still served by DRAMsim3, their
+     * callbacks are ignored */
+    auto req = req_parts_pending.find(req_id);
+    if (req == req_parts_pending.end())
+    {
+        return;
+    }
+
+    if (--req->second == 0)
+    {
+        req_parts_pending.erase(req);
+        completed_req_ids.push_back(req_id);
+    }
 }
 
 void
-dramsim_wrapper::write_complete(uint64_t addr)
+dramsim_wrapper::read_complete(uint64_t addr)
 {
-    auto it = mem_addr_cb_status.find(addr);
-    assert(it != mem_addr_cb_status.end());
-    it->second = true;
+    transaction_complete(addr, false);
 }
 
-bool
-dramsim_wrapper::access_complete()
+void
+dramsim_wrapper::write_complete(uint64_t addr)
 {
-    auto it = mem_addr_cb_status.begin();
-
-    while (it != mem_addr_cb_status.end())
-    {
-        if (it->second == false)
-        {
-            return false;
-        }
-        it++;
-    }
-
-    return true;
+    transaction_complete(addr, true);
 }
 
 bool
@@ -91,32 +99,86 @@ dramsim_wrapper::add_transaction(target_ulong addr, bool isWrite)
     return dramsim->AddTransaction(addr, isWrite);
 }
 
-int
-dramsim_wrapper::get_max_clock_cycles(PendingMemAccessEntry *e)
+bool
+dramsim_wrapper::try_send_transaction(const PendingTransaction &trans)
+{
+    if (!can_add_transaction(trans.addr, trans.is_write))
+    {
+        return false;
+    }
+
+    assert(add_transaction(trans.addr, trans.is_write));
+    addr_req_ids[trans.is_write][trans.addr].push_back(trans.req_id);
+    return true;
+}
+
+/* send_request()
+ * @details
+ * Hand over a memory controller request to DRAMsim3 without waiting for it to
+ * complete. The request is identified by req_id, which is returned by
+ * get_completed_request() once all of its parts are served. Transactions
+ * DRAMsim3 cannot accept right now are retried in order from tick().
+ */
+void
+dramsim_wrapper::send_request(uint64_t req_id, PendingMemAccessEntry *e)
 {
     int bytes_accessed = 0;
-    int clock_cycles_elasped = 0;
-    target_ulong addr;
+    PendingTransaction trans;
 
-    mem_addr_cb_status.clear();
+    trans.req_id = req_id;
+    trans.is_write = (bool)e->type;
 
-    /* Split the entire request size into MEM_BUS_WIDTH sized parts, and query
-     * latency for each of the part separately */
+    /* Split the entire request size into MEM_BUS_WIDTH sized parts, and send
+     * each of the part separately */
     while (bytes_accessed < e->access_size_bytes)
     {
-        addr = e->addr + bytes_accessed;
-        mem_addr_cb_status.insert(std::pair<target_ulong, bool>(addr, false));
-        assert(add_transaction(addr, (bool)e->type));
+        trans.addr = e->addr + bytes_accessed;
+        ++req_parts_pending[req_id];
+        if (!retry_queue.empty() || !try_send_transaction(trans))
+        {
+            retry_queue.push(trans);
+        }
         bytes_accessed += MEM_BUS_WIDTH;
     }
+}
+
+void
+dramsim_wrapper::tick()
+{
+    while (!retry_queue.empty())
+    {
+        if (!try_send_transaction(retry_queue.front()))
+        {
+            break;
+        }
+        retry_queue.pop();
+    }
 
-    while (!access_complete())
+    dramsim->ClockTick();
+}
+
+bool
+dramsim_wrapper::get_completed_request(uint64_t *req_id)
+{
+    if (completed_req_ids.empty())
     {
-        dramsim->ClockTick();
-        clock_cycles_elasped++;
+        return false;
     }
 
-    return clock_cycles_elasped;
+    *req_id = completed_req_ids.front();
+    completed_req_ids.pop_front();
+    return true;
+}
+
+/* Forget about all the requests sent so far. Transactions already accepted by
+ * DRAMsim3 stay in addr_req_ids, so that their callbacks are matched and
+ * ignored. */
+void
+dramsim_wrapper::reset()
+{
+    req_parts_pending.clear();
+    completed_req_ids.clear();
+    std::queue<PendingTransaction>().swap(retry_queue);
 }
 
 void
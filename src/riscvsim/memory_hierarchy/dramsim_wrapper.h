@@ -28,8 +28,11 @@
 #define _DRAMSIM_WRAPPER_H_
 
 #include <cstdint>
+#include <deque>
 #include <functional>
 #include <map>
+#include <queue>
+#include <unordered_map>
 
 #include "../riscv_sim_typedefs.h"
 #include "memory_controller_utils.h"
@@ -45,20 +48,43 @@ class dramsim_wrapper
     ~dramsim_wrapper();
     bool can_add_transaction(target_ulong addr, bool isWrite);
     bool add_transaction(target_ulong addr, bool isWrite);
-    int get_max_clock_cycles(PendingMemAccessEntry *e);
+    void send_request(uint64_t req_id, PendingMemAccessEntry *e);
+    void tick();
+    bool get_completed_request(uint64_t *req_id);
+    void reset();
     void reset_stats();
     void print_stats(const char* timestamp);
     int get_burst_size();
     void read_complete(uint64_t);
     void write_complete(uint64_t);
-    bool access_complete();
 
-    /* We split the cache-line address into MEM_BUS_WIDTH sized parts, so this map
-     * keeps track of callbacks for each of this part */
-    std::map<target_ulong, bool> mem_addr_cb_status;
+    /* We split the cache-line address into MEM_BUS_WIDTH sized parts, so this
+     * map keeps track of the number of parts still in flight for each of the
+     * requests sent by the memory controller */
+    std::unordered_map<uint64_t, int> req_parts_pending;
+
+    /* DRAMsim3 calls back with the address only, so keep the requests which
+     * have a read (index 0) or write (index 1) transaction in flight for each
+     * address, oldest first */
+    std::map<target_ulong, std::deque<uint64_t>> addr_req_ids[2];
+
+    /* Requests whose parts have all been served, in order of completion */
+    std::deque<uint64_t> completed_req_ids;
 
     MemorySystem *dramsim;
     std::function<void(uint64_t)> read_cb;
     std::function<void(uint64_t)> write_cb;
+
+  private:
+    struct PendingTransaction
+    {
+        uint64_t req_id;
+        target_ulong addr;
+        bool is_write;
+    };
+
+    std::queue<PendingTransaction> retry_queue;
+    bool try_send_transaction(const PendingTransaction &trans);
+    void transaction_complete(uint64_t addr, bool is_write);
 };
 #endif
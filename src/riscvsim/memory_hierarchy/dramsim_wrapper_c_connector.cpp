@@ -33,58 +33,83 @@
 extern "C" {
 #endif
 
-static dramsim_wrapper *dramsim_wrapper_obj = NULL;
+/* Each handle is a dramsim_wrapper, so several DRAMSim3 memory systems can
+ * live in the same process */
+static dramsim_wrapper *
+to_obj(DramsimWrapper *w)
+{
+    return reinterpret_cast<dramsim_wrapper *>(w);
+}
 
-void
+DramsimWrapper *
 dramsim_wrapper_init(const char *config_file, const char *output_dir)
 {
-    if (dramsim_wrapper_obj == NULL)
-    {
-        dramsim_wrapper_obj = new dramsim_wrapper(config_file, output_dir);
-    }
+    return reinterpret_cast<DramsimWrapper *>(
+        new dramsim_wrapper(config_file, output_dir));
 }
 
 void
-dramsim_wrapper_destroy()
+dramsim_wrapper_destroy(DramsimWrapper **w)
 {
-    delete dramsim_wrapper_obj;
-    dramsim_wrapper_obj = NULL;
+    delete to_obj(*w);
+    *w = NULL;
 }
 
 int
-dramsim_wrapper_can_add_transaction(target_ulong addr, int isWrite)
+dramsim_wrapper_can_add_transaction(DramsimWrapper *w, target_ulong addr,
+                                    int isWrite)
 {
-    return dramsim_wrapper_obj->can_add_transaction(addr, (bool)isWrite);
+    return to_obj(w)->can_add_transaction(addr, (bool)isWrite);
 }
 
 int
-dramsim_wrapper_add_transaction(target_ulong addr, int isWrite)
+dramsim_wrapper_add_transaction(DramsimWrapper *w, target_ulong addr,
+                                int isWrite)
+{
+    return to_obj(w)->add_transaction(addr, (bool)isWrite);
+}
+
+void
+dramsim_wrapper_send_request(DramsimWrapper *w, uint64_t req_id,
+                             PendingMemAccessEntry *e)
 {
-    return dramsim_wrapper_obj->add_transaction(addr, (bool)isWrite);
+    to_obj(w)->send_request(req_id, e);
+}
+
+void
+dramsim_wrapper_tick(DramsimWrapper *w)
+{
+    to_obj(w)->tick();
 }
 
 int
-dramsim_wrapper_get_max_clock_cycles(PendingMemAccessEntry *e)
+dramsim_wrapper_get_completed_request(DramsimWrapper *w, uint64_t *req_id)
+{
+    return (int)to_obj(w)->get_completed_request(req_id);
+}
+
+void
+dramsim_wrapper_reset(DramsimWrapper *w)
 {
-    return dramsim_wrapper_obj->get_max_clock_cycles(e);
+    to_obj(w)->reset();
 }
 
 void
-dramsim_wrapper_print_stats(const char* timestamp)
+dramsim_wrapper_print_stats(DramsimWrapper *w, const char *timestamp)
 {
-    dramsim_wrapper_obj->print_stats(timestamp);
+    to_obj(w)->print_stats(timestamp);
 }
 
 void
-dramsim_wrapper_reset_stats()
+dramsim_wrapper_reset_stats(DramsimWrapper *w)
 {
-    dramsim_wrapper_obj->reset_stats();
+    to_obj(w)->reset_stats();
 }
 
 int
-dramsim_get_burst_size()
+dramsim_get_burst_size(DramsimWrapper *w)
 {
-    return dramsim_wrapper_obj->get_burst_size();
+    return to_obj(w)->get_burst_size();
 }
 
 #ifdef __cplusplus
@@ -32,17 +32,27 @@
 #include "../riscv_sim_typedefs.h"
 #include "memory_controller_utils.h"
 
+/* Opaque handle to one DRAMSim3 instance */
+typedef struct DramsimWrapper DramsimWrapper;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
-void dramsim_wrapper_init(const char *config_file, const char *output_dir);
-void dramsim_wrapper_destroy();
-int dramsim_wrapper_can_add_transaction(target_ulong addr, int isWrite);
-int dramsim_wrapper_add_transaction(target_ulong addr, int isWrite);
-int dramsim_wrapper_get_max_clock_cycles(PendingMemAccessEntry *e);
-void dramsim_wrapper_print_stats(const char *timestamp);
-void dramsim_wrapper_reset_stats();
-int dramsim_get_burst_size();
+DramsimWrapper *dramsim_wrapper_init(const char *config_file,
+                                     const char *output_dir);
+void dramsim_wrapper_destroy(DramsimWrapper **w);
+int dramsim_wrapper_can_add_transaction(DramsimWrapper *w, target_ulong addr,
+                                        int isWrite);
+int dramsim_wrapper_add_transaction(DramsimWrapper *w, target_ulong addr,
+                                    int isWrite);
+void dramsim_wrapper_send_request(DramsimWrapper *w, uint64_t req_id,
+                                  PendingMemAccessEntry *e);
+void dramsim_wrapper_tick(DramsimWrapper *w);
+int dramsim_wrapper_get_completed_request(DramsimWrapper *w, uint64_t *req_id);
+void dramsim_wrapper_reset(DramsimWrapper *w);
+void dramsim_wrapper_print_stats(DramsimWrapper *w, const char *timestamp);
+void dramsim_wrapper_reset_stats(DramsimWrapper *w);
+int dramsim_get_burst_size(DramsimWrapper *w);
 
 #ifdef __cplusplus
 }
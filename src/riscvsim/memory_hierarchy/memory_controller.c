@@ -28,10 +28,12 @@
  * THE SOFTWARE.
  */
 #include <assert.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "../../pim_map.h"
 #include "../utils/circular_queue.h"
 #include "../utils/sim_log.h"
 #include "dramsim_wrapper_c_connector.h"
@@ -46,11 +48,30 @@ mem_controller_log_config(const MemoryController *m)
     sim_log_param_to_file(sim_log, "%s: %d", "mem_cpu_stage_queue_size", BACKEND_MEM_ACCESS_QUEUE_SIZE);
     sim_log_param_to_file(sim_log, "%s: %d", "global_mem_request_queue_size", MEM_REQUEST_QUEUE_SIZE);
     sim_log_param_to_file(sim_log, "%s: %s", "dram_model_type", dram_model_type_str[m->dram_model_type]);
+    sim_log_param_to_file(sim_log, "%s: %d", "num_backends", m->num_backends);
+}
+
+/* The requests of a fill are dropped along with the ones of the CPU stages,
+ * the accesses still waiting on it, such as loads parked in the LSQ, complete
+ * right away as if the line had arrived */
+static void
+drop_fill(MemoryController *m, StageMemAccessQueue *q)
+{
+    int j;
+
+    mem_controller_invalidate_mem_request_queue_entries(m, q);
+    for (j = 0; j < q->cur_idx; ++j)
+    {
+        mem_controller_complete_stage_queue_entry(q, j);
+    }
+    mem_controller_reset_cpu_stage_queue(q);
 }
 
 void
 mem_controller_reset(MemoryController *m)
 {
+    int i;
+
     /* Invalidate the entries added to mem_request_queue on the speculated path */
     mem_controller_invalidate_mem_request_queue_entries(
         m, &m->frontend_mem_access_queue);
@@ -64,8 +85,34 @@ mem_controller_reset(MemoryController *m)
         m, &m->backend_aim_queue);
     mem_controller_reset_cpu_stage_queue(&m->backend_aim_queue);
 
+    for (i = 0; i < m->num_fill_queues; ++i)
+    {
+        drop_fill(m, m->fill_queue[i]);
+    }
+
+    /* Shared DRAM models may still serve requests of the other cores, so the
+     * entries invalidated above are left for mem_controller_run_quantum() to
+     * remove */
+    if (!m->shares_backends)
+    {
+        mem_controller_reset_backends(m);
+    }
+}
+
+/* Drop the requests queued or in flight in the back ends */
+void
+mem_controller_reset_backends(MemoryController *m)
+{
+    int i;
+
     mem_controller_reset_mem_request_queue(m);
-    dram_reset(m->dram);
+    if (m->owns_backends)
+    {
+        for (i = 0; i < m->num_backends; ++i)
+        {
+            dram_reset(m->backend[i].dram);
+        }
+    }
 }
 
 void
@@ -84,7 +131,68 @@ mem_controller_reset_cpu_stage_queue(StageMemAccessQueue *q)
 void
 mem_controller_reset_mem_request_queue(MemoryController *m)
 {
-    cq_reset(&m->mem_request_queue.cq);
+    int i;
+
+    for (i = 0; i < m->num_backends; ++i)
+    {
+        cq_reset(&m->backend[i].mem_request_queue.cq);
+    }
+}
+
+/* With AiMulator, AiM commands and the loads and stores to the PIM area are
+ * routed to the PIM back end, and everything else to the host back end */
+static MemBackendType
+mem_controller_get_backend(const MemoryController *m, target_ulong paddr,
+                           MemAccessType type)
+{
+    if (m->num_backends == 1)
+    {
+        return MEM_BACKEND_HOST;
+    }
+
+    if ((type != MEM_ACCESS_READ && type != MEM_ACCESS_WRITE)
+        || (paddr >= PIM_BASE_ADDR && paddr < PIM_BASE_ADDR + PIM_SIZE))
+    {
+        return MEM_BACKEND_PIM;
+    }
+
+    return MEM_BACKEND_HOST;
+}
+
+static StageMemAccessQueue *
+get_stage_queue(MemoryController *m, const MemAccessInfo *info,
+                MemAccessType op_type)
+{
+    if (info->fill_queue)
+    {
+        return info->fill_queue;
+    }
+
+    switch (info->stage_id)
+    {
+        case FETCH:
+        {
+            return &m->frontend_mem_access_queue;
+        }
+        case MEMORY:
+        {
+            if ((op_type == MEM_ACCESS_READ) || (op_type == MEM_ACCESS_WRITE))
+            {
+                return &m->backend_mem_access_queue;
+            }
+            // AiM
+            return &m->backend_aim_queue;
+        }
+        default:
+        {
+            sim_assert(
+                (0), "error: %s at line %d in %s(): %s", __FILE__, __LINE__,
+                __func__,
+                "memory access generated by incorrect pipeline stage");
+        }
+    }
+
+    return NULL;
 }
 
 static void
@@ -95,6 +203,9 @@ fill_memory_request_entry(MemoryController *m, PendingMemAccessEntry *e, target_
     e->type = type;
     e->req_pte = is_pte;
     e->valid = TRUE;
+    e->in_flight = FALSE;
+    e->fill_queue = NULL;
+    e->fill_waiter = NULL;
     // MARSS-RISCV assumes that the cache line size equals to the burst length.
     e->access_size_bytes = m->burst_length;
 
@@ -109,13 +220,21 @@ mem_controller_create_mem_request(MemoryController *m, target_ulong paddr,
                                   void *p_mem_access_info)
 {
     target_ulong start_offset;
-    int index, source_cpu_stage_id;
+    int index;
+    StageMemAccessQueue *stage_queue;
+    MemBackendType backend;
+    MemRequestQueue *q;
+    PendingMemAccessEntry *e;
+    const MemAccessInfo *info = (const MemAccessInfo *)p_mem_access_info;
 
-    source_cpu_stage_id = *(int *)p_mem_access_info;
+    if (m->functional_warming)
+    {
+        return 0;
+    }
 
 #ifdef DEBUG_BUILD
     fprintf(stderr, "(DEBUG) [NDP-Sim: MemCtrl] Mem request: op_type=%d, paddr=0x%lx, bytes_to_access=%d, op_type=%d, source_cpu_stage_id=%d\n",
-           op_type, paddr, bytes_to_access, op_type, source_cpu_stage_id);
+           op_type, paddr, bytes_to_access, op_type, info->stage_id);
 #endif
     /*  Align the address for this access to the burst_length */
     if ((op_type == MEM_ACCESS_READ || op_type == MEM_ACCESS_WRITE) && paddr != 0)
@@ -134,66 +253,51 @@ mem_controller_create_mem_request(MemoryController *m, target_ulong paddr,
         bytes_to_access = m->burst_length;
     }
     
+    stage_queue = get_stage_queue(m, info, op_type);
+
+    backend = mem_controller_get_backend(m, paddr, op_type);
+    q = &m->backend[backend].mem_request_queue;
+
     while (bytes_to_access > 0)
     {
-        switch (source_cpu_stage_id)
-        {
-            case FETCH:
-            {
-                fill_memory_request_entry(
-                    m, &m->frontend_mem_access_queue
-                            .entry[m->frontend_mem_access_queue.cur_idx],
-                    paddr, op_type, FALSE);
-                ++m->frontend_mem_access_queue.cur_idx;
-                ++m->frontend_mem_access_queue.cur_size;
-                break;
-            }
-            case MEMORY:
-            {
-                if ((op_type == MEM_ACCESS_READ) || (op_type == MEM_ACCESS_WRITE))
-                {
-                    fill_memory_request_entry(
-                        m, &m->backend_mem_access_queue
-                                .entry[m->backend_mem_access_queue.cur_idx],
-                        paddr, op_type, FALSE);
-                    ++m->backend_mem_access_queue.cur_idx;
-                    ++m->backend_mem_access_queue.cur_size;
-                    break;
-                }
-                else
-                {// AiM
-                    fill_memory_request_entry(
-                        m, &m->backend_aim_queue.entry[m->backend_aim_queue.cur_idx],
-                        paddr, op_type, FALSE);
-                    ++m->backend_aim_queue.cur_idx;
-                    ++m->backend_aim_queue.cur_size;
-#ifdef DEBUG_BUILD
-                    fprintf(stderr, "(DEBUG) [NDP-Sim: MemCtrl] Backend AiM queue cur_size=%d, cur_idx=%d\n",
-                            m->backend_aim_queue.cur_size, m->backend_aim_queue.cur_idx);
-#endif
-                    break;
-                }
-            }
-            default:
-            {
-                sim_assert(
-                    (0), "error: %s at line %d in %s(): %s", __FILE__, __LINE__,
-                    __func__,
-                    "memory access generated by incorrect pipeline stage");
-            }
-        }
-
         /* Add requests to the mem_request_queue */
-        index = cq_enqueue(&m->mem_request_queue.cq);
+        index = cq_enqueue(&q->cq);
 
         sim_assert((index != -1), "error: %s at line %d in %s(): %s", __FILE__,
                    __LINE__, __func__, "memory request queue is full");
+        sim_assert((stage_queue->cur_idx < stage_queue->max_size),
+                   "error: %s at line %d in %s(): %s", __FILE__, __LINE__,
+                   __func__, "CPU stage or MSHR fill queue is full");
 #ifdef DEBUG_BUILD
         fprintf(stderr, "(DEBUG) [NDP-Sim: MemCtrl] Mem request added at index %d, addr: 0x%lx, type: %d, cpu_stage: %d\n",
-               index, paddr, op_type, source_cpu_stage_id);
+               index, paddr, op_type, info->stage_id);
+#endif
+        e = &q->entry[index];
+        fill_memory_request_entry(m, e, paddr, op_type, FALSE);
+        e->stage_queue = stage_queue;
+        e->stage_queue_index = stage_queue->cur_idx;
+
+        /* AiMulator takes addresses in the PIM area as offsets, like the ones
+         * of AiM commands */
+        if (backend == MEM_BACKEND_PIM
+            && (op_type == MEM_ACCESS_READ || op_type == MEM_ACCESS_WRITE))
+        {
+            e->addr -= PIM_BASE_ADDR;
+        }
+
+        fill_memory_request_entry(m, &stage_queue->entry[stage_queue->cur_idx],
+                                  paddr, op_type, FALSE);
+        stage_queue->entry[stage_queue->cur_idx].mem_request_index = index;
+        stage_queue->entry[stage_queue->cur_idx].mem_backend = backend;
+        ++stage_queue->cur_idx;
+        ++stage_queue->cur_size;
+#ifdef DEBUG_BUILD
+        if (stage_queue == &m->backend_aim_queue)
+        {
+            fprintf(stderr, "(DEBUG) [NDP-Sim: MemCtrl] Backend AiM queue cur_size=%d, cur_idx=%d\n",
+                    stage_queue->cur_size, stage_queue->cur_idx);
+        }
 #endif
-        fill_memory_request_entry(m, &m->mem_request_queue.entry[index], paddr,
-                                  op_type, FALSE);
 
         /* Calculate remaining transactions for this access */
         bytes_to_access -= m->burst_length;
@@ -203,42 +307,323 @@ mem_controller_create_mem_request(MemoryController *m, target_ulong paddr,
     return 0;
 }
 
-void
-mem_controller_clock(MemoryController *m)
+/* Gather in b->aim_batch the entry at index i, followed by the AiM commands
+ * which can be sent to AiMulator together with it. They must be ready by the
+ * given cycle, of the same type and target different words, e.g. the same
+ * command issued to every channel. Entries flushed or already in flight are
+ * skipped, and the batch is limited to the requests the DRAM model can still
+ * keep in flight. Returns the number of entries in the batch. */
+static int
+mem_controller_get_aim_batch(MemBackend *b, int i, uint64_t cycle)
 {
+    int k, num_entries, max_entries;
+    PendingMemAccessEntry *e, *f;
+    CQ *cq = &b->mem_request_queue.cq;
+
+    e = &b->mem_request_queue.entry[i];
+    b->aim_batch[0] = e;
+    num_entries = 1;
+
+    if (e->type == MEM_ACCESS_READ || e->type == MEM_ACCESS_WRITE)
+    {
+        return num_entries;
+    }
+
+    max_entries = dram_get_max_batch_size(b->dram);
+    while ((num_entries < max_entries) && (i != cq_rear(cq)))
+    {
+        i = (i + 1) % cq->max_size;
+        f = &b->mem_request_queue.entry[i];
+
+        if (!f->valid || f->in_flight)
+        {
+            continue;
+        }
+        if (!f->start_access || (f->start_cycle > cycle)
+            || (f->type != e->type))
+        {
+            break;
+        }
+        for (k = 0; k < num_entries; ++k)
+        {
+            if (b->aim_batch[k]->addr == f->addr)
+            {
+                break;
+            }
+        }
+        if (k < num_entries)
+        {
+            break;
+        }
+        b->aim_batch[num_entries++] = f;
+    }
+
+    return num_entries;
+}
+
+static void
+count_requests(MemBackend *b, int num_entries)
+{
+    int k;
+
+    for (k = 0; k < num_entries; ++k)
+    {
+        switch (b->aim_batch[k]->type)
+        {
+            case MEM_ACCESS_READ:
+            {
+                ++b->stats.reads;
+                break;
+            }
+            case MEM_ACCESS_WRITE:
+            {
+                ++b->stats.writes;
+                break;
+            }
+            default:
+            {
+                ++b->stats.aim_cmds;
+                break;
+            }
+        }
+    }
+}
+
+static void
+mem_backend_send_requests(MemBackend *b, uint64_t cycle)
+{
+    int i, num_entries;
     PendingMemAccessEntry *e;
+    CQ *cq = &b->mem_request_queue.cq;
 
-    if (dram_can_accept_request(m->dram))
+    /* Remove the entries at the head which the DRAM model is done with, or
+     * which were on the miss speculated path and were flushed by the CPU
+     * pipeline stage. Flushed entries already sent to the DRAM model stay
+     * until the DRAM model completes them. */
+    while (!cq_empty(cq))
     {
-        if (!cq_empty(&m->mem_request_queue.cq))
+        e = &b->mem_request_queue.entry[cq_front(cq)];
+        if (e->valid || e->in_flight)
         {
-            e = &m->mem_request_queue.entry[cq_front(&m->mem_request_queue.cq)];
+            break;
+        }
+        cq_dequeue(cq);
+    }
+
+    /* Send the pending requests in order, as long as the DRAM model can accept
+     * them */
+    if (!cq_empty(cq))
+    {
+        i = cq_front(cq);
+        while (dram_can_accept_request(b->dram))
+        {
+            e = &b->mem_request_queue.entry[i];
             // Validated by fill_memory_request() called from mem_cpu_stage_exec()
-            if (e->valid)
+            if (e->valid && !e->in_flight)
             {
                 // Set to be TRUE by mem_controller_cache_lookup_complete_signal()
-                if (e->start_access)
+                if (!e->start_access || (e->start_cycle > cycle))
                 {
-                    dram_send_request(m->dram, e);
+                    break;
                 }
+                num_entries = mem_controller_get_aim_batch(b, i, cycle);
+                dram_send_request(b->dram, b->aim_batch, num_entries);
+                count_requests(b, num_entries);
             }
-            else
+
+            if (i == cq_rear(cq))
             {
-                /* This entry was on miss speculated path, so it was flushed by
-                 * the CPU pipeline stage */
-                cq_dequeue(&m->mem_request_queue.cq);
+                break;
             }
+            i = (i + 1) % cq->max_size;
         }
     }
+}
+
+/* Back ends are independent of each other, a request waiting in one of them
+ * never holds back the requests of the other one */
+void
+mem_controller_clock(MemoryController *m)
+{
+    int i;
 
-    if (dram_clock(m->dram))
+    if (!m->shares_backends)
     {
-        cq_dequeue(&m->mem_request_queue.cq);
+        for (i = 0; i < m->num_backends; ++i)
+        {
+            mem_backend_send_requests(&m->backend[i], m->clock);
+            dram_clock(m->backend[i].dram);
+        }
     }
+    ++m->clock;
 }
 
+static int
+mem_backend_idle(const MemBackend *b)
+{
+    return cq_empty(&b->mem_request_queue.cq) && !b->dram->clock_backend
+           && !b->dram->num_inflight_entries;
+}
+
+/* mem_controller_run_quantum()
+ * @details
+ * Clock the DRAM models shared by the num_controllers memory controllers from
+ * cycle start to end, as mem_controller_clock() would have done for a single
+ * core. Every cycle, the requests of the cores are sent in core order, so the
+ * result only depends on the requests made during the quantum and the cycle
+ * each one was made.
+ */
+void
+mem_controller_run_quantum(MemoryController **m, int num_controllers,
+                           uint64_t start, uint64_t end)
+{
+    int i, j;
+    uint64_t cycle;
+
+    for (i = 0; i < m[0]->num_backends; ++i)
+    {
+        for (j = 0; j < num_controllers; ++j)
+        {
+            if (!mem_backend_idle(&m[j]->backend[i]))
+            {
+                break;
+            }
+        }
+
+        /* Nothing to send, and a base DRAM model with nothing in flight */
+        if (j == num_controllers)
+        {
+            continue;
+        }
+
+        for (cycle = start; cycle < end; ++cycle)
+        {
+            for (j = 0; j < num_controllers; ++j)
+            {
+                mem_backend_send_requests(&m[j]->backend[i], cycle);
+            }
+            dram_clock(m[0]->backend[i].dram);
+        }
+    }
+}
+
+static int
+mem_backend_sends_request(const MemBackend *b)
+{
+    int i;
+    const PendingMemAccessEntry *e;
+    const CQ *cq = &b->mem_request_queue.cq;
+
+    if (!cq_empty(cq) && dram_can_accept_request(b->dram))
+    {
+        i = cq_front(cq);
+        while (1)
+        {
+            e = &b->mem_request_queue.entry[i];
+            if (e->valid && !e->in_flight)
+            {
+                return e->start_access;
+            }
+
+            if (i == cq_rear(cq))
+            {
+                break;
+            }
+            i = (i + 1) % cq->max_size;
+        }
+    }
+
+    return FALSE;
+}
+
+/* mem_controller_get_idle_cycles()
+ * @details
+ * Number of mem_controller_clock() calls during which neither a request is sent
+ * to the DRAM model nor one completes, so that they can be replaced by a single
+ * mem_controller_skip_cycles(). Returns 0 if that cannot be guaranteed.
+ */
+int
+mem_controller_get_idle_cycles(const MemoryController *m)
+{
+    int i, idle_cycles;
+    int cycles = INT_MAX;
+    const MemBackend *b;
+
+    /* Stage queues are only updated at the end of the quantum */
+    if (m->shares_backends)
+    {
+        if (m->clock >= m->quantum_end)
+        {
+            return 0;
+        }
+        return (m->quantum_end - m->clock < INT_MAX)
+                   ? (int)(m->quantum_end - m->clock)
+                   : INT_MAX;
+    }
+
+    for (i = 0; i < m->num_backends; ++i)
+    {
+        b = &m->backend[i];
+
+        /* Check if the next clock sends a request */
+        if (mem_backend_sends_request(b))
+        {
+            return 0;
+        }
+
+        /* A base DRAM model with nothing in flight stays idle */
+        if (!b->dram->clock_backend && !b->dram->num_inflight_entries)
+        {
+            continue;
+        }
+
+        idle_cycles = dram_get_idle_cycles(b->dram);
+        if (idle_cycles < cycles)
+        {
+            cycles = idle_cycles;
+        }
+    }
+
+    return (cycles == INT_MAX) ? 0 : cycles;
+}
+
+void
+mem_controller_skip_cycles(MemoryController *m, int cycles)
+{
+    int i;
+
+    if (!m->shares_backends)
+    {
+        for (i = 0; i < m->num_backends; ++i)
+        {
+            dram_skip_cycles(m->backend[i].dram, cycles);
+        }
+    }
+    m->clock += cycles;
+}
+
+/* The back end gets its own DRAM model, unless dram is set */
+static void
+mem_backend_init(MemBackend *b, const SimParams *p, int dram_model_type,
+                 Dram *dram)
+{
+    cq_init(&b->mem_request_queue.cq, MEM_REQUEST_QUEUE_SIZE);
+    memset((void *)b->mem_request_queue.entry, 0,
+           sizeof(PendingMemAccessEntry) * MEM_REQUEST_QUEUE_SIZE);
+
+    b->dram = dram ? dram : dram_create(p, dram_model_type);
+    b->aim_batch = (PendingMemAccessEntry **)calloc(
+        b->dram->aim_batch_size, sizeof(PendingMemAccessEntry *));
+    assert(b->aim_batch);
+}
+
+/* mem_controller_init()
+ * @details
+ * If shared is set, the new memory controller has its own queues, and uses the
+ * DRAM models of shared, which must outlive it.
+ */
 MemoryController *
-mem_controller_init(const SimParams *p)
+mem_controller_init(const SimParams *p, const MemoryController *shared)
 {
     MemoryController *m;
 
@@ -263,15 +648,31 @@ mem_controller_init(const SimParams *p)
         m->backend_aim_queue.max_size, sizeof(PendingMemAccessEntry));
     assert(m->backend_aim_queue.entry);
 
-    cq_init(&m->mem_request_queue.cq, MEM_REQUEST_QUEUE_SIZE);
-    memset((void *)m->mem_request_queue.entry, 0,
-           sizeof(PendingMemAccessEntry) * MEM_REQUEST_QUEUE_SIZE);
-
-    m->dram = dram_create(p, &m->frontend_mem_access_queue,
-                          &m->backend_mem_access_queue,
-                          &m->backend_aim_queue);
+    /* AiMulator serves only the PIM area, the guest RAM gets its own DRAM
+     * model */
+    if (m->dram_model_type == MEM_MODEL_AIMULATOR)
+    {
+        m->num_backends = 2;
+        mem_backend_init(&m->backend[MEM_BACKEND_HOST], p,
+                         p->host_dram_model_type,
+                         shared ? shared->backend[MEM_BACKEND_HOST].dram
+                                : NULL);
+        mem_backend_init(&m->backend[MEM_BACKEND_PIM], p, MEM_MODEL_AIMULATOR,
+                         shared ? shared->backend[MEM_BACKEND_PIM].dram
+                                : NULL);
+    }
+    else
+    {
+        m->num_backends = 1;
+        mem_backend_init(&m->backend[MEM_BACKEND_HOST], p, m->dram_model_type,
+                         shared ? shared->backend[MEM_BACKEND_HOST].dram
+                                : NULL);
+    }
+    m->owns_backends = !shared;
+    m->shares_backends = p->parallel_sim && (p->num_cores > 1);
 
-    switch (m->dram_model_type)
+    /* Burst length is set by the DRAM model serving the guest RAM */
+    switch (m->backend[MEM_BACKEND_HOST].dram->dram_model_type)
     {
         case MEM_MODEL_BASE:
         {
@@ -280,7 +681,9 @@ mem_controller_init(const SimParams *p)
         }
         case MEM_MODEL_DRAMSIM:
         {
-            mem_controller_set_burst_length(m, dramsim_get_burst_size());
+            mem_controller_set_burst_length(
+                m, dramsim_get_burst_size(
+                       m->backend[MEM_BACKEND_HOST].dram->dramsim));
             break;
         }
         case MEM_MODEL_RAMULATOR:
@@ -300,14 +703,27 @@ mem_controller_init(const SimParams *p)
                        __LINE__, __func__, "invalid memory model");
         }
     }
-    mem_controller_log_config(m);
+    if (!shared)
+    {
+        mem_controller_log_config(m);
+    }
     return m;
 }
 
 void
 mem_controller_free(MemoryController **m)
 {
-    dram_free(&(*m)->dram);
+    int i;
+
+    for (i = 0; i < (*m)->num_backends; ++i)
+    {
+        if ((*m)->owns_backends)
+        {
+            dram_free(&(*m)->backend[i].dram);
+        }
+        free((*m)->backend[i].aim_batch);
+        (*m)->backend[i].aim_batch = NULL;
+    }
 
     // AiM
     free((*m)->backend_aim_queue.entry);
@@ -317,52 +733,38 @@ mem_controller_free(MemoryController **m)
     (*m)->backend_mem_access_queue.entry = NULL;
     free((*m)->frontend_mem_access_queue.entry);
     (*m)->frontend_mem_access_queue.entry = NULL;
+    free((*m)->fill_queue);
+    (*m)->fill_queue = NULL;
     free(*m);
     *m = NULL;
 }
 
+/* Requests in the stage queue which are still valid are not completed yet,
+ * so their paired entries are still in the mem_request_queue, or in the fill
+ * queue of an MSHR, whose requests are started along */
 void
 mem_controller_cache_lookup_complete_signal(MemoryController *m,
                                             StageMemAccessQueue *stage_queue)
 {
-    int i, j;
-    target_ulong addr;
+    int j;
+    const PendingMemAccessEntry *se;
+    PendingMemAccessEntry *e;
 
     for (j = 0; j < stage_queue->cur_idx; ++j)
     {
-        addr = stage_queue->entry[j].addr;
-
-        if (!cq_empty(&m->mem_request_queue.cq))
+        se = &stage_queue->entry[j];
+        if (se->valid && se->fill_queue)
         {
-            if (m->mem_request_queue.cq.rear >= m->mem_request_queue.cq.front)
-            {
-                for (i = m->mem_request_queue.cq.front;
-                     i <= m->mem_request_queue.cq.rear; i++)
-                {
-                    if (m->mem_request_queue.entry[i].addr == addr)
-                    {
-                        m->mem_request_queue.entry[i].start_access = TRUE;
-                    }
-                }
-            }
-            else
+            mem_controller_cache_lookup_complete_signal(m, se->fill_queue);
+        }
+        else if (se->valid)
+        {
+            e = &m->backend[se->mem_backend]
+                     .mem_request_queue.entry[se->mem_request_index];
+            if (!e->start_access)
             {
-                for (i = m->mem_request_queue.cq.front;
-                     i < m->mem_request_queue.cq.max_size; i++)
-                {
-                    if (m->mem_request_queue.entry[i].addr == addr)
-                    {
-                        m->mem_request_queue.entry[i].start_access = TRUE;
-                    }
-                }
-
-                for (i = 0; i <= m->mem_request_queue.cq.rear; i++)
-                {
-                    if (m->mem_request_queue.entry[i].addr == addr)
-                    {
-                        m->mem_request_queue.entry[i].start_access = TRUE;
-                    }
-                }
+                e->start_access = TRUE;
+                e->start_cycle = m->clock;
             }
         }
     }
@@ -372,45 +774,115 @@ void
 mem_controller_invalidate_mem_request_queue_entries(
     MemoryController *m, StageMemAccessQueue *stage_queue)
 {
-    int i, j;
-    target_ulong addr;
+    int j;
+    const PendingMemAccessEntry *se;
 
     for (j = 0; j < stage_queue->cur_idx; ++j)
     {
-        addr = stage_queue->entry[j].addr;
+        se = &stage_queue->entry[j];
+        if (se->valid && se->fill_queue)
+        {
+            /* The line is allocated already, so the fill goes on without the
+             * flushed access, which may have been the one to start it */
+            se->fill_waiter->valid = FALSE;
+            mem_controller_cache_lookup_complete_signal(m, se->fill_queue);
+        }
+        else if (se->valid)
+        {
+            m->backend[se->mem_backend]
+                .mem_request_queue.entry[se->mem_request_index]
+                .valid = FALSE;
+        }
+    }
+}
 
-        if (!cq_empty(&m->mem_request_queue.cq))
+/* Entries of CPU stage and fill queues are completed by the DRAM model, or by
+ * the fill they wait on. Once the last request of a fill completes, the line is
+ * in the cache, and so are the accesses merged into the fill. */
+void
+mem_controller_complete_stage_queue_entry(StageMemAccessQueue *q, int index)
+{
+    int i;
+    PendingMemAccessEntry *se = &q->entry[index];
+
+    if (!se->valid)
+    {
+        return;
+    }
+
+    se->valid = FALSE;
+    --q->cur_size;
+
+    if (!q->cur_size && q->waiter)
+    {
+        for (i = 0; i < q->max_waiters; ++i)
         {
-            if (m->mem_request_queue.cq.rear >= m->mem_request_queue.cq.front)
+            if (q->waiter[i].valid)
             {
-                for (i = m->mem_request_queue.cq.front;
-                     i <= m->mem_request_queue.cq.rear; i++)
-                {
-                    if (m->mem_request_queue.entry[i].addr == addr)
-                    {
-                        m->mem_request_queue.entry[i].valid = FALSE;
-                    }
-                }
+                q->waiter[i].valid = FALSE;
+                mem_controller_complete_stage_queue_entry(
+                    q->waiter[i].stage_queue, q->waiter[i].stage_queue_index);
             }
-            else
-            {
-                for (i = m->mem_request_queue.cq.front;
-                     i < m->mem_request_queue.cq.max_size; i++)
-                {
-                    if (m->mem_request_queue.entry[i].addr == addr)
-                    {
-                        m->mem_request_queue.entry[i].valid = FALSE;
-                    }
-                }
+        }
+    }
+}
 
-                for (i = 0; i <= m->mem_request_queue.cq.rear; i++)
-                {
-                    if (m->mem_request_queue.entry[i].addr == addr)
-                    {
-                        m->mem_request_queue.entry[i].valid = FALSE;
-                    }
-                }
-            }
+/* mem_controller_wait_fill()
+ * @details
+ * Add an entry to the stage queue the access was made from, or to the fill
+ * queue set in p_mem_access_info, which completes once fill_queue drains.
+ * Returns FALSE if fill_queue has no waiter entry left.
+ */
+int
+mem_controller_wait_fill(MemoryController *m, void *p_mem_access_info,
+                         MemAccessType op_type, StageMemAccessQueue *fill_queue)
+{
+    int i;
+    StageMemAccessQueue *stage_queue;
+    PendingMemAccessEntry *se, *w;
+
+    for (i = 0; i < fill_queue->max_waiters; ++i)
+    {
+        if (!fill_queue->waiter[i].valid)
+        {
+            break;
         }
     }
-}
\ No newline at end of file
+
+    if (i == fill_queue->max_waiters)
+    {
+        return FALSE;
+    }
+
+    stage_queue = get_stage_queue(
+        m, (const MemAccessInfo *)p_mem_access_info, op_type);
+    sim_assert((stage_queue->cur_idx < stage_queue->max_size),
+               "error: %s at line %d in %s(): %s", __FILE__, __LINE__,
+               __func__, "CPU stage or MSHR fill queue is full");
+
+    w = &fill_queue->waiter[i];
+    w->valid = TRUE;
+    w->stage_queue = stage_queue;
+    w->stage_queue_index = stage_queue->cur_idx;
+
+    se = &stage_queue->entry[stage_queue->cur_idx];
+    memset(se, 0, sizeof(PendingMemAccessEntry));
+    se->valid = TRUE;
+    se->type = op_type;
+    se->fill_queue = fill_queue;
+    se->fill_waiter = w;
+    ++stage_queue->cur_idx;
+    ++stage_queue->cur_size;
+
+    return TRUE;
+}
+
+void
+mem_controller_add_fill_queue(MemoryController *m,
+                              StageMemAccessQueue *fill_queue)
+{
+    m->fill_queue = (StageMemAccessQueue **)realloc(
+        m->fill_queue, (m->num_fill_queues + 1) * sizeof(StageMemAccessQueue *));
+    assert(m->fill_queue);
+    m->fill_queue[m->num_fill_queues++] = fill_queue;
+}
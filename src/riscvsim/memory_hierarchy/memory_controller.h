@@ -36,6 +36,7 @@
 #include "../riscv_sim_typedefs.h"
 #include "../utils/circular_queue.h"
 #include "../utils/sim_params.h"
+#include "../utils/sim_stats.h"
 #include "dram.h"
 #include "memory_controller_utils.h"
 
@@ -53,9 +54,34 @@ typedef struct MemRequestQueue
     PendingMemAccessEntry entry[MEM_REQUEST_QUEUE_SIZE];
 } MemRequestQueue;
 
+/* With AiMulator, the guest RAM and the PIM area are served by separate DRAM
+ * models, see mem_controller_get_backend(). Otherwise, there is only the host
+ * back end. */
+typedef enum MemBackendType
+{
+    MEM_BACKEND_HOST,
+    MEM_BACKEND_PIM,
+    NUM_MEM_BACKENDS
+} MemBackendType;
+
+typedef struct MemBackend
+{
+    /* A FIFO queue known as mem_request_queue comprising all the pending
+     * memory access requests routed to this back end */
+    MemRequestQueue mem_request_queue;
+
+    /* Entries sent to the DRAM model as one request, see
+     * Dram::aim_batch_size */
+    PendingMemAccessEntry **aim_batch;
+    Dram *dram;
+
+    /* Requests sent to the DRAM model since the simulator started */
+    MemBackendStats stats;
+} MemBackend;
+
 typedef struct MemoryController
 {
-    /* Type of DRAM model: base or dramsim3 */
+    /* Type of DRAM model: base, dramsim3, ramulator or aimulator */
     int dram_model_type;
 
     /* Memory controller burst length in bytes (or cache line size) */
@@ -67,20 +93,47 @@ typedef struct MemoryController
     StageMemAccessQueue backend_mem_access_queue;
     StageMemAccessQueue backend_aim_queue;
 
-    /* A single FIFO queue known as mem_request_queue comprising all the pending
-     * memory access requests */
-    MemRequestQueue mem_request_queue;
+    /* Each back end has its own mem_request_queue and DRAM model, which runs
+     * in its own clock domain */
+    int num_backends;
+    MemBackend backend[NUM_MEM_BACKENDS];
 
     /* To keep track of cache lookup cycle(s) for reading/writing page table
      * entries during hardware page walk */
     int page_walk_delay;
-    Dram *dram;
+
+    /* Cycles elapsed, in step with the clock of the core */
+    uint64_t clock;
+
+    /* When the cores are simulated in parallel, each one has its own memory
+     * controller, and the DRAM models are owned by the one of the first core.
+     * The DRAM models are then not clocked by mem_controller_clock(), but
+     * by mem_controller_run_quantum() for all the cores at the end of each
+     * quantum. */
+    int shares_backends;
+    int owns_backends;
+    uint64_t quantum_end;
+
+    /* Set while the caches are warmed without timing in sampled simulation,
+     * the cache misses and evictions then create no DRAM requests */
+    int functional_warming;
+
+    /* Fill queues of the cache MSHRs sending their requests through this
+     * memory controller, dropped with the stage queues on reset */
+    int num_fill_queues;
+    StageMemAccessQueue **fill_queue;
 } MemoryController;
 
-MemoryController *mem_controller_init(const SimParams *p);
+MemoryController *mem_controller_init(const SimParams *p,
+                                      const MemoryController *shared);
 void mem_controller_free(MemoryController **m);
 void mem_controller_reset(MemoryController *m);
+void mem_controller_reset_backends(MemoryController *m);
+void mem_controller_run_quantum(MemoryController **m, int num_controllers,
+                                uint64_t start, uint64_t end);
 void mem_controller_clock(MemoryController *m);
+int mem_controller_get_idle_cycles(const MemoryController *m);
+void mem_controller_skip_cycles(MemoryController *m, int cycles);
 void mem_controller_reset_cpu_stage_queue(StageMemAccessQueue *q);
 void mem_controller_reset_mem_request_queue(MemoryController *m);
 void mem_controller_set_burst_length(MemoryController *m, int burst_length);
@@ -88,6 +141,11 @@ int mem_controller_create_mem_request(MemoryController *m, target_ulong paddr,
                                       int bytes_to_access,
                                       MemAccessType op_type,
                                       void *p_mem_access_info);
+int mem_controller_wait_fill(MemoryController *m, void *p_mem_access_info,
+                             MemAccessType op_type,
+                             StageMemAccessQueue *fill_queue);
+void mem_controller_add_fill_queue(MemoryController *m,
+                                   StageMemAccessQueue *fill_queue);
 void mem_controller_cache_lookup_complete_signal(MemoryController *m,
                                             StageMemAccessQueue *stage_queue);
 void mem_controller_invalidate_mem_request_queue_entries(
@@ -64,17 +64,30 @@ typedef enum MemAccessType {
     // AIM_AF_4BK_INTER_BG = 0x9,  // funct3 = 011
 } MemAccessType;
 
+/* Entries are created in pairs, one in the CPU stage queue and one in the
+ * mem_request_queue of a memory controller back end, which point to each other
+ * by index. The DRAM models may be shared by the memory controllers of several
+ * cores, so a mem_request_queue entry also points to its CPU stage queue. */
 typedef struct PendingMemAccessEntry
 {
     int valid;
     int start_access;
+    uint64_t start_cycle; /* Memory controller cycle start_access was set */
+    int in_flight; /* Sent to the DRAM model, waiting for it to complete */
     int access_size_bytes;
     target_ulong addr;
     target_ulong req_addr;
     target_ulong req_pte;
-    int stage_queue_index;
-    int stage_queue_type;
+    int stage_queue_index;   /* Set for mem_request_queue entries */
+    struct StageMemAccessQueue *stage_queue;
+    int mem_request_index;   /* Set for CPU stage queue entries */
+    int mem_backend;         /* Set for CPU stage queue entries */
     MemAccessType type;
+
+    /* Set for stage queue entries waiting on the fill of a cache MSHR instead
+     * of a mem_request_queue entry, see mem_controller_wait_fill() */
+    struct StageMemAccessQueue *fill_queue;
+    struct PendingMemAccessEntry *fill_waiter;
 } PendingMemAccessEntry;
 
 typedef struct StageMemAccessQueue
@@ -83,5 +96,25 @@ typedef struct StageMemAccessQueue
     int max_size;
     int cur_size;
     PendingMemAccessEntry *entry;
+
+    /* Set for the fill queue of a cache MSHR, which holds the requests filling
+     * the line. The accesses merged into the fill are paired with waiter
+     * entries, like with mem_request_queue entries, and complete when the
+     * fill queue drains. */
+    int max_waiters;
+    PendingMemAccessEntry *waiter;
 } StageMemAccessQueue;
+
+/* Passed down the memory hierarchy as p_mem_access_info. The requests are
+ * added to fill_queue if set, otherwise to the queue of the CPU stage. pc is
+ * the PC of the instruction making a data access, 0 if unknown. */
+typedef struct MemAccessInfo
+{
+    int stage_id;
+    StageMemAccessQueue *fill_queue;
+    target_ulong pc;
+} MemAccessInfo;
+
+void mem_controller_complete_stage_queue_entry(StageMemAccessQueue *q,
+                                               int index);
 #endif
\ No newline at end of file
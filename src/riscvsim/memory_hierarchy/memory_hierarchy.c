@@ -39,9 +39,11 @@ mem_hierarchy_cache_disabled_read(MemoryHierarchy *mem_hierarchy,
                                   target_ulong paddr, int bytes, int stage_id,
                                   int priv)
 {
+    MemAccessInfo info = { stage_id, NULL };
+
     mem_controller_create_mem_request(mem_hierarchy->mem_controller, paddr,
                                       bytes, MEM_ACCESS_READ,
-                                      (void *)&stage_id);
+                                      (void *)&info);
     return 1;
 }
 
@@ -50,9 +52,11 @@ mem_hierarchy_cache_disabled_write(MemoryHierarchy *mem_hierarchy,
                                    target_ulong paddr, int bytes, int stage_id,
                                    int priv)
 {
+    MemAccessInfo info = { stage_id, NULL };
+
     mem_controller_create_mem_request(mem_hierarchy->mem_controller, paddr,
                                       bytes, MEM_ACCESS_WRITE,
-                                      (void *)&stage_id);
+                                      (void *)&info);
     return 1;
 }
 
@@ -62,6 +66,8 @@ mem_hierarchy_cache_bypass_aim(MemoryHierarchy *mem_hierarchy,
                                  target_ulong paddr, int bytes, int stage_id,
                                  int priv, InstructionLatch *e)
 {
+    MemAccessInfo info = { stage_id, NULL };
+
     // printf("mem_hierarchy_cache_by");
     MemAccessType aim_type = -1;
     switch (e->ins.type)
@@ -121,7 +127,7 @@ mem_hierarchy_cache_bypass_aim(MemoryHierarchy *mem_hierarchy,
             break;
     }
     mem_controller_create_mem_request(mem_hierarchy->mem_controller, paddr,
-                                      bytes, aim_type, (void *)&stage_id);
+                                      bytes, aim_type, (void *)&info);
     return 1;
 }
 
@@ -129,7 +135,9 @@ static int
 mem_hierarchy_icache_read(MemoryHierarchy *mem_hierarchy, target_ulong paddr,
                           int bytes, int stage_id, int priv)
 {
-    return cache_read(mem_hierarchy->icache, paddr, bytes, (void *)&stage_id,
+    MemAccessInfo info = { stage_id, NULL };
+
+    return cache_read(mem_hierarchy->icache, paddr, bytes, (void *)&info,
                       priv);
 }
 
@@ -137,7 +145,9 @@ static int
 mem_hierarchy_dcache_read(MemoryHierarchy *mem_hierarchy, target_ulong paddr,
                           int bytes, int stage_id, int priv)
 {
-    return cache_read(mem_hierarchy->dcache, paddr, bytes, (void *)&stage_id,
+    MemAccessInfo info = { stage_id, NULL, mem_hierarchy->access_pc };
+
+    return cache_read(mem_hierarchy->dcache, paddr, bytes, (void *)&info,
                       priv);
 }
 
@@ -145,7 +155,9 @@ static int
 mem_hierarchy_dcache_write(MemoryHierarchy *mem_hierarchy, target_ulong paddr,
                            int bytes, int stage_id, int priv)
 {
-    return cache_write(mem_hierarchy->dcache, paddr, bytes, (void *)&stage_id,
+    MemAccessInfo info = { stage_id, NULL, mem_hierarchy->access_pc };
+
+    return cache_write(mem_hierarchy->dcache, paddr, bytes, (void *)&info,
                        priv);
 }
 
@@ -154,7 +166,9 @@ mem_hierarchy_pte_read_cache(MemoryHierarchy *mem_hierarchy,
                               target_ulong paddr, int bytes, int stage_id,
                               int priv)
 {
-    return cache_read(mem_hierarchy->page_walk_cache, paddr, bytes, (void *)&stage_id,
+    MemAccessInfo info = { stage_id, NULL };
+
+    return cache_read(mem_hierarchy->page_walk_cache, paddr, bytes, (void *)&info,
                       priv);
 }
 
@@ -162,7 +176,9 @@ static int
 mem_hierarchy_pte_write_cache(MemoryHierarchy *mem_hierarchy, target_ulong paddr,
                         int bytes, int stage_id, int priv)
 {
-    return cache_write(mem_hierarchy->page_walk_cache, paddr, bytes, (void *)&stage_id,
+    MemAccessInfo info = { stage_id, NULL };
+
+    return cache_write(mem_hierarchy->page_walk_cache, paddr, bytes, (void *)&info,
                        priv);
 }
 
@@ -183,8 +199,15 @@ mem_hierarchy_set_page_walk_cache(MemoryHierarchy *m, const SimParams *p)
     }
 }
 
+/* memory_hierarchy_init()
+ * @details
+ * If shared is set, the new hierarchy only gets its own L1 caches, and uses
+ * the L2 cache and memory controller of shared, which must outlive it. With
+ * parallel_sim, it only uses the DRAM models of shared.
+ */
 MemoryHierarchy *
-memory_hierarchy_init(const SimParams *p, SimLog *log)
+memory_hierarchy_init(const SimParams *p, SimLog *log,
+                      const MemoryHierarchy *shared)
 {
     int words_per_cache_line;
     MemoryHierarchy *mem_hierarchy;
@@ -194,7 +217,19 @@ memory_hierarchy_init(const SimParams *p, SimLog *log)
     mem_hierarchy->p = (SimParams *)p;
 
     /* Setup memory controller */
-    mem_hierarchy->mem_controller = mem_controller_init(p);
+    if (shared && !p->parallel_sim)
+    {
+        mem_hierarchy->mem_controller = shared->mem_controller;
+        mem_hierarchy->l2_cache = shared->l2_cache;
+    }
+    else
+    {
+        mem_hierarchy->mem_controller
+            = mem_controller_init(p, shared ? shared->mem_controller : NULL);
+        mem_hierarchy->owns_l2_cache = TRUE;
+        mem_hierarchy->owns_mem_controller = TRUE;
+    }
+    mem_hierarchy->owns_shared_levels = !shared;
 
     /* Setup caches */
     if (p->enable_l1_caches)
@@ -208,17 +243,22 @@ memory_hierarchy_init(const SimParams *p, SimLog *log)
 
         /* If DRAMSim3 memory model is used, its burst length must be equal to
          * cache line size */
-        if (mem_hierarchy->mem_controller->dram_model_type == MEM_MODEL_DRAMSIM)
+        if (mem_hierarchy->mem_controller->backend[MEM_BACKEND_HOST]
+                .dram->dram_model_type
+            == MEM_MODEL_DRAMSIM)
         {
             sim_assert((mem_hierarchy->mem_controller->burst_length
-                        == dramsim_get_burst_size()),
+                        == dramsim_get_burst_size(
+                            mem_hierarchy->mem_controller
+                                ->backend[MEM_BACKEND_HOST]
+                                .dram->dramsim)),
                        "error: %s at line %d in %s(): %s", __FILE__, __LINE__,
                        __func__, "DRAMSim3 burst length must be equal to "
                                  "MARSS-RISCV cache line size or CPU memory "
                                  "controller burst length");
         }
 
-        if (p->enable_l2_cache)
+        if (p->enable_l2_cache && mem_hierarchy->owns_l2_cache)
         {
             sim_log_event_to_file(log, "%s", "Setting up L2-cache");
             mem_hierarchy->l2_cache = cache_init(
@@ -230,7 +270,18 @@ memory_hierarchy_init(const SimParams *p, SimLog *log)
                 (CacheWritePolicy)p->cache_write_policy,
                 (CacheReadAllocPolicy)p->cache_read_allocate_policy,
                 (CacheWriteAllocPolicy)p->cache_write_allocate_policy,
-                mem_hierarchy->mem_controller);
+                mem_hierarchy->mem_controller,
+                p->l2_shared_cache_mshrs);
+
+            if (p->l2_shared_cache_prefetcher != PREFETCHER_NONE)
+            {
+                cache_set_prefetcher(
+                    mem_hierarchy->l2_cache,
+                    prefetcher_create(p->l2_shared_cache_prefetcher,
+                                      p->l2_shared_cache_prefetch_degree,
+                                      p->l2_shared_cache_prefetch_distance,
+                                      mem_hierarchy->cache_line_size));
+            }
         }
 
         sim_log_event_to_file(log, "%s", "Setting up L1-instruction cache");
@@ -242,7 +293,7 @@ memory_hierarchy_init(const SimParams *p, SimLog *log)
             (CacheWritePolicy)p->cache_write_policy,
             (CacheReadAllocPolicy)p->cache_read_allocate_policy,
             (CacheWriteAllocPolicy)p->cache_write_allocate_policy,
-            mem_hierarchy->mem_controller);
+            mem_hierarchy->mem_controller, p->l1_code_cache_mshrs);
 
         sim_log_event_to_file(log, "%s", "Setting up L1-data cache");
         mem_hierarchy->dcache = cache_init(
@@ -253,7 +304,17 @@ memory_hierarchy_init(const SimParams *p, SimLog *log)
             p->l1_data_cache_evict, (CacheWritePolicy)p->cache_write_policy,
             (CacheReadAllocPolicy)p->cache_read_allocate_policy,
             (CacheWriteAllocPolicy)p->cache_write_allocate_policy,
-            mem_hierarchy->mem_controller);
+            mem_hierarchy->mem_controller, p->l1_data_cache_mshrs);
+
+        if (p->l1_data_cache_prefetcher != PREFETCHER_NONE)
+        {
+            cache_set_prefetcher(
+                mem_hierarchy->dcache,
+                prefetcher_create(p->l1_data_cache_prefetcher,
+                                  p->l1_data_cache_prefetch_degree,
+                                  p->l1_data_cache_prefetch_distance,
+                                  mem_hierarchy->cache_line_size));
+        }
     }
 
     mem_hierarchy_set_page_walk_cache(mem_hierarchy, p);
@@ -296,7 +357,7 @@ memory_hierarchy_free(MemoryHierarchy **mem_hierarchy)
 {
     if ((*mem_hierarchy)->p->enable_l1_caches)
     {
-        if ((*mem_hierarchy)->l2_cache)
+        if ((*mem_hierarchy)->l2_cache && (*mem_hierarchy)->owns_l2_cache)
         {
             cache_free(&(*mem_hierarchy)->l2_cache);
         }
@@ -304,7 +365,10 @@ memory_hierarchy_free(MemoryHierarchy **mem_hierarchy)
         cache_free(&(*mem_hierarchy)->icache);
     }
 
-    mem_controller_free(&(*mem_hierarchy)->mem_controller);
+    if ((*mem_hierarchy)->owns_mem_controller)
+    {
+        mem_controller_free(&(*mem_hierarchy)->mem_controller);
+    }
 
     free(*mem_hierarchy);
     *mem_hierarchy = NULL;
@@ -50,9 +50,21 @@ typedef struct MemoryHierarchy
     Cache *page_walk_cache;
     SimParams *p;
 
+    /* The L2 cache and memory controller are shared by all the cores, and
+     * owned by the hierarchy of the first one. When the cores are simulated in
+     * parallel, only the DRAM models are shared, and every core has its own L2
+     * cache and memory controller. */
+    int owns_shared_levels;
+    int owns_l2_cache;
+    int owns_mem_controller;
+
     /* If caches are enabled */
     int cache_line_size;
 
+    /* PC of the instruction making the next data accesses, set by the core
+     * for the prefetchers trained with the PC */
+    target_ulong access_pc;
+
     /* Pointers are set based on whether caches are enabled or disabled */
     int (*insn_read_delay)(struct MemoryHierarchy *mmu, target_ulong paddr,
                            int bytes, int cpu_stage_id, int priv);
@@ -73,6 +85,7 @@ typedef struct MemoryHierarchy
                                int bytes, int cpu_stage_id, int priv);
 } MemoryHierarchy;
 
-MemoryHierarchy *memory_hierarchy_init(const SimParams *p, SimLog *log);
+MemoryHierarchy *memory_hierarchy_init(const SimParams *p, SimLog *log,
+                                       const MemoryHierarchy *shared);
 void memory_hierarchy_free(MemoryHierarchy **mmu);
 #endif
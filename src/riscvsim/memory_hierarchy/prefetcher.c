@@ -0,0 +1,276 @@
+/**
+ * Cache prefetchers
+ *
+ * MARSS-RISCV : Micro-Architectural System Simulator for RISC-V
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../cutils.h"
+#include "../riscv_sim_macros.h"
+#include "../utils/sim_log.h"
+#include "prefetcher.h"
+
+/* Confidence of a stride or stream before its lines are prefetched */
+#define PREFETCH_MIN_CONFIDENCE 2
+#define PREFETCH_MAX_CONFIDENCE 3
+
+/* Prefetch the line of addr, unless it is in another page than the trigger */
+static void
+add_candidate(Prefetcher *p, target_ulong trigger, target_ulong addr)
+{
+    if ((addr >> PREFETCH_PAGE_BITS) == (trigger >> PREFETCH_PAGE_BITS))
+    {
+        p->candidate[p->num_candidates++]
+            = addr & ~(target_ulong)(p->line_size - 1);
+    }
+}
+
+/* Prefetch degree lines, spaced by step bytes, from distance steps after
+ * paddr */
+static int
+add_candidates(Prefetcher *p, target_ulong paddr, int64_t step)
+{
+    int i;
+
+    p->num_candidates = 0;
+    for (i = 0; i < p->degree; ++i)
+    {
+        add_candidate(p, paddr, paddr + step * (p->distance + i));
+    }
+
+    return p->num_candidates;
+}
+
+static int
+next_line_train(Prefetcher *p, target_ulong paddr, target_ulong pc, int miss)
+{
+    if (!miss)
+    {
+        return 0;
+    }
+
+    return add_candidates(p, paddr, p->line_size);
+}
+
+/* Reference prediction table: the entry of the PC holds the last address it
+ * accessed and the last stride seen. The stride is prefetched once it was seen
+ * PREFETCH_MIN_CONFIDENCE times in a row. Strides shorter than a line prefetch
+ * the next lines in the same direction. */
+static int
+stride_train(Prefetcher *p, target_ulong paddr, target_ulong pc, int miss)
+{
+    int64_t stride;
+    PrefetchEntry *e;
+
+    if (!pc)
+    {
+        return 0;
+    }
+
+    e = &p->entry[(pc >> 1) % p->num_entries];
+    if (!e->valid || (e->pc != pc))
+    {
+        memset((void *)e, 0, sizeof(PrefetchEntry));
+        e->valid = TRUE;
+        e->pc = pc;
+        e->last_addr = paddr;
+        return 0;
+    }
+
+    stride = (int64_t)(paddr - e->last_addr);
+    if (!stride)
+    {
+        return 0;
+    }
+    e->last_addr = paddr;
+
+    if (stride == e->stride)
+    {
+        if (e->confidence < PREFETCH_MAX_CONFIDENCE)
+        {
+            ++e->confidence;
+        }
+    }
+    else if (e->confidence)
+    {
+        --e->confidence;
+        return 0;
+    }
+    else
+    {
+        e->stride = stride;
+        return 0;
+    }
+
+    if (e->confidence < PREFETCH_MIN_CONFIDENCE)
+    {
+        return 0;
+    }
+
+    if (stride > -p->line_size && stride < p->line_size)
+    {
+        stride = (stride > 0) ? p->line_size : -p->line_size;
+    }
+
+    return add_candidates(p, paddr, stride);
+}
+
+/* A miss close to the last line of a stream advances it, and sets its
+ * direction the first time. Otherwise, it starts a new stream in place of
+ * the least recently used one. The lines ahead of a stream are prefetched
+ * once it advanced PREFETCH_MIN_CONFIDENCE times in the same direction. */
+static int
+stream_train(Prefetcher *p, target_ulong paddr, target_ulong pc, int miss)
+{
+    int i;
+    int64_t delta;
+    target_ulong line = paddr / p->line_size;
+    PrefetchEntry *e;
+    PrefetchEntry *lru = &p->entry[0];
+
+    if (!miss)
+    {
+        return 0;
+    }
+
+    ++p->num_trainings;
+    for (i = 0; i < p->num_entries; ++i)
+    {
+        e = &p->entry[i];
+        if (!e->valid)
+        {
+            if (lru->valid)
+            {
+                lru = e;
+            }
+            continue;
+        }
+
+        if (lru->valid && (e->last_use < lru->last_use))
+        {
+            lru = e;
+        }
+
+        delta = (int64_t)(line - e->last_addr);
+        if (!delta || (delta > PREFETCH_STREAM_WINDOW)
+            || (delta < -PREFETCH_STREAM_WINDOW))
+        {
+            continue;
+        }
+
+        if (!e->stride)
+        {
+            e->stride = (delta > 0) ? 1 : -1;
+        }
+        else if ((delta > 0) != (e->stride > 0))
+        {
+            continue;
+        }
+
+        e->last_addr = line;
+        e->last_use = p->num_trainings;
+        if (e->confidence < PREFETCH_MAX_CONFIDENCE)
+        {
+            ++e->confidence;
+        }
+
+        if (e->confidence < PREFETCH_MIN_CONFIDENCE)
+        {
+            return 0;
+        }
+
+        return add_candidates(p, paddr, e->stride * p->line_size);
+    }
+
+    memset((void *)lru, 0, sizeof(PrefetchEntry));
+    lru->valid = TRUE;
+    lru->last_addr = line;
+    lru->last_use = p->num_trainings;
+    return 0;
+}
+
+static void
+prefetcher_reset(Prefetcher *p)
+{
+    memset((void *)p->entry, 0, p->num_entries * sizeof(PrefetchEntry));
+    p->num_trainings = 0;
+    p->num_candidates = 0;
+}
+
+Prefetcher *
+prefetcher_create(int type, int degree, int distance, int line_size)
+{
+    Prefetcher *p;
+
+    p = calloc(1, sizeof(Prefetcher));
+    assert(p);
+
+    p->type = type;
+    p->degree = degree;
+    p->distance = distance;
+    p->line_size = line_size;
+
+    p->candidate = calloc(degree, sizeof(target_ulong));
+    assert(p->candidate);
+
+    switch (p->type)
+    {
+        case PREFETCHER_NEXT_LINE:
+        {
+            p->train = &next_line_train;
+            break;
+        }
+        case PREFETCHER_STRIDE:
+        {
+            p->num_entries = PREFETCH_STRIDE_TABLE_SIZE;
+            p->train = &stride_train;
+            break;
+        }
+        case PREFETCHER_STREAM:
+        {
+            p->num_entries = PREFETCH_NUM_STREAMS;
+            p->train = &stream_train;
+            break;
+        }
+        default:
+        {
+            sim_assert((0), "error: %s at line %d in %s(): %s", __FILE__,
+                       __LINE__, __func__, "invalid prefetcher type");
+        }
+    }
+
+    p->entry = calloc(p->num_entries, sizeof(PrefetchEntry));
+    assert(p->entry || !p->num_entries);
+
+    p->reset = &prefetcher_reset;
+    return p;
+}
+
+void
+prefetcher_free(Prefetcher **p)
+{
+    free((*p)->entry);
+    free((*p)->candidate);
+    free(*p);
+    *p = NULL;
+}
@@ -0,0 +1,87 @@
+/**
+ * Cache prefetchers
+ *
+ * A prefetcher is trained with the demand accesses of the cache it is attached
+ * to, and returns the lines the cache should prefetch. Three engines are
+ * available: next-line, stride (indexed by the PC of the load or store) and
+ * stream. degree is the number of lines prefetched per trigger, and distance
+ * how many lines (or strides) ahead of the trigger the first one is.
+ *
+ * MARSS-RISCV : Micro-Architectural System Simulator for RISC-V
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _PREFETCHER_H_
+#define _PREFETCHER_H_
+
+#include <inttypes.h>
+
+#include "../riscv_sim_typedefs.h"
+
+/* Entries of the PC-indexed stride table, and streams tracked at a time */
+#define PREFETCH_STRIDE_TABLE_SIZE 64
+#define PREFETCH_NUM_STREAMS 16
+
+/* Misses at most this many lines apart are considered part of a stream */
+#define PREFETCH_STREAM_WINDOW 16
+
+/* Lines are not prefetched across page boundaries, as the next physical page
+ * is unrelated to the next virtual one */
+#define PREFETCH_PAGE_BITS 12
+
+/* A stride table entry, or a stream. stride is in bytes for the stride engine,
+ * and the direction of the stream (+1 or -1 line) for the stream engine. */
+typedef struct PrefetchEntry
+{
+    int valid;
+    target_ulong pc;
+    target_ulong last_addr;
+    int64_t stride;
+    int confidence;
+    uint64_t last_use;
+} PrefetchEntry;
+
+typedef struct Prefetcher
+{
+    int type;
+    int degree;
+    int distance;
+    int line_size;
+
+    int num_entries;
+    PrefetchEntry *entry;
+    uint64_t num_trainings;
+
+    /* Lines to prefetch, found by the last call to train */
+    int num_candidates;
+    target_ulong *candidate;
+
+    /* This pointers are set according to the prefetcher type. train is called
+     * for every demand access to paddr, with miss also set on the first access
+     * to a prefetched line, for the prefetches to keep ahead of the demand
+     * stream. It returns the number of lines to prefetch. */
+    void (*reset)(struct Prefetcher *p);
+    int (*train)(struct Prefetcher *p, target_ulong paddr, target_ulong pc,
+                 int miss);
+} Prefetcher;
+
+Prefetcher *prefetcher_create(int type, int degree, int distance,
+                              int line_size);
+void prefetcher_free(Prefetcher **p);
+#endif /* _PREFETCHER_H_ */
@@ -54,36 +54,44 @@ ramulator_wrapper::finish()
 }
 
 void
-ramulator_wrapper::read_complete(ramulator::Request &req)
+ramulator_wrapper::transaction_complete(target_ulong addr, bool is_write)
 {
-    auto it = mem_addr_cb_status.find(req.addr);
-    assert(it != mem_addr_cb_status.end());
-    it->second = true;
+    uint64_t req_id;
+    auto it = addr_req_ids[is_write].find(addr);
+    assert(it != addr_req_ids[is_write].end());
+
+    req_id = it->second.front();
+    it->second.pop_front();
+    if (it->second.empty())
+    {
+        addr_req_ids[is_write].erase(it);
+    }
+
+    /* Requests dropped by reset() are still served by Ramulator, their
+     * callbacks are ignored */
+    auto req = req_parts_pending.find(req_id);
+    if (req == req_parts_pending.end())
+    {
+        return;
+    }
+
+    if (--req->second == 0)
+    {
+        req_parts_pending.erase(req);
+        completed_req_ids.push_back(req_id);
+    }
 }
 
 void
-ramulator_wrapper::write_complete(ramulator::Request &req)
+ramulator_wrapper::read_complete(ramulator::Request &req)
 {
-    auto it = mem_addr_cb_status.find(req.addr);
-    assert(it != mem_addr_cb_status.end());
-    it->second = true;
+    transaction_complete(req.addr, false);
 }
 
-bool
-ramulator_wrapper::access_complete()
+void
+ramulator_wrapper::write_complete(ramulator::Request &req)
 {
-    auto it = mem_addr_cb_status.begin();
-
-    while (it != mem_addr_cb_status.end())
-    {
-        if (it->second == false)
-        {
-            return false;
-        }
-        it++;
-    }
-
-    return true;
+    transaction_complete(req.addr, true);
 }
 
 bool
@@ -107,32 +115,85 @@ ramulator_wrapper::add_transaction(target_ulong addr, bool isWrite)
     return request_sent;
 }
 
-int
-ramulator_wrapper::get_max_clock_cycles(PendingMemAccessEntry *e)
+bool
+ramulator_wrapper::try_send_transaction(const PendingTransaction &trans)
+{
+    if (!add_transaction(trans.addr, trans.is_write))
+    {
+        return false;
+    }
+
+    addr_req_ids[trans.is_write][trans.addr].push_back(trans.req_id);
+    return true;
+}
+
+/* send_request()
+ * @details
+ * Hand over a memory controller request to Ramulator without waiting for it to
+ * complete. The request is identified by req_id, which is returned by
+ * get_completed_request() once all of its parts are served. Transactions
+ * Ramulator cannot accept right now are retried in order from tick().
+ */
+void
+ramulator_wrapper::send_request(uint64_t req_id, PendingMemAccessEntry *e)
 {
     int bytes_accessed = 0;
-    int clock_cycles_elasped = 0;
-    target_ulong addr;
+    PendingTransaction trans;
 
-    mem_addr_cb_status.clear();
+    trans.req_id = req_id;
+    trans.is_write = (bool)e->type;
 
-    /* Split the entire request size into MEM_BUS_WIDTH sized parts, and query
-     * latency for each of the part separately */
+    /* Split the entire request size into MEM_BUS_WIDTH sized parts, and send
+     * each of the part separately */
     while (bytes_accessed < e->access_size_bytes)
     {
-        addr = e->addr + bytes_accessed;
-        mem_addr_cb_status.insert(std::pair<target_ulong, bool>(addr, false));
-        assert(add_transaction(addr, (bool)e->type));
+        trans.addr = e->addr + bytes_accessed;
+        ++req_parts_pending[req_id];
+        if (!retry_queue.empty() || !try_send_transaction(trans))
+        {
+            retry_queue.push(trans);
+        }
         bytes_accessed += MEM_BUS_WIDTH;
     }
+}
 
-    while (!access_complete())
+void
+ramulator_wrapper::tick()
+{
+    while (!retry_queue.empty())
     {
-        gem5_wrapper->tick();
-        clock_cycles_elasped++;
+        if (!try_send_transaction(retry_queue.front()))
+        {
+            break;
+        }
+        retry_queue.pop();
     }
 
-    return clock_cycles_elasped;
+    gem5_wrapper->tick();
+}
+
+bool
+ramulator_wrapper::get_completed_request(uint64_t *req_id)
+{
+    if (completed_req_ids.empty())
+    {
+        return false;
+    }
+
+    *req_id = completed_req_ids.front();
+    completed_req_ids.pop_front();
+    return true;
+}
+
+/* Forget about all the requests sent so far. Transactions already accepted by
+ * Ramulator stay in addr_req_ids, so that their callbacks are matched and
+ * ignored. */
+void
+ramulator_wrapper::reset()
+{
+    req_parts_pending.clear();
+    completed_req_ids.clear();
+    std::queue<PendingTransaction>().swap(retry_queue);
 }
 
 void
@@ -32,7 +32,10 @@
 
 #include <Gem5Wrapper.h>
 #include <Request.h>
+#include <deque>
 #include <map>
+#include <queue>
+#include <unordered_map>
 
 using namespace ramulator;
 
@@ -43,19 +46,42 @@ class ramulator_wrapper
     ramulator_wrapper(const char *config_file, int cache_line_size);
     ~ramulator_wrapper();
     bool add_transaction(target_ulong addr, bool isWrite);
-    int get_max_clock_cycles(PendingMemAccessEntry *e);
-    bool access_complete();
+    void send_request(uint64_t req_id, PendingMemAccessEntry *e);
+    void tick();
+    bool get_completed_request(uint64_t *req_id);
+    void reset();
     void write_complete(ramulator::Request &req);
     void read_complete(ramulator::Request &req);
     void finish();
     void print_stats(const char *stats_dir, const char *timestamp);
 
-    /* We split the cache-line address into MEM_BUS_WIDTH sized parts, so this map
-     * keeps track of callbacks for each of this part */
-    std::map<target_ulong, bool> mem_addr_cb_status;
+    /* We split the cache-line address into MEM_BUS_WIDTH sized parts, so this
+     * map keeps track of the number of parts still in flight for each of the
+     * requests sent by the memory controller */
+    std::unordered_map<uint64_t, int> req_parts_pending;
+
+    /* Ramulator calls back with the address only, so keep the requests which
+     * have a read (index 0) or write (index 1) transaction in flight for each
+     * address, oldest first */
+    std::map<target_ulong, std::deque<uint64_t>> addr_req_ids[2];
+
+    /* Requests whose parts have all been served, in order of completion */
+    std::deque<uint64_t> completed_req_ids;
 
     std::function<void(ramulator::Request &)> read_cb_func;
     std::function<void(ramulator::Request &)> write_cb_func;
     Gem5Wrapper *gem5_wrapper;
+
+  private:
+    struct PendingTransaction
+    {
+        uint64_t req_id;
+        target_ulong addr;
+        bool is_write;
+    };
+
+    std::queue<PendingTransaction> retry_queue;
+    bool try_send_transaction(const PendingTransaction &trans);
+    void transaction_complete(target_ulong addr, bool is_write);
 };
-#endif
\ No newline at end of file
+#endif
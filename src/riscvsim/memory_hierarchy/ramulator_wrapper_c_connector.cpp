@@ -31,47 +31,71 @@
 extern "C" {
 #endif
 
-static ramulator_wrapper *ramulator_wrapper_obj = NULL;
+/* Each handle is a ramulator_wrapper, so several Ramulator memory systems can
+ * live in the same process */
+static ramulator_wrapper *
+to_obj(RamulatorWrapper *w)
+{
+    return reinterpret_cast<ramulator_wrapper *>(w);
+}
 
-void
+RamulatorWrapper *
 ramulator_wrapper_init(const char *config_file, int cache_line_size)
 {
-    if (ramulator_wrapper_obj == NULL)
-    {
-        ramulator_wrapper_obj
-            = new ramulator_wrapper(config_file, cache_line_size);
-    }
+    return reinterpret_cast<RamulatorWrapper *>(
+        new ramulator_wrapper(config_file, cache_line_size));
 }
 
 void
-ramulator_wrapper_destroy()
+ramulator_wrapper_destroy(RamulatorWrapper **w)
 {
-    delete ramulator_wrapper_obj;
-    ramulator_wrapper_obj = NULL;
+    delete to_obj(*w);
+    *w = NULL;
 }
 
 void
-ramulator_wrapper_finish()
+ramulator_wrapper_finish(RamulatorWrapper *w)
 {
-    ramulator_wrapper_obj->finish();
+    to_obj(w)->finish();
 }
 
 int
-ramulator_wrapper_add_transaction(target_ulong addr, int isWrite)
+ramulator_wrapper_add_transaction(RamulatorWrapper *w, target_ulong addr,
+                                  int isWrite)
+{
+    return (int)to_obj(w)->add_transaction(addr, (bool)isWrite);
+}
+
+void
+ramulator_wrapper_send_request(RamulatorWrapper *w, uint64_t req_id,
+                               PendingMemAccessEntry *e)
 {
-    return (int)ramulator_wrapper_obj->add_transaction(addr, (bool)isWrite);
+    to_obj(w)->send_request(req_id, e);
+}
+
+void
+ramulator_wrapper_tick(RamulatorWrapper *w)
+{
+    to_obj(w)->tick();
 }
 
 int
-ramulator_wrapper_get_max_clock_cycles(PendingMemAccessEntry *e)
+ramulator_wrapper_get_completed_request(RamulatorWrapper *w, uint64_t *req_id)
+{
+    return (int)to_obj(w)->get_completed_request(req_id);
+}
+
+void
+ramulator_wrapper_reset(RamulatorWrapper *w)
 {
-    return ramulator_wrapper_obj->get_max_clock_cycles(e);
+    to_obj(w)->reset();
 }
 
 void
-ramulator_wrapper_print_stats(const char *stats_dir, const char *timestamp)
+ramulator_wrapper_print_stats(RamulatorWrapper *w, const char *stats_dir,
+                              const char *timestamp)
 {
-    ramulator_wrapper_obj->print_stats(stats_dir, timestamp);
+    to_obj(w)->print_stats(stats_dir, timestamp);
 }
 
 #ifdef __cplusplus
@@ -32,15 +32,26 @@
 #include "../riscv_sim_typedefs.h"
 #include "memory_controller_utils.h"
 
+/* Opaque handle to one Ramulator instance */
+typedef struct RamulatorWrapper RamulatorWrapper;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
-void ramulator_wrapper_init(const char *config_file, int cache_line_size);
-void ramulator_wrapper_destroy();
-void ramulator_wrapper_finish();
-void ramulator_wrapper_print_stats(const char* stats_dir, const char* timestamp);
-int ramulator_wrapper_add_transaction(target_ulong addr, int isWrite);
-int ramulator_wrapper_get_max_clock_cycles(PendingMemAccessEntry *e);
+RamulatorWrapper *ramulator_wrapper_init(const char *config_file,
+                                         int cache_line_size);
+void ramulator_wrapper_destroy(RamulatorWrapper **w);
+void ramulator_wrapper_finish(RamulatorWrapper *w);
+void ramulator_wrapper_print_stats(RamulatorWrapper *w, const char *stats_dir,
+                                   const char *timestamp);
+int ramulator_wrapper_add_transaction(RamulatorWrapper *w, target_ulong addr,
+                                      int isWrite);
+void ramulator_wrapper_send_request(RamulatorWrapper *w, uint64_t req_id,
+                                    PendingMemAccessEntry *e);
+void ramulator_wrapper_tick(RamulatorWrapper *w);
+int ramulator_wrapper_get_completed_request(RamulatorWrapper *w,
+                                            uint64_t *req_id);
+void ramulator_wrapper_reset(RamulatorWrapper *w);
 
 #ifdef __cplusplus
 }
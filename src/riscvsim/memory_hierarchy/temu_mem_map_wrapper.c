@@ -27,9 +27,16 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  * THE SOFTWARE.
  */
+#include <pthread.h>
+
 #include "temu_mem_map_wrapper.h"
 #include "../../riscv_cpu_priv.h"
 
+/* With parallel_sim, the cores run on their own host threads. Atomics are
+ * executed one at a time, and SC also fails if another core changed the
+ * value read by LR. */
+static pthread_mutex_t atomic_insn_lock = PTHREAD_MUTEX_INITIALIZER;
+
 #define MEMORY_OP_A(size)                                                      \
     {                                                                          \
         uint##size##_t rval;                                                   \
@@ -42,17 +49,20 @@
                     goto mmu_exception;                                        \
                 val = (int##size##_t)rval;                                     \
                 s->load_res = e->ins.mem_addr;                                 \
+                s->load_res_val = val;                                         \
                 break;                                                         \
             case 3: /* sc.w */                                                 \
+                val = 1;                                                       \
                 if (s->load_res == addr)                                       \
                 {                                                              \
-                    if (target_write_u##size(s, addr, e->ins.rs2_val))         \
+                    if (target_read_u##size(s, &rval, addr))                   \
                         goto mmu_exception;                                    \
-                    val = 0;                                                   \
-                }                                                              \
-                else                                                           \
-                {                                                              \
-                    val = 1;                                                   \
+                    if ((int##size##_t)rval == (int##size##_t)s->load_res_val) \
+                    {                                                          \
+                        if (target_write_u##size(s, addr, e->ins.rs2_val))     \
+                            goto mmu_exception;                                \
+                        val = 0;                                               \
+                    }                                                          \
                 }                                                              \
                 break;                                                         \
             case 1:    /* amiswap.w */                                         \
@@ -116,6 +126,7 @@ temu_exec_atomic_insn(RISCVCPUState *s, InstructionLatch *e)
 {
     target_ulong val = 0, val2 = 0;
 
+    pthread_mutex_lock(&atomic_insn_lock);
     switch (e->ins.funct3)
     {
         case 2:
@@ -127,12 +138,59 @@ temu_exec_atomic_insn(RISCVCPUState *s, InstructionLatch *e)
             break;
 #endif
     }
+    pthread_mutex_unlock(&atomic_insn_lock);
     e->ins.buffer = val;
     return 0;
 mmu_exception:
+    pthread_mutex_unlock(&atomic_insn_lock);
     return -1;
 }
 
+static PIMCommand
+get_aim_command(int ins_type)
+{
+    switch (ins_type)
+    {
+        case INS_TYPE_AIM_MAC_SBK:
+            return PIM_CMD_MAC_SBK;
+        case INS_TYPE_AIM_AF_SBK:
+            return PIM_CMD_AF_SBK;
+        case INS_TYPE_AIM_COPY_BKGB:
+            return PIM_CMD_COPY_BKGB;
+        case INS_TYPE_AIM_COPY_GBBK:
+            return PIM_CMD_COPY_GBBK;
+        case INS_TYPE_AIM_MAC_4BK_INTRA_BG:
+            return PIM_CMD_MAC_4BK;
+        case INS_TYPE_AIM_AF_4BK_INTRA_BG:
+            return PIM_CMD_AF_4BK;
+        case INS_TYPE_AIM_EWMUL:
+            return PIM_CMD_EWMUL;
+        case INS_TYPE_AIM_EWADD:
+            return PIM_CMD_EWADD;
+        case INS_TYPE_AIM_MAC_ABK:
+            return PIM_CMD_MAC_ABK;
+        case INS_TYPE_AIM_AF_ABK:
+            return PIM_CMD_AF_ABK;
+        case INS_TYPE_AIM_WR_AFLUT:
+            return PIM_CMD_WR_AFLUT;
+        case INS_TYPE_AIM_WR_BK:
+            return PIM_CMD_WR_BK;
+        case INS_TYPE_AIM_WR_GB:
+            return PIM_CMD_WR_GB;
+        case INS_TYPE_AIM_WR_MAC:
+            return PIM_CMD_WR_MAC;
+        case INS_TYPE_AIM_WR_BIAS:
+            return PIM_CMD_WR_BIAS;
+        case INS_TYPE_AIM_RD_MAC:
+            return PIM_CMD_RD_MAC;
+        case INS_TYPE_AIM_RD_AF:
+            return PIM_CMD_RD_AF;
+    }
+    sim_assert(0, "error: %s at line %d in %s(): %s", __FILE__, __LINE__,
+               __func__, "unknown AiM instruction type");
+    return PIM_CMD_COUNT;
+}
+
 static int
 temu_exec_load_store_insn(RISCVCPUState *s, InstructionLatch *e)
 {
@@ -145,109 +203,14 @@ temu_exec_load_store_insn(RISCVCPUState *s, InstructionLatch *e)
     // AiM
     if (e->ins.is_aim)
     {
-        if (e->ins.is_store)
-        {
-            switch (e->ins.bytes_to_rw)
-            {
-                case 1:
-                {
-                    if (target_write_u8(s, addr, e->ins.rs2_val))
-                        goto mmu_exception;
-                    break;
-                }
-                case 2:
-                {
-                    if (target_write_u16(s, addr, e->ins.rs2_val))
-                        goto mmu_exception;
-                    break;
-                }
-                case 4:
-                {
-                    if (target_write_u32(s, addr, e->ins.rs2_val))
-                        goto mmu_exception;
-                    break;
-                }
-                case 8:
-                {
-                    if (target_write_u64(s, addr, e->ins.rs2_val))
-                        goto mmu_exception;
-                    break;
-                }
-                case 32:
-                {
-                    if (target_write_u64(s, addr, e->ins.rs2_val))
-                        goto mmu_exception;
-                    break;
-                }
-            }
-        }
-        else if (e->ins.is_load)
+        uint64_t rval = 0;
+
+        if (target_aim_command(s, addr, get_aim_command(e->ins.type),
+                               e->ins.rs2_val, &rval))
+            goto mmu_exception;
+        if (e->ins.is_load)
         {
-            
-            switch (e->ins.bytes_to_rw)
-            {
-                case 1:
-                {
-                    uint8_t rval;
-                    if (target_read_u8(s, &rval, addr))
-                        goto mmu_exception;
-                    if (e->ins.is_unsigned)
-                    {
-                        e->ins.buffer = rval;
-                    }
-                    else
-                    {
-                        e->ins.buffer = (int8_t)rval;
-                    }
-                    break;
-                }
-                case 2:
-                {
-                    uint16_t rval;
-                    if (target_read_u16(s, &rval, addr))
-                        goto mmu_exception;
-                    if (e->ins.is_unsigned)
-                    {
-                        e->ins.buffer = rval;
-                    }
-                    else
-                    {
-                        e->ins.buffer = (int16_t)rval;
-                    }
-                    break;
-                }
-                case 4:
-                {
-                    uint32_t rval;
-                    if (target_read_u32(s, &rval, addr))
-                        goto mmu_exception;
-                    rval = 0; // AiM: Dummy read
-                    if (e->ins.is_unsigned)
-                    {
-                        e->ins.buffer = rval;
-                    }
-                    else
-                    {
-                        e->ins.buffer = (int32_t)rval;
-                    }
-                    break;
-                }
-                case 8:
-                {
-                    uint64_t rval;
-                    if (target_read_u64(s, &rval, addr))
-                        goto mmu_exception;
-                    if (e->ins.is_unsigned)
-                    {
-                        e->ins.buffer = rval;
-                    }
-                    else
-                    {
-                        e->ins.buffer = (int64_t)rval;
-                    }
-                    break;
-                }
-            }
+            e->ins.buffer = rval;
         }
     }
     else
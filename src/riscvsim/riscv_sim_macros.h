@@ -99,12 +99,6 @@
 
 #define RISCV_INS_STR_MAX_LENGTH 64
 
-/* NOTE: Max size of instruction latch pool, must always be greater than ROB
- * size */
-#define INSN_LATCH_POOL_SIZE 128
-#define INSN_LATCH_FREE 0x0
-#define INSN_LATCH_ALLOCATED 0x1
-
 /* Used to check pipeline drain status in case of exception inside simulator */
 #define PIPELINE_NOT_DRAINED 0
 #define PIPELINE_DRAINED 1
@@ -163,8 +157,9 @@
 #define BPU_MISS 0x0
 #define BPU_HIT 0x1
 
-#define SET_BIT(x, bit) ((x) |= (1LL << (bit)))
+#define SET_BIT(x, bit) ((x) |= (1ULL << (bit)))
 #define GET_BIT(x, bit) (((x) >> (bit)) & 1)
+#define CLEAR_BIT(x, bit) ((x) &= ~(1ULL << (bit)))
 #define BITMASK(x) ((1LL << (x))- 1LL)
 #define GET_NUM_BITS(x) ceil(log2((x)))
 
@@ -202,4 +197,10 @@
 #define EVICT_POLICY_RANDOM 0x0
 #define EVICT_POLICY_BIT_PLRU 0x1
 
+/* Cache prefetchers */
+#define PREFETCHER_NONE 0x0
+#define PREFETCHER_NEXT_LINE 0x1
+#define PREFETCHER_STRIDE 0x2
+#define PREFETCHER_STREAM 0x3
+
 #endif
@@ -29,6 +29,7 @@
  */
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "../../cutils.h"
 #include "../riscv_sim_macros.h"
@@ -56,65 +57,142 @@ cpu_stage_flush_pipe(CPUStage *stage, int num_stages)
 
 void
 cpu_stage_flush_free_insn_latch(CPUStage *stage,
-                                InstructionLatch *insn_latch_pool)
+                                InsnLatchPool *insn_latch_pool)
 {
     if (stage->insn_latch_index != -1)
     {
-        insn_latch_pool[stage->insn_latch_index].status = INSN_LATCH_FREE;
+        insn_latch_free(insn_latch_pool,
+                        get_insn_latch(insn_latch_pool, stage->insn_latch_index));
     }
     cpu_stage_flush(stage);
 }
 
-static int
-get_free_insn_latch(const InstructionLatch *insn_latch_pool)
+InsnLatchPool *
+insn_latch_pool_init(int size)
 {
-    int i;
+    InsnLatchPool *p;
 
-    for (i = 0; i < INSN_LATCH_POOL_SIZE; ++i)
-    {
-        if (insn_latch_pool[i].status == INSN_LATCH_FREE)
-        {
-            return i;
-        }
-    }
+    p = (InsnLatchPool *)calloc(1, sizeof(InsnLatchPool));
+    assert(p);
+
+    p->size = size;
+    p->num_words = (size + 63) / 64;
+    p->latches = (InstructionLatch *)calloc(size, sizeof(InstructionLatch));
+    assert(p->latches);
+    p->ins_str = calloc(size, RISCV_INS_STR_MAX_LENGTH);
+    assert(p->ins_str);
+    p->free_map = (uint64_t *)calloc(p->num_words, sizeof(uint64_t));
+    assert(p->free_map);
+
+    reset_insn_latch_pool(p);
+    return p;
+}
 
-    return -1;
+void
+insn_latch_pool_free(InsnLatchPool **p)
+{
+    free((*p)->latches);
+    free((*p)->ins_str);
+    free((*p)->free_map);
+    free(*p);
+    *p = NULL;
 }
 
 void
-reset_insn_latch_pool(InstructionLatch *insn_latch_pool)
+reset_insn_latch_pool(InsnLatchPool *p)
 {
     int i;
 
     /* Add all the latches back to latch pool */
-    for (i = 0; i < INSN_LATCH_POOL_SIZE; ++i)
+    for (i = 0; i < p->num_words; ++i)
     {
-        insn_latch_pool[i].status = INSN_LATCH_FREE;
+        p->free_map[i] = ~0ULL;
     }
+    if (p->size % 64)
+    {
+        p->free_map[p->num_words - 1] = (1ULL << (p->size % 64)) - 1;
+    }
+    p->first_free_word = 0;
 }
 
 InstructionLatch *
-insn_latch_allocate(InstructionLatch *insn_latch_pool)
+insn_latch_allocate(InsnLatchPool *p)
 {
     InstructionLatch *e;
-    int insn_latch_index;
+    int i, insn_latch_index;
 
-    insn_latch_index = get_free_insn_latch(insn_latch_pool);
+    for (i = p->first_free_word; i < p->num_words; ++i)
+    {
+        if (p->free_map[i])
+        {
+            break;
+        }
+    }
 
     sim_assert(
-        (insn_latch_index != -1), "error: %s at line %d in %s(): %s", __FILE__,
+        (i < p->num_words), "error: %s at line %d in %s(): %s", __FILE__,
         __LINE__, __func__,
         "failed to allocate instruction latch from instruction latch pool");
 
-    e = &insn_latch_pool[insn_latch_index];
-    memset((void *)e, 0, sizeof(InstructionLatch));
-    e->status = INSN_LATCH_ALLOCATED;
+    insn_latch_index = i * 64 + __builtin_ctzll(p->free_map[i]);
+    p->free_map[i] &= p->free_map[i] - 1;
+    p->first_free_word = i;
+
+    /* Only the fields which the stages read before writing them are reset.
+     * The decoded instruction is cleared by the decode stage on a decode
+     * cache miss, and copied over on a hit. */
+    e = &p->latches[insn_latch_index];
     e->insn_latch_index = insn_latch_index;
+    e->is_decoded = FALSE;
+    e->ins_guest_paddr = 0;
+    e->data_guest_paddr = 0;
+    e->has_data_guest_paddr = FALSE;
+    e->max_clock_cycles = 0;
+    e->elapsed_clock_cycles = 0;
+    e->cache_lookup_complete_signal_sent = FALSE;
+    e->data_fwd_done = FALSE;
+    e->read_rs1 = FALSE;
+    e->read_rs2 = FALSE;
+    e->read_rs3 = FALSE;
+    e->keep_dest_busy = FALSE;
+    e->renamed = FALSE;
+    e->rob_idx = 0;
+    e->iq_idx = 0;
+    e->lsq_idx = 0;
+    e->branch_processed = FALSE;
+    e->mispredict = FALSE;
+    e->is_branch_taken = FALSE;
+    e->is_pred_correct = FALSE;
+    e->branch_target = 0;
+    e->predicted_target = 0;
+    memset((void *)&e->bpu_resp_pkt, 0, sizeof(BPUResponsePkt));
+    e->ins_dispatch_id = 0;
+
+    /* Instruction fields set or read by fetch */
+    e->ins.binary = 0;
+    e->ins.exception = FALSE;
+    e->ins.exception_cause = 0;
+    e->ins.str = p->ins_str[insn_latch_index];
     return e;
 }
 
-InstructionLatch *
-get_insn_latch(InstructionLatch *insn_latch_pool, int index)
+/* Freeing a latch which is already free is allowed, as the latches are freed
+ * from the stages without tracking which of them were freed before */
+void
+insn_latch_free(InsnLatchPool *p, const InstructionLatch *e)
+{
+    int i = e->insn_latch_index / 64;
+
+    p->free_map[i] |= 1ULL << (e->insn_latch_index % 64);
+    if (i < p->first_free_word)
+    {
+        p->first_free_word = i;
+    }
+}
+
+/* Mark a latch as allocated again after reset_insn_latch_pool() */
+void
+insn_latch_reserve(InsnLatchPool *p, const InstructionLatch *e)
 {
-    return (&insn_latch_pool[index]);
-}
\ No newline at end of file
+    p->free_map[e->insn_latch_index / 64] &= ~(1ULL << (e->insn_latch_index % 64));
+}
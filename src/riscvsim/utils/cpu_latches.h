@@ -37,12 +37,16 @@
  * complete information concerning it. This information is updated as the
  * instruction passes through the pipeline. This information includes status
  * flags, PC, decoded fields, latency in CPU cycles, operands values, the result
- * produced, memory address, branch status, exception status, etc. */
+ * produced, memory address, branch status, exception status, etc. Latches are
+ * not cleared on allocation, so new fields must be reset in
+ * insn_latch_allocate() if they are read before being written. */
 typedef struct InstructionLatch
 {
-    int status;
     int insn_latch_index;
     int is_decoded;
+    target_ulong ins_guest_paddr; /* Set by fetch, used to probe decode cache */
+    target_ulong data_guest_paddr; /* Set by memory stage, for RAM and PIM */
+    int has_data_guest_paddr; /* data_guest_paddr is valid */
     struct RVInstruction ins;
     int max_clock_cycles;
     int elapsed_clock_cycles;
@@ -77,13 +81,35 @@ typedef struct CPUStage
     int insn_latch_index;
 } CPUStage;
 
+/* Simulator maintains a pool of instruction latches. Free latches are tracked
+ * in a bitmap, searched from the first word which can have a free latch, so
+ * allocating and freeing a latch does not scan the latches. The instruction
+ * strings are kept in a side table and only written when tracing. */
+typedef struct InsnLatchPool
+{
+    InstructionLatch *latches;
+    char (*ins_str)[RISCV_INS_STR_MAX_LENGTH];
+    uint64_t *free_map; /* Bit set for a free latch */
+    int num_words;
+    int first_free_word;
+    int size;
+} InsnLatchPool;
+
 void cpu_stage_flush(CPUStage *stage);
 void cpu_stage_flush_pipe(CPUStage *stage, int num_stages);
 void cpu_stage_flush_free_insn_latch(CPUStage *stage,
-                                     InstructionLatch *insn_latch_pool);
+                                     InsnLatchPool *insn_latch_pool);
 
-InstructionLatch *insn_latch_allocate(InstructionLatch *insn_latch_pool);
-InstructionLatch *get_insn_latch(InstructionLatch *insn_latch_pool,
-                                 int index);
-void reset_insn_latch_pool(InstructionLatch *e);
+InsnLatchPool *insn_latch_pool_init(int size);
+void insn_latch_pool_free(InsnLatchPool **p);
+InstructionLatch *insn_latch_allocate(InsnLatchPool *p);
+void insn_latch_free(InsnLatchPool *p, const InstructionLatch *e);
+void insn_latch_reserve(InsnLatchPool *p, const InstructionLatch *e);
+void reset_insn_latch_pool(InsnLatchPool *p);
+
+static inline InstructionLatch *
+get_insn_latch(InsnLatchPool *p, int index)
+{
+    return &p->latches[index];
+}
 #endif
@@ -0,0 +1,253 @@
+/**
+ * Epoch Statistics
+ *
+ * MARSS-RISCV : Micro-Architectural System Simulator for RISC-V
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_epoch.h"
+#include "sim_log.h"
+
+/* The records are written through a large buffer, an epoch record being about
+ * 4 KB */
+#define SIM_EPOCH_BUF_SIZE (1 << 20)
+
+#define EPOCH_STAT(fp, d, attr)                                                \
+    do                                                                         \
+    {                                                                          \
+        fprintf(fp, ",\"%s\":%lu", #attr, (d)->attr);                          \
+    } while (0)
+
+#define EPOCH_STAT_ARRAY(fp, d, attr, n)                                       \
+    do                                                                         \
+    {                                                                          \
+        print_array(fp, #attr, (d)->attr, n);                                  \
+    } while (0)
+
+static void
+print_array(FILE *fp, const char *name, const uint64_t *a, int n)
+{
+    int i;
+
+    fprintf(fp, ",\"%s\":[", name);
+    for (i = 0; i < n; ++i)
+    {
+        fprintf(fp, "%s%lu", i ? "," : "", a[i]);
+    }
+    fprintf(fp, "]");
+}
+
+static void
+print_stats(FILE *fp, const SimStats *d)
+{
+    fprintf(fp, "\"cycles\":%lu", d->cycles);
+    EPOCH_STAT(fp, d, insn_mem_delay);
+    EPOCH_STAT(fp, d, data_mem_delay);
+    EPOCH_STAT(fp, d, pim_mem_delay);
+    EPOCH_STAT(fp, d, exec_unit_delay);
+
+    EPOCH_STAT(fp, d, ins_fetch);
+    EPOCH_STAT(fp, d, ins_simulated);
+    EPOCH_STAT(fp, d, ins_emulated);
+    EPOCH_STAT_ARRAY(fp, d, ins_type, NUM_MAX_INS_TYPES);
+    EPOCH_STAT(fp, d, ins_cond_branch_taken);
+
+    EPOCH_STAT(fp, d, decode_cache_hits);
+    EPOCH_STAT(fp, d, decode_cache_misses);
+
+    EPOCH_STAT(fp, d, csr_reads);
+    EPOCH_STAT(fp, d, csr_writes);
+    EPOCH_STAT(fp, d, fp_regfile_reads);
+    EPOCH_STAT(fp, d, fp_regfile_writes);
+    EPOCH_STAT(fp, d, int_regfile_reads);
+    EPOCH_STAT(fp, d, int_regfile_writes);
+
+    EPOCH_STAT_ARRAY(fp, d, fu_access, NUM_MAX_FU);
+
+    EPOCH_STAT(fp, d, btb_probes);
+    EPOCH_STAT(fp, d, btb_hits);
+    EPOCH_STAT(fp, d, btb_updates);
+    EPOCH_STAT(fp, d, btb_inserts);
+    EPOCH_STAT(fp, d, bpu_cond_correct);
+    EPOCH_STAT(fp, d, bpu_cond_incorrect);
+    EPOCH_STAT(fp, d, bpu_uncond_correct);
+    EPOCH_STAT(fp, d, bpu_uncond_incorrect);
+
+    EPOCH_STAT(fp, d, code_tlb_lookups);
+    EPOCH_STAT(fp, d, code_tlb_hits);
+    EPOCH_STAT(fp, d, load_tlb_lookups);
+    EPOCH_STAT(fp, d, load_tlb_hits);
+    EPOCH_STAT(fp, d, store_tlb_lookups);
+    EPOCH_STAT(fp, d, store_tlb_hits);
+    EPOCH_STAT(fp, d, ins_page_walks);
+    EPOCH_STAT(fp, d, load_page_walks);
+    EPOCH_STAT(fp, d, store_page_walks);
+
+    EPOCH_STAT(fp, d, icache_read);
+    EPOCH_STAT(fp, d, icache_read_miss);
+    EPOCH_STAT(fp, d, dcache_read);
+    EPOCH_STAT(fp, d, dcache_write);
+    EPOCH_STAT(fp, d, dcache_read_miss);
+    EPOCH_STAT(fp, d, dcache_write_miss);
+    EPOCH_STAT(fp, d, l2_cache_read);
+    EPOCH_STAT(fp, d, l2_cache_write);
+    EPOCH_STAT(fp, d, l2_cache_read_miss);
+    EPOCH_STAT(fp, d, l2_cache_write_miss);
+
+    EPOCH_STAT(fp, d, icache_mshr_allocs);
+    EPOCH_STAT(fp, d, icache_mshr_merges);
+    EPOCH_STAT(fp, d, icache_mshr_full);
+    EPOCH_STAT(fp, d, icache_mshr_occupancy);
+    EPOCH_STAT(fp, d, dcache_mshr_allocs);
+    EPOCH_STAT(fp, d, dcache_mshr_merges);
+    EPOCH_STAT(fp, d, dcache_mshr_full);
+    EPOCH_STAT(fp, d, dcache_mshr_occupancy);
+    EPOCH_STAT(fp, d, l2_cache_mshr_allocs);
+    EPOCH_STAT(fp, d, l2_cache_mshr_merges);
+    EPOCH_STAT(fp, d, l2_cache_mshr_full);
+    EPOCH_STAT(fp, d, l2_cache_mshr_occupancy);
+
+    EPOCH_STAT(fp, d, dcache_pf_issued);
+    EPOCH_STAT(fp, d, dcache_pf_useful);
+    EPOCH_STAT(fp, d, dcache_pf_late);
+    EPOCH_STAT(fp, d, dcache_pf_useless);
+    EPOCH_STAT(fp, d, l2_cache_pf_issued);
+    EPOCH_STAT(fp, d, l2_cache_pf_useful);
+    EPOCH_STAT(fp, d, l2_cache_pf_late);
+    EPOCH_STAT(fp, d, l2_cache_pf_useless);
+
+    EPOCH_STAT_ARRAY(fp, d, interrupts, 24);
+    EPOCH_STAT_ARRAY(fp, d, exceptions, 24);
+    EPOCH_STAT(fp, d, pipeline_flush);
+}
+
+static void
+print_record(SimEpoch *e, const SimStats *stats, const MemBackendStats *mem,
+             uint64_t clock, uint64_t icount)
+{
+    int i;
+    SimStats total, delta;
+
+    sim_stats_get_total(&total, stats);
+    memset((void *)&delta, 0, sizeof(SimStats));
+    sim_stats_add_delta(&delta, &total, &e->start_stats);
+
+    fprintf(e->fp,
+            "{\"epoch\":%lu,\"start_cycle\":%lu,\"end_cycle\":%lu,"
+            "\"start_icount\":%lu,\"end_icount\":%lu,\"stats\":{",
+            e->num_epochs, e->start_cycle, clock, e->start_icount, icount);
+    print_stats(e->fp, &delta);
+    fprintf(e->fp, "},\"mem_backend\":[");
+    for (i = 0; i < e->num_backends; ++i)
+    {
+        fprintf(e->fp, "%s{\"reads\":%lu,\"writes\":%lu,\"aim_cmds\":%lu}",
+                i ? "," : "", mem[i].reads - e->start_mem[i].reads,
+                mem[i].writes - e->start_mem[i].writes,
+                mem[i].aim_cmds - e->start_mem[i].aim_cmds);
+    }
+    fprintf(e->fp, "]}\n");
+}
+
+static void
+begin_epoch(SimEpoch *e, const SimStats *stats, const MemBackendStats *mem,
+            uint64_t clock, uint64_t icount)
+{
+    e->start_cycle = clock;
+    e->start_icount = icount;
+    sim_stats_get_total(&e->start_stats, stats);
+    memcpy(e->start_mem, mem, e->num_backends * sizeof(MemBackendStats));
+    e->next_end
+        = ((e->unit == SIM_EPOCH_CYCLES) ? clock : icount) + e->length;
+}
+
+SimEpoch *
+sim_epoch_init(const SimParams *p)
+{
+    SimEpoch *e;
+
+    e = (SimEpoch *)calloc(1, sizeof(SimEpoch));
+    assert(e);
+
+    e->unit = p->sim_epoch_unit;
+    e->length = p->sim_epoch_length;
+    e->buf = (char *)malloc(SIM_EPOCH_BUF_SIZE);
+    assert(e->buf);
+    return e;
+}
+
+void
+sim_epoch_free(SimEpoch **e)
+{
+    if ((*e)->fp)
+    {
+        fclose((*e)->fp);
+    }
+    free((*e)->buf);
+    free(*e);
+    *e = NULL;
+}
+
+/* sim_epoch_start()
+ * @details
+ * Opens filename and starts the first epoch, called when simulation starts
+ * with the current counters.
+ */
+void
+sim_epoch_start(SimEpoch *e, const char *filename, const SimStats *stats,
+                const MemBackendStats *mem, int num_backends, uint64_t clock,
+                uint64_t icount)
+{
+    e->fp = fopen(filename, "w");
+    sim_assert((e->fp), "error: %s at line %d in %s(): %s", __FILE__,
+               __LINE__, __func__, "cannot open the epoch stats file");
+    setvbuf(e->fp, e->buf, _IOFBF, SIM_EPOCH_BUF_SIZE);
+
+    e->num_epochs = 0;
+    e->num_backends = num_backends;
+    begin_epoch(e, stats, mem, clock, icount);
+}
+
+/* Appends the record of the current epoch, and starts the next one */
+void
+sim_epoch_end(SimEpoch *e, const SimStats *stats, const MemBackendStats *mem,
+              uint64_t clock, uint64_t icount)
+{
+    print_record(e, stats, mem, clock, icount);
+    ++e->num_epochs;
+    begin_epoch(e, stats, mem, clock, icount);
+}
+
+/* The last epoch is recorded if it is not empty, then the file is closed */
+void
+sim_epoch_stop(SimEpoch *e, const SimStats *stats, const MemBackendStats *mem,
+               uint64_t clock, uint64_t icount)
+{
+    if ((clock != e->start_cycle) || (icount != e->start_icount))
+    {
+        print_record(e, stats, mem, clock, icount);
+        ++e->num_epochs;
+    }
+
+    fclose(e->fp);
+    e->fp = NULL;
+}
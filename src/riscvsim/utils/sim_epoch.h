@@ -0,0 +1,84 @@
+/**
+ * Epoch Statistics
+ *
+ * During simulation, every sim_epoch_length cycles or committed instructions,
+ * the change of every performance counter since the previous epoch is
+ * appended to the epoch file as one JSON object per line:
+ *
+ *   {"epoch":0,"start_cycle":0,"end_cycle":100000,"start_icount":0,
+ *    "end_icount":61234,"stats":{"cycles":100000,...,"ins_type":[...],...},
+ *    "mem_backend":[{"reads":..,"writes":..,"aim_cmds":..},...]}
+ *
+ * stats holds the SimStats counters, including the cache counters, summed
+ * over all the privilege levels. mem_backend holds the requests sent to the
+ * host DRAM back end, then to the PIM back end if there is one. Epochs end on
+ * the first commit past their boundary, so that a long stall ends up in one
+ * longer epoch, and the last one is cut short when simulation stops.
+ *
+ * MARSS-RISCV : Micro-Architectural System Simulator for RISC-V
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _SIM_EPOCH_H_
+#define _SIM_EPOCH_H_
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "sim_params.h"
+#include "sim_stats.h"
+
+typedef struct SimEpoch
+{
+    int unit;
+    uint64_t length;
+
+    FILE *fp;
+    char *buf;
+
+    uint64_t num_epochs;
+    uint64_t next_end;
+
+    /* Counters at the start of the current epoch */
+    uint64_t start_cycle;
+    uint64_t start_icount;
+    SimStats start_stats;
+    int num_backends;
+    MemBackendStats start_mem[NUM_MAX_MEM_BACKENDS];
+} SimEpoch;
+
+SimEpoch *sim_epoch_init(const SimParams *p);
+void sim_epoch_free(SimEpoch **e);
+void sim_epoch_start(SimEpoch *e, const char *filename, const SimStats *stats,
+                     const MemBackendStats *mem, int num_backends,
+                     uint64_t clock, uint64_t icount);
+void sim_epoch_end(SimEpoch *e, const SimStats *stats,
+                   const MemBackendStats *mem, uint64_t clock,
+                   uint64_t icount);
+void sim_epoch_stop(SimEpoch *e, const SimStats *stats,
+                    const MemBackendStats *mem, uint64_t clock,
+                    uint64_t icount);
+
+/* Returns TRUE when the current epoch is over */
+static inline int
+sim_epoch_done(const SimEpoch *e, uint64_t clock, uint64_t icount)
+{
+    return ((e->unit == SIM_EPOCH_CYCLES) ? clock : icount) >= e->next_end;
+}
+#endif
@@ -44,8 +44,12 @@ sim_exception_set(SimException *s, const InstructionLatch *e)
         {
             s->pc = e->ins.pc;
             s->insn = e->ins.binary;
-            strncpy(s->insn_str, e->ins.str, RISCV_INS_STR_MAX_LENGTH);
-            s->insn_str[RISCV_INS_STR_MAX_LENGTH - 1] = '\0';
+            s->insn_str[0] = '\0';
+            if (e->ins.create_str)
+            {
+                strncpy(s->insn_str, e->ins.str, RISCV_INS_STR_MAX_LENGTH);
+                s->insn_str[RISCV_INS_STR_MAX_LENGTH - 1] = '\0';
+            }
             break;
         }
 
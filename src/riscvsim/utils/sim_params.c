@@ -43,6 +43,7 @@ const char *core_type_str[] = {"in-order", "out-of-order"};
 const char *sim_param_status[] = {"false", "true"};
 const char *evict_policy_str[] = {"random", "bit-plru"};
 const char *cache_ra_str[] = {"true", "false"};
+const char *prefetcher_str[] = {"none", "next_line", "stride", "stream"};
 const char *cache_wa_str[] = {"true", "false"};
 const char *cache_wp_str[] = {"writeback", "writethrough"};
 const char *bpu_type_str[] = {"bimodal", "adaptive"};
@@ -50,6 +51,8 @@ const char *bpu_aliasing_func_type_str[] = {"xor", "and", "none"};
 // AiM
 const char *dram_model_type_str[] = {"base", "dramsim3", "ramulator", "aimulator"};
 const char *cpu_mode_str[] = {"user", "supervisor", "hypervisor", "machine"};
+const char *sim_trace_format_str[] = {"text", "binary"};
+const char *sim_epoch_unit_str[] = {"cycles", "insns"};
 
 void
 sim_params_log_options(const SimParams *p)
@@ -84,6 +87,8 @@ sim_params_log_options(const SimParams *p)
     if (p->do_sim_trace)
     {
         sim_log_param_to_file(sim_log, "%s", "-sim-trace");
+        sim_log_param_to_file(sim_log, "%s: %s", "-sim-trace-format",
+                              sim_trace_format_str[p->sim_trace_format]);
         sim_log_param_to_file(sim_log, "%s: %s", "-sim-trace-file",
                               p->sim_trace_file);
     }
@@ -104,10 +109,47 @@ sim_params_log_options(const SimParams *p)
                               p->sim_emulate_after_icount);
     }
 
+    if (p->sim_epoch_length)
+    {
+        sim_log_param_to_file(sim_log, "%s %s,%lu", "-sim-epoch",
+                              sim_epoch_unit_str[p->sim_epoch_unit],
+                              p->sim_epoch_length);
+    }
+
+    if (p->do_sim_profile)
+    {
+        sim_log_param_to_file(sim_log, "%s", "-sim-profile");
+    }
+
+    if (p->do_aim_trace)
+    {
+        sim_log_param_to_file(sim_log, "%s", "-sim-aim-trace");
+    }
+
+    if (p->sample_detail_icount)
+    {
+        sim_log_param_to_file(sim_log, "%s %lu,%lu,%lu", "-sim-sample",
+                              p->sample_ff_icount, p->sample_warmup_icount,
+                              p->sample_detail_icount);
+    }
+
     sim_log_param_to_file(sim_log, "%s: %s", "core_type",
                           core_type_str[p->core_type]);
     sim_log_param_to_file(sim_log, "%s: %lu MHz", "rtc_freq_mhz", p->rtc_freq_mhz);
     sim_log_param_to_file(sim_log, "%s: %lu MHz", "cpu_freq_mhz", p->cpu_freq_mhz);
+    sim_log_param_to_file(sim_log, "%s: %d", "insn_latch_pool_size",
+                          p->insn_latch_pool_size);
+    sim_log_param_to_file(sim_log, "%s: %d", "num_cores", p->num_cores);
+    if (p->num_cores > 1)
+    {
+        sim_log_param_to_file(sim_log, "%s: %s", "parallel_sim",
+                              sim_param_status[p->parallel_sim]);
+        if (p->parallel_sim)
+        {
+            sim_log_param_to_file(sim_log, "%s: %d", "sim_quantum_cycles",
+                                  p->sim_quantum_cycles);
+        }
+    }
     sim_log_param_to_file(sim_log, "%s: %s", "enable_bpu",
                           sim_param_status[p->enable_bpu]);
     if (p->enable_bpu)
@@ -123,6 +165,11 @@ sim_params_log_options(const SimParams *p)
                           sim_param_status[p->enable_l2_cache]);
     sim_log_param_to_file(sim_log, "%s: %s", "dram_model_type",
                           dram_model_type_str[p->dram_model_type]);
+    if (p->dram_model_type == MEM_MODEL_AIMULATOR)
+    {
+        sim_log_param_to_file(sim_log, "%s: %s", "host_dram_model_type",
+                              dram_model_type_str[p->host_dram_model_type]);
+    }
 }
 
 static void
@@ -152,7 +199,12 @@ sim_params_set_defaults(SimParams *p)
     p->start_in_sim = DEF_START_SIM;
     p->enable_stats_display = DEF_STATS_DISPLAY;
     p->create_ins_str = DEF_CREATE_INS_STR;
+    p->sim_trace_format = DEF_SIM_TRACE_FORMAT;
 
+    p->insn_latch_pool_size = DEF_INSN_LATCH_POOL_SIZE;
+    p->num_cores = DEF_NUM_CORES;
+    p->parallel_sim = DEF_PARALLEL_SIM;
+    p->sim_quantum_cycles = DEF_SIM_QUANTUM_CYCLES;
     p->num_cpu_stages = DEF_NUM_STAGES;
     p->enable_parallel_fu = DEF_ENABLE_PARALLEL_FU;
 
@@ -229,11 +281,16 @@ sim_params_set_defaults(SimParams *p)
     p->l1_code_cache_size = DEF_L1_CODE_CACHE_SIZE;
     p->l1_code_cache_ways = DEF_L1_CODE_CACHE_WAYS;
     p->l1_code_cache_evict = DEF_L1_CODE_CACHE_EVICT;
+    p->l1_code_cache_mshrs = DEF_L1_CODE_CACHE_MSHRS;
     p->l1_data_cache_read_latency = DEF_L1_DATA_CACHE_READ_LATENCY;
     p->l1_data_cache_write_latency = DEF_L1_DATA_CACHE_WRITE_LATENCY;
     p->l1_data_cache_size = DEF_L1_DATA_CACHE_SIZE;
     p->l1_data_cache_ways = DEF_L1_DATA_CACHE_WAYS;
     p->l1_data_cache_evict = DEF_L1_DATA_CACHE_EVICT;
+    p->l1_data_cache_mshrs = DEF_L1_DATA_CACHE_MSHRS;
+    p->l1_data_cache_prefetcher = DEF_L1_DATA_CACHE_PREFETCHER;
+    p->l1_data_cache_prefetch_degree = DEF_L1_DATA_CACHE_PREFETCH_DEGREE;
+    p->l1_data_cache_prefetch_distance = DEF_L1_DATA_CACHE_PREFETCH_DISTANCE;
 
     p->enable_l2_cache = DEF_ENABLE_L2_CACHE;
     p->l2_shared_cache_read_latency = DEF_L2_CACHE_READ_LATENCY;
@@ -241,6 +298,10 @@ sim_params_set_defaults(SimParams *p)
     p->l2_shared_cache_size = DEF_L2_CACHE_SIZE;
     p->l2_shared_cache_ways = DEF_L2_CACHE_WAYS;
     p->l2_shared_cache_evict = DEF_L2_CACHE_EVICT;
+    p->l2_shared_cache_mshrs = DEF_L2_CACHE_MSHRS;
+    p->l2_shared_cache_prefetcher = DEF_L2_CACHE_PREFETCHER;
+    p->l2_shared_cache_prefetch_degree = DEF_L2_CACHE_PREFETCH_DEGREE;
+    p->l2_shared_cache_prefetch_distance = DEF_L2_CACHE_PREFETCH_DISTANCE;
 
     p->cache_line_size = DEF_CACHE_LINE_SIZE;
     p->cache_read_allocate_policy = DEF_CACHE_READ_ALLOC_POLICY;
@@ -253,16 +314,22 @@ sim_params_set_defaults(SimParams *p)
     p->flush_sim_mem_on_simstart = DEF_FLUSH_SIM_MEM_ON_SIMSTART;
 
     p->mem_access_latency = DEF_MEM_ACCESS_LATENCY;
+    p->max_inflight_requests = DEF_MAX_INFLIGHT_REQUESTS;
 
     p->dramsim_config_file = strdup(DEF_DRAMSIM_CONFIG_FILE);
     assert(p->dramsim_config_file);
+    p->dramsim_clock_freq_mhz = DEF_DRAM_CLOCK_FREQ_MHZ;
 
     p->ramulator_config_file = strdup(DEF_RAMULATOR_CONFIG_FILE);
     assert(p->ramulator_config_file);
+    p->ramulator_clock_freq_mhz = DEF_DRAM_CLOCK_FREQ_MHZ;
 
     // AiM
     p->aimulator_config_file = strdup(DEF_AIMULATOR_CONFIG_FILE);
     assert(p->aimulator_config_file);
+    p->aimulator_clock_freq_mhz = DEF_DRAM_CLOCK_FREQ_MHZ;
+    p->aim_batch_size = DEF_AIM_BATCH_SIZE;
+    p->host_dram_model_type = DEF_HOST_MEM_MODEL;
 
     p->sim_emulate_after_icount = DEF_SIM_EMULATE_AFTER_ICOUNT;
     p->system_insn_latency = DEF_STAGE_LATENCY;
@@ -297,6 +364,28 @@ validate_param(const char *param_name, int has_range, int min, int max,
     }
 }
 
+/* The fills of a prefetcher are tracked by the MSHRs of its cache */
+static void
+validate_prefetcher(const char *cache_name, int prefetcher, int degree,
+                    int distance, int mshrs)
+{
+    char buf[256];
+
+    snprintf(buf, sizeof(buf), "%s_prefetcher", cache_name);
+    validate_param(buf, 1, PREFETCHER_NONE, PREFETCHER_STREAM, prefetcher);
+
+    if (prefetcher != PREFETCHER_NONE)
+    {
+        snprintf(buf, sizeof(buf), "%s_prefetch_degree", cache_name);
+        validate_param(buf, 1, 1, MAX_PREFETCH_DEGREE, degree);
+        snprintf(buf, sizeof(buf), "%s_prefetch_distance", cache_name);
+        validate_param(buf, 1, 1, MAX_PREFETCH_DISTANCE, distance);
+        sim_assert((mshrs), "error: %s at line %d in %s(): error validating "
+                            "param - %s_prefetcher requires %s_mshrs",
+                   __FILE__, __LINE__, __func__, cache_name, cache_name);
+    }
+}
+
 static void
 validate_param_p2(const char *param_name, int val)
 {
@@ -314,6 +403,21 @@ sim_params_validate(SimParams *p)
 
     validate_param("start_in_sim", 1, 0, 1, p->start_in_sim);
     validate_param("enable_stats_display", 1, 0, 1, p->enable_stats_display);
+    validate_param("insn_latch_pool_size", 0, 1, 0, p->insn_latch_pool_size);
+    validate_param("num_cores", 1, 1, MAX_NUM_CORES, p->num_cores);
+    validate_param("parallel_sim", 1, 0, 1, p->parallel_sim);
+    validate_param("sim_quantum_cycles", 0, 1, 0, p->sim_quantum_cycles);
+
+    if (p->sample_detail_icount)
+    {
+        sim_assert((p->num_cores == 1), "error: %s at line %d in %s(): %s",
+                   __FILE__, __LINE__, __func__,
+                   "sampled simulation requires a single core");
+        sim_assert((!p->sim_emulate_after_icount),
+                   "error: %s at line %d in %s(): %s", __FILE__, __LINE__,
+                   __func__, "sampled simulation cannot be combined with "
+                             "sim_emulate_after_icount");
+    }
 
     if (strcmp(p->core_name, "incore") == 0)
     {
@@ -327,6 +431,12 @@ sim_params_validate(SimParams *p)
         validate_param("lsq_size", 0, 1, 2048, p->lsq_size);
     }
 
+    if (p->core_type == CORE_TYPE_OOCORE)
+    {
+        validate_param("insn_latch_pool_size", 0, p->rob_size + 1, 0,
+                       p->insn_latch_pool_size);
+    }
+
     validate_param("rtc_freq_mhz", 1, 1, 1000, p->rtc_freq_mhz);
 
     /* Validate FU config */
@@ -417,6 +527,8 @@ sim_params_validate(SimParams *p)
         validate_param("l1_code_cache_size", 0, 1, 2048, p->l1_code_cache_size);
         validate_param("l1_code_cache_ways", 0, 1, 2048, p->l1_code_cache_ways);
         validate_param("l1_code_cache_evict", 1, 0, 1, p->l1_code_cache_evict);
+        validate_param("l1_code_cache_mshrs", 1, 0, MAX_CACHE_MSHRS,
+                       p->l1_code_cache_mshrs);
 
         validate_param("l1_data_cache_read_latency", 0, 1, 2048,
                        p->l1_data_cache_read_latency);
@@ -425,6 +537,12 @@ sim_params_validate(SimParams *p)
         validate_param("l1_data_cache_size", 0, 1, 2048, p->l1_data_cache_size);
         validate_param("l1_data_cache_ways", 0, 1, 2048, p->l1_data_cache_ways);
         validate_param("l1_data_cache_evict", 1, 0, 1, p->l1_data_cache_evict);
+        validate_param("l1_data_cache_mshrs", 1, 0, MAX_CACHE_MSHRS,
+                       p->l1_data_cache_mshrs);
+        validate_prefetcher("l1_data_cache", p->l1_data_cache_prefetcher,
+                            p->l1_data_cache_prefetch_degree,
+                            p->l1_data_cache_prefetch_distance,
+                            p->l1_data_cache_mshrs);
 
         validate_param_p2("cache_line_size", p->cache_line_size);
         validate_param("cache_read_allocate_policy", 1, 0, 1,
@@ -447,18 +565,44 @@ sim_params_validate(SimParams *p)
                            p->l2_shared_cache_ways);
             validate_param("l2_shared_cache_evict", 1, 0, 1,
                            p->l2_shared_cache_evict);
+            validate_param("l2_shared_cache_mshrs", 1, 0, MAX_CACHE_MSHRS,
+                           p->l2_shared_cache_mshrs);
+            validate_prefetcher("l2_shared_cache",
+                                p->l2_shared_cache_prefetcher,
+                                p->l2_shared_cache_prefetch_degree,
+                                p->l2_shared_cache_prefetch_distance,
+                                p->l2_shared_cache_mshrs);
         }
     }
 
     validate_param("tlb_size", 0, 1, 2048, p->tlb_size);
     validate_param("burst_length", 0, 1, 2048, (int)p->burst_length);
     validate_param("mem_access_latency", 0, 1, 2048, p->mem_access_latency);
+    validate_param("max_inflight_requests", 0, 1, 2048,
+                   p->max_inflight_requests);
+    validate_param("aim_batch_size", 0, 1, 2048, p->aim_batch_size);
+    validate_param("dramsim_clock_freq_mhz", 0, 0, 100000,
+                   p->dramsim_clock_freq_mhz);
+    validate_param("ramulator_clock_freq_mhz", 0, 0, 100000,
+                   p->ramulator_clock_freq_mhz);
+    validate_param("aimulator_clock_freq_mhz", 0, 0, 100000,
+                   p->aimulator_clock_freq_mhz);
+
+    if (p->dram_model_type == MEM_MODEL_AIMULATOR)
+    {
+        sim_assert((p->host_dram_model_type != MEM_MODEL_AIMULATOR),
+                   "error: %s at line %d in %s(): %s", __FILE__, __LINE__,
+                   __func__,
+                   "host_mem_model must be one of base, dramsim3, ramulator");
+    }
 
     /* Create full trace file name */
     strcpy(trace_file_name, p->sim_file_path);
     strcat(trace_file_name, "/");
     strcat(trace_file_name, p->sim_file_prefix);
-    strcat(trace_file_name, ".trace");
+    strcat(trace_file_name, (p->sim_trace_format == SIM_TRACE_FORMAT_BINARY)
+                                ? ".btrace"
+                                : ".trace");
 
     free(p->sim_trace_file);
     p->sim_trace_file = strdup(trace_file_name);
@@ -510,6 +654,211 @@ log_default_param_str(const char *obj, const char *param, const char *val)
                   obj, obj, param, val);
 }
 
+/* Parse the prefetcher of the cache object obj, named obj_name */
+static void
+parse_prefetcher_params(JSONValue obj, const char *obj_name, int *prefetcher,
+                        int *degree, int *distance)
+{
+    int i;
+    const char *tag_name, *str;
+
+    tag_name = "prefetcher";
+    if (vm_get_str(obj, tag_name, &str) < 0)
+    {
+        log_default_param_str(obj_name, tag_name, prefetcher_str[*prefetcher]);
+    }
+    else
+    {
+        for (i = PREFETCHER_NONE; i <= PREFETCHER_STREAM; ++i)
+        {
+            if (strcmp(str, prefetcher_str[i]) == 0)
+            {
+                *prefetcher = i;
+                break;
+            }
+        }
+
+        if (i > PREFETCHER_STREAM)
+        {
+            sim_assert((0), "error: %s at line %d in %s(): error parsing "
+                            "param - %s->%s has invalid value",
+                       __FILE__, __LINE__, __func__, obj_name, tag_name);
+        }
+    }
+
+    tag_name = "prefetch_degree";
+    if (vm_get_int(obj, tag_name, degree) < 0)
+    {
+        log_default_param_int(obj_name, tag_name, *degree);
+    }
+
+    tag_name = "prefetch_distance";
+    if (vm_get_int(obj, tag_name, distance) < 0)
+    {
+        log_default_param_int(obj_name, tag_name, *distance);
+    }
+}
+
+/* Parse the section of the memory object for the given DRAM model */
+static void
+parse_dram_model_params(SimParams *p, JSONValue obj1, int dram_model_type)
+{
+    char buf1[256];
+    const char *tag_name, *str;
+    JSONValue obj;
+
+    switch (dram_model_type)
+    {
+        case MEM_MODEL_BASE:
+        {
+            snprintf(buf1, sizeof(buf1), "%s", "base_dram_model");
+            obj = json_object_get(obj1, buf1);
+
+            if (json_is_undefined(obj))
+            {
+                log_default_param_str(buf1, "", "");
+            }
+
+            tag_name = "mem_access_latency";
+            if (vm_get_int(obj, tag_name, &p->mem_access_latency) < 0)
+            {
+                log_default_param_int(buf1, tag_name, p->mem_access_latency);
+            }
+            break;
+        }
+        case MEM_MODEL_DRAMSIM:
+        {
+            snprintf(buf1, sizeof(buf1), "%s", "dramsim3");
+            obj = json_object_get(obj1, buf1);
+
+            if (json_is_undefined(obj))
+            {
+                log_default_param_str(buf1, "", "");
+            }
+
+            tag_name = "config_file";
+            if (vm_get_str(obj, tag_name, &str) < 0)
+            {
+                log_default_param_str(buf1, tag_name, p->dramsim_config_file);
+            }
+            else
+            {
+                free(p->dramsim_config_file);
+                p->dramsim_config_file = strdup(str);
+            }
+
+            tag_name = "clock_freq_mhz";
+            if (vm_get_int(obj, tag_name, &p->dramsim_clock_freq_mhz) < 0)
+            {
+                log_default_param_int(buf1, tag_name,
+                                      p->dramsim_clock_freq_mhz);
+            }
+            break;
+        }
+        case MEM_MODEL_RAMULATOR:
+        {
+            snprintf(buf1, sizeof(buf1), "%s", "ramulator");
+            obj = json_object_get(obj1, buf1);
+
+            if (json_is_undefined(obj))
+            {
+                log_default_param_str(buf1, "", "");
+            }
+
+            tag_name = "config_file";
+            if (vm_get_str(obj, tag_name, &str) < 0)
+            {
+                log_default_param_str(buf1, tag_name, p->ramulator_config_file);
+            }
+            else
+            {
+                free(p->ramulator_config_file);
+                p->ramulator_config_file = strdup(str);
+            }
+
+            tag_name = "clock_freq_mhz";
+            if (vm_get_int(obj, tag_name, &p->ramulator_clock_freq_mhz) < 0)
+            {
+                log_default_param_int(buf1, tag_name,
+                                      p->ramulator_clock_freq_mhz);
+            }
+            break;
+        }
+        // AiM
+        case MEM_MODEL_AIMULATOR:
+        {
+            snprintf(buf1, sizeof(buf1), "%s", "aimulator");
+            obj = json_object_get(obj1, buf1);
+
+            if (json_is_undefined(obj))
+            {
+                log_default_param_str(buf1, "", "");
+            }
+
+            tag_name = "config_file";
+            if (vm_get_str(obj, tag_name, &str) < 0)
+            {
+                log_default_param_str(buf1, tag_name, p->aimulator_config_file);
+            }
+            else
+            {
+                free(p->aimulator_config_file);
+                p->aimulator_config_file = strdup(str);
+            }
+
+            tag_name = "batch_size";
+            if (vm_get_int(obj, tag_name, &p->aim_batch_size) < 0)
+            {
+                log_default_param_int(buf1, tag_name, p->aim_batch_size);
+            }
+
+            tag_name = "clock_freq_mhz";
+            if (vm_get_int(obj, tag_name, &p->aimulator_clock_freq_mhz) < 0)
+            {
+                log_default_param_int(buf1, tag_name,
+                                      p->aimulator_clock_freq_mhz);
+            }
+
+            tag_name = "host_mem_model";
+            if (vm_get_str(obj, tag_name, &str) < 0)
+            {
+                log_default_param_str(
+                    buf1, tag_name,
+                    dram_model_type_str[p->host_dram_model_type]);
+            }
+            else
+            {
+                if (strcmp(str, "base") == 0)
+                {
+                    p->host_dram_model_type = MEM_MODEL_BASE;
+                }
+                else if (strcmp(str, "dramsim3") == 0)
+                {
+                    p->host_dram_model_type = MEM_MODEL_DRAMSIM;
+                }
+                else if (strcmp(str, "ramulator") == 0)
+                {
+                    p->host_dram_model_type = MEM_MODEL_RAMULATOR;
+                }
+                else
+                {
+                    sim_assert((0),
+                               "error: %s at line %d in %s(): error parsing "
+                               "param - %s->%s has invalid value",
+                               __FILE__, __LINE__, __func__, buf1, tag_name);
+                }
+            }
+            break;
+        }
+        default:
+        {
+            sim_assert((0),
+                       "error: %s at line %d in %s(): invalid memory model",
+                       __FILE__, __LINE__, __func__);
+        }
+    }
+}
+
 void
 sim_params_parse(SimParams *p, JSONValue cfg)
 {
@@ -567,6 +916,48 @@ sim_params_parse(SimParams *p, JSONValue cfg)
         log_default_param_int(buf1, tag_name, p->cpu_freq_mhz);
     }
 
+    tag_name = "insn_latch_pool_size";
+    if (vm_get_int(core_obj, tag_name, &p->insn_latch_pool_size) < 0)
+    {
+        log_default_param_int(buf1, tag_name, p->insn_latch_pool_size);
+    }
+
+    tag_name = "num_cores";
+    if (vm_get_int(core_obj, tag_name, &p->num_cores) < 0)
+    {
+        log_default_param_int(buf1, tag_name, p->num_cores);
+    }
+
+    tag_name = "parallel_sim";
+    if (vm_get_str(core_obj, tag_name, &str) < 0)
+    {
+        log_default_param_str(buf1, tag_name,
+                              sim_param_status[p->parallel_sim]);
+    }
+    else
+    {
+        if (strcmp(str, "false") == 0)
+        {
+            p->parallel_sim = DISABLE;
+        }
+        else if (strcmp(str, "true") == 0)
+        {
+            p->parallel_sim = ENABLE;
+        }
+        else
+        {
+            sim_assert((0), "error: %s at line %d in %s(): error parsing "
+                            "param - %s->%s has invalid value",
+                       __FILE__, __LINE__, __func__, buf1, tag_name);
+        }
+    }
+
+    tag_name = "sim_quantum_cycles";
+    if (vm_get_int(core_obj, tag_name, &p->sim_quantum_cycles) < 0)
+    {
+        log_default_param_int(buf1, tag_name, p->sim_quantum_cycles);
+    }
+
     if (p->core_type == CORE_TYPE_INCORE)
     {
         snprintf(buf1, sizeof(buf1), "%s", "incore");
@@ -1106,6 +1497,12 @@ sim_params_parse(SimParams *p, JSONValue cfg)
             log_default_param_int(buf1, tag_name, p->l1_code_cache_ways);
         }
 
+        tag_name = "mshrs";
+        if (vm_get_int(obj, tag_name, &p->l1_code_cache_mshrs) < 0)
+        {
+            log_default_param_int(buf1, tag_name, p->l1_code_cache_mshrs);
+        }
+
         tag_name = "eviction";
         if (vm_get_str(obj, tag_name, &str) < 0)
         {
@@ -1157,6 +1554,16 @@ sim_params_parse(SimParams *p, JSONValue cfg)
             log_default_param_int(buf1, tag_name, p->l1_data_cache_ways);
         }
 
+        tag_name = "mshrs";
+        if (vm_get_int(obj, tag_name, &p->l1_data_cache_mshrs) < 0)
+        {
+            log_default_param_int(buf1, tag_name, p->l1_data_cache_mshrs);
+        }
+
+        parse_prefetcher_params(obj, buf1, &p->l1_data_cache_prefetcher,
+                                &p->l1_data_cache_prefetch_degree,
+                                &p->l1_data_cache_prefetch_distance);
+
         tag_name = "eviction";
         if (vm_get_str(obj, tag_name, &str) < 0)
         {
@@ -1288,6 +1695,16 @@ sim_params_parse(SimParams *p, JSONValue cfg)
                 log_default_param_int(buf1, tag_name, p->l2_shared_cache_ways);
             }
 
+            tag_name = "mshrs";
+            if (vm_get_int(obj, tag_name, &p->l2_shared_cache_mshrs) < 0)
+            {
+                log_default_param_int(buf1, tag_name, p->l2_shared_cache_mshrs);
+            }
+
+            parse_prefetcher_params(obj, buf1, &p->l2_shared_cache_prefetcher,
+                                    &p->l2_shared_cache_prefetch_degree,
+                                    &p->l2_shared_cache_prefetch_distance);
+
             tag_name = "eviction";
             if (vm_get_str(obj, tag_name, &str) < 0)
             {
@@ -1335,98 +1752,19 @@ sim_params_parse(SimParams *p, JSONValue cfg)
         log_default_param_int(buf1, tag_name, p->burst_length);
     }
 
-    switch (p->dram_model_type)
+    tag_name = "max_inflight_requests";
+    if (vm_get_int(obj1, tag_name, &p->max_inflight_requests) < 0)
     {
-        case MEM_MODEL_BASE:
-        {
-            snprintf(buf1, sizeof(buf1), "%s", "base_dram_model");
-            obj = json_object_get(obj1, buf1);
-
-            if (json_is_undefined(obj))
-            {
-                log_default_param_str(buf1, "", "");
-            }
-
-            tag_name = "mem_access_latency";
-            if (vm_get_int(obj, tag_name, &p->mem_access_latency) < 0)
-            {
-                log_default_param_int(buf1, tag_name, p->mem_access_latency);
-            }
-            break;
-        }
-        case MEM_MODEL_DRAMSIM:
-        {
-            snprintf(buf1, sizeof(buf1), "%s", "dramsim3");
-            obj = json_object_get(obj1, buf1);
-
-            if (json_is_undefined(obj))
-            {
-                log_default_param_str(buf1, "", "");
-            }
-
-            tag_name = "config_file";
-            if (vm_get_str(obj, tag_name, &str) < 0)
-            {
-                log_default_param_str(buf1, tag_name, p->dramsim_config_file);
-            }
-            else
-            {
-                free(p->dramsim_config_file);
-                p->dramsim_config_file = strdup(str);
-            }
-            break;
-        }
-        case MEM_MODEL_RAMULATOR:
-        {
-            snprintf(buf1, sizeof(buf1), "%s", "ramulator");
-            obj = json_object_get(obj1, buf1);
-
-            if (json_is_undefined(obj))
-            {
-                log_default_param_str(buf1, "", "");
-            }
-
-            tag_name = "config_file";
-            if (vm_get_str(obj, tag_name, &str) < 0)
-            {
-                log_default_param_str(buf1, tag_name, p->ramulator_config_file);
-            }
-            else
-            {
-                free(p->ramulator_config_file);
-                p->ramulator_config_file = strdup(str);
-            }
-            break;
-        }
-        // AiM
-        case MEM_MODEL_AIMULATOR:
-        {
-            snprintf(buf1, sizeof(buf1), "%s", "aimulator");
-            obj = json_object_get(obj1, buf1);
+        log_default_param_int(buf1, tag_name, p->max_inflight_requests);
+    }
 
-            if (json_is_undefined(obj))
-            {
-                log_default_param_str(buf1, "", "");
-            }
+    parse_dram_model_params(p, obj1, p->dram_model_type);
 
-            tag_name = "config_file";
-            if (vm_get_str(obj, tag_name, &str) < 0)
-            {
-                log_default_param_str(buf1, tag_name, p->aimulator_config_file);
-            }
-            else
-            {
-                free(p->aimulator_config_file);
-                p->aimulator_config_file = strdup(str);
-            }
-            break;
-        }
-        default:
-        {
-            sim_assert((0),
-                       "error: %s at line %d in %s(): invalid memory model",
-                       __FILE__, __LINE__, __func__);
-        }
+    /* The guest RAM is served by a separate DRAM model, set in the aimulator
+     * section */
+    if (p->dram_model_type == MEM_MODEL_AIMULATOR)
+    {
+        parse_dram_model_params(p, obj1, p->host_dram_model_type);
     }
 }
 
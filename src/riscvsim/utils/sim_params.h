@@ -94,12 +94,25 @@ enum MEM_MODEL_TYPE
     MEM_MODEL_AIMULATOR,
 };
 
+enum SIM_TRACE_FORMAT
+{
+    SIM_TRACE_FORMAT_TEXT,
+    SIM_TRACE_FORMAT_BINARY
+};
+
+enum SIM_EPOCH_UNIT
+{
+    SIM_EPOCH_CYCLES,
+    SIM_EPOCH_INSNS
+};
+
 /* Default values for simulation parameters */
 #define DEF_CORE_NAME "default-riscv-core"
 #define DEF_CORE_TYPE CORE_TYPE_INCORE
 #define DEF_START_SIM 0
 #define DEF_STATS_DISPLAY 0
 #define DEF_DO_SIM_TRACE DISABLE
+#define DEF_SIM_TRACE_FORMAT SIM_TRACE_FORMAT_TEXT
 #define DEF_CREATE_INS_STR 0
 #define DEF_SIM_FILE_PATH "."
 #define DEF_SIM_FILE_PREFIX "sim"
@@ -107,6 +120,19 @@ enum MEM_MODEL_TYPE
 #define DEF_SIM_LOG_FILE DEF_SIM_FILE_PREFIX".log"
 #define DEF_SIM_STATS_SHM_NAME DEF_SIM_FILE_PREFIX"-shm"
 
+/* Must always be greater than the number of instructions in the pipeline, for
+ * the out-of-order core the ROB size */
+#define DEF_INSN_LATCH_POOL_SIZE 128
+
+/* Simulated cores, each seen by the guest as a hart */
+#define DEF_NUM_CORES 1
+#define MAX_NUM_CORES 64
+
+/* With several cores, run each one on its own host thread, synchronized every
+ * sim_quantum_cycles */
+#define DEF_PARALLEL_SIM DISABLE
+#define DEF_SIM_QUANTUM_CYCLES 1000
+
 #define DEF_NUM_STAGES 6
 #define DEF_ENABLE_PARALLEL_FU DISABLE
 
@@ -142,12 +168,17 @@ enum MEM_MODEL_TYPE
 #define DEF_L1_CODE_CACHE_SIZE 32
 #define DEF_L1_CODE_CACHE_WAYS 4
 #define DEF_L1_CODE_CACHE_EVICT EVICT_POLICY_RANDOM
+#define DEF_L1_CODE_CACHE_MSHRS 0
 
 #define DEF_L1_DATA_CACHE_READ_LATENCY 1
 #define DEF_L1_DATA_CACHE_WRITE_LATENCY 1
 #define DEF_L1_DATA_CACHE_SIZE 32
 #define DEF_L1_DATA_CACHE_WAYS 4
 #define DEF_L1_DATA_CACHE_EVICT EVICT_POLICY_RANDOM
+#define DEF_L1_DATA_CACHE_MSHRS 0
+#define DEF_L1_DATA_CACHE_PREFETCHER PREFETCHER_NONE
+#define DEF_L1_DATA_CACHE_PREFETCH_DEGREE 2
+#define DEF_L1_DATA_CACHE_PREFETCH_DISTANCE 1
 
 #define DEF_ENABLE_L2_CACHE ENABLE
 #define DEF_L2_CACHE_READ_LATENCY 1
@@ -155,6 +186,17 @@ enum MEM_MODEL_TYPE
 #define DEF_L2_CACHE_SIZE 256
 #define DEF_L2_CACHE_WAYS 16
 #define DEF_L2_CACHE_EVICT EVICT_POLICY_RANDOM
+#define DEF_L2_CACHE_MSHRS 0
+#define DEF_L2_CACHE_PREFETCHER PREFETCHER_NONE
+#define DEF_L2_CACHE_PREFETCH_DEGREE 2
+#define DEF_L2_CACHE_PREFETCH_DISTANCE 1
+
+/* Miss status holding registers per cache, 0 keeps the cache blocking */
+#define MAX_CACHE_MSHRS 64
+
+/* Lines prefetched per trigger, and how far ahead of it */
+#define MAX_PREFETCH_DEGREE 16
+#define MAX_PREFETCH_DISTANCE 64
 
 #define DEF_CACHE_READ_ALLOC_POLICY CACHE_READ_ALLOC
 #define DEF_CACHE_WRITE_ALLOC_POLICY CACHE_WRITE_ALLOC
@@ -167,11 +209,17 @@ enum MEM_MODEL_TYPE
 #define DEF_MEM_MODEL MEM_MODEL_BASE
 
 #define DEF_MEM_ACCESS_LATENCY 46
+#define DEF_MAX_INFLIGHT_REQUESTS 1
 
 #define DEF_DRAMSIM_CONFIG_FILE "DRAMsim3/configs/DDR4_4Gb_x16_2400.ini"
 #define DEF_RAMULATOR_CONFIG_FILE "ramulator/configs/DDR4-config.cfg"
 // AiM
 #define DEF_AIMULATOR_CONFIG_FILE "aimulator/ndp_pim.yaml"
+#define DEF_AIM_BATCH_SIZE 1
+#define DEF_HOST_MEM_MODEL MEM_MODEL_BASE
+
+/* Event-driven DRAM models are ticked at the CPU frequency by default */
+#define DEF_DRAM_CLOCK_FREQ_MHZ 0
 
 #define DEF_SIM_EMULATE_AFTER_ICOUNT 0
 
@@ -182,12 +230,15 @@ extern const char *core_type_str[];
 extern const char *sim_param_status[];
 extern const char *evict_policy_str[];
 extern const char *cache_ra_str[];
+extern const char *prefetcher_str[];
 extern const char *cache_wa_str[];
 extern const char *cache_wp_str[];
 extern const char *bpu_type_str[];
 extern const char *bpu_aliasing_func_type_str[];
 extern const char *dram_model_type_str[];
 extern const char *cpu_mode_str[];
+extern const char *sim_trace_format_str[];
+extern const char *sim_epoch_unit_str[];
 
 typedef struct SimParams
 {
@@ -198,6 +249,8 @@ typedef struct SimParams
     int enable_stats_display;
     int create_ins_str;
     int do_sim_trace;
+    int sim_trace_format;
+    int do_sim_profile;
     char *sim_trace_file;
     char *sim_file_path;
     char *sim_file_prefix;
@@ -206,6 +259,11 @@ typedef struct SimParams
     /* Name of the POSIX shared memory to write stats */
     char *sim_stats_shm_name;
 
+    int insn_latch_pool_size;
+    int num_cores;
+    int parallel_sim;
+    int sim_quantum_cycles;
+
     /* In-order core */
     int num_cpu_stages;
     int enable_parallel_fu;
@@ -254,11 +312,16 @@ typedef struct SimParams
     int l1_code_cache_size;
     int l1_code_cache_ways;
     int l1_code_cache_evict;
+    int l1_code_cache_mshrs;
     int l1_data_cache_read_latency;
     int l1_data_cache_write_latency;
     int l1_data_cache_size;
     int l1_data_cache_ways;
     int l1_data_cache_evict;
+    int l1_data_cache_mshrs;
+    int l1_data_cache_prefetcher;
+    int l1_data_cache_prefetch_degree;
+    int l1_data_cache_prefetch_distance;
 
     /* L2 Caches */
     int enable_l2_cache;
@@ -267,6 +330,10 @@ typedef struct SimParams
     int l2_shared_cache_size;
     int l2_shared_cache_ways;
     int l2_shared_cache_evict;
+    int l2_shared_cache_mshrs;
+    int l2_shared_cache_prefetcher;
+    int l2_shared_cache_prefetch_degree;
+    int l2_shared_cache_prefetch_distance;
 
     /* Common cache parameters */
     int cache_line_size;
@@ -281,18 +348,46 @@ typedef struct SimParams
     int dram_model_type;
     int burst_length;
     int mem_access_latency;
+    int max_inflight_requests;
 
     /* DRAMSim3 Params */
     char *dramsim_config_file;
+    int dramsim_clock_freq_mhz;
 
     /* Ramulator Params */
     char *ramulator_config_file;
+    int ramulator_clock_freq_mhz;
 
     // AiM
     /* AiMulator Params */
     char *aimulator_config_file;
+    int aimulator_clock_freq_mhz;
+    int aim_batch_size;
+
+    /* Record the requests sent to AiMulator in <prefix>.aimtrace, for
+     * sim-aim-replay */
+    int do_aim_trace;
+
+    /* DRAM model serving the guest RAM when AiMulator serves the PIM area */
+    int host_dram_model_type;
 
     uint64_t sim_emulate_after_icount;
+
+    /* Sampled simulation: once simulation starts, the instructions are
+     * emulated in a repeating sequence of sample_ff_icount instructions
+     * without any timing, sample_warmup_icount instructions which only update
+     * the caches and the BPU, and sample_detail_icount instructions simulated
+     * in detail. Disabled if sample_detail_icount is 0. */
+    uint64_t sample_ff_icount;
+    uint64_t sample_warmup_icount;
+    uint64_t sample_detail_icount;
+
+    /* Epoch stats: the change of the counters over every sim_epoch_length
+     * cycles or committed instructions is appended to the epoch file.
+     * Disabled if sim_epoch_length is 0. */
+    int sim_epoch_unit;
+    uint64_t sim_epoch_length;
+
     int system_insn_latency;
     int rtc_freq_mhz;
     int cpu_freq_mhz;
@@ -0,0 +1,352 @@
+/**
+ * Commit Stall Profiler
+ *
+ * MARSS-RISCV : Micro-Architectural System Simulator for RISC-V
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_profile.h"
+
+#define SIM_PROFILE_TABLE_INIT_SIZE 1024
+
+static const char *profile_stall_str[NUM_PROFILE_STALLS]
+    = { "fetch", "lsu", "pim", "fu" };
+
+static void
+table_init(SimProfileTable *t, int size)
+{
+    t->size = size;
+    t->num_entries = 0;
+    t->entry = (SimProfileEntry *)calloc(size, sizeof(SimProfileEntry));
+    assert(t->entry);
+}
+
+static SimProfileEntry *
+table_probe(SimProfileTable *t, target_ulong key)
+{
+    uint64_t i;
+
+    /* Fibonacci hashing spreads the 2 or 4 byte aligned PCs and the region
+     * addresses over the table, whose size is a power of 2 */
+    i = ((uint64_t)key * 0x9e3779b97f4a7c15ULL) >> 32;
+    while (1)
+    {
+        i &= t->size - 1;
+        if (!t->entry[i].key || (t->entry[i].key == key))
+        {
+            return &t->entry[i];
+        }
+        ++i;
+    }
+}
+
+static void
+table_grow(SimProfileTable *t)
+{
+    int i;
+    SimProfileTable old = *t;
+
+    table_init(t, old.size * 2);
+    for (i = 0; i < old.size; ++i)
+    {
+        if (old.entry[i].key)
+        {
+            *table_probe(t, old.entry[i].key) = old.entry[i];
+            ++t->num_entries;
+        }
+    }
+    free(old.entry);
+}
+
+static SimProfileEntry *
+table_get(SimProfileTable *t, target_ulong key)
+{
+    SimProfileEntry *pe;
+
+    pe = table_probe(t, key);
+    if (!pe->key)
+    {
+        if (2 * (t->num_entries + 1) > t->size)
+        {
+            table_grow(t);
+            pe = table_probe(t, key);
+        }
+        pe->key = key;
+        ++t->num_entries;
+    }
+
+    return pe;
+}
+
+static uint64_t
+get_total_cycles(const SimProfileEntry *pe)
+{
+    int i;
+    uint64_t total = 0;
+
+    for (i = 0; i < NUM_PROFILE_STALLS; ++i)
+    {
+        total += pe->cycles[i];
+    }
+
+    return total;
+}
+
+static int
+compare_total_cycles(const void *a, const void *b)
+{
+    uint64_t ca = get_total_cycles((const SimProfileEntry *)a);
+    uint64_t cb = get_total_cycles((const SimProfileEntry *)b);
+
+    if (ca != cb)
+    {
+        return (ca < cb) ? 1 : -1;
+    }
+
+    return (((const SimProfileEntry *)a)->key
+            > ((const SimProfileEntry *)b)->key)
+           - (((const SimProfileEntry *)a)->key
+              < ((const SimProfileEntry *)b)->key);
+}
+
+/* Returns the entries of the table sorted by decreasing stall cycles */
+static SimProfileEntry *
+table_sort(const SimProfileTable *t)
+{
+    int i, n = 0;
+    SimProfileEntry *sorted;
+
+    sorted = (SimProfileEntry *)calloc(t->num_entries + 1,
+                                       sizeof(SimProfileEntry));
+    assert(sorted);
+
+    for (i = 0; i < t->size; ++i)
+    {
+        if (t->entry[i].key)
+        {
+            sorted[n++] = t->entry[i];
+        }
+    }
+    qsort(sorted, n, sizeof(SimProfileEntry), &compare_total_cycles);
+    return sorted;
+}
+
+/* Regions are keyed with their aligned base address with bit 0 set, as key 0
+ * marks the empty entries and the low memory is region 0. PCs are 2 byte
+ * aligned, so print_table() clears bit 0 of the keys of both tables. */
+static target_ulong
+get_region(target_ulong paddr)
+{
+    return (paddr & ~(((target_ulong)1 << SIM_PROFILE_REGION_BITS) - 1)) | 1;
+}
+
+static int
+accesses_memory(const InstructionLatch *e)
+{
+    return e->ins.is_load || e->ins.is_store || e->ins.is_atomic
+           || e->ins.is_aim;
+}
+
+SimProfile *
+sim_profile_init()
+{
+    SimProfile *p;
+
+    p = (SimProfile *)calloc(1, sizeof(SimProfile));
+    assert(p);
+
+    table_init(&p->pcs, SIM_PROFILE_TABLE_INIT_SIZE);
+    table_init(&p->regions, SIM_PROFILE_TABLE_INIT_SIZE);
+    return p;
+}
+
+void
+sim_profile_free(SimProfile **p)
+{
+    free((*p)->pcs.entry);
+    free((*p)->regions.entry);
+    free(*p);
+    *p = NULL;
+}
+
+void
+sim_profile_reset(SimProfile *p)
+{
+    memset((void *)p->pcs.entry, 0, p->pcs.size * sizeof(SimProfileEntry));
+    p->pcs.num_entries = 0;
+    memset((void *)p->regions.entry, 0,
+           p->regions.size * sizeof(SimProfileEntry));
+    p->regions.num_entries = 0;
+    memset((void *)p->cycles, 0, sizeof(p->cycles));
+}
+
+void
+sim_profile_commit(SimProfile *p, const InstructionLatch *e)
+{
+    ++table_get(&p->pcs, e->ins.pc)->commits;
+
+    if (accesses_memory(e) && e->has_data_guest_paddr)
+    {
+        ++table_get(&p->regions, get_region(e->data_guest_paddr))->commits;
+    }
+}
+
+/* sim_profile_stall()
+ * @details
+ * Attributes cycles in which no instruction committed to e, the oldest
+ * instruction in the pipeline. If there is none, the stall is a fetch stall
+ * attributed to fetch_pc, the next PC to fetch from.
+ */
+void
+sim_profile_stall(SimProfile *p, const InstructionLatch *e,
+                  target_ulong fetch_pc, uint64_t cycles)
+{
+    SimProfileStall type;
+
+    if (!e)
+    {
+        type = PROFILE_STALL_FETCH;
+    }
+    else if (e->ins.is_aim)
+    {
+        type = PROFILE_STALL_PIM;
+    }
+    else if (accesses_memory(e))
+    {
+        type = PROFILE_STALL_LSU;
+    }
+    else
+    {
+        type = PROFILE_STALL_FU;
+    }
+
+    p->cycles[type] += cycles;
+    table_get(&p->pcs, e ? e->ins.pc : fetch_pc)->cycles[type] += cycles;
+
+    /* The physical address is only known once the access was executed */
+    if (((type == PROFILE_STALL_LSU) || (type == PROFILE_STALL_PIM))
+        && e->has_data_guest_paddr)
+    {
+        table_get(&p->regions, get_region(e->data_guest_paddr))->cycles[type]
+            += cycles;
+    }
+}
+
+static FILE *
+open_profile_file(const char *pathname, const char *stats_file,
+                  const char *ext)
+{
+    FILE *fp;
+    char filename[1024];
+
+    snprintf(filename, sizeof(filename), "%s/%s_profile.%s", pathname,
+             stats_file, ext);
+    fp = fopen(filename, "w");
+    assert(fp);
+    return fp;
+}
+
+static void
+print_table(FILE *fp, const SimProfileTable *t, const char *key_name,
+            uint64_t total)
+{
+    int i;
+    uint64_t cycles, cum = 0;
+    SimProfileEntry *sorted;
+
+    fprintf(fp, "%12s %7s %7s %12s %12s %12s %12s %12s  %s\n", "cycles",
+            "self%", "cum%", profile_stall_str[PROFILE_STALL_FETCH],
+            profile_stall_str[PROFILE_STALL_LSU],
+            profile_stall_str[PROFILE_STALL_PIM],
+            profile_stall_str[PROFILE_STALL_FU], "commits", key_name);
+
+    sorted = table_sort(t);
+    for (i = 0; i < t->num_entries; ++i)
+    {
+        cycles = get_total_cycles(&sorted[i]);
+        cum += cycles;
+        fprintf(fp,
+                "%12lu %7.2lf %7.2lf %12lu %12lu %12lu %12lu %12lu  0x%" TARGET_ULONG_HEX
+                "\n",
+                cycles, total ? 100.0 * cycles / total : 0.0,
+                total ? 100.0 * cum / total : 0.0,
+                sorted[i].cycles[PROFILE_STALL_FETCH],
+                sorted[i].cycles[PROFILE_STALL_LSU],
+                sorted[i].cycles[PROFILE_STALL_PIM],
+                sorted[i].cycles[PROFILE_STALL_FU], sorted[i].commits,
+                sorted[i].key & ~(target_ulong)1);
+    }
+    free(sorted);
+}
+
+/* sim_profile_print_to_file()
+ * @details
+ * Writes the flat profile in <stats_file>_profile.txt, and the stall cycles
+ * of every PC which stalled the commit in <stats_file>_profile.pcs.
+ */
+void
+sim_profile_print_to_file(const SimProfile *p, const char *pathname,
+                          const char *stats_file)
+{
+    int i;
+    FILE *fp;
+    uint64_t total = 0, mem_total;
+    SimProfileEntry *sorted;
+
+    for (i = 0; i < NUM_PROFILE_STALLS; ++i)
+    {
+        total += p->cycles[i];
+    }
+    mem_total = p->cycles[PROFILE_STALL_LSU] + p->cycles[PROFILE_STALL_PIM];
+
+    fp = open_profile_file(pathname, stats_file, "txt");
+    fprintf(fp, "Commit stall cycles: %lu\n", total);
+    for (i = 0; i < NUM_PROFILE_STALLS; ++i)
+    {
+        fprintf(fp, "  %-6s %12lu (%.2lf%%)\n", profile_stall_str[i],
+                p->cycles[i], total ? 100.0 * p->cycles[i] / total : 0.0);
+    }
+
+    fprintf(fp, "\nPer-PC flat profile:\n");
+    print_table(fp, &p->pcs, "pc", total);
+
+    fprintf(fp, "\nPer-region profile (%d KB guest physical regions, lsu and "
+                "pim stalls only):\n",
+            1 << (SIM_PROFILE_REGION_BITS - 10));
+    print_table(fp, &p->regions, "region", mem_total);
+    fclose(fp);
+
+    fp = open_profile_file(pathname, stats_file, "pcs");
+    sorted = table_sort(&p->pcs);
+    for (i = 0; i < p->pcs.num_entries; ++i)
+    {
+        if (get_total_cycles(&sorted[i]))
+        {
+            fprintf(fp, "0x%" TARGET_ULONG_HEX " %lu\n", sorted[i].key,
+                    get_total_cycles(&sorted[i]));
+        }
+    }
+    free(sorted);
+    fclose(fp);
+}
@@ -0,0 +1,91 @@
+/**
+ * Commit Stall Profiler
+ *
+ * Every cycle in which the core commits no instruction is attributed to the
+ * instruction blocking the commit: the head of the ROB for the out-of-order
+ * core, or the oldest instruction in the pipeline for the in-order core. The
+ * stall is classified by what this instruction waits on: fetch (no instruction
+ * to commit yet), LSU, AiM queue or functional unit. LSU and AiM stalls are
+ * also attributed to the guest physical region of the blocking access.
+ *
+ * When simulation stops, the profile is written in two files next to the
+ * stats file:
+ *   <stats_file>_profile.txt: flat profile of the PCs and of the regions,
+ *                             sorted by stall cycles
+ *   <stats_file>_profile.pcs: one "pc cycles" line per PC, in hexadecimal and
+ *                             decimal, whose first column can be fed to
+ *                             addr2line -e vmlinux
+ *
+ * MARSS-RISCV : Micro-Architectural System Simulator for RISC-V
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _SIM_PROFILE_H_
+#define _SIM_PROFILE_H_
+
+#include <inttypes.h>
+
+#include "../riscv_sim_typedefs.h"
+#include "cpu_latches.h"
+
+/* Size of the guest physical regions, 1 MB */
+#define SIM_PROFILE_REGION_BITS 20
+
+typedef enum SimProfileStall
+{
+    PROFILE_STALL_FETCH,
+    PROFILE_STALL_LSU,
+    PROFILE_STALL_PIM,
+    PROFILE_STALL_FU,
+    NUM_PROFILE_STALLS,
+} SimProfileStall;
+
+/* A PC, or the first address of a region */
+typedef struct SimProfileEntry
+{
+    target_ulong key;
+    uint64_t commits;
+    uint64_t cycles[NUM_PROFILE_STALLS];
+} SimProfileEntry;
+
+/* Open addressing hash table, grown when half full. Key 0 marks a free entry,
+ * neither PC 0 nor the first guest physical region being of interest. */
+typedef struct SimProfileTable
+{
+    int size;
+    int num_entries;
+    SimProfileEntry *entry;
+} SimProfileTable;
+
+typedef struct SimProfile
+{
+    SimProfileTable pcs;
+    SimProfileTable regions;
+    uint64_t cycles[NUM_PROFILE_STALLS];
+} SimProfile;
+
+SimProfile *sim_profile_init();
+void sim_profile_free(SimProfile **p);
+void sim_profile_reset(SimProfile *p);
+void sim_profile_commit(SimProfile *p, const InstructionLatch *e);
+void sim_profile_stall(SimProfile *p, const InstructionLatch *e,
+                       target_ulong fetch_pc, uint64_t cycles);
+void sim_profile_print_to_file(const SimProfile *p, const char *pathname,
+                               const char *stats_file);
+#endif
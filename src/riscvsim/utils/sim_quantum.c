@@ -0,0 +1,128 @@
+/**
+ * Simulation Quantum
+ *
+ * MARSS-RISCV : Micro-Architectural System Simulator for RISC-V
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <assert.h>
+#include <stdlib.h>
+
+#include "sim_quantum.h"
+
+SimQuantum *
+sim_quantum_init(uint64_t cycles,
+                 void (*end_quantum)(void *opaque, uint64_t start,
+                                     uint64_t end),
+                 void *opaque)
+{
+    SimQuantum *q;
+
+    q = (SimQuantum *)calloc(1, sizeof(SimQuantum));
+    assert(q);
+
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->cond, NULL);
+    q->cycles = cycles;
+    q->end_quantum = end_quantum;
+    q->opaque = opaque;
+    sim_quantum_reset(q);
+    return q;
+}
+
+void
+sim_quantum_free(SimQuantum **q)
+{
+    pthread_cond_destroy(&(*q)->cond);
+    pthread_mutex_destroy(&(*q)->lock);
+    free(*q);
+    *q = NULL;
+}
+
+/* For a new simulation run, starting at cycle 0 with no core taking part */
+void
+sim_quantum_reset(SimQuantum *q)
+{
+    q->end = q->cycles;
+    q->num_active = 0;
+    q->num_waiting = 0;
+}
+
+/* Called with the lock held, by the last core to arrive */
+static void
+sim_quantum_advance(SimQuantum *q)
+{
+    q->end_quantum(q->opaque, q->end - q->cycles, q->end);
+    q->end += q->cycles;
+    q->num_waiting = 0;
+    ++q->generation;
+    pthread_cond_broadcast(&q->cond);
+}
+
+void
+sim_quantum_enter(SimQuantum *q)
+{
+    pthread_mutex_lock(&q->lock);
+    ++q->num_active;
+    pthread_mutex_unlock(&q->lock);
+}
+
+/* The others no longer wait for this core */
+void
+sim_quantum_leave(SimQuantum *q)
+{
+    pthread_mutex_lock(&q->lock);
+    --q->num_active;
+    if (q->num_active && (q->num_waiting == q->num_active))
+    {
+        sim_quantum_advance(q);
+    }
+    pthread_mutex_unlock(&q->lock);
+}
+
+/* sim_quantum_wait()
+ * @details
+ * Wait until the quantum holding the given clock cycle starts, and return its
+ * end. Returns at once if clock is before the end of the current quantum.
+ */
+uint64_t
+sim_quantum_wait(SimQuantum *q, uint64_t clock)
+{
+    uint64_t generation, end;
+
+    pthread_mutex_lock(&q->lock);
+    while (clock >= q->end)
+    {
+        if (++q->num_waiting == q->num_active)
+        {
+            sim_quantum_advance(q);
+        }
+        else
+        {
+            generation = q->generation;
+            while (generation == q->generation)
+            {
+                pthread_cond_wait(&q->cond, &q->lock);
+            }
+        }
+    }
+    end = q->end;
+    pthread_mutex_unlock(&q->lock);
+    return end;
+}
@@ -0,0 +1,66 @@
+/**
+ * Simulation Quantum
+ *
+ * Barrier for the cores simulated in parallel host threads. Every core runs
+ * until its clock reaches the end of the current quantum, and waits there for
+ * the others. The last one to arrive runs the end_quantum callback, before
+ * all of them are released into the next quantum.
+ *
+ * MARSS-RISCV : Micro-Architectural System Simulator for RISC-V
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _SIM_QUANTUM_H_
+#define _SIM_QUANTUM_H_
+
+#include <inttypes.h>
+#include <pthread.h>
+
+typedef struct SimQuantum
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    /* Length of a quantum in cycles, and end of the current one */
+    uint64_t cycles;
+    uint64_t end;
+
+    /* Cores taking part, and the ones waiting for the others */
+    int num_active;
+    int num_waiting;
+
+    /* Incremented every time a quantum ends */
+    uint64_t generation;
+
+    /* Called with the cycles covered by the quantum which just ended, while
+     * all the cores taking part are waiting */
+    void (*end_quantum)(void *opaque, uint64_t start, uint64_t end);
+    void *opaque;
+} SimQuantum;
+
+SimQuantum *sim_quantum_init(uint64_t cycles,
+                             void (*end_quantum)(void *opaque, uint64_t start,
+                                                 uint64_t end),
+                             void *opaque);
+void sim_quantum_free(SimQuantum **q);
+void sim_quantum_reset(SimQuantum *q);
+void sim_quantum_enter(SimQuantum *q);
+void sim_quantum_leave(SimQuantum *q);
+uint64_t sim_quantum_wait(SimQuantum *q, uint64_t clock);
+#endif
@@ -0,0 +1,230 @@
+/**
+ * Guest-tagged Simulation Regions
+ *
+ * MARSS-RISCV : Micro-Architectural System Simulator for RISC-V
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../cutils.h"
+#include "sim_log.h"
+#include "sim_region.h"
+
+/* Columns of the summary table */
+typedef struct SimRegionRow
+{
+    uint64_t cycles;
+    uint64_t insns;
+    uint64_t aim_insns;
+    uint64_t dcache_miss;
+    uint64_t l2_cache_miss;
+    uint64_t data_mem_delay;
+    uint64_t pim_mem_delay;
+    uint64_t mem_reads;
+    uint64_t mem_writes;
+    uint64_t aim_cmds;
+} SimRegionRow;
+
+static SimRegion *
+find_region(SimRegions *r, uint64_t id)
+{
+    int i;
+
+    for (i = 0; i < r->num_regions; ++i)
+    {
+        if (r->region[i].id == id)
+        {
+            return &r->region[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void
+get_row(const SimRegions *r, const SimRegion *g, SimRegionRow *row)
+{
+    int i;
+    const SimStats *s = &g->total;
+
+    memset((void *)row, 0, sizeof(SimRegionRow));
+    row->cycles = s->cycles;
+    row->insns = s->ins_simulated;
+    for (i = INS_TYPE_AIM_MAC_SBK; i <= INS_TYPE_AIM_RD_AF; ++i)
+    {
+        row->aim_insns += s->ins_type[i];
+    }
+    row->dcache_miss = s->dcache_read_miss + s->dcache_write_miss;
+    row->l2_cache_miss = s->l2_cache_read_miss + s->l2_cache_write_miss;
+    row->data_mem_delay = s->data_mem_delay;
+    row->pim_mem_delay = s->pim_mem_delay;
+    for (i = 0; i < r->num_backends; ++i)
+    {
+        row->mem_reads += g->mem[i].reads;
+        row->mem_writes += g->mem[i].writes;
+        row->aim_cmds += g->mem[i].aim_cmds;
+    }
+}
+
+SimRegions *
+sim_regions_init()
+{
+    SimRegions *r;
+
+    r = (SimRegions *)calloc(1, sizeof(SimRegions));
+    assert(r);
+    return r;
+}
+
+void
+sim_regions_free(SimRegions **r)
+{
+    free(*r);
+    *r = NULL;
+}
+
+void
+sim_regions_reset(SimRegions *r)
+{
+    memset((void *)r, 0, sizeof(SimRegions));
+}
+
+/* stats holds the counters of every privilege level */
+void
+sim_region_begin(SimRegions *r, uint64_t id, const SimStats *stats,
+                 const MemBackendStats *mem, int num_backends)
+{
+    SimRegion *g;
+
+    g = find_region(r, id);
+    if (!g)
+    {
+        if (r->num_regions == SIM_MAX_REGIONS)
+        {
+            sim_log_event(sim_log, "Ignoring region %lu, more than %d regions",
+                          id, SIM_MAX_REGIONS);
+            return;
+        }
+        g = &r->region[r->num_regions++];
+        g->id = id;
+    }
+    else if (g->active)
+    {
+        sim_log_event(sim_log, "Region %lu begins again before its end, "
+                               "restarting it",
+                      id);
+    }
+
+    r->num_backends = num_backends;
+    g->active = TRUE;
+    sim_stats_get_total(&g->start, stats);
+    memcpy(g->start_mem, mem, num_backends * sizeof(MemBackendStats));
+}
+
+void
+sim_region_end(SimRegions *r, uint64_t id, const SimStats *stats,
+               const MemBackendStats *mem)
+{
+    int i;
+    SimStats end;
+    SimRegion *g;
+
+    g = find_region(r, id);
+    if (!g || !g->active)
+    {
+        sim_log_event(sim_log, "Ignoring the end of region %lu, which did not "
+                               "begin",
+                      id);
+        return;
+    }
+
+    sim_stats_get_total(&end, stats);
+    sim_stats_add_delta(&g->total, &end, &g->start);
+    for (i = 0; i < r->num_backends; ++i)
+    {
+        g->mem[i].reads += mem[i].reads - g->start_mem[i].reads;
+        g->mem[i].writes += mem[i].writes - g->start_mem[i].writes;
+        g->mem[i].aim_cmds += mem[i].aim_cmds - g->start_mem[i].aim_cmds;
+    }
+    g->active = FALSE;
+    ++g->count;
+}
+
+/* sim_regions_print_to_file()
+ * @details
+ * Logs the summary table of the regions, and writes it in CSV format in
+ * <stats_file>_regions.csv. Executions of a region still running when
+ * simulation stops are not counted.
+ */
+void
+sim_regions_print_to_file(const SimRegions *r, const char *pathname,
+                          const char *stats_file)
+{
+    int i;
+    FILE *fp;
+    char filename[1024];
+    SimRegionRow row;
+    const SimRegion *g;
+
+    if (!r->num_regions)
+    {
+        return;
+    }
+
+    snprintf(filename, sizeof(filename), "%s/%s_regions.csv", pathname,
+             stats_file);
+    fp = fopen(filename, "w");
+    assert(fp);
+    fprintf(fp, "region,count,cycles,commits,ipc,aim_insns,dcache_miss,"
+                "l2_cache_miss,data_mem_delay,pim_mem_delay,mem_reads,"
+                "mem_writes,aim_cmds\n");
+
+    sim_log_event(sim_log, "%s", "Region Summary:");
+    sim_log_param(sim_log, "%8s %8s %14s %14s %7s %12s %12s %12s %14s %14s",
+                  "region", "count", "cycles", "commits", "ipc", "aim-insns",
+                  "dcache-miss", "l2-miss", "data-mem-delay",
+                  "pim-mem-delay");
+
+    for (i = 0; i < r->num_regions; ++i)
+    {
+        g = &r->region[i];
+        get_row(r, g, &row);
+
+        sim_log_param(sim_log,
+                      "%8lu %8lu %14lu %14lu %7.4lf %12lu %12lu %12lu %14lu "
+                      "%14lu",
+                      g->id, g->count, row.cycles, row.insns,
+                      row.cycles ? (double)row.insns / row.cycles : 0.0,
+                      row.aim_insns, row.dcache_miss, row.l2_cache_miss,
+                      row.data_mem_delay, row.pim_mem_delay);
+        fprintf(fp, "%lu,%lu,%lu,%lu,%.4lf,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n",
+                g->id, g->count, row.cycles, row.insns,
+                row.cycles ? (double)row.insns / row.cycles : 0.0,
+                row.aim_insns, row.dcache_miss, row.l2_cache_miss,
+                row.data_mem_delay, row.pim_mem_delay, row.mem_reads,
+                row.mem_writes, row.aim_cmds);
+    }
+
+    fclose(fp);
+    sim_log_event(sim_log, "Saved region stats in %s", filename);
+}
@@ -0,0 +1,72 @@
+/**
+ * Guest-tagged Simulation Regions
+ *
+ * The guest marks the code regions to measure by writing their id to CSR 0x802
+ * at their start and to CSR 0x803 at their end, see SIM_REGION_BEGIN() and
+ * SIM_REGION_END() in tools/def.h. Every region accumulates the change of all
+ * the counters between its begin and end markers, over any number of
+ * executions, without leaving simulation mode. Regions of different ids may
+ * nest or overlap. The regions are reported in one table when simulation
+ * stops, in the log and in <stats_file>_regions.csv.
+ *
+ * MARSS-RISCV : Micro-Architectural System Simulator for RISC-V
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _SIM_REGION_H_
+#define _SIM_REGION_H_
+
+#include <inttypes.h>
+
+#include "sim_stats.h"
+
+#define SIM_MAX_REGIONS 64
+
+typedef struct SimRegion
+{
+    uint64_t id;
+    uint64_t count;
+    int active;
+
+    /* Counters, summed over the privilege levels, at the last begin marker */
+    SimStats start;
+    MemBackendStats start_mem[NUM_MAX_MEM_BACKENDS];
+
+    /* Counters accumulated over the completed executions of the region */
+    SimStats total;
+    MemBackendStats mem[NUM_MAX_MEM_BACKENDS];
+} SimRegion;
+
+typedef struct SimRegions
+{
+    int num_regions;
+    int num_backends;
+    SimRegion region[SIM_MAX_REGIONS];
+} SimRegions;
+
+SimRegions *sim_regions_init();
+void sim_regions_free(SimRegions **r);
+void sim_regions_reset(SimRegions *r);
+void sim_region_begin(SimRegions *r, uint64_t id, const SimStats *stats,
+                      const MemBackendStats *mem, int num_backends);
+void sim_region_end(SimRegions *r, uint64_t id, const SimStats *stats,
+                    const MemBackendStats *mem);
+void sim_regions_print_to_file(const SimRegions *r, const char *pathname,
+                               const char *stats_file);
+#endif
@@ -0,0 +1,179 @@
+/**
+ * Sampled Simulation
+ *
+ * MARSS-RISCV : Micro-Architectural System Simulator for RISC-V
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_log.h"
+#include "sim_sample.h"
+
+/* Normal quantile for a 95% confidence interval */
+#define SAMPLE_CONFIDENCE_Z 1.96
+
+static const char *sample_metric_str[NUM_SAMPLE_METRICS]
+    = { "cycles", "mem-stall-cycles", "pim-stall-cycles" };
+
+SimSampler *
+sim_sampler_init(const SimParams *p)
+{
+    SimSampler *s;
+
+    s = (SimSampler *)calloc(1, sizeof(SimSampler));
+    assert(s);
+
+    s->phase_icount[SAMPLE_FAST_FORWARD] = p->sample_ff_icount;
+    s->phase_icount[SAMPLE_WARMUP] = p->sample_warmup_icount;
+    s->phase_icount[SAMPLE_DETAIL] = p->sample_detail_icount;
+    return s;
+}
+
+void
+sim_sampler_free(SimSampler **s)
+{
+    free(*s);
+    *s = NULL;
+}
+
+/* Simulation starts with a fast-forward phase, or the first non-empty phase
+ * after it */
+void
+sim_sampler_start(SimSampler *s, uint64_t insn_counter)
+{
+    s->region_start = insn_counter;
+    s->num_samples = 0;
+    memset(s->sum, 0, sizeof(s->sum));
+    memset(s->sum_sq, 0, sizeof(s->sum_sq));
+
+    s->phase = SAMPLE_DETAIL;
+    sim_sampler_next_phase(s, insn_counter);
+}
+
+/* Empty phases are skipped, the detail phase never is */
+SimSamplePhase
+sim_sampler_next_phase(SimSampler *s, uint64_t insn_counter)
+{
+    do
+    {
+        s->phase = (s->phase + 1) % NUM_SAMPLE_PHASES;
+    } while (!s->phase_icount[s->phase]);
+
+    s->phase_end = insn_counter + s->phase_icount[s->phase];
+    return s->phase;
+}
+
+void
+sim_sampler_begin_window(SimSampler *s, uint64_t icount,
+                         const uint64_t *counters)
+{
+    s->window_icount = icount;
+    memcpy(s->window_start, counters, sizeof(s->window_start));
+}
+
+void
+sim_sampler_end_window(SimSampler *s, uint64_t icount,
+                       const uint64_t *counters)
+{
+    int i;
+    double x;
+    uint64_t insns = icount - s->window_icount;
+
+    if (!insns)
+    {
+        return;
+    }
+
+    for (i = 0; i < NUM_SAMPLE_METRICS; ++i)
+    {
+        x = (double)(counters[i] - s->window_start[i]) / (double)insns;
+        s->sum[i] += x;
+        s->sum_sq[i] += x * x;
+    }
+    ++s->num_samples;
+}
+
+/* Half width of the confidence interval of the mean, 0 with a single
+ * sample */
+static double
+get_confidence_interval(const SimSampler *s, int metric, double mean)
+{
+    double n = (double)s->num_samples;
+    double var;
+
+    if (s->num_samples < 2)
+    {
+        return 0;
+    }
+
+    var = (s->sum_sq[metric] - n * mean * mean) / (n - 1);
+    if (var < 0)
+    {
+        var = 0;
+    }
+    return SAMPLE_CONFIDENCE_Z * sqrt(var / n);
+}
+
+/* sim_sampler_print()
+ * @details
+ * Logs the mean of every metric per instruction, and its estimate over all
+ * the instructions executed since simulation started, with their 95%
+ * confidence interval.
+ */
+void
+sim_sampler_print(const SimSampler *s, uint64_t insn_counter)
+{
+    int i;
+    double mean[NUM_SAMPLE_METRICS], ci[NUM_SAMPLE_METRICS];
+    double region_insns = (double)(insn_counter - s->region_start);
+
+    sim_log_event(sim_log, "%s", "Sampling Summary:");
+    sim_log_param(sim_log, "region-insns: %lu", insn_counter - s->region_start);
+    sim_log_param(sim_log, "samples: %lu", s->num_samples);
+
+    if (!s->num_samples)
+    {
+        sim_log_param(sim_log, "%s", "no detailed window completed");
+        return;
+    }
+
+    for (i = 0; i < NUM_SAMPLE_METRICS; ++i)
+    {
+        mean[i] = s->sum[i] / (double)s->num_samples;
+        ci[i] = get_confidence_interval(s, i, mean[i]);
+        sim_log_param(sim_log, "%s-per-insn: %.4lf +/- %.4lf",
+                      sample_metric_str[i], mean[i], ci[i]);
+        sim_log_param(sim_log, "estimated-%s: %.0lf +/- %.0lf",
+                      sample_metric_str[i], mean[i] * region_insns,
+                      ci[i] * region_insns);
+    }
+
+    /* IPC is the inverse of the mean CPI, its interval bounds are the
+     * inverses of the CPI interval bounds */
+    sim_log_param(sim_log, "estimated-ipc: %.4lf [%.4lf, %.4lf]",
+                  1.0 / mean[SAMPLE_CYCLES],
+                  1.0 / (mean[SAMPLE_CYCLES] + ci[SAMPLE_CYCLES]),
+                  (mean[SAMPLE_CYCLES] > ci[SAMPLE_CYCLES])
+                      ? 1.0 / (mean[SAMPLE_CYCLES] - ci[SAMPLE_CYCLES])
+                      : INFINITY);
+}
@@ -0,0 +1,86 @@
+/**
+ * Sampled Simulation
+ *
+ * Once simulation starts, the instructions are split into a repeating
+ * sequence of phases: fast-forward (emulated without any timing), warmup
+ * (emulated, updating the caches and the BPU) and detail (simulated). Every
+ * detailed window gives one sample of the per-instruction metrics, whose mean
+ * and confidence interval are extrapolated to all the instructions executed
+ * until simulation stops.
+ *
+ * MARSS-RISCV : Micro-Architectural System Simulator for RISC-V
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _SIM_SAMPLE_H_
+#define _SIM_SAMPLE_H_
+
+#include <inttypes.h>
+
+#include "sim_params.h"
+
+typedef enum SimSamplePhase
+{
+    SAMPLE_FAST_FORWARD,
+    SAMPLE_WARMUP,
+    SAMPLE_DETAIL,
+    NUM_SAMPLE_PHASES,
+} SimSamplePhase;
+
+/* Counters measured over every detailed window, sampled per instruction */
+typedef enum SimSampleMetric
+{
+    SAMPLE_CYCLES,
+    SAMPLE_MEM_STALL_CYCLES,
+    SAMPLE_PIM_STALL_CYCLES,
+    NUM_SAMPLE_METRICS,
+} SimSampleMetric;
+
+typedef struct SimSampler
+{
+    uint64_t phase_icount[NUM_SAMPLE_PHASES];
+
+    /* Current phase, which lasts until the emulated instruction counter
+     * reaches phase_end */
+    SimSamplePhase phase;
+    uint64_t phase_end;
+
+    /* Emulated instruction counter when simulation started */
+    uint64_t region_start;
+
+    /* Committed instructions and counters at the start of the current
+     * detailed window */
+    uint64_t window_icount;
+    uint64_t window_start[NUM_SAMPLE_METRICS];
+
+    uint64_t num_samples;
+    double sum[NUM_SAMPLE_METRICS];
+    double sum_sq[NUM_SAMPLE_METRICS];
+} SimSampler;
+
+SimSampler *sim_sampler_init(const SimParams *p);
+void sim_sampler_free(SimSampler **s);
+void sim_sampler_start(SimSampler *s, uint64_t insn_counter);
+SimSamplePhase sim_sampler_next_phase(SimSampler *s, uint64_t insn_counter);
+void sim_sampler_begin_window(SimSampler *s, uint64_t icount,
+                              const uint64_t *counters);
+void sim_sampler_end_window(SimSampler *s, uint64_t icount,
+                            const uint64_t *counters);
+void sim_sampler_print(const SimSampler *s, uint64_t insn_counter);
+#endif
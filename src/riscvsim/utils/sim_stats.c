@@ -103,6 +103,7 @@ sim_stats_print_to_file(const SimStats *s, const char *pathname,
 
     SIM_STAT_PRINT_TO_FILE(fp, s, "insn_mem_delay", insn_mem_delay);
     SIM_STAT_PRINT_TO_FILE(fp, s, "data_mem_delay", data_mem_delay);
+    SIM_STAT_PRINT_TO_FILE(fp, s, "pim_mem_delay", pim_mem_delay);
     SIM_STAT_PRINT_TO_FILE(fp, s, "exec_unit_delay", exec_unit_delay);
 
     SIM_STAT_PRINT_TO_FILE(fp, s, "load_insn", ins_type[INS_TYPE_LOAD]);
@@ -134,6 +135,9 @@ sim_stats_print_to_file(const SimStats *s, const char *pathname,
     SIM_STAT_PRINT_TO_FILE(fp, s, "load_double_word_insn",
                            ins_type[INS_TYPE_LOAD_DOUBLE_WORD]);
 
+    SIM_STAT_PRINT_TO_FILE(fp, s, "decode_cache_hits", decode_cache_hits);
+    SIM_STAT_PRINT_TO_FILE(fp, s, "decode_cache_misses", decode_cache_misses);
+
     SIM_STAT_PRINT_TO_FILE(fp, s, "itlb_reads", code_tlb_lookups);
     SIM_STAT_PRINT_TO_FILE(fp, s, "itlb_hits", code_tlb_hits);
     SIM_STAT_PRINT_TO_FILE(fp, s, "load_tlb_reads", load_tlb_lookups);
@@ -213,6 +217,31 @@ sim_stats_print_to_file(const SimStats *s, const char *pathname,
     SIM_STAT_PRINT_TO_FILE(fp, s, "L2_cache_writes", l2_cache_write);
     SIM_STAT_PRINT_TO_FILE(fp, s, "L2_cache_write_misses", l2_cache_write_miss);
 
+    SIM_STAT_PRINT_TO_FILE(fp, s, "L1_icache_mshr_allocs", icache_mshr_allocs);
+    SIM_STAT_PRINT_TO_FILE(fp, s, "L1_icache_mshr_merges", icache_mshr_merges);
+    SIM_STAT_PRINT_TO_FILE(fp, s, "L1_icache_mshr_full", icache_mshr_full);
+    SIM_STAT_PRINT_TO_FILE(fp, s, "L1_icache_mshr_occupancy", icache_mshr_occupancy);
+
+    SIM_STAT_PRINT_TO_FILE(fp, s, "L1_dcache_mshr_allocs", dcache_mshr_allocs);
+    SIM_STAT_PRINT_TO_FILE(fp, s, "L1_dcache_mshr_merges", dcache_mshr_merges);
+    SIM_STAT_PRINT_TO_FILE(fp, s, "L1_dcache_mshr_full", dcache_mshr_full);
+    SIM_STAT_PRINT_TO_FILE(fp, s, "L1_dcache_mshr_occupancy", dcache_mshr_occupancy);
+
+    SIM_STAT_PRINT_TO_FILE(fp, s, "L2_cache_mshr_allocs", l2_cache_mshr_allocs);
+    SIM_STAT_PRINT_TO_FILE(fp, s, "L2_cache_mshr_merges", l2_cache_mshr_merges);
+    SIM_STAT_PRINT_TO_FILE(fp, s, "L2_cache_mshr_full", l2_cache_mshr_full);
+    SIM_STAT_PRINT_TO_FILE(fp, s, "L2_cache_mshr_occupancy", l2_cache_mshr_occupancy);
+
+    SIM_STAT_PRINT_TO_FILE(fp, s, "L1_dcache_prefetches", dcache_pf_issued);
+    SIM_STAT_PRINT_TO_FILE(fp, s, "L1_dcache_prefetches_useful", dcache_pf_useful);
+    SIM_STAT_PRINT_TO_FILE(fp, s, "L1_dcache_prefetches_late", dcache_pf_late);
+    SIM_STAT_PRINT_TO_FILE(fp, s, "L1_dcache_prefetches_useless", dcache_pf_useless);
+
+    SIM_STAT_PRINT_TO_FILE(fp, s, "L2_cache_prefetches", l2_cache_pf_issued);
+    SIM_STAT_PRINT_TO_FILE(fp, s, "L2_cache_prefetches_useful", l2_cache_pf_useful);
+    SIM_STAT_PRINT_TO_FILE(fp, s, "L2_cache_prefetches_late", l2_cache_pf_late);
+    SIM_STAT_PRINT_TO_FILE(fp, s, "L2_cache_prefetches_useless", l2_cache_pf_useless);
+
     fclose(fp);
     sim_log_event(sim_log, "Saved simulation stats in %s", filename);
     free(filename);
@@ -224,6 +253,40 @@ sim_stats_reset(SimStats *s)
     memset((void *)s, 0, NUM_MAX_PRV_LEVELS * sizeof(SimStats));
 }
 
+/* Sum the counters of all the privilege levels, all being uint64_t */
+void
+sim_stats_get_total(SimStats *total, const SimStats *s)
+{
+    int i, j;
+    uint64_t *t = (uint64_t *)total;
+    const uint64_t *c;
+
+    memset((void *)total, 0, sizeof(SimStats));
+    for (i = 0; i < NUM_MAX_PRV_LEVELS; ++i)
+    {
+        c = (const uint64_t *)&s[i];
+        for (j = 0; j < (int)(sizeof(SimStats) / sizeof(uint64_t)); ++j)
+        {
+            t[j] += c[j];
+        }
+    }
+}
+
+/* Add the change of every counter from start to end to acc */
+void
+sim_stats_add_delta(SimStats *acc, const SimStats *end, const SimStats *start)
+{
+    int j;
+    uint64_t *a = (uint64_t *)acc;
+    const uint64_t *e = (const uint64_t *)end;
+    const uint64_t *s = (const uint64_t *)start;
+
+    for (j = 0; j < (int)(sizeof(SimStats) / sizeof(uint64_t)); ++j)
+    {
+        a[j] += e[j] - s[j];
+    }
+}
+
 int
 sim_file_path_valid(const char *path)
 {
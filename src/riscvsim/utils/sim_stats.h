@@ -36,10 +36,12 @@
 
 typedef struct SimStats
 {
-    /* General Stats */
+    /* General Stats. All the counters are uint64_t, see sim_epoch.c for the
+     * epoch records. */
     uint64_t cycles;
     uint64_t insn_mem_delay;
     uint64_t data_mem_delay;
+    uint64_t pim_mem_delay; /* Part of data_mem_delay waiting on AiM commands */
     uint64_t exec_unit_delay;
 
     /* Instruction Stats */
@@ -50,6 +52,10 @@ typedef struct SimStats
     uint64_t ins_type[NUM_MAX_INS_TYPES];
     uint64_t ins_cond_branch_taken;
 
+    /* Decoded instruction cache */
+    uint64_t decode_cache_hits;
+    uint64_t decode_cache_misses;
+
     /* Register Access */
     uint64_t csr_reads;
     uint64_t csr_writes;
@@ -98,12 +104,47 @@ typedef struct SimStats
     uint64_t l2_cache_read_miss;
     uint64_t l2_cache_write_miss;
 
+    /* Cache MSHRs, see CacheStats */
+    uint64_t icache_mshr_allocs;
+    uint64_t icache_mshr_merges;
+    uint64_t icache_mshr_full;
+    uint64_t icache_mshr_occupancy;
+    uint64_t dcache_mshr_allocs;
+    uint64_t dcache_mshr_merges;
+    uint64_t dcache_mshr_full;
+    uint64_t dcache_mshr_occupancy;
+    uint64_t l2_cache_mshr_allocs;
+    uint64_t l2_cache_mshr_merges;
+    uint64_t l2_cache_mshr_full;
+    uint64_t l2_cache_mshr_occupancy;
+
+    /* Cache prefetchers, see CacheStats */
+    uint64_t dcache_pf_issued;
+    uint64_t dcache_pf_useful;
+    uint64_t dcache_pf_late;
+    uint64_t dcache_pf_useless;
+    uint64_t l2_cache_pf_issued;
+    uint64_t l2_cache_pf_useful;
+    uint64_t l2_cache_pf_late;
+    uint64_t l2_cache_pf_useless;
+
     /* Exceptions */
     uint64_t interrupts[24];
     uint64_t exceptions[24];
     uint64_t pipeline_flush;
 } SimStats;
 
+/* Requests sent by the memory controller to one of its back ends: host DRAM,
+ * then PIM if AiMulator serves the PIM area */
+#define NUM_MAX_MEM_BACKENDS 2
+
+typedef struct MemBackendStats
+{
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t aim_cmds;
+} MemBackendStats;
+
 /* Performance counters are printed to file in CSV format when simulation
  * completes */
 void sim_stats_print_to_file(const SimStats *s, const char *pathname,
@@ -114,5 +155,8 @@ void sim_stats_print_to_file(const SimStats *s, const char *pathname,
  * simulation completes */
 void sim_stats_print_to_terminal(const SimStats *s);
 void sim_stats_reset(SimStats *s);
+void sim_stats_get_total(SimStats *total, const SimStats *s);
+void sim_stats_add_delta(SimStats *acc, const SimStats *end,
+                         const SimStats *start);
 int sim_file_path_valid(const char *path);
 #endif
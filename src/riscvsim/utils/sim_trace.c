@@ -26,26 +26,273 @@
  */
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
 
+#include "sim_log.h"
+#include "sim_params.h"
 #include "sim_trace.h"
 
+static void
+write_to_trace_file(SimTrace *s, const void *data, size_t size)
+{
+    if (fwrite(data, 1, size, s->trace_fp) != size)
+    {
+        sim_assert((0), "error: %s at line %d in %s(): %s", __FILE__, __LINE__,
+                   __func__, "failed to write the simulation trace");
+    }
+    s->file_offset += size;
+}
+
+static void
+write_chunk(SimTrace *s, const SimTraceChunk *c)
+{
+    SimTraceChunkHeader h;
+    SimTraceIndexEntry *ie;
+    uLongf compressed_size = compressBound(SIM_TRACE_CHUNK_SIZE);
+
+    if (compress2(s->compressed, &compressed_size, c->data, c->size,
+                  Z_BEST_SPEED)
+        != Z_OK)
+    {
+        sim_assert((0), "error: %s at line %d in %s(): %s", __FILE__, __LINE__,
+                   __func__, "failed to compress the simulation trace");
+    }
+
+    if (s->num_chunks == s->max_chunks)
+    {
+        s->max_chunks = s->max_chunks ? 2 * s->max_chunks : 1024;
+        s->index = (SimTraceIndexEntry *)realloc(
+            s->index, s->max_chunks * sizeof(SimTraceIndexEntry));
+        assert(s->index);
+    }
+
+    ie = &s->index[s->num_chunks++];
+    ie->offset = s->file_offset;
+    ie->min_cycle = c->min_cycle;
+    ie->max_cycle = c->max_cycle;
+    ie->num_records = c->num_records;
+
+    memset(&h, 0, sizeof(h));
+    h.raw_size = c->size;
+    h.compressed_size = compressed_size;
+    h.num_records = c->num_records;
+    h.min_cycle = c->min_cycle;
+    h.max_cycle = c->max_cycle;
+    write_to_trace_file(s, &h, sizeof(h));
+    write_to_trace_file(s, s->compressed, compressed_size);
+}
+
+/* Background thread compressing and writing the full chunks */
+static void *
+trace_writer(void *arg)
+{
+    SimTrace *s = (SimTrace *)arg;
+
+    while (1)
+    {
+        pthread_mutex_lock(&s->lock);
+        while (!s->num_pending && !s->stop)
+        {
+            pthread_cond_wait(&s->chunk_pending, &s->lock);
+        }
+
+        if (!s->num_pending)
+        {
+            pthread_mutex_unlock(&s->lock);
+            break;
+        }
+        pthread_mutex_unlock(&s->lock);
+
+        /* The chunk stays owned by this thread until it is written */
+        write_chunk(s, &s->chunk[s->tail]);
+
+        pthread_mutex_lock(&s->lock);
+        s->tail = (s->tail + 1) % SIM_TRACE_NUM_CHUNKS;
+        --s->num_pending;
+        pthread_cond_signal(&s->chunk_free);
+        pthread_mutex_unlock(&s->lock);
+    }
+
+    return NULL;
+}
+
+static void
+reset_chunk(SimTrace *s, SimTraceChunk *c)
+{
+    c->size = 0;
+    c->num_records = 0;
+    c->min_cycle = UINT64_MAX;
+    c->max_cycle = 0;
+    s->prev_cycle = 0;
+    s->next_pc = 0;
+}
+
+/* Hand the current chunk over to the background thread and wait for the next
+ * one to be free */
+static void
+submit_chunk(SimTrace *s)
+{
+    pthread_mutex_lock(&s->lock);
+    ++s->num_pending;
+    s->head = (s->head + 1) % SIM_TRACE_NUM_CHUNKS;
+    pthread_cond_signal(&s->chunk_pending);
+    while (s->num_pending == SIM_TRACE_NUM_CHUNKS)
+    {
+        pthread_cond_wait(&s->chunk_free, &s->lock);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    reset_chunk(s, &s->chunk[s->head]);
+}
+
+static void
+write_binary_record(SimTrace *s, uint64_t clock_cycle, int cpu_mode,
+                    target_ulong pc, uint32_t insn)
+{
+    uint8_t *p;
+    uint8_t flags;
+    int insn_size;
+    SimTraceChunk *c = &s->chunk[s->head];
+
+    insn_size = ((insn & 3) != 3) ? 2 : 4;
+    flags = cpu_mode & SIM_TRACE_MODE_MASK;
+    if (insn_size == 2)
+    {
+        flags |= SIM_TRACE_COMPRESSED_INSN;
+    }
+    if (pc == s->next_pc)
+    {
+        flags |= SIM_TRACE_SEQUENTIAL_PC;
+    }
+
+    p = c->data + c->size;
+    *p++ = flags;
+    p = sim_trace_put_varint(
+        p, sim_trace_zigzag_encode((int64_t)(clock_cycle - s->prev_cycle)));
+    if (!(flags & SIM_TRACE_SEQUENTIAL_PC))
+    {
+        p = sim_trace_put_varint(
+            p, sim_trace_zigzag_encode((int64_t)(pc - s->next_pc)));
+    }
+    memcpy(p, &insn, insn_size);
+    p += insn_size;
+
+    c->size = p - c->data;
+    ++c->num_records;
+    if (clock_cycle < c->min_cycle)
+    {
+        c->min_cycle = clock_cycle;
+    }
+    if (clock_cycle > c->max_cycle)
+    {
+        c->max_cycle = clock_cycle;
+    }
+    s->prev_cycle = clock_cycle;
+    s->next_pc = pc + insn_size;
+
+    if (c->size > SIM_TRACE_CHUNK_SIZE - SIM_TRACE_MAX_RECORD_SIZE)
+    {
+        submit_chunk(s);
+    }
+}
+
 void
-sim_trace_start(SimTrace *s, const char *filename)
+sim_trace_start(SimTrace *s, const char *filename, int format)
 {
+    int i;
+    SimTraceFileHeader h;
+
+    s->format = format;
     s->trace_fp = fopen(filename, "w");
     assert(s->trace_fp);
+
+    if (s->format != SIM_TRACE_FORMAT_BINARY)
+    {
+        return;
+    }
+
+    for (i = 0; i < SIM_TRACE_NUM_CHUNKS; ++i)
+    {
+        if (!s->chunk[i].data)
+        {
+            s->chunk[i].data = (uint8_t *)malloc(SIM_TRACE_CHUNK_SIZE);
+            assert(s->chunk[i].data);
+        }
+    }
+
+    if (!s->compressed)
+    {
+        s->compressed = (uint8_t *)malloc(compressBound(SIM_TRACE_CHUNK_SIZE));
+        assert(s->compressed);
+    }
+
+    s->file_offset = 0;
+    s->num_chunks = 0;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SIM_TRACE_MAGIC, sizeof(h.magic));
+    h.version = SIM_TRACE_VERSION;
+    h.chunk_size = SIM_TRACE_CHUNK_SIZE;
+    write_to_trace_file(s, &h, sizeof(h));
+
+    s->head = 0;
+    s->tail = 0;
+    s->num_pending = 0;
+    s->stop = FALSE;
+    reset_chunk(s, &s->chunk[s->head]);
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->chunk_pending, NULL);
+    pthread_cond_init(&s->chunk_free, NULL);
+    if (pthread_create(&s->writer, NULL, trace_writer, s))
+    {
+        sim_assert((0), "error: %s at line %d in %s(): %s", __FILE__, __LINE__,
+                   __func__, "failed to start the trace writer thread");
+    }
 }
 
 void
 sim_trace_stop(SimTrace *s)
 {
+    SimTraceFileFooter f;
+
+    if (s->format == SIM_TRACE_FORMAT_BINARY)
+    {
+        if (s->chunk[s->head].num_records)
+        {
+            submit_chunk(s);
+        }
+
+        pthread_mutex_lock(&s->lock);
+        s->stop = TRUE;
+        pthread_cond_signal(&s->chunk_pending);
+        pthread_mutex_unlock(&s->lock);
+        pthread_join(s->writer, NULL);
+        pthread_cond_destroy(&s->chunk_free);
+        pthread_cond_destroy(&s->chunk_pending);
+        pthread_mutex_destroy(&s->lock);
+
+        memset(&f, 0, sizeof(f));
+        f.index_offset = s->file_offset;
+        f.num_chunks = s->num_chunks;
+        memcpy(f.magic, SIM_TRACE_INDEX_MAGIC, sizeof(SIM_TRACE_INDEX_MAGIC));
+        write_to_trace_file(s, s->index,
+                            s->num_chunks * sizeof(SimTraceIndexEntry));
+        write_to_trace_file(s, &f, sizeof(f));
+    }
+
     fclose(s->trace_fp);
 }
 
 void
-sim_trace_commit(const SimTrace *s, uint64_t clock_cycle, int cpu_mode,
+sim_trace_commit(SimTrace *s, uint64_t clock_cycle, int cpu_mode,
                  InstructionLatch *e)
 {
+    if (s->format == SIM_TRACE_FORMAT_BINARY)
+    {
+        write_binary_record(s, clock_cycle, cpu_mode, e->ins.pc, e->ins.binary);
+        return;
+    }
+
     fprintf(s->trace_fp, "cycle=%" TARGET_ULONG_FMT, clock_cycle);
     fprintf(s->trace_fp, " pc=%" TARGET_ULONG_HEX, e->ins.pc);
     fprintf(s->trace_fp, " insn=%" PRIx32, e->ins.binary);
@@ -55,9 +302,15 @@ sim_trace_commit(const SimTrace *s, uint64_t clock_cycle, int cpu_mode,
 }
 
 void
-sim_trace_exception(const SimTrace *s, uint64_t clock_cycle, int cpu_mode,
+sim_trace_exception(SimTrace *s, uint64_t clock_cycle, int cpu_mode,
                     SimException *e)
 {
+    if (s->format == SIM_TRACE_FORMAT_BINARY)
+    {
+        write_binary_record(s, clock_cycle, cpu_mode, e->pc, e->insn);
+        return;
+    }
+
     fprintf(s->trace_fp, "cycle=%" TARGET_ULONG_FMT, clock_cycle);
     fprintf(s->trace_fp, " pc=%" TARGET_ULONG_HEX, e->pc);
     fprintf(s->trace_fp, " insn=%" PRIx32, e->insn);
@@ -78,6 +331,14 @@ sim_trace_init()
 void
 sim_trace_free(SimTrace **s)
 {
+    int i;
+
+    for (i = 0; i < SIM_TRACE_NUM_CHUNKS; ++i)
+    {
+        free((*s)->chunk[i].data);
+    }
+    free((*s)->compressed);
+    free((*s)->index);
     free(*s);
     *s = NULL;
-}
\ No newline at end of file
+}
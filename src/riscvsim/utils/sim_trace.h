@@ -28,22 +28,59 @@
 #define _SIM_TRACE_H_
 
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdio.h>
 
 #include "cpu_latches.h"
 #include "sim_exception.h"
+#include "sim_trace_format.h"
+
+/* Number of chunk buffers shared with the compression thread */
+#define SIM_TRACE_NUM_CHUNKS 4
+
+typedef struct SimTraceChunk
+{
+    uint8_t *data;
+    uint32_t size;
+    uint32_t num_records;
+    uint64_t min_cycle;
+    uint64_t max_cycle;
+} SimTraceChunk;
 
 typedef struct SimTrace
 {
     FILE *trace_fp;
+    int format;
+
+    /* Binary format: records are appended to chunk[head], full chunks are
+     * compressed and written to the file by a background thread, from
+     * chunk[tail] onwards */
+    SimTraceChunk chunk[SIM_TRACE_NUM_CHUNKS];
+    int head;
+    int tail;
+    int num_pending;
+    int stop;
+    uint64_t prev_cycle;
+    uint64_t next_pc;
+    pthread_t writer;
+    pthread_mutex_t lock;
+    pthread_cond_t chunk_pending;
+    pthread_cond_t chunk_free;
+
+    /* Owned by the background thread until it exits */
+    uint8_t *compressed;
+    uint64_t file_offset;
+    SimTraceIndexEntry *index;
+    uint64_t num_chunks;
+    uint64_t max_chunks;
 } SimTrace;
 
 SimTrace *sim_trace_init();
-void sim_trace_start(SimTrace *s, const char *filename);
+void sim_trace_start(SimTrace *s, const char *filename, int format);
 void sim_trace_stop(SimTrace *s);
-void sim_trace_commit(const SimTrace *s, uint64_t clock_cycle, int cpu_mode,
+void sim_trace_commit(SimTrace *s, uint64_t clock_cycle, int cpu_mode,
                       InstructionLatch *e);
-void sim_trace_exception(const SimTrace *s, uint64_t clock_cycle, int cpu_mode,
+void sim_trace_exception(SimTrace *s, uint64_t clock_cycle, int cpu_mode,
                          SimException *e);
 void sim_trace_free(SimTrace **s);
 #endif
@@ -0,0 +1,136 @@
+/**
+ * Binary Simulation Trace Format
+ *
+ * MARSS-RISCV : Micro-Architectural System Simulator for RISC-V
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _SIM_TRACE_FORMAT_H_
+#define _SIM_TRACE_FORMAT_H_
+
+#include <inttypes.h>
+
+/*
+ * File layout, all fields in host byte order:
+ *
+ *   SimTraceFileHeader
+ *   SimTraceChunkHeader, zlib compressed records    (repeated)
+ *   SimTraceIndexEntry                              (one per chunk)
+ *   SimTraceFileFooter
+ *
+ * Each chunk is decoded on its own, so a reader can use the index to seek to a
+ * cycle range. The index and footer are written when the trace is closed; for
+ * a trace cut short, the chunk headers can still be scanned in order.
+ *
+ * A record is a flags byte followed by:
+ * - zigzag varint of the cycle delta from the previous record
+ * - zigzag varint of the PC delta from the previous record, only if the PC is
+ *   not the one right after the previous instruction
+ * - the instruction word, 2 bytes for a compressed instruction, else 4 bytes
+ * The previous cycle and PC are 0 at the start of every chunk.
+ */
+
+#define SIM_TRACE_MAGIC "MRVTRACE"
+#define SIM_TRACE_INDEX_MAGIC "MRVTIDX"
+#define SIM_TRACE_VERSION 1
+
+/* Uncompressed size of a chunk */
+#define SIM_TRACE_CHUNK_SIZE (1 << 20)
+#define SIM_TRACE_MAX_RECORD_SIZE 32
+
+/* Record flags */
+#define SIM_TRACE_MODE_MASK 0x3
+#define SIM_TRACE_COMPRESSED_INSN 0x4
+#define SIM_TRACE_SEQUENTIAL_PC 0x8
+
+typedef struct SimTraceFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t chunk_size;
+} SimTraceFileHeader;
+
+typedef struct SimTraceChunkHeader
+{
+    uint32_t raw_size;
+    uint32_t compressed_size;
+    uint32_t num_records;
+    uint32_t reserved;
+    uint64_t min_cycle;
+    uint64_t max_cycle;
+} SimTraceChunkHeader;
+
+typedef struct SimTraceIndexEntry
+{
+    uint64_t offset; /* of the chunk header */
+    uint64_t min_cycle;
+    uint64_t max_cycle;
+    uint64_t num_records;
+} SimTraceIndexEntry;
+
+typedef struct SimTraceFileFooter
+{
+    uint64_t index_offset;
+    uint64_t num_chunks;
+    char magic[8];
+} SimTraceFileFooter;
+
+static inline uint64_t
+sim_trace_zigzag_encode(int64_t val)
+{
+    return ((uint64_t)val << 1) ^ (uint64_t)(val >> 63);
+}
+
+static inline int64_t
+sim_trace_zigzag_decode(uint64_t val)
+{
+    return (int64_t)(val >> 1) ^ -(int64_t)(val & 1);
+}
+
+static inline uint8_t *
+sim_trace_put_varint(uint8_t *p, uint64_t val)
+{
+    while (val >= 0x80)
+    {
+        *p++ = (uint8_t)(val | 0x80);
+        val >>= 7;
+    }
+    *p++ = (uint8_t)val;
+    return p;
+}
+
+/* Returns NULL if the varint runs past end */
+static inline const uint8_t *
+sim_trace_get_varint(const uint8_t *p, const uint8_t *end, uint64_t *val)
+{
+    int shift = 0;
+
+    *val = 0;
+    while (p < end && shift < 64)
+    {
+        *val |= (uint64_t)(*p & 0x7f) << shift;
+        if (!(*p++ & 0x80))
+        {
+            return p;
+        }
+        shift += 7;
+    }
+    return NULL;
+}
+#endif
@@ -0,0 +1,304 @@
+/**
+ * Binary Simulation Trace Reader
+ *
+ * MARSS-RISCV : Micro-Architectural System Simulator for RISC-V
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include "sim_trace_reader.h"
+
+static int
+add_index_entry(SimTraceReader *r, uint64_t *max_chunks,
+                const SimTraceIndexEntry *ie)
+{
+    SimTraceIndexEntry *index;
+
+    if (r->num_chunks == *max_chunks)
+    {
+        *max_chunks = *max_chunks ? 2 * *max_chunks : 1024;
+        index = (SimTraceIndexEntry *)realloc(
+            r->index, *max_chunks * sizeof(SimTraceIndexEntry));
+        if (!index)
+        {
+            return -1;
+        }
+        r->index = index;
+    }
+
+    r->index[r->num_chunks++] = *ie;
+    return 0;
+}
+
+/* Read the index written at the end of the trace */
+static int
+read_index(SimTraceReader *r, off_t file_size)
+{
+    SimTraceFileFooter f;
+
+    if (file_size < (off_t)(sizeof(SimTraceFileHeader) + sizeof(f))
+        || fseeko(r->fp, file_size - sizeof(f), SEEK_SET)
+        || fread(&f, sizeof(f), 1, r->fp) != 1
+        || memcmp(f.magic, SIM_TRACE_INDEX_MAGIC, sizeof(SIM_TRACE_INDEX_MAGIC))
+        || f.index_offset + f.num_chunks * sizeof(SimTraceIndexEntry)
+               != file_size - sizeof(f))
+    {
+        return -1;
+    }
+
+    r->index = (SimTraceIndexEntry *)malloc(
+        (f.num_chunks ? f.num_chunks : 1) * sizeof(SimTraceIndexEntry));
+    if (!r->index || fseeko(r->fp, f.index_offset, SEEK_SET)
+        || fread(r->index, sizeof(SimTraceIndexEntry), f.num_chunks, r->fp)
+               != f.num_chunks)
+    {
+        return -1;
+    }
+
+    r->num_chunks = f.num_chunks;
+    return 0;
+}
+
+/* Rebuild the index from the chunk headers, for a trace which was not closed.
+ * A partially written chunk at the end is ignored. */
+static int
+scan_index(SimTraceReader *r, off_t file_size)
+{
+    SimTraceChunkHeader h;
+    SimTraceIndexEntry ie;
+    uint64_t max_chunks = 0;
+    off_t offset = sizeof(SimTraceFileHeader);
+
+    free(r->index);
+    r->index = NULL;
+    r->num_chunks = 0;
+
+    while (offset + (off_t)sizeof(h) <= file_size)
+    {
+        if (fseeko(r->fp, offset, SEEK_SET) || fread(&h, sizeof(h), 1, r->fp) != 1
+            || offset + (off_t)sizeof(h) + h.compressed_size > file_size)
+        {
+            break;
+        }
+
+        ie.offset = offset;
+        ie.min_cycle = h.min_cycle;
+        ie.max_cycle = h.max_cycle;
+        ie.num_records = h.num_records;
+        if (add_index_entry(r, &max_chunks, &ie))
+        {
+            return -1;
+        }
+        offset += sizeof(h) + h.compressed_size;
+    }
+
+    return 0;
+}
+
+SimTraceReader *
+sim_trace_reader_open(const char *filename)
+{
+    SimTraceReader *r;
+    SimTraceFileHeader h;
+    off_t file_size;
+
+    r = (SimTraceReader *)calloc(1, sizeof(SimTraceReader));
+    if (!r)
+    {
+        return NULL;
+    }
+
+    r->fp = fopen(filename, "rb");
+    if (!r->fp)
+    {
+        fprintf(stderr, "error: cannot open %s\n", filename);
+        goto fail;
+    }
+
+    if (fread(&h, sizeof(h), 1, r->fp) != 1
+        || memcmp(h.magic, SIM_TRACE_MAGIC, sizeof(h.magic))
+        || h.version != SIM_TRACE_VERSION || h.chunk_size > SIM_TRACE_CHUNK_SIZE)
+    {
+        fprintf(stderr, "error: %s is not a binary simulation trace\n",
+                filename);
+        goto fail;
+    }
+
+    if (fseeko(r->fp, 0, SEEK_END) || (file_size = ftello(r->fp)) < 0)
+    {
+        goto fail;
+    }
+
+    if (read_index(r, file_size))
+    {
+        fprintf(stderr, "warning: %s has no index, trace may be truncated\n",
+                filename);
+        if (scan_index(r, file_size))
+        {
+            goto fail;
+        }
+    }
+
+    r->data = (uint8_t *)malloc(SIM_TRACE_CHUNK_SIZE);
+    if (!r->data)
+    {
+        goto fail;
+    }
+
+    return r;
+
+fail:
+    sim_trace_reader_close(&r);
+    return NULL;
+}
+
+void
+sim_trace_reader_close(SimTraceReader **r)
+{
+    if ((*r)->fp)
+    {
+        fclose((*r)->fp);
+    }
+    free((*r)->index);
+    free((*r)->data);
+    free((*r)->compressed);
+    free(*r);
+    *r = NULL;
+}
+
+/* Position the reader at the first chunk which can hold a record at or after
+ * the given cycle */
+void
+sim_trace_reader_seek(SimTraceReader *r, uint64_t cycle)
+{
+    for (r->next_chunk = 0; r->next_chunk < r->num_chunks; ++r->next_chunk)
+    {
+        if (r->index[r->next_chunk].max_cycle >= cycle)
+        {
+            break;
+        }
+    }
+    r->pos = r->end = NULL;
+}
+
+static int
+read_chunk(SimTraceReader *r)
+{
+    SimTraceChunkHeader h;
+    uLongf raw_size = SIM_TRACE_CHUNK_SIZE;
+    uint8_t *compressed;
+
+    if (fseeko(r->fp, r->index[r->next_chunk].offset, SEEK_SET)
+        || fread(&h, sizeof(h), 1, r->fp) != 1
+        || h.raw_size > SIM_TRACE_CHUNK_SIZE)
+    {
+        return -1;
+    }
+
+    if (h.compressed_size > r->compressed_max_size)
+    {
+        compressed = (uint8_t *)realloc(r->compressed, h.compressed_size);
+        if (!compressed)
+        {
+            return -1;
+        }
+        r->compressed = compressed;
+        r->compressed_max_size = h.compressed_size;
+    }
+
+    if (fread(r->compressed, 1, h.compressed_size, r->fp) != h.compressed_size
+        || uncompress(r->data, &raw_size, r->compressed, h.compressed_size)
+               != Z_OK
+        || raw_size != h.raw_size)
+    {
+        return -1;
+    }
+
+    ++r->next_chunk;
+    r->pos = r->data;
+    r->end = r->data + raw_size;
+    r->prev_cycle = 0;
+    r->next_pc = 0;
+    return 0;
+}
+
+/* Returns 1 if a record was read, 0 at the end of the trace, -1 on a corrupt
+ * trace */
+int
+sim_trace_reader_next(SimTraceReader *r, SimTraceRecord *rec)
+{
+    uint8_t flags;
+    uint64_t val;
+    int insn_size;
+
+    while (r->pos == r->end)
+    {
+        if (r->next_chunk == r->num_chunks)
+        {
+            return 0;
+        }
+
+        if (read_chunk(r))
+        {
+            fprintf(stderr, "error: corrupt chunk %" PRIu64 "\n",
+                    r->next_chunk);
+            return -1;
+        }
+    }
+
+    flags = *r->pos++;
+    if (!(r->pos = sim_trace_get_varint(r->pos, r->end, &val)))
+    {
+        goto corrupt;
+    }
+    rec->cycle = r->prev_cycle + sim_trace_zigzag_decode(val);
+
+    rec->pc = r->next_pc;
+    if (!(flags & SIM_TRACE_SEQUENTIAL_PC))
+    {
+        if (!(r->pos = sim_trace_get_varint(r->pos, r->end, &val)))
+        {
+            goto corrupt;
+        }
+        rec->pc += sim_trace_zigzag_decode(val);
+    }
+
+    insn_size = (flags & SIM_TRACE_COMPRESSED_INSN) ? 2 : 4;
+    if (r->end - r->pos < insn_size)
+    {
+        goto corrupt;
+    }
+    rec->insn = 0;
+    memcpy(&rec->insn, r->pos, insn_size);
+    r->pos += insn_size;
+    rec->cpu_mode = flags & SIM_TRACE_MODE_MASK;
+
+    r->prev_cycle = rec->cycle;
+    r->next_pc = rec->pc + insn_size;
+    return 1;
+
+corrupt:
+    fprintf(stderr, "error: corrupt record in chunk %" PRIu64 "\n",
+            r->next_chunk - 1);
+    r->pos = r->end = NULL;
+    return -1;
+}
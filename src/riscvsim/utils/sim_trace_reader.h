@@ -0,0 +1,62 @@
+/**
+ * Binary Simulation Trace Reader
+ *
+ * MARSS-RISCV : Micro-Architectural System Simulator for RISC-V
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef _SIM_TRACE_READER_H_
+#define _SIM_TRACE_READER_H_
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "sim_trace_format.h"
+
+typedef struct SimTraceRecord
+{
+    uint64_t cycle;
+    uint64_t pc;
+    uint32_t insn;
+    int cpu_mode;
+} SimTraceRecord;
+
+/* Reads a binary trace one chunk at a time */
+typedef struct SimTraceReader
+{
+    FILE *fp;
+    SimTraceIndexEntry *index;
+    uint64_t num_chunks;
+    uint64_t next_chunk;
+
+    /* Current chunk */
+    uint8_t *data;
+    uint8_t *compressed;
+    uint32_t compressed_max_size;
+    const uint8_t *pos;
+    const uint8_t *end;
+    uint64_t prev_cycle;
+    uint64_t next_pc;
+} SimTraceReader;
+
+SimTraceReader *sim_trace_reader_open(const char *filename);
+void sim_trace_reader_close(SimTraceReader **r);
+void sim_trace_reader_seek(SimTraceReader *r, uint64_t cycle);
+int sim_trace_reader_next(SimTraceReader *r, SimTraceRecord *rec);
+#endif
@@ -0,0 +1,267 @@
+/*
+ * AiMulator Request Trace Replay Tool
+ *
+ * MARSS-RISCV : Micro-Architectural System Simulator for RISC-V
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "riscvsim/memory_hierarchy/aim_trace_reader.h"
+#include "riscvsim/memory_hierarchy/aimulator_wrapper_c_connector.h"
+
+#define NOT_DONE UINT64_MAX
+
+typedef struct ReplayRequest
+{
+    uint64_t issue_clock;
+    uint64_t done_clock; /* once all the entries are served */
+    int num_entries_pending;
+} ReplayRequest;
+
+static void
+usage(void)
+{
+    printf("usage: sim-aim-replay [options] aimulator_config_file trace_file\n"
+           "Run the AiMulator requests recorded with -sim-aim-trace against an\n"
+           "AiMulator configuration, without simulating the CPU\n"
+           "options are:\n"
+           "-o dir      directory to store the AiMulator stats (default=.)\n"
+           "-t name     name of the AiMulator stats (default=replay)\n"
+           "-n num      max requests in flight (default=recorded one)\n");
+    exit(1);
+}
+
+static ReplayRequest *
+add_request(ReplayRequest *req, uint64_t num_requests, uint64_t *max_requests)
+{
+    if (num_requests == *max_requests)
+    {
+        *max_requests = *max_requests ? 2 * *max_requests : 4096;
+        req = (ReplayRequest *)realloc(req,
+                                       *max_requests * sizeof(ReplayRequest));
+        if (!req)
+        {
+            fprintf(stderr, "error: out of memory\n");
+            exit(1);
+        }
+    }
+
+    return req;
+}
+
+int
+main(int argc, char **argv)
+{
+    int c, i, ret, entry_idx;
+    int max_inflight = 0, num_inflight = 0;
+    const char *stats_dir = ".", *stats_name = "replay";
+    uint64_t clock = 0, due, dep, req_id;
+    uint64_t prev_issue_clock = 0, prev_rec_clock = 0;
+    uint64_t num_requests = 0, max_requests = 0, first_pending = 0;
+    uint64_t num_entries = 0, num_completed = 0, total_latency = 0;
+    ReplayRequest *req = NULL;
+    PendingMemAccessEntry *entry, **e;
+    AimTraceReader *r;
+    AimTraceRecord rec;
+    AimulatorWrapper *w;
+
+    while ((c = getopt(argc, argv, "ho:t:n:")) != -1)
+    {
+        switch (c)
+        {
+            case 'o':
+            {
+                stats_dir = optarg;
+                break;
+            }
+            case 't':
+            {
+                stats_name = optarg;
+                break;
+            }
+            case 'n':
+            {
+                max_inflight = atoi(optarg);
+                break;
+            }
+            default:
+            {
+                usage();
+            }
+        }
+    }
+
+    if (optind + 2 != argc)
+    {
+        usage();
+    }
+
+    r = aim_trace_reader_open(argv[optind + 1]);
+    if (!r)
+    {
+        return 1;
+    }
+
+    if (max_inflight <= 0)
+    {
+        max_inflight = r->header.max_inflight_requests;
+    }
+
+    entry = (PendingMemAccessEntry *)calloc(r->header.aim_batch_size,
+                                            sizeof(PendingMemAccessEntry));
+    e = (PendingMemAccessEntry **)calloc(r->header.aim_batch_size,
+                                         sizeof(PendingMemAccessEntry *));
+    if (!entry || !e)
+    {
+        fprintf(stderr, "error: out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < (int)r->header.aim_batch_size; ++i)
+    {
+        e[i] = &entry[i];
+    }
+
+    w = aimulator_wrapper_init(argv[optind]);
+
+    /* Records are sent in order, as the memory controller did: each one no
+     * sooner than the recorded delay after the previous one, and after the
+     * recorded delay from the completion of the request it depends on. The
+     * front of the trace blocks the records behind it, and requests the
+     * AiMulator frontend cannot accept wait in the retry queue of the
+     * wrapper, like during simulation. */
+    ret = aim_trace_reader_next(r, &rec);
+    while (ret > 0 || num_inflight)
+    {
+        while (ret > 0)
+        {
+            due = prev_issue_clock + (rec.clock - prev_rec_clock);
+            if (rec.type != AIM_TRACE_RESET && rec.dep_distance)
+            {
+                if (rec.dep_distance > num_requests)
+                {
+                    fprintf(stderr, "error: corrupt AiM request trace "
+                                    "dependency\n");
+                    return 1;
+                }
+
+                dep = num_requests - rec.dep_distance;
+                if (req[dep].done_clock == NOT_DONE)
+                {
+                    break;
+                }
+
+                if (req[dep].done_clock + rec.dep_gap > due)
+                {
+                    due = req[dep].done_clock + rec.dep_gap;
+                }
+            }
+
+            if (clock < due)
+            {
+                break;
+            }
+
+            if (rec.type == AIM_TRACE_RESET)
+            {
+                /* The requests in flight are dropped */
+                aimulator_wrapper_reset(w);
+                for (; first_pending < num_requests; ++first_pending)
+                {
+                    if (req[first_pending].done_clock == NOT_DONE)
+                    {
+                        req[first_pending].done_clock = clock;
+                    }
+                }
+                num_inflight = 0;
+            }
+            else
+            {
+                /* Each entry of a batch takes one of the requests in
+                 * flight, as in the DRAM model */
+                if (num_inflight
+                    && (num_inflight + rec.num_entries > max_inflight))
+                {
+                    break;
+                }
+
+                for (i = 0; i < rec.num_entries; ++i)
+                {
+                    entry[i].type = (MemAccessType)rec.type;
+                    entry[i].addr = rec.addr[i];
+                    entry[i].access_size_bytes = rec.access_size_bytes;
+                }
+
+                req = add_request(req, num_requests, &max_requests);
+                req[num_requests].issue_clock = clock;
+                req[num_requests].done_clock = NOT_DONE;
+                req[num_requests].num_entries_pending = rec.num_entries;
+                aimulator_wrapper_send_request(w, num_requests, e,
+                                               rec.num_entries);
+                ++num_requests;
+                num_entries += rec.num_entries;
+                num_inflight += rec.num_entries;
+            }
+
+            prev_issue_clock = clock;
+            prev_rec_clock = rec.clock;
+            ret = aim_trace_reader_next(r, &rec);
+        }
+
+        if (ret < 0)
+        {
+            return 1;
+        }
+
+        ++clock;
+        aimulator_wrapper_tick(w);
+        while (aimulator_wrapper_get_completed_entry(w, &req_id, &entry_idx))
+        {
+            --num_inflight;
+            if (--req[req_id].num_entries_pending)
+            {
+                continue;
+            }
+            req[req_id].done_clock = clock;
+            total_latency += clock - req[req_id].issue_clock;
+            ++num_completed;
+        }
+    }
+
+    printf("replayed %" PRIu64 " requests (%" PRIu64 " entries) in %" PRIu64
+           " memory clocks, %" PRIu64 " when recorded\n",
+           num_requests, num_entries, clock, prev_rec_clock);
+    printf("average request latency: %.2lf memory clocks\n",
+           num_completed ? (double)total_latency / num_completed : 0.0);
+
+    aimulator_wrapper_finish_and_print_stats(w, stats_dir, stats_name);
+    printf("saved aimulator statistics in %s/aimulator_%s.stats\n", stats_dir,
+           stats_name);
+
+    aimulator_wrapper_destroy(&w);
+    aim_trace_reader_close(&r);
+    free(req);
+    free(entry);
+    free(e);
+    return 0;
+}
@@ -0,0 +1,116 @@
+/*
+ * Binary Simulation Trace Dump Tool
+ *
+ * MARSS-RISCV : Micro-Architectural System Simulator for RISC-V
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "riscvsim/decoder/riscv_instruction.h"
+#include "riscvsim/utils/sim_trace_reader.h"
+
+/* Same as cpu_mode_str in sim_params.c */
+static const char *cpu_mode_str[]
+    = {"user", "supervisor", "hypervisor", "machine"};
+
+static void
+usage(void)
+{
+    printf("usage: sim-trace-dump [options] trace_file\n"
+           "Print a binary simulation trace in the text trace format\n"
+           "options are:\n"
+           "-s cycle    first cycle to print\n"
+           "-e cycle    last cycle to print\n");
+    exit(1);
+}
+
+int
+main(int argc, char **argv)
+{
+    int c, ret;
+    uint64_t start_cycle = 0, end_cycle = UINT64_MAX;
+    SimTraceReader *r;
+    SimTraceRecord rec;
+    RVInstruction ins;
+    char ins_str[RISCV_INS_STR_MAX_LENGTH];
+
+    while ((c = getopt(argc, argv, "hs:e:")) != -1)
+    {
+        switch (c)
+        {
+            case 's':
+            {
+                start_cycle = strtoull(optarg, NULL, 0);
+                break;
+            }
+            case 'e':
+            {
+                end_cycle = strtoull(optarg, NULL, 0);
+                break;
+            }
+            default:
+            {
+                usage();
+            }
+        }
+    }
+
+    if (optind >= argc)
+    {
+        usage();
+    }
+
+    r = sim_trace_reader_open(argv[optind]);
+    if (!r)
+    {
+        return 1;
+    }
+
+    /* Records are in cycle order, as each trace covers one simulation run */
+    sim_trace_reader_seek(r, start_cycle);
+    while ((ret = sim_trace_reader_next(r, &rec)) > 0)
+    {
+        if (rec.cycle < start_cycle)
+        {
+            continue;
+        }
+
+        if (rec.cycle > end_cycle)
+        {
+            break;
+        }
+
+        memset(&ins, 0, sizeof(ins));
+        ins_str[0] = '\0';
+        ins.str = ins_str;
+        ins.create_str = 1;
+        decode_riscv_binary(&ins, rec.insn);
+
+        printf("cycle=%" PRIu64 " pc=%" PRIx64 " insn=%" PRIx32 " %s mode=%s\n",
+               rec.cycle, rec.pc, rec.insn, ins.str, cpu_mode_str[rec.cpu_mode]);
+    }
+
+    sim_trace_reader_close(&r);
+    return (ret < 0) ? 1 : 0;
+}
@@ -178,6 +178,55 @@ print_tlb_stats()
     printf("\n");
 }
 
+/* Only shown for the caches with MSHRs */
+static void
+print_mshr_stats(const char *cache, uint64_t allocs, uint64_t merges,
+                 uint64_t occupancy)
+{
+    char name[32];
+
+    if (!allocs)
+    {
+        return;
+    }
+
+    snprintf(name, sizeof(name), "%s-mshr-allocs", cache);
+    printf("%-22s : %-22" PRIu64 " (%0.2lf busy on average)\n", name, allocs,
+           (double)occupancy / (double)allocs);
+
+    snprintf(name, sizeof(name), "%s-mshr-merges", cache);
+    printf("%-22s : %-22" PRIu64 "\n", name, merges);
+}
+
+/* Only shown for the caches with a prefetcher. Late prefetches are counted
+ * in the useful ones. */
+static void
+print_prefetch_stats(const char *cache, uint64_t issued, uint64_t useful,
+                     uint64_t late, uint64_t useless)
+{
+    char name[32];
+
+    if (!issued)
+    {
+        return;
+    }
+
+    snprintf(name, sizeof(name), "%s-prefetches", cache);
+    printf("%-22s : %-22" PRIu64 "\n", name, issued);
+
+    snprintf(name, sizeof(name), "%s-pf-useful", cache);
+    printf("%-22s : %-22" PRIu64 " (%0.2lf %%)\n", name, useful,
+           ((double)useful / (double)issued) * 100);
+
+    snprintf(name, sizeof(name), "%s-pf-late", cache);
+    printf("%-22s : %-22" PRIu64 " (%0.2lf %%)\n", name, late,
+           ((double)late / (double)issued) * 100);
+
+    snprintf(name, sizeof(name), "%s-pf-useless", cache);
+    printf("%-22s : %-22" PRIu64 " (%0.2lf %%)\n", name, useless,
+           ((double)useless / (double)issued) * 100);
+}
+
 static void
 print_caches_stats()
 {
@@ -215,6 +264,25 @@ print_caches_stats()
            ((double)l2_cache_write_hit / (double)GET_TOTAL_STAT(l2_cache_write))
                * 100);
 
+    print_mshr_stats("icache", GET_TOTAL_STAT(icache_mshr_allocs),
+                     GET_TOTAL_STAT(icache_mshr_merges),
+                     GET_TOTAL_STAT(icache_mshr_occupancy));
+    print_mshr_stats("dcache", GET_TOTAL_STAT(dcache_mshr_allocs),
+                     GET_TOTAL_STAT(dcache_mshr_merges),
+                     GET_TOTAL_STAT(dcache_mshr_occupancy));
+    print_mshr_stats("l2-shared", GET_TOTAL_STAT(l2_cache_mshr_allocs),
+                     GET_TOTAL_STAT(l2_cache_mshr_merges),
+                     GET_TOTAL_STAT(l2_cache_mshr_occupancy));
+
+    print_prefetch_stats("dcache", GET_TOTAL_STAT(dcache_pf_issued),
+                         GET_TOTAL_STAT(dcache_pf_useful),
+                         GET_TOTAL_STAT(dcache_pf_late),
+                         GET_TOTAL_STAT(dcache_pf_useless));
+    print_prefetch_stats("l2-shared", GET_TOTAL_STAT(l2_cache_pf_issued),
+                         GET_TOTAL_STAT(l2_cache_pf_useful),
+                         GET_TOTAL_STAT(l2_cache_pf_late),
+                         GET_TOTAL_STAT(l2_cache_pf_useless));
+
     printf("\n");
 }
 
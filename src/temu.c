@@ -306,6 +306,50 @@ static int bf_write_async(BlockDevice *bs,
     return ret;
 }
 
+/* in snapshot mode, the written sectors only exist in memory */
+static void bf_checkpoint(BlockDevice *bs, Checkpoint *ck)
+{
+    BlockDeviceFile *bf = bs->opaque;
+    uint64_t count, sector_num;
+    int64_t i;
+
+    if (ck->is_restore) {
+        checkpoint_data(ck, &count, sizeof(count));
+        if (count != 0 && bf->mode != BF_MODE_SNAPSHOT) {
+            fprintf(stderr, "checkpoint: the disk image must be restored in snapshot mode\n");
+            ck->error = TRUE;
+            return;
+        }
+        while (count-- > 0 && !ck->error) {
+            checkpoint_data(ck, &sector_num, sizeof(sector_num));
+            if (ck->error || sector_num >= bf->nb_sectors) {
+                ck->error = TRUE;
+                break;
+            }
+            if (!bf->sector_table[sector_num])
+                bf->sector_table[sector_num] = malloc(SECTOR_SIZE);
+            checkpoint_data(ck, bf->sector_table[sector_num], SECTOR_SIZE);
+        }
+    } else {
+        count = 0;
+        if (bf->mode == BF_MODE_SNAPSHOT) {
+            for(i = 0; i < bf->nb_sectors; i++) {
+                if (bf->sector_table[i])
+                    count++;
+            }
+        }
+        checkpoint_data(ck, &count, sizeof(count));
+        for(i = 0; i < bf->nb_sectors && count > 0; i++) {
+            if (bf->sector_table[i]) {
+                sector_num = i;
+                checkpoint_data(ck, &sector_num, sizeof(sector_num));
+                checkpoint_data(ck, bf->sector_table[i], SECTOR_SIZE);
+                count--;
+            }
+        }
+    }
+}
+
 static BlockDevice *block_device_init(const char *filename,
                                       BlockDeviceModeEnum mode)
 {
@@ -345,6 +389,7 @@ static BlockDevice *block_device_init(const char *filename,
     bs->get_sector_count = bf_get_sector_count;
     bs->read_async = bf_read_async;
     bs->write_async = bf_write_async;
+    bs->checkpoint = bf_checkpoint;
     return bs;
 }
 
@@ -624,6 +669,13 @@ static struct option options[] = {
     {"sim-file-path", required_argument},
     {"sim-file-prefix", required_argument},
     {"sim-stop-after-icount", required_argument},
+    {"sim-trace-format", required_argument},
+    {"checkpoint", required_argument},
+    {"restore", required_argument},
+    {"sim-sample", required_argument},
+    {"sim-profile", no_argument},
+    {"sim-epoch", required_argument},
+    {"sim-aim-trace", no_argument},
     {NULL},
 };
 
@@ -646,9 +698,21 @@ void help(void)
            "-sim-flush-mem                      flush simulator memory hierarchy on every new simulation run\n"
            "-sim-flush-bpu                      flush branch prediction unit on every new simulation run\n"
            "-sim-trace                          generate instruction commit trace in [trace-file-name] during simulation\n"
+           "-sim-trace-format [text,\n"
+           "                   binary]          format of the commit trace, binary traces are read by sim-trace-dump tool\n"
            "-sim-file-path [directory path]     path of the directory to store stats, log, and trace file\n"
            "-sim-file-prefix [prefix]           prefix appended to stats, log, and trace file names\n"
            "-sim-emulate-after-icount [icount]  switch to emulation mode after simulating icount instructions every time simulation starts\n"
+           "-checkpoint [file]                  save the machine state in file and exit when the simulation is first started\n"
+           "-restore [file]                     restore the machine state from file, saved with the same configuration\n"
+           "-sim-sample [ff,warmup,detail]      once simulation starts, repeatedly emulate ff instructions, warm the caches and\n"
+           "                                    BPU on warmup instructions, then simulate detail instructions\n"
+           "-sim-profile                        attribute the cycles in which no instruction commits to the blocking PC and\n"
+           "                                    guest physical region, saved next to the stats file\n"
+           "-sim-epoch [cycles|insns,N]         every N cycles or committed instructions, append the change of the stats\n"
+           "                                    as one JSON line to [prefix].epoch.jsonl\n"
+           "-sim-aim-trace                      record the requests sent to AiMulator in [prefix].aimtrace, which\n"
+           "                                    sim-aim-replay runs against other AiMulator configurations\n"
            "\n"
            "Console keys:\n"
            "Press C-a x to exit the emulator, C-a h to get some help.\n");
@@ -675,6 +739,7 @@ int main(int argc, char **argv)
     VirtMachine *s;
     char sim_log_file_name[1024];
     const char *path, *cmdline, *build_preload_file;
+    const char *checkpoint_file = NULL, *restore_file = NULL;
     char *sim_file_path = NULL, *sim_file_prefix = NULL, *sim_stats_shm_name = NULL;
     int c, option_index, i, ram_size, accel_enable;
     BOOL allow_ctrlc;
@@ -685,8 +750,14 @@ int main(int argc, char **argv)
     int marss_mem_model = MEM_MODEL_BASE;
     int marss_flush_sim_mem_on_simstart = FALSE;
     int marss_do_sim_trace = FALSE;
+    int marss_do_sim_profile = FALSE;
+    int marss_do_aim_trace = FALSE;
+    char marss_epoch_unit[16] = "cycles";
+    uint64_t marss_epoch_length = 0;
+    int marss_sim_trace_format = SIM_TRACE_FORMAT_TEXT;
     int marss_flush_bpu_on_simstart = FALSE;
     uint64_t marss_sim_emulate_after_icount = 0;
+    uint64_t marss_sample_icount[3] = { 0, 0, 0 };
 
     ram_size = -1;
     allow_ctrlc = FALSE;
@@ -768,6 +839,52 @@ int main(int argc, char **argv)
             case 15: /* sim-stop-after-icount */
                 marss_sim_emulate_after_icount = strtoll(optarg, NULL, 10);
                 break;
+            case 16: /* sim-trace-format */
+                if (strcmp(optarg, "text") == 0)
+                {
+                    marss_sim_trace_format = SIM_TRACE_FORMAT_TEXT;
+                }
+                else if (strcmp(optarg, "binary") == 0)
+                {
+                    marss_sim_trace_format = SIM_TRACE_FORMAT_BINARY;
+                }
+                else
+                {
+                    fprintf(stderr, "unknown sim-trace-format type, see help\n");
+                    exit(1);
+                }
+                break;
+            case 17: /* checkpoint */
+                checkpoint_file = optarg;
+                break;
+            case 18: /* restore */
+                restore_file = optarg;
+                break;
+            case 19: /* sim-sample */
+                if (sscanf(optarg, "%" SCNu64 ",%" SCNu64 ",%" SCNu64,
+                           &marss_sample_icount[0], &marss_sample_icount[1],
+                           &marss_sample_icount[2]) != 3 ||
+                    marss_sample_icount[2] == 0) {
+                    fprintf(stderr, "invalid sim-sample, see help\n");
+                    exit(1);
+                }
+                break;
+            case 20: /* sim-profile */
+                marss_do_sim_profile = TRUE;
+                break;
+            case 21: /* sim-epoch */
+                if (sscanf(optarg, "%15[^,],%" SCNu64, marss_epoch_unit,
+                           &marss_epoch_length) != 2 ||
+                    marss_epoch_length == 0 ||
+                    (strcmp(marss_epoch_unit, "cycles") &&
+                     strcmp(marss_epoch_unit, "insns"))) {
+                    fprintf(stderr, "invalid sim-epoch, see help\n");
+                    exit(1);
+                }
+                break;
+            case 22: /* sim-aim-trace */
+                marss_do_aim_trace = TRUE;
+                break;
             default:
                 fprintf(stderr, "unknown option index: %d\n", option_index);
                 exit(1);
@@ -799,7 +916,17 @@ int main(int argc, char **argv)
     p->sim_params->flush_sim_mem_on_simstart = marss_flush_sim_mem_on_simstart;
     p->sim_params->flush_bpu_on_simstart = marss_flush_bpu_on_simstart;
     p->sim_params->do_sim_trace = marss_do_sim_trace;
+    p->sim_params->do_sim_profile = marss_do_sim_profile;
+    p->sim_params->do_aim_trace = marss_do_aim_trace;
+    p->sim_params->sim_epoch_unit = strcmp(marss_epoch_unit, "insns")
+                                        ? SIM_EPOCH_CYCLES
+                                        : SIM_EPOCH_INSNS;
+    p->sim_params->sim_epoch_length = marss_epoch_length;
+    p->sim_params->sim_trace_format = marss_sim_trace_format;
     p->sim_params->sim_emulate_after_icount = marss_sim_emulate_after_icount;
+    p->sim_params->sample_ff_icount = marss_sample_icount[0];
+    p->sim_params->sample_warmup_icount = marss_sample_icount[1];
+    p->sim_params->sample_detail_icount = marss_sample_icount[2];
     p->sim_params->dram_model_type = marss_mem_model;
 
     if (sim_file_path) {
@@ -853,6 +980,10 @@ int main(int argc, char **argv)
     }
     if (accel_enable != -1)
         p->accel_enable = accel_enable;
+    if (checkpoint_file)
+        p->checkpoint_file = strdup(checkpoint_file);
+    if (restore_file)
+        p->restore_file = strdup(restore_file);
     if (cmdline) {
         vm_add_cmdline(p, cmdline);
     }
@@ -150,6 +150,8 @@ struct VIRTIODevice {
                                               is written */
     uint32_t config_space_size; /* in bytes, must be multiple of 4 */
     uint8_t config_space[MAX_CONFIG_SPACE_SIZE];
+    /* optional, saves or restores the device specific state */
+    void (*device_checkpoint)(VIRTIODevice *s, Checkpoint *ck);
 };
 
 static uint32_t virtio_mmio_read(void *opaque, uint32_t offset1, int size_log2);
@@ -970,6 +972,23 @@ void virtio_set_debug(VIRTIODevice *s, int debug)
     s->debug = debug;
 }
 
+/* the guest visible state of the transport. The device is restored in a
+   machine built with the same configuration, so the device type and the
+   host side (files, network, console) are not saved. */
+void virtio_checkpoint(VIRTIODevice *s, Checkpoint *ck)
+{
+    checkpoint_section(ck, "virtio");
+    checkpoint_check_u64(ck, s->device_id);
+    checkpoint_field(ck, s, int_status);
+    checkpoint_field(ck, s, status);
+    checkpoint_field(ck, s, device_features_sel);
+    checkpoint_field(ck, s, queue_sel);
+    checkpoint_field(ck, s, queue);
+    checkpoint_field(ck, s, config_space);
+    if (s->device_checkpoint)
+        s->device_checkpoint(s, ck);
+}
+
 static void virtio_config_change_notify(VIRTIODevice *s)
 {
     /* INT_CONFIG interrupt */
@@ -1114,6 +1133,21 @@ static int virtio_block_recv_request(VIRTIODevice *s, int queue_idx,
     return 0;
 }
 
+static void virtio_block_checkpoint(VIRTIODevice *s1, Checkpoint *ck)
+{
+    VIRTIOBlockDevice *s = (VIRTIOBlockDevice *)s1;
+
+    /* the request buffers are host memory */
+    if (s->req_in_progress) {
+        fprintf(stderr, "virtio_block: cannot checkpoint with a request in progress\n");
+        ck->error = TRUE;
+        return;
+    }
+    checkpoint_check_u64(ck, s->bs->checkpoint != NULL);
+    if (s->bs->checkpoint)
+        s->bs->checkpoint(s->bs, ck);
+}
+
 VIRTIODevice *virtio_block_init(VIRTIOBusDef *bus, BlockDevice *bs)
 {
     VIRTIOBlockDevice *s;
@@ -1123,6 +1157,7 @@ VIRTIODevice *virtio_block_init(VIRTIOBusDef *bus, BlockDevice *bs)
     virtio_init(&s->common, bus,
                 2, 8, virtio_block_recv_request);
     s->bs = bs;
+    s->common.device_checkpoint = virtio_block_checkpoint;
     
     nb_sectors = bs->get_sector_count(bs);
     put_le32(s->common.config_space, nb_sectors);
@@ -1629,6 +1664,13 @@ static void virtio_input_config_write(VIRTIODevice *s)
     }
 }
 
+static void virtio_input_checkpoint(VIRTIODevice *s1, Checkpoint *ck)
+{
+    VIRTIOInputDevice *s = (VIRTIOInputDevice *)s1;
+
+    checkpoint_field(ck, s, buttons_state);
+}
+
 VIRTIODevice *virtio_input_init(VIRTIOBusDef *bus, VirtioInputTypeEnum type)
 {
     VIRTIOInputDevice *s;
@@ -1639,6 +1681,7 @@ VIRTIODevice *virtio_input_init(VIRTIOBusDef *bus, VirtioInputTypeEnum type)
     s->common.queue[0].manual_recv = TRUE;
     s->common.device_features = 0;
     s->common.config_write = virtio_input_config_write;
+    s->common.device_checkpoint = virtio_input_checkpoint;
     s->type = type;
     return (VIRTIODevice *)s;
 }
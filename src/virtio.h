@@ -58,6 +58,7 @@ typedef struct VIRTIODevice VIRTIODevice;
 #define VIRTIO_DEBUG_9P (1 << 1)
 
 void virtio_set_debug(VIRTIODevice *s, int debug_flags);
+void virtio_checkpoint(VIRTIODevice *s, Checkpoint *ck);
 
 /* block device */
 
@@ -73,6 +74,9 @@ struct BlockDevice {
     int (*write_async)(BlockDevice *bs,
                        uint64_t sector_num, const uint8_t *buf, int n,
                        BlockDeviceCompletionFunc *cb, void *opaque);
+    /* optional, saves or restores the sectors which are not written to
+       the backing store */
+    void (*checkpoint)(BlockDevice *bs, Checkpoint *ck);
     void *opaque;
 };
 
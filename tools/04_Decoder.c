@@ -1,6 +1,16 @@
 #include "pim_function.h"
 #include "function.h"
 
+// Simulation regions of the decoder layer
+enum {
+    REGION_QKV = 1,
+    REGION_SCORING,
+    REGION_SOFTMAX,
+    REGION_WEIGHTED_SUM,
+    REGION_OUTPUT_PROJ,
+    REGION_FFN,
+};
+
 int main()
 {
 #if TRACE_MODE
@@ -64,6 +74,7 @@ int main()
     SIM_START();
 #endif
 
+    SIM_REGION_BEGIN(REGION_QKV);
     // RMS Norm
     rmsnorm(X, Y, 1e-6f);
     // QKV Generation
@@ -79,30 +90,40 @@ int main()
     int token_idx = 128;
     PIMupdateKV(manager, pim_K, K, batch, token_idx, kv_heads, seq_len, hidden_dim/q_heads, 1);
     PIMupdateKV(manager, pim_V, V, batch, token_idx, kv_heads, seq_len, hidden_dim/q_heads, 0);
+    SIM_REGION_END(REGION_QKV);
 
     // GQA Scoring
+    SIM_REGION_BEGIN(REGION_SCORING);
     if(!PIMgemv(manager, pim_Q, pim_K, S, batch, q_heads, kv_heads, hidden_dim/q_heads, seq_len)){
         printf("PIMgemv failed!\n");
         return -1;
     }
+    SIM_REGION_END(REGION_SCORING);
 
     // Softmax
+    SIM_REGION_BEGIN(REGION_SOFTMAX);
     softmax(S, seq_len, A);
+    SIM_REGION_END(REGION_SOFTMAX);
 
     // Weighted Sum
+    SIM_REGION_BEGIN(REGION_WEIGHTED_SUM);
     PIMmemcpy(manager, pim_A, A, pim_A->size);
     if(!PIMgemv(manager, pim_A, pim_V, O, batch, q_heads, kv_heads, seq_len, hidden_dim/q_heads)){
         printf("PIMgemv failed!\n");
         return -1;
     }
+    SIM_REGION_END(REGION_WEIGHTED_SUM);
 
     // Output Projection
+    SIM_REGION_BEGIN(REGION_OUTPUT_PROJ);
     output_projection(O, weight_O, O);
 
     // Residual
     residual_add_inplace(X, O);
+    SIM_REGION_END(REGION_OUTPUT_PROJ);
 
     // RMS Norm
+    SIM_REGION_BEGIN(REGION_FFN);
     rmsnorm(X, Y2, 1e-5f);
     
     // Up Projection
@@ -116,6 +137,7 @@ int main()
 
     // Residual
     residual_add_inplace(X, D);
+    SIM_REGION_END(REGION_FFN);
 
 #if PIM_SIM
     SIM_STOP();
@@ -3,134 +3,212 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include "def.h"
+#include "../src/riscvsim/memory_hierarchy/aim_trace_format.h"
 
-// Debug AiM assembly functions
+// Trace of the AiM commands and PIM writes of the host library, in the
+// AiMulator request trace format which sim-aim-replay runs against an
+// AiMulator configuration. The trace is written to $AIM_TRACE_FILE, or to
+// AIM_TRACE_DEFAULT_FILE, and closed at exit.
+//
+// The host library has no timing: the records have no clock delay and no
+// dependency, so sim-aim-replay sends them in order as fast as AiMulator
+// accepts them.
+
+#define AIM_TRACE_DEFAULT_FILE "aim_host.aimtrace"
+#define AIM_TRACE_BUF_SIZE (1 << 20)
+
+// Requests in flight, same as the default max_inflight_requests of the
+// simulator, sim-aim-replay -n overrides it
+#define AIM_TRACE_MAX_INFLIGHT 1
+
+// Request types, same as MemAccessType in the simulator
+enum {
+    AIM_TRACE_WR = 0x1,
+    AIM_TRACE_MAC_SBK = 0x2,
+    AIM_TRACE_AF_SBK = 0x3,
+    AIM_TRACE_COPY_BKGB = 0x4,
+    AIM_TRACE_COPY_GBBK = 0x5,
+    AIM_TRACE_MAC_4BK_INTRA_BG = 0x6,
+    AIM_TRACE_AF_4BK_INTRA_BG = 0x7,
+    AIM_TRACE_EWMUL = 0x8,
+    AIM_TRACE_EWADD = 0x9,
+    AIM_TRACE_MAC_ABK = 0xa,
+    AIM_TRACE_AF_ABK = 0xb,
+    AIM_TRACE_WR_AFLUT = 0xc,
+    AIM_TRACE_WR_BK = 0xd,
+    AIM_TRACE_WR_GB = 0xe,
+    AIM_TRACE_WR_MAC = 0xf,
+    AIM_TRACE_WR_BIAS = 0x10,
+    AIM_TRACE_RD_MAC = 0x11,
+    AIM_TRACE_RD_AF = 0x12,
+};
+
+static FILE *aim_trace_fp;
+static char aim_trace_buf[AIM_TRACE_BUF_SIZE];
+static uint64_t aim_trace_prev_addr;
+
+static void aim_trace_close(void)
+{
+    fclose(aim_trace_fp);
+    aim_trace_fp = NULL;
+}
+
+static void aim_trace_open(void)
+{
+    AimTraceFileHeader h = {{0}};
+    const char *filename = getenv("AIM_TRACE_FILE");
+
+    if (!filename)
+        filename = AIM_TRACE_DEFAULT_FILE;
+
+    aim_trace_fp = fopen(filename, "wb");
+    if (!aim_trace_fp) {
+        perror(filename);
+        exit(1);
+    }
+    setvbuf(aim_trace_fp, aim_trace_buf, _IOFBF, AIM_TRACE_BUF_SIZE);
+
+    memcpy(h.magic, AIM_TRACE_MAGIC, sizeof(h.magic));
+    h.version = AIM_TRACE_VERSION;
+    h.max_inflight_requests = AIM_TRACE_MAX_INFLIGHT;
+    h.aim_batch_size = 1;
+    fwrite(&h, sizeof(h), 1, aim_trace_fp);
+
+    atexit(aim_trace_close);
+}
+
+// Appends one request, offset is the address from addr_gen()
+static void aim_trace_emit(int type, uint64_t offset, int bytes)
+{
+    uint8_t buf[64];
+    uint8_t *p = buf;
+
+    if (!aim_trace_fp)
+        aim_trace_open();
+
+    *p++ = (uint8_t)type;
+    p = sim_trace_put_varint(p, 0); // clock delta
+    p = sim_trace_put_varint(p, 0); // no dependency
+    p = sim_trace_put_varint(p, 1); // one entry
+    if (type == AIM_TRACE_WR)
+        p = sim_trace_put_varint(p, bytes);
+    p = sim_trace_put_varint(p, sim_trace_zigzag_encode((int64_t)(offset - aim_trace_prev_addr)));
+    aim_trace_prev_addr = offset;
+
+    fwrite(buf, 1, p - buf, aim_trace_fp);
+}
+
+/* PIM write of bytes at offset, from PIMmemcpy() and PIMupdateKV() */
+void aim_trace_write(uint64_t offset, int bytes)
+{
+    aim_trace_emit(AIM_TRACE_WR, offset, bytes);
+}
 
 /* AiM: RD_AF  (LOAD_MASK, funct3=7) */
 uint16_t aim_rd_af(const void *base, uint64_t offset)
 {
-    uint16_t value;
-    const char *addr = (const char *)base + offset;
-
-    printf("aim_rd_af %lx\n", offset);
-    return value;
+    aim_trace_emit(AIM_TRACE_RD_AF, offset, 0);
+    return 0;
 }
 
 /* AIM_MAC_SBK  (STORE_MASK, funct3 = 4) */
 void aim_mac_sbk(void *base, uint64_t offset)
 {
-    char *addr = (char *)base + offset;
-    
-    printf("aim_mac_sbk %lx\n", offset);
+    aim_trace_emit(AIM_TRACE_MAC_SBK, offset, 0);
 }
 
 /* AIM_AF_SBK   (STORE_MASK, funct3 = 5) */
 void aim_af_sbk(void *base, uint64_t offset)
 {
-    char *addr = (char *)base + offset;
-    printf("aim_af_sbk %lx\n", offset);
+    aim_trace_emit(AIM_TRACE_AF_SBK, offset, 0);
 }
 
 /* AIM_COPY_BKGB (STORE_MASK, funct3 = 6) */
 void aim_copy_bkgb(void *base, uint64_t offset)
 {
-    char *addr = (char *)base + offset;
-    printf("aim_copy_bkgb %lx\n", offset);
+    aim_trace_emit(AIM_TRACE_COPY_BKGB, offset, 0);
 }
 
 /* AIM_COPY_GBBK (STORE_MASK, funct3 = 7) */
 void aim_copy_gbbk(void *base, uint64_t offset)
 {
-    char *addr = (char *)base + offset;
-    printf("aim_copy_gbbk %lx\n", offset);
+    aim_trace_emit(AIM_TRACE_COPY_GBBK, offset, 0);
 }
 
 /* AiM: RD_MAC  (FLOAD_MASK, funct3 = 7) */
 uint16_t aim_rd_mac(const void *base, uint64_t offset)
 {
-    uint16_t value;
-    const char *addr = (const char *)base + offset;
-
-    printf("aim_rd_mac %lx\n", offset);
-    return value;
+    aim_trace_emit(AIM_TRACE_RD_MAC, offset, 0);
+    return 0;
 }
 
 /* AIM_WR_GB (FLOAD_MASK, funct3 = 4) */
 void aim_wr_gb(void *base, uint64_t offset)
 {
-    char *addr = (char *)base + offset;
-    printf("aim_wr_gb %lx\n", offset);
+    aim_trace_emit(AIM_TRACE_WR_GB, offset, 0);
 }
 
 /* AIM_WR_MAC (FLOAD_MASK, funct3 = 5) */
 void aim_wr_mac(void *base, uint64_t offset)
 {
-    char *addr = (char *)base + offset;
-    printf("aim_wr_mac %lx\n", offset);
+    aim_trace_emit(AIM_TRACE_WR_MAC, offset, 0);
 }
 
 /* AIM_WR_BIAS (FLOAD_MASK, funct3 = 6) */
 void aim_wr_bias(void *base, uint64_t offset)
 {
-    char *addr = (char *)base + offset;
-    printf("aim_wr_bias %lx\n", offset);
+    aim_trace_emit(AIM_TRACE_WR_BIAS, offset, 0);
 }
 
 /* AIM_MAC_4BK_INTRA_BG (AIM_CUSTOM_1_MASK, funct3 = 0) */
 void aim_mac_4bk_intra_bg(void *base, uint64_t offset)
 {
-    char *addr = (char *)base + offset;
-    printf("aim_mac_4bk_intra_bg %lx\n", offset);
+    aim_trace_emit(AIM_TRACE_MAC_4BK_INTRA_BG, offset, 0);
 }
 
 /* AIM_AF_4BK_INTRA_BG (AIM_CUSTOM_1_MASK, funct3 = 1) */
 void aim_af_4bk_intra_bg(void *base, uint64_t offset)
 {
-    char *addr = (char *)base + offset;
-    printf("aim_af_4bk_intra_bg %lx\n", offset);
+    aim_trace_emit(AIM_TRACE_AF_4BK_INTRA_BG, offset, 0);
 }
 
 /* AIM_EWMUL (AIM_CUSTOM_1_MASK, funct3 = 2) */
 void aim_ewmul(void *base, uint64_t offset)
 {
-    char *addr = (char *)base + offset;
-    printf("aim_ewmul %lx\n", offset);
+    aim_trace_emit(AIM_TRACE_EWMUL, offset, 0);
 }
 
 /* AIM_EWADD (AIM_CUSTOM_1_MASK, funct3 = 3) */
 void aim_ewadd(void *base, uint64_t offset)
 {
-    char *addr = (char *)base + offset;
-    printf("aim_ewadd %lx\n", offset);
+    aim_trace_emit(AIM_TRACE_EWADD, offset, 0);
 }
 
 /* AIM_MAC_ABK (AIM_CUSTOM_1_MASK, funct3 = 4) */
 void aim_mac_abk(void *base, uint64_t offset)
 {
-    char *addr = (char *)base + offset;
-    printf("aim_mac_abk %lx\n", offset);
+    aim_trace_emit(AIM_TRACE_MAC_ABK, offset, 0);
 }
 
 /* AIM_AF_ABK (AIM_CUSTOM_1_MASK, funct3 = 5) */
 void aim_af_abk(void *base, uint64_t offset)
 {
-    char *addr = (char *)base + offset;
-    printf("aim_af_abk %lx\n", offset);
+    aim_trace_emit(AIM_TRACE_AF_ABK, offset, 0);
 }
 
 /* AIM_WR_AFLUT (AIM_CUSTOM_1_MASK, funct3 = 6) */
 void aim_wr_aflut(void *base, uint64_t offset)
 {
-    char *addr = (char *)base + offset;
-    printf("aim_wr_aflut %lx\n", offset);
+    aim_trace_emit(AIM_TRACE_WR_AFLUT, offset, 0);
 }
 
 /* AIM_WR_BK (AIM_CUSTOM_1_MASK, funct3 = 7) */
 void aim_wr_bk(void *base, uint64_t offset)
 {
-    char *addr = (char *)base + offset;
-    printf("aim_wr_bk %lx\n", offset);
+    aim_trace_emit(AIM_TRACE_WR_BK, offset, 0);
 }
 
-#endif // AIM_TEST_H
\ No newline at end of file
+#endif // AIM_TEST_H
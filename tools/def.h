@@ -52,4 +52,14 @@
 #define SIM_START() asm("csrs 0x800,zero")
 #define SIM_STOP() asm("csrs 0x801,zero")
 
+// Regions timed separately within one simulation run, see the region summary
+// at the end of the simulation log.
+#if PIM_SIM
+#define SIM_REGION_BEGIN(id) asm volatile("csrw 0x802,%0" : : "r"((unsigned long)(id)))
+#define SIM_REGION_END(id) asm volatile("csrw 0x803,%0" : : "r"((unsigned long)(id)))
+#else
+#define SIM_REGION_BEGIN(id)
+#define SIM_REGION_END(id)
+#endif
+
 #endif /* DEF_H */
\ No newline at end of file
@@ -131,7 +131,7 @@ int PIMmemcpy(PIM_MANAGER *manager, PIM_BUFFER *pimbf, uint16_t *hostData, int h
                         uint64_t addr = addr_gen(ch, 0, bg, bk, row, col);
 
 #if TRACE_MODE
-                        printf("Addr ch: %d, bg: %d, bk: %d, row: %d, col: %d\n", ch, bg, bk, row, col);
+                        aim_trace_write(addr, WORD_SIZE * sizeof(uint16_t));
 #else
                         for(int offset = 0; offset < WORD_SIZE; offset++){
                             uint64_t byte_offset = addr + offset * sizeof(uint16_t);
@@ -161,7 +161,7 @@ int PIMmemcpy(PIM_MANAGER *manager, PIM_BUFFER *pimbf, uint16_t *hostData, int h
                     uint64_t addr = addr_gen(ch, 0, bg, bk, row, col);
 
 #if TRACE_MODE
-                    printf("Addr ch: %d, bg: %d, bk: %d, row: %d, col: %d\n", ch, bg, bk, row, col);
+                    aim_trace_write(addr, WORD_SIZE * sizeof(uint16_t));
 #else
                     for(int offset = 0; offset < WORD_SIZE; offset++){
                         uint64_t byte_offset = addr + offset * sizeof(uint16_t);
@@ -185,7 +185,7 @@ int PIMmemcpy(PIM_MANAGER *manager, PIM_BUFFER *pimbf, uint16_t *hostData, int h
 
                 uint64_t addr = addr_gen(ch, 0, 0, 0, row, col);
 #if TRACE_MODE
-                printf("Addr ch: %d, bg: %d, bk: %d, row: %d, col: %d\n", ch, 0, 0, row, col);
+                aim_trace_write(addr, WORD_SIZE * sizeof(uint16_t));
 #else
                 for(int offset = 0; offset < WORD_SIZE; offset++){
                     uint64_t byte_offset = addr + offset * sizeof(uint16_t);
@@ -369,7 +369,8 @@ int PIMupdate(PIM_MANAGER *manager, PIM_BUFFER *pimbf, uint16_t *new_vec,
             uint64_t addr = addr_gen(ch, 0, bg, bk, row, col);
 
 #if TRACE_MODE
-            printf("Addr ch: %d, bg: %d, bk: %d, row: %d, col: %d\n", ch, bg, bk, row, col);
+            int n = (h_dim - d < WORD_SIZE) ? h_dim - d : WORD_SIZE;
+            aim_trace_write(addr, n * sizeof(uint16_t));
 #else
             for (int w = 0; w < WORD_SIZE; w++) {
                 if (d + w >= h_dim) break;
@@ -405,7 +406,7 @@ int PIMupdate(PIM_MANAGER *manager, PIM_BUFFER *pimbf, uint16_t *new_vec,
 
             uint64_t addr = addr_gen(ch, 0, bg, bk, row, col);
 #if TRACE_MODE
-            printf("Addr ch: %d, bg: %d, bk: %d, row: %d, col: %d\n", ch, bg, bk, row, col);
+            aim_trace_write(addr + word_internal_offset * sizeof(uint16_t), sizeof(uint16_t));
 #else
             uint64_t byte_offset = addr + word_internal_offset * sizeof(uint16_t);
             volatile uint16_t *dst = (volatile uint16_t *)((volatile uint8_t *)manager->pim_base + byte_offset);